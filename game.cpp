@@ -6,6 +6,7 @@
 #include <cerrno> // n.b., needed on Linux at least
 
 #include <stdexcept> // needed for Android at least
+#include <algorithm>
 
 #ifdef _WIN32
 #include <io.h> // for access
@@ -50,8 +51,6 @@ const bool default_pref_music_on_c = true;
 const bool default_pref_disallow_nukes_c = false;
 
 Game::Game() {
-	TrackedObject::initialise();
-
 	scale_factor_w = 1.0f;
 	scale_factor_h = 1.0f;
 	scale_width = 0.0f;
@@ -70,6 +69,8 @@ Game::Game() {
 #endif
 	using_old_gfx = false;
 	is_testing = false;
+	is_headless = false;
+	standin_player = -1;
 
 	application = NULL;
 	screen = NULL;
@@ -80,12 +81,16 @@ Game::Game() {
 
 	frame_counter = 0;
 	time_rate = 1;
+	skip_to_events = false;
 	real_time = 0;
 	real_loop_time = 0;
 	game_time = 0;
 	loop_time = 0;
 	accumulated_time = 0.0f;
 	mouseTime = -1;
+	setRandomSeed(0);
+	worker_pool = NULL;
+	profiler = NULL;
 
 	pref_sound_on = default_pref_sound_on_c;
 	pref_music_on = default_pref_music_on_c;
@@ -111,6 +116,7 @@ Game::Game() {
 		}
 	}
 	map = NULL;
+	resetAllAlliances(); // n.b., after setting map, and game_g isn't yet this game when run on another thread
 	n_men_store = 0;
 	n_player_suspended = 0;
 
@@ -310,14 +316,7 @@ Game::Game() {
 
 	music = NULL;
 
-	for(int i=0;i<n_epochs_c;i++) {
-		invention_shields[i] = NULL;
-		invention_defences[i] = NULL;
-		invention_weapons[i] = NULL;
-	}
-	for(int i=0;i<N_ID;i++) {
-		elements[i] = NULL;
-	}
+	// n.b., inventions and elements are shared between games, so aren't reset here
 	for(int i=0;i<n_players_c;i++) {
 		players[i] = NULL;
 	}
@@ -349,23 +348,34 @@ Game::~Game() {
 		delete screen;
 		screen = NULL;
 	}
-	LOG("clean up tracked objects\n");
-	TrackedObject::cleanup();
+	if( worker_pool != NULL ) {
+		LOG("delete worker pool\n");
+		delete worker_pool;
+		worker_pool = NULL;
+	}
+	if( profiler != NULL ) {
+		LOG("delete profiler\n");
+		delete profiler;
+		profiler = NULL;
+	}
+	// the images, samples and music that this game loaded; n.b., the application, sound system and anything
+	// else shared by the games in the process are freed by playGame()
+	LOG("free tracked objects\n");
+	TrackedObject::flushGame(this);
 	// no longer need to stop music, as it's deleted as a TrackedObject
 	//stopMusic();
-	LOG("free sound\n");
-	freeSound();
-	LOG("delete application %d\n", application);
-	delete application;
-	LOG("exiting...\n");
-	cleanupLogFile();
 }
 
 bool Game::oneMouseButtonMode() const {
 	return onemousebutton || application->isBlankMouse();
 }
 
-Game *game_g = NULL;
+THREAD_LOCAL Game *game_g = NULL;
+
+Invention *Game::invention_shields[n_epochs_c];
+Invention *Game::invention_defences[n_epochs_c];
+Weapon *Game::invention_weapons[n_epochs_c];
+Element *Game::elements[N_ID];
 
 #ifdef WINRT
 const char *maps_dirname = "Assets/islands";
@@ -391,13 +401,13 @@ const char autosave_filename[] = "autosave.sav";
 const char autosave_bad_filename[] = "autosave_bad.sav";
 const char autosave_old_filename[] = "autosave_old.sav";
 const bool autosave_survive_uninstall = false; // important for autosave state to be deleted upon uninstall if possible, so that any problems can be fixed by a reinstall
+const char profiler_trace_filename[] = "profile_trace.json"; // open in chrome://tracing
 
 bool validDifficulty(DifficultyLevel difficulty) {
 	return difficulty >= 0 && difficulty < DIFFICULTY_N_LEVELS;
 }
 
-int Game::getMenPerEpoch() const {
-	ASSERT( gameType == GAMETYPE_ALLISLANDS );
+static int menPerEpoch(DifficultyLevel difficulty_level) {
 	if( difficulty_level == DIFFICULTY_EASY )
 		return 150;
 	else if( difficulty_level == DIFFICULTY_MEDIUM )
@@ -410,6 +420,18 @@ int Game::getMenPerEpoch() const {
 	return 0;
 }
 
+int Game::getMenPerEpoch() const {
+	ASSERT( gameType == GAMETYPE_ALLISLANDS );
+	return menPerEpoch(difficulty_level);
+}
+
+/* The men the stand-in player starts with in headless games: what a human would have for one island,
+ * if they shared the men for the epoch evenly between its islands.
+ */
+int Game::getStandInMen() const {
+	return menPerEpoch(difficulty_level) / max_islands_per_epoch_c;
+}
+
 int Game::getMenAvailable() const {
 	if( start_epoch == end_epoch_c && gameType == GAMETYPE_ALLISLANDS )
 		return n_player_suspended;
@@ -428,7 +450,7 @@ Map *Game::getMap() {
 	return map;
 }
 
-Map::Map(MapColour colour,int n_opponents,const char *name) {
+Map::Map(Game *game, MapColour colour,int n_opponents,const char *name) : game(game) {
 	//*this->filename = '\0';
 	this->colour = colour;
 	this->n_opponents = n_opponents;
@@ -440,6 +462,16 @@ Map::Map(MapColour colour,int n_opponents,const char *name) {
 			//panels[x][y] = NULL;
 		}
 	}
+	this->invalidateReachability();
+	this->island_image = NULL;
+	this->overlay_image = NULL;
+	this->cache_background = NULL;
+	this->cache_offset_x = 0;
+	this->cache_offset_y = 0;
+	this->cache_targets_generation = 0;
+	this->island_image_valid = false;
+	this->overlay_generation = 0;
+	this->overlay_image_generation = -1;
 	/*for(int i=0;i<N_ID;i++) {
 	this->elements[i] = 0;
 	}*/
@@ -451,6 +483,7 @@ Map::Map(MapColour colour,int n_opponents,const char *name) {
 
 Map::~Map() {
 	freeSectors();
+	freeCachedImages();
 }
 
 /*void Map::clearTemp() {
@@ -485,10 +518,11 @@ void Map::newSquareAt(int x,int y) {
 
 void Map::createSectors(PlayingGameState *gamestate, int epoch) {
 	ASSERT_EPOCH(epoch);
+	this->clearIndex(); // new sectors are unowned, with no armies
 	for(int x=0;x<map_width_c;x++) {
 		for(int y=0;y<map_height_c;y++) {
 			if( sector_at[x][y] ) {
-				this->sectors[x][y] = new Sector(gamestate, epoch, x, y, this->getColour());
+				this->sectors[x][y] = new Sector(game, gamestate, epoch, x, y, this->getColour());
 				/*for(int i=0;i<N_ID;i++) {
 				this->sectors[x][y]->setElements(i, this->elements[i]);
 				}*/
@@ -530,10 +564,107 @@ void Map::freeSectors() {
 			}
 		}
 	}
+	while( !economy_events.empty() ) {
+		economy_events.pop();
+	}
+	this->clearIndex();
 	//current_sector = NULL;
     //LOG("Map::freeSectors exit\n");
 }
 
+void Map::clearIndex() {
+	for(int i=0;i<n_players_c;i++) {
+		this->player_sectors[i].clear();
+		this->army_sectors[i].clear();
+	}
+	this->invalidateReachability();
+	this->overlay_generation++;
+}
+
+/** Whether sector a comes before sector b, in the order of a scan over the map.
+ */
+static bool beforeInScan(const Sector *a, const Sector *b) {
+	if( a->getXPos() != b->getXPos() )
+		return a->getXPos() < b->getXPos();
+	return a->getYPos() < b->getYPos();
+}
+
+static void updateIndexList(vector<Sector *> *list, Sector *sector, bool in_list) {
+	vector<Sector *>::iterator iter = std::lower_bound(list->begin(), list->end(), sector, beforeInScan);
+	bool found = iter != list->end() && *iter == sector;
+	if( in_list && !found )
+		list->insert(iter, sector);
+	else if( !in_list && found )
+		list->erase(iter);
+}
+
+/** Brings the index up to date with the sector's owner and armies. Sectors call this (via
+ *  Sector::mapIndexChanged()) whenever these, or whether the sector is nuked, may have changed.
+ */
+void Map::updateIndex(Sector *sector) {
+	ASSERT( this->sectors[sector->getXPos()][sector->getYPos()] == sector );
+	for(int i=0;i<n_players_c;i++) {
+		updateIndexList(&this->player_sectors[i], sector, sector->getPlayer() == i);
+		updateIndexList(&this->army_sectors[i], sector, sector->getArmy(i)->any(true));
+	}
+	// these all affect where armies can move, and what's shown on the map
+	this->invalidateReachability();
+	this->overlay_generation++;
+}
+
+/** Returns the first sector after the supplied one (or the first sector, if after is NULL), in the order of a
+ *  scan over the map, that the player owns or has an army in. Returns NULL if there are none. As this looks at
+ *  the index as it is now, the sectors can be changed in between calls.
+ */
+Sector *Map::nextPlayerSector(int player, const Sector *after) {
+	ASSERT( player >= 0 && player < n_players_c );
+	const vector<Sector *> *lists[2] = {&this->player_sectors[player], &this->army_sectors[player]};
+	Sector *next = NULL;
+	for(int i=0;i<2;i++) {
+		vector<Sector *>::const_iterator iter = after == NULL ? lists[i]->begin() : std::upper_bound(lists[i]->begin(), lists[i]->end(), after, beforeInScan);
+		if( iter != lists[i]->end() && ( next == NULL || beforeInScan(*iter, next) ) )
+			next = *iter;
+	}
+	return next;
+}
+
+void Map::scheduleEconomyEvent(int time, Sector *sector, int generation) {
+	economy_events.push(EconomyEvent(time, sector, generation));
+}
+
+/** Marks all sectors with economy events up to the supplied time as needing processing.
+*/
+void Map::processEconomyEvents(int time) {
+	while( !economy_events.empty() && economy_events.top().time <= time ) {
+		EconomyEvent event = economy_events.top();
+		economy_events.pop();
+		event.sector->economyEvent(event.generation);
+	}
+}
+
+/** Returns the time of the next scheduled economy event, or -1 if there isn't one. This may be an
+ *  event that has since been superseded, so is only a lower bound.
+ */
+int Map::getNextEconomyEventTime() const {
+	if( economy_events.empty() )
+		return -1;
+	return economy_events.top().time;
+}
+
+/** Whether any sector has armies that are fighting, or a nuke on its way, which need resolving in small steps
+ *  rather than being skipped over.
+ */
+bool Map::isFighting() const {
+	for(int x=0;x<map_width_c;x++) {
+		for(int y=0;y<map_height_c;y++) {
+			const Sector *sector = this->sectors[x][y];
+			if( sector != NULL && ( sector->isBeingNuked() || sector->isFighting() ) )
+				return true;
+		}
+	}
+	return false;
+}
+
 /*void Map::setElements(int id,int n_elements) {
 ASSERT_ELEMENT_ID(id);
 this->elements[id] = n_elements;
@@ -541,8 +672,8 @@ this->elements[id] = n_elements;
 
 void Map::findRandomSector(int *rx,int *ry) const {
 	while(true) {
-		int x = rand() % map_width_c;
-		int y = rand() % map_height_c;
+		int x = game->random(RANDOM_SIMULATION) % map_width_c;
+		int y = game->random(RANDOM_SIMULATION) % map_height_c;
 		if( sector_at[x][y] ) {
 			*rx = x;
 			*ry = y;
@@ -551,82 +682,139 @@ void Map::findRandomSector(int *rx,int *ry) const {
 	}
 }
 
-void Map::canMoveTo(bool temp[map_width_c][map_height_c], int sx,int sy,int player) const {
-	ASSERT(player != -1 );
+/** Must be called whenever a sector's owner, armies or nuked status change, or an alliance is made or broken.
+ */
+void Map::invalidateReachability() {
+	for(int i=0;i<n_players_c;i++) {
+		for(int x=0;x<map_width_c;x++) {
+			for(int y=0;y<map_height_c;y++) {
+				this->reachability[i][x][y].valid = false;
+			}
+		}
+	}
+}
+
+/** Returns where the player can move to from (sx, sy). An army can move through the starting square, squares
+ *  the player owns, and unowned squares without enemies, but not out of a nuked square. Only to be called from
+ *  the main thread, as the results are cached.
+ */
+const Map::Reachability *Map::getReachability(int sx, int sy, int player) const {
+	ASSERT(player >= 0 && player < n_players_c );
 	ASSERT(this->sector_at[sx][sy]);
-	//clearTemp();
-	//bool temp[map_width_c][map_height_c];
+	Reachability *reach = &this->reachability[player][sx][sy];
+	if( reach->valid ) {
+		return reach;
+	}
 
 	for(int x=0;x<map_width_c;x++) {
 		for(int y=0;y<map_height_c;y++) {
-			temp[x][y] = false;
+			reach->reachable[x][y] = false;
+			reach->distance[x][y] = -1;
+			reach->parent[x][y] = -1;
+		}
+	}
+
+	int queue[map_width_c*map_height_c];
+	int queue_start = 0, queue_end = 0;
+	reach->reachable[sx][sy] = true;
+	reach->distance[sx][sy] = 0;
+	queue[queue_end++] = sx*map_height_c + sy;
+	while( queue_start < queue_end ) {
+		int square = queue[queue_start++];
+		int x = square / map_height_c;
+		int y = square % map_height_c;
+		const Sector *sector = sectors[x][y];
+		// can we move through this square?
+		if( sector->isNuked() ) {
+			continue;
+		}
+		if( !( ( x == sx && y == sy ) ||
+			sector->getPlayer() == player ||
+			( sector->getPlayer() == -1 && !sector->enemiesPresent(player) ) ) ) {
+			continue;
+		}
+		for(int c=0;c<4;c++) {
+			int cx = x, cy = y;
+			if( c == 0 )
+				cy--;
+			else if( c == 1 )
+				cx++;
+			else if( c == 2 )
+				cy++;
+			else if( c == 3 )
+				cx--;
+			if( cx >= 0 && cy >= 0 && cx < map_width_c && cy < map_height_c
+				&& sector_at[cx][cy]
+				&& !reach->reachable[cx][cy] ) {
+				reach->reachable[cx][cy] = true;
+				reach->distance[cx][cy] = reach->distance[x][y] + 1;
+				reach->parent[cx][cy] = square;
+				queue[queue_end++] = cx*map_height_c + cy;
+			}
+		}
+	}
+	reach->valid = true;
+	return reach;
+}
+
+void Map::canMoveTo(bool temp[map_width_c][map_height_c], int sx,int sy,int player) const {
+	const Reachability *reach = this->getReachability(sx, sy, player);
+	for(int x=0;x<map_width_c;x++) {
+		for(int y=0;y<map_height_c;y++) {
+			temp[x][y] = reach->reachable[x][y];
 		}
 	}
+}
 
-	temp[sx][sy] = true;
-	bool changed = false;
-	do {
-		changed = false;
+bool Map::canMoveTo(int sx, int sy, int tx, int ty, int player) const {
+	ASSERT(tx >= 0 && tx < map_width_c && ty >= 0 && ty < map_height_c);
+	return this->getReachability(sx, sy, player)->reachable[tx][ty];
+}
 
-		for(int x=0;x<map_width_c;x++) {
-			for(int y=0;y<map_height_c;y++) {
-				if( temp[x][y] ) {
-					// can we move through this square?
-					if( ( x == sx && y == sy ) ||
-						sectors[x][y]->getPlayer() == player ||
-						( sectors[x][y]->getPlayer() == -1 &&
-						!sectors[x][y]->enemiesPresent(player) ) ) {
-							for(int c=0;c<4;c++) {
-								int cx = x, cy = y;
-								if( c == 0 )
-									cy--;
-								else if( c == 1 )
-									cx++;
-								else if( c == 2 )
-									cy++;
-								else if( c == 3 )
-									cx--;
-								if( cx >= 0 && cy >= 0 && cx < map_width_c && cy < map_height_c
-									&& sector_at[cx][cy]
-								&& !sectors[x][y]->isNuked()
-									&& !temp[cx][cy] ) {
-										temp[cx][cy] = true;
-										changed = true;
-								}
-							}
-					}
-				}
-			}
-		}
-	} while( changed );
+/** Returns the fewest number of moves for the player to get from (sx, sy) to (tx, ty), or -1 if it can't. If path
+ *  isn't NULL, it's set to the squares along a shortest path, not including the start.
+ */
+int Map::findPath(int sx, int sy, int tx, int ty, int player, vector<Sector *> *path) const {
+	ASSERT(tx >= 0 && tx < map_width_c && ty >= 0 && ty < map_height_c);
+	const Reachability *reach = this->getReachability(sx, sy, player);
+	int distance = reach->distance[tx][ty];
+	if( path != NULL ) {
+		path->clear();
+		if( distance > 0 ) {
+			path->resize(distance);
+			for(int square = tx*map_height_c + ty, i = distance-1;i>=0;i--) {
+				int x = square / map_height_c;
+				int y = square % map_height_c;
+				(*path)[i] = sectors[x][y];
+				square = reach->parent[x][y];
+			}
+		}
+	}
+	return distance;
 }
 
 void Map::calculateStats() const {
 	// deaths = start + births - remaining
 	for(int i=0;i<n_players_c;i++) {
-		if( game_g->players[i] != NULL ) {
-			game_g->players[i]->setNDeaths( game_g->players[i]->getNMenForThisIsland() + game_g->players[i]->getNBirths() );
-			game_g->players[i]->setNSuspended(0);
+		if( game->players[i] != NULL ) {
+			game->players[i]->setNDeaths( game->players[i]->getNMenForThisIsland() + game->players[i]->getNBirths() );
+			game->players[i]->setNSuspended(0);
 		}
 	}
-	for(int x=0;x<map_width_c;x++) {
-		for(int y=0;y<map_height_c;y++) {
-			if( this->sector_at[x][y] ) {
-				Sector *sector = this->sectors[x][y];
-				if( sector->getPlayer() != -1 && game_g->players[sector->getPlayer()] != NULL ) {
-					// check for players[sector->getPlayer()] not being NULL should be redundant, but just to be safe
-					game_g->players[sector->getPlayer()]->addNDeaths( - sector->getPopulation() );
-					if( sector->isShutdown() && game_g->getGameResult() == GAMERESULT_WON ) {
-						game_g->players[sector->getPlayer()]->addNSuspended(sector->getPopulation());
-					}
-				}
-				for(int i=0;i<n_players_c;i++) {
-					if( game_g->players[i] != NULL ) {
-						game_g->players[i]->addNDeaths( - sector->getArmy(i)->getTotalMen() );
-					}
-				}
+	for(int i=0;i<n_players_c;i++) {
+		if( game->players[i] == NULL )
+			continue;
+		for(size_t j=0;j<this->player_sectors[i].size();j++) {
+			const Sector *sector = this->player_sectors[i][j];
+			game->players[i]->addNDeaths( - sector->getPopulation() );
+			if( sector->isShutdown() && game->getGameResult() == GAMERESULT_WON ) {
+				game->players[i]->addNSuspended(sector->getPopulation());
 			}
 		}
+		for(size_t j=0;j<this->army_sectors[i].size();j++) {
+			const Sector *sector = this->army_sectors[i][j];
+			game->players[i]->addNDeaths( - sector->getArmy(i)->getTotalMen() );
+		}
 	}
 	/*for(int i=0;i<n_players_c;i++) {
 	if( players[i] != NULL )
@@ -639,6 +827,7 @@ void Map::saveStateSectors(stringstream &stream) const {
 		for(int y=0;y<map_height_c;y++) {
 			if( this->sector_at[x][y] ) {
 				Sector *sector = this->sectors[x][y];
+				sector->catchUpEconomy();
 				sector->saveState(stream);
 			}
 		}
@@ -662,7 +851,7 @@ int Map::getNSquares() const {
 	return n_squares;
 }
 
-void Map::draw(int offset_x, int offset_y) const {
+void Map::drawIsland(int offset_x, int offset_y) const {
     for(int y=0;y<map_height_c;y++) {
 		for(int x=0;x<map_width_c;x++) {
 			if( this->sector_at[x][y] ) {
@@ -676,41 +865,222 @@ void Map::draw(int offset_x, int offset_y) const {
 				if( x > 0 && this->sector_at[x-1][y] )
 					icon += 8;
 				ASSERT( icon >= 0 && icon < 16 );
-				if( game_g->map_sq[colour][icon] == NULL ) {
+				if( game->map_sq[colour][icon] == NULL ) {
 					LOG("map name: %s\n", this->getName());
 					LOG("ERROR map icon not available [%d,%d]: %d, %d\n", x, y, colour, icon);
-					ASSERT( game_g->map_sq[colour][icon] != NULL );
+					ASSERT( game->map_sq[colour][icon] != NULL );
 				}
-				int map_x = offset_x - game_g->getMapSqOffset() + 16 * x;
-				int map_y = offset_y - game_g->getMapSqOffset() + 16 * y;
-				int coast_map_x = offset_x - game_g->getMapSqCoastOffset() + 16 * x;
-				int coast_map_y = offset_y - game_g->getMapSqCoastOffset() + 16 * y;
+				int map_x = offset_x - game->getMapSqOffset() + 16 * x;
+				int map_y = offset_y - game->getMapSqOffset() + 16 * y;
+				int coast_map_x = offset_x - game->getMapSqCoastOffset() + 16 * x;
+				int coast_map_y = offset_y - game->getMapSqCoastOffset() + 16 * y;
                 //LOG("draw at: %d, %d : %d, %d\n", x, y, map_sq[colour][icon]->getWidth(), map_sq[colour][icon]->getHeight());
-                game_g->map_sq[colour][icon]->draw(map_x, map_y);
+                game->map_sq[colour][icon]->draw(map_x, map_y);
 				//LOG(">>> %d %d %d\n", icon, icon & 1, 4 & 1);
-				if( (icon & 1) == 0 && game_g->coast_icons[0] != NULL )
-					game_g->coast_icons[0]->draw(coast_map_x, coast_map_y);
-				if( (icon & 2) == 0 && game_g->coast_icons[1] != NULL )
-					game_g->coast_icons[1]->draw(coast_map_x, coast_map_y);
-				if( (icon & 4) == 0 && game_g->coast_icons[2] != NULL )
-					game_g->coast_icons[2]->draw(coast_map_x, coast_map_y);
-				if( (icon & 8) == 0 && game_g->coast_icons[3] != NULL )
-					game_g->coast_icons[3]->draw(coast_map_x, coast_map_y);
+				if( (icon & 1) == 0 && game->coast_icons[0] != NULL )
+					game->coast_icons[0]->draw(coast_map_x, coast_map_y);
+				if( (icon & 2) == 0 && game->coast_icons[1] != NULL )
+					game->coast_icons[1]->draw(coast_map_x, coast_map_y);
+				if( (icon & 4) == 0 && game->coast_icons[2] != NULL )
+					game->coast_icons[2]->draw(coast_map_x, coast_map_y);
+				if( (icon & 8) == 0 && game->coast_icons[3] != NULL )
+					game->coast_icons[3]->draw(coast_map_x, coast_map_y);
 
 				// now do corners
-				if( x > 0 && y > 0 && this->sector_at[x-1][y] && this->sector_at[x][y-1] && !this->sector_at[x-1][y-1] && game_g->coast_icons[4] != NULL )
-					game_g->coast_icons[4]->draw(coast_map_x, coast_map_y);
-				if( x < map_width_c-1 && y > 0 && this->sector_at[x+1][y] && this->sector_at[x][y-1] && !this->sector_at[x+1][y-1] && game_g->coast_icons[5] != NULL )
-					game_g->coast_icons[5]->draw(coast_map_x, coast_map_y);
-				if( x > 0 && y < map_height_c-1 && this->sector_at[x-1][y] && this->sector_at[x][y+1] && !this->sector_at[x-1][y+1] && game_g->coast_icons[6] != NULL )
-					game_g->coast_icons[6]->draw(coast_map_x, coast_map_y);
-				if( x < map_width_c-1 && y < map_height_c-1 && this->sector_at[x+1][y] && this->sector_at[x][y+1] && !this->sector_at[x+1][y+1] && game_g->coast_icons[7] != NULL )
-					game_g->coast_icons[7]->draw(coast_map_x, coast_map_y);
+				if( x > 0 && y > 0 && this->sector_at[x-1][y] && this->sector_at[x][y-1] && !this->sector_at[x-1][y-1] && game->coast_icons[4] != NULL )
+					game->coast_icons[4]->draw(coast_map_x, coast_map_y);
+				if( x < map_width_c-1 && y > 0 && this->sector_at[x+1][y] && this->sector_at[x][y-1] && !this->sector_at[x+1][y-1] && game->coast_icons[5] != NULL )
+					game->coast_icons[5]->draw(coast_map_x, coast_map_y);
+				if( x > 0 && y < map_height_c-1 && this->sector_at[x-1][y] && this->sector_at[x][y+1] && !this->sector_at[x-1][y+1] && game->coast_icons[6] != NULL )
+					game->coast_icons[6]->draw(coast_map_x, coast_map_y);
+				if( x < map_width_c-1 && y < map_height_c-1 && this->sector_at[x+1][y] && this->sector_at[x][y+1] && !this->sector_at[x+1][y+1] && game->coast_icons[7] != NULL )
+					game->coast_icons[7]->draw(coast_map_x, coast_map_y);
 			}
 		}
 	}
 }
 
+/** Draws the towers, nuke holes and armies on the map, which was drawn at (offset_x, offset_y).
+ */
+void Map::drawOverlay(int offset_x, int offset_y) const {
+	for(int y=0;y<map_height_c;y++) {
+		for(int x=0;x<map_width_c;x++) {
+			const Sector *sector = this->sectors[x][y];
+			if( sector != NULL ) {
+				int map_x = offset_x + 16 * x;
+				int map_y = offset_y + 16 * y;
+				if( sector->getPlayer() != -1 ) {
+					game->icon_towers[ sector->getPlayer() ]->draw(map_x + 5, map_y + 5);
+				}
+				else if( sector->isNuked() ) {
+					game->icon_nuke_hole->draw(map_x + 4, map_y + 4);
+				}
+				for(int i=0;i<n_players_c;i++) {
+					const Army *army = sector->getArmy(i);
+					int n_army = army->getTotal();
+					if( n_army > 0 ) {
+						int off_step = 5;
+						int off_step_x = ( i == 0 || i == 2 ) ? -off_step : off_step;
+						int off_step_y = ( i == 0 || i == 1 ) ? -off_step : off_step;
+						game->icon_armies[i]->draw(map_x + 6 + off_step_x, map_y + 6 + off_step_y);
+					}
+				}
+			}
+		}
+	}
+}
+
+/** Extends rect to also cover the image drawn at (x, y). If *empty is true, rect is set to just the image.
+ */
+static void includeImage(Rect2D *rect, bool *empty, const Image *image, int x, int y) {
+	if( image == NULL )
+		return;
+	int right = x + image->getScaledWidth();
+	int bottom = y + image->getScaledHeight();
+	if( *empty ) {
+		rect->set(x, y, right - x, bottom - y);
+		*empty = false;
+		return;
+	}
+	int left = std::min(rect->x, x);
+	int top = std::min(rect->y, y);
+	right = std::max(rect->getRight(), right);
+	bottom = std::max(rect->getBottom(), bottom);
+	rect->set(left, top, right - left, bottom - top);
+}
+
+/** Returns the area that drawIsland() and drawOverlay() can draw to, for the map drawn at (offset_x, offset_y).
+ */
+Rect2D Map::getDrawRect(int offset_x, int offset_y) const {
+	Rect2D rect;
+	bool empty = true;
+	for(int y=0;y<map_height_c;y++) {
+		for(int x=0;x<map_width_c;x++) {
+			if( !this->sector_at[x][y] )
+				continue;
+			int map_x = offset_x + 16 * x;
+			int map_y = offset_y + 16 * y;
+			for(int i=0;i<n_map_sq_c;i++) {
+				includeImage(&rect, &empty, game->map_sq[colour][i], map_x - game->getMapSqOffset(), map_y - game->getMapSqOffset());
+			}
+			for(int i=0;i<8;i++) {
+				includeImage(&rect, &empty, game->coast_icons[i], map_x - game->getMapSqCoastOffset(), map_y - game->getMapSqCoastOffset());
+			}
+			for(int i=0;i<n_players_c;i++) {
+				includeImage(&rect, &empty, game->icon_towers[i], map_x + 5, map_y + 5);
+				includeImage(&rect, &empty, game->icon_armies[i], map_x + 1, map_y + 1);
+				includeImage(&rect, &empty, game->icon_armies[i], map_x + 11, map_y + 11);
+			}
+			includeImage(&rect, &empty, game->icon_nuke_hole, map_x + 4, map_y + 4);
+		}
+	}
+	return rect;
+}
+
+static Map *cached_images_map = NULL; // the map that has cached images, if any
+
+/** Makes sure that island_image holds the island drawn at (offset_x, offset_y) over the supplied background
+ *  (which must be all that's underneath, drawn at (0, 0)). Returns false if the island can't be cached, in
+ *  which case it should be drawn directly.
+ */
+bool Map::prepareIslandImage(int offset_x, int offset_y, const Image *background) {
+	if( this->island_image != NULL && ( this->cache_background != background || this->cache_offset_x != offset_x || this->cache_offset_y != offset_y || this->cache_targets_generation != Image::getRenderTargetsGeneration() ) ) {
+		this->freeCachedImages();
+	}
+	float scale_x = game->getScaleWidth();
+	float scale_y = game->getScaleHeight();
+	if( this->island_image == NULL ) {
+		// the cached images are only drawn exactly as the individual images would be if they line up with whole pixels
+		if( background == NULL || scale_x != (int)scale_x || scale_y != (int)scale_y )
+			return false;
+		Rect2D rect = this->getDrawRect(offset_x, offset_y);
+		if( rect.w <= 0 || rect.h <= 0 )
+			return false;
+		float background_x = rect.x * scale_x / background->getScaleX();
+		float background_y = rect.y * scale_y / background->getScaleY();
+		if( background_x != (int)background_x || background_y != (int)background_y )
+			return false;
+		this->island_image = Image::createRenderTarget((int)(rect.w * scale_x), (int)(rect.h * scale_y));
+		if( this->island_image == NULL )
+			return false;
+		this->island_image->setScale(scale_x, scale_y);
+		if( cached_images_map != NULL && cached_images_map != this ) {
+			cached_images_map->freeCachedImages();
+		}
+		cached_images_map = this;
+		this->cache_background = background;
+		this->cache_offset_x = offset_x;
+		this->cache_offset_y = offset_y;
+		this->cache_rect = rect;
+		this->cache_targets_generation = Image::getRenderTargetsGeneration();
+	}
+	if( !this->island_image_valid ) {
+		if( !this->island_image->setRenderTarget() )
+			return false;
+		game->getScreen()->clear();
+		background->draw((int)(- cache_rect.x * scale_x / background->getScaleX()), (int)(- cache_rect.y * scale_y / background->getScaleY()));
+		this->drawIsland(offset_x - cache_rect.x, offset_y - cache_rect.y);
+		Image::resetRenderTarget();
+		this->island_image_valid = true;
+	}
+	return true;
+}
+
+void Map::freeCachedImages() {
+	delete this->island_image;
+	this->island_image = NULL;
+	delete this->overlay_image;
+	this->overlay_image = NULL;
+	this->island_image_valid = false;
+	this->overlay_image_generation = -1;
+	if( cached_images_map == this ) {
+		cached_images_map = NULL;
+	}
+}
+
+/** Draws the island at (offset_x, offset_y). background is what's underneath it, drawn at (0, 0), and is
+ *  cached along with the island.
+ */
+void Map::draw(int offset_x, int offset_y, const Image *background) {
+	if( this->prepareIslandImage(offset_x, offset_y, background) )
+		this->island_image->draw(cache_rect.x, cache_rect.y);
+	else
+		this->drawIsland(offset_x, offset_y);
+}
+
+/** As draw(), but also draws the towers and armies. These are cached too, and only drawn again when the
+ *  sectors tell us something has changed (see updateIndex()).
+ */
+void Map::drawWithOverlay(int offset_x, int offset_y, const Image *background) {
+	if( !this->prepareIslandImage(offset_x, offset_y, background) ) {
+		this->drawIsland(offset_x, offset_y);
+		this->drawOverlay(offset_x, offset_y);
+		return;
+	}
+	if( this->overlay_image == NULL ) {
+		this->overlay_image = Image::createRenderTarget(this->island_image->getWidth(), this->island_image->getHeight());
+		if( this->overlay_image == NULL ) {
+			this->island_image->draw(cache_rect.x, cache_rect.y);
+			this->drawOverlay(offset_x, offset_y);
+			return;
+		}
+		this->overlay_image->setScale(game->getScaleWidth(), game->getScaleHeight());
+	}
+	if( this->overlay_image_generation != this->overlay_generation ) {
+		if( !this->overlay_image->setRenderTarget() ) {
+			this->island_image->draw(cache_rect.x, cache_rect.y);
+			this->drawOverlay(offset_x, offset_y);
+			return;
+		}
+		game->getScreen()->clear();
+		this->island_image->draw(0, 0);
+		this->drawOverlay(offset_x - cache_rect.x, offset_y - cache_rect.y);
+		Image::resetRenderTarget();
+		this->overlay_image_generation = this->overlay_generation;
+	}
+	this->overlay_image->draw(cache_rect.x, cache_rect.y);
+}
+
 void Game::updatedEpoch() {
 	ASSERT( start_epoch >= 0 && start_epoch < n_epochs_c );
 	n_sub_epochs = 4;
@@ -754,6 +1124,10 @@ void Game::setEpoch(int epoch) {
 }
 
 void Game::drawProgress(int percentage) const {
+	if( screen == NULL ) {
+		// headless
+		return;
+	}
 	const int width = (int)(screen->getWidth() * 0.25f);
 	const int height = (int)(screen->getHeight()/15.0f);
 	const int xpos = (int)(screen->getWidth()*0.5f - width*0.5f);
@@ -1358,7 +1732,9 @@ void Game::calculateScale(const Image *image) {
 	scale_width = ((float)(image->getWidth()))/(float)default_width_c;
 	scale_height = ((float)(image->getHeight()))/(float)default_height_c;
 	LOG("scale width/height of logical resolution = %f X %f\n", scale_width, scale_height);
-	screen->setLogicalSize((int)(scale_width*default_width_c), (int)(scale_height*default_height_c), true);
+	if( screen != NULL ) {
+		screen->setLogicalSize((int)(scale_width*default_width_c), (int)(scale_height*default_height_c), true);
+	}
 #endif
 }
 
@@ -1384,7 +1760,9 @@ bool Game::loadOldImages() {
 	scale_width = 1.0f;
 	scale_height = 1.0f;
 	LOG("scale width/height of logical resolution = %f X %f\n", scale_width, scale_height);
-	screen->setLogicalSize((int)(scale_width*default_width_c), (int)(scale_height*default_height_c), false); // don't smooth, as doesn't look too good with old graphics
+	if( screen != NULL ) {
+		screen->setLogicalSize((int)(scale_width*default_width_c), (int)(scale_height*default_height_c), false);
+	} // don't smooth, as doesn't look too good with old graphics
 #endif
 
 	// nb, still scale if scale_factor==1, as this is a way of converting to 8bit
@@ -2720,6 +3098,19 @@ bool Game::loadImages() {
 	return true;
 }
 
+/** Sets up the inventions, elements and designs, which are shared by every game in the process. Must be
+ *  called before any game is created, and not while games are being run.
+ */
+void Game::setupSharedTables() {
+	if( elements[0] != NULL ) {
+		// already set up, e.g., on Android, where statics aren't reinitialised if the native app restarts
+		return;
+	}
+	setupInventions();
+	setupElements();
+	Design::setupDesigns();
+}
+
 void Game::setupInventions() {
 	/*for(int i=0;i<n_shields_c;i++)
 	invention_shields[i] = new Invention("SHIELD", Invention::SHIELD, start_epoch + i);*/
@@ -2781,7 +3172,7 @@ void Game::cleanupPlayers() {
 	}
 
 	// need to reset alliance flags!
-	Player::resetAllAlliances();
+	this->resetAllAlliances();
 }
 
 void Game::setupPlayers() {
@@ -2797,7 +3188,7 @@ void Game::setupPlayers() {
 	ASSERT( n_opponents+1 <= maps[start_epoch][selected_island]->getNSquares() );
 	int n_free = 4;
 	if( human_player != PLAYER_DEMO ) {
-		players[human_player] = new Player(true, human_player);
+		players[human_player] = new Player(this, true, human_player);
 		n_free--;
 	}
 	else {
@@ -2806,11 +3197,11 @@ void Game::setupPlayers() {
 
 	if( gameMode == GAMEMODE_SINGLEPLAYER ) {
 		for(int i=0;i<n_opponents && n_free > 0;i++) {
-			int indx = rand() % n_free;
+			int indx = random(RANDOM_SIMULATION) % n_free;
 			for(int j=0;j<4;j++) {
 				if( players[j] == NULL ) {
 					if( indx == 0 ) {
-						players[j] = new Player(false, j);
+						players[j] = new Player(this, false, j);
 						n_free--;
 						break;
 					}
@@ -3003,7 +3394,8 @@ bool Game::openScreen(bool fullscreen) {
 bool Game::readMapProcessLine(int *epoch, int *index, Map **l_map, char *line, const int MAX_LINE, const char *filename) {
 	bool ok = true;
 	line[ strlen(line) - 1 ] = '\0'; // trim new line
-	line[ strlen(line) - 1 ] = '\0'; // trim carriage return
+	if( strlen(line) > 0 && line[ strlen(line) - 1 ] == '\r' )
+		line[ strlen(line) - 1 ] = '\0'; // trim carriage return (n.b., files may have been checked out with unix line endings)
 	//LOG("line: %s\n", line);
 	if( *l_map == NULL ) {
 		if( line[0] != '#' ) {
@@ -3086,7 +3478,7 @@ bool Game::readMapProcessLine(int *epoch, int *index, Map **l_map, char *line, c
 			ok = false;
 			return ok;
 		}
-		*l_map = maps[*epoch][*index] = new Map(map_colour, n_opponents, name.c_str());
+		*l_map = maps[*epoch][*index] = new Map(this, map_colour, n_opponents, name.c_str());
 		(*l_map)->setFilename(filename);
 	}
 	else {
@@ -3413,23 +3805,23 @@ void Game::setGameStateID(GameStateID state, GameState *new_gamestate) {
 		gamestate = new_gamestate;
 	}
 	else if( gameStateID == GAMESTATEID_CHOOSEGAMETYPE )
-		gamestate = new ChooseGameTypeGameState(human_player);
+		gamestate = new ChooseGameTypeGameState(this, human_player);
 	else if( gameStateID == GAMESTATEID_CHOOSEDIFFICULTY )
-		gamestate = new ChooseDifficultyGameState(human_player);
+		gamestate = new ChooseDifficultyGameState(this, human_player);
 	else if( gameStateID == GAMESTATEID_CHOOSEPLAYER )
-		gamestate = new ChoosePlayerGameState(human_player);
+		gamestate = new ChoosePlayerGameState(this, human_player);
 	else if( gameStateID == GAMESTATEID_CHOOSETUTORIAL )
-		gamestate = new ChooseTutorialGameState(human_player);
+		gamestate = new ChooseTutorialGameState(this, human_player);
 	else if( gameStateID == GAMESTATEID_PLACEMEN )
-		gamestate = new PlaceMenGameState(human_player);
+		gamestate = new PlaceMenGameState(this, human_player);
 	else if( gameStateID == GAMESTATEID_PLAYING ) {
-		gamestate = new PlayingGameState(human_player);
+		gamestate = new PlayingGameState(this, human_player);
 		int map_x = 0, map_y = 0, n_men = 0;
 		if( gameType == GAMETYPE_TUTORIAL ) {
 			map_x = tutorial->getStartMapX();
 			map_y = tutorial->getStartMapY();
 			n_men = tutorial->getNMen();
-			game_g->players[human_player]->setNMenForThisIsland( n_men ); // need to set this here - for non-tutorial, this is done in PlaceMenGameState::setStartMapPos()
+			this->players[human_player]->setNMenForThisIsland( n_men ); // need to set this here - for non-tutorial, this is done in PlaceMenGameState::setStartMapPos()
 		}
 		else {
 			map_x = static_cast<PlaceMenGameState *>(old_gamestate)->getStartMapX();
@@ -3442,9 +3834,9 @@ void Game::setGameStateID(GameStateID state, GameState *new_gamestate) {
 		}
 	}
 	else if( gameStateID == GAMESTATEID_ENDISLAND )
-		gamestate = new EndIslandGameState(human_player);
+		gamestate = new EndIslandGameState(this, human_player);
 	else if( gameStateID == GAMESTATEID_GAMECOMPLETE )
-		gamestate = new GameCompleteGameState(human_player);
+		gamestate = new GameCompleteGameState(this, human_player);
 	else {
 		ASSERT(false);
 	}
@@ -3503,7 +3895,7 @@ void Game::endIsland() {
 			}
 		}
 		if( n_cpu > 0 ) {
-			int index = rand() % n_cpu;
+			int index = random(RANDOM_COSMETIC) % n_cpu;
 			n_cpu = 0;
 			for(int i=0;i<n_players_c;i++) {
 				if( players[i] != NULL && !players[i]->isDead() && i != human_player ) {
@@ -3662,11 +4054,48 @@ bool Game::isPaused() const {
 	return paused;
 }
 
+void Game::setRandomSeed(unsigned int random_seed) {
+	LOG("set random seed to %u\n", random_seed);
+	this->random_seed = random_seed;
+	for(int i=0;i<N_RANDOM_STREAMS;i++) {
+		randoms[i].seed(random_seed * N_RANDOM_STREAMS + i);
+	}
+}
+
 void Game::setTimeRate(int time_rate) {
 	this->time_rate = time_rate;
+	this->skip_to_events = false;
 	LOG("time_rate = %d\n", time_rate);
 }
 
+/** Cycles from the normal time rates through each fast forward rate, then skipping to events, then
+ *  back to the normal rate.
+ */
+void Game::cycleFastForward() {
+	if( skip_to_events ) {
+		setTimeRate(1);
+	}
+	else if( time_rate >= fast_forward_rates_c[n_fast_forward_rates_c-1] ) {
+		setSkipToEvents(true);
+	}
+	else {
+		for(int i=0;i<n_fast_forward_rates_c;i++) {
+			if( time_rate < fast_forward_rates_c[i] ) {
+				setTimeRate(fast_forward_rates_c[i]);
+				break;
+			}
+		}
+	}
+	if( gameStateID == GAMESTATEID_PLAYING && !isDemo() ) {
+		static_cast<PlayingGameState *>(gamestate)->refreshTimeRate();
+	}
+}
+
+void Game::setSkipToEvents(bool skip_to_events) {
+	this->skip_to_events = skip_to_events;
+	LOG("skip_to_events = %d\n", skip_to_events);
+}
+
 void Game::setRealTime(int real_time) {
 	this->real_time = real_time;
 }
@@ -3706,6 +4135,18 @@ void Game::updateTime(int time) {
 	loop_time = (int)(time * time_ratio_c * time_rate + accumulated_time);
 	accumulated_time = (time * time_ratio_c * time_rate + accumulated_time) - loop_time;
 	//LOG("time %d loop time %d accumulated %f\n", time, loop_time, accumulated_time);
+	if( skip_to_events && time > 0 && gameStateID == GAMESTATEID_PLAYING && map != NULL ) {
+		// jump straight to the next time a sector's economy needs processing
+		int skip = max_event_skip_c;
+		int next_event_time = map->getNextEconomyEventTime();
+		if( next_event_time != -1 )
+			skip = std::min(skip, next_event_time - game_time);
+		if( map->isFighting() ) {
+			// don't resolve a battle or a nuke in one jump
+			skip = std::min(skip, max_combat_step_c);
+		}
+		loop_time = std::max(loop_time, skip);
+	}
 
 	game_time += loop_time;
 	frame_counter = (getRealTime() * time_rate) / ticks_per_frame_c;
@@ -3931,7 +4372,7 @@ GameState *Game::loadStateParseXMLNode(const TiXmlNode *parent) {
 					}
 				}
 				else if( strcmp(element_name, "playing_gamestate") == 0 ) {
-					PlayingGameState *playing_gamestate = new PlayingGameState(human_player);
+					PlayingGameState *playing_gamestate = new PlayingGameState(this, human_player);
 					try {
 						if( map == NULL ) {
 							throw std::runtime_error("playing_gamestate map not yet set");
@@ -4074,7 +4515,7 @@ void Game::mouseClick(int m_x, int m_y, bool m_left, bool m_middle, bool m_right
 	}
 	else {
 		// use getTicks() not getRealTime(), as this function may be called at any occasion (due to mouse click events), so getRealTime() might not yet be updated!
-		unsigned int ticks = game_g->getApplication()->getTicks();
+		unsigned int ticks = this->getApplication()->getTicks();
 		if( ticks - lastmousepress_time >= mousepress_delay ) {
 			//LOG("mouse press: %d, %d\n", lastmousepress_time, ticks);
 			lastmousepress_time = ticks;
@@ -4086,13 +4527,56 @@ void Game::mouseClick(int m_x, int m_y, bool m_left, bool m_middle, bool m_right
 	}
 }
 
+/** Creates the worker threads used for updating sectors. If n_threads is negative, the number is chosen
+ *  from the number of CPUs.
+ */
+void Game::createWorkerPool(int n_threads) {
+	if( n_threads < 0 ) {
+		n_threads = std::min(SDL_GetCPUCount() - 1, max_worker_threads_c);
+		n_threads = std::max(n_threads, 0);
+	}
+	LOG("create worker pool with %d threads\n", n_threads);
+	delete worker_pool;
+	worker_pool = new WorkerPool(n_threads);
+}
+
+/** Starts recording how long each phase of a frame takes, shown on screen and written as a trace with
+ *  writeProfilerTrace().
+ */
+void Game::enableProfiler() {
+	if( profiler == NULL ) {
+		profiler = new Profiler();
+	}
+}
+
+void Game::writeProfilerTrace() const {
+	if( profiler != NULL ) {
+		const char *filename = getApplicationFilename(profiler_trace_filename, false);
+		profiler->writeTrace(filename);
+		delete [] filename;
+	}
+}
+
+struct SectorUpdateTask {
+	Game *game;
+	vector<Sector *> sectors;
+	int client_player;
+};
+
+static void updateSector(void *data, int index) {
+	SectorUpdateTask *task = static_cast<SectorUpdateTask *>(data);
+	game_g = task->game; // this thread is now running this game
+	ProfileScope profile_scope(task->game->getProfiler(), PROFILE_SECTOR_UPDATE);
+	task->sectors[index]->update(task->client_player);
+}
+
 void Game::updateGame() {
-	if( !paused ) {
+	if( !paused && screen != NULL ) {
 		int m_x = 0, m_y = 0;
 		bool m_left = false, m_middle = false, m_right = false;
 		bool m_res = screen->getMouseState(&m_x, &m_y, &m_left, &m_middle, &m_right);
 		/*screen->getMouseCoords(&m_x, &m_y);
-		game_g->getApplication()->getMousePressed(&m_left, &m_middle, &m_right);*/
+		this->getApplication()->getMousePressed(&m_left, &m_middle, &m_right);*/
 		if( m_res ) {
 			mouseClick(m_x, m_y, m_left, m_middle, m_right, false);
 		}
@@ -4104,22 +4588,52 @@ void Game::updateGame() {
 	// update
 	if( !paused ) {
 		if( gameStateID == GAMESTATEID_PLAYING ) {
-			for(int i=0;i<n_players_c;i++) {
-				if( i != human_player && players[i] != NULL )
-					players[i]->doAIUpdate(human_player, static_cast<PlayingGameState *>(gamestate));
+			{
+				ProfileScope profile_scope(profiler, PROFILE_AI);
+				for(int i=0;i<n_players_c;i++) {
+					if( i != human_player && players[i] != NULL )
+						players[i]->doAIUpdate(human_player, static_cast<PlayingGameState *>(gamestate));
+				}
 			}
 			//players[ enemy_player ]->doAIUpdate();
-			gamestate->update();
+			{
+				ProfileScope profile_scope(profiler, PROFILE_GAMESTATE_UPDATE);
+				gamestate->update();
+			}
+			map->processEconomyEvents(game_time);
+			// sectors are updated in parallel; their effects on anything outside the sector are queued, then applied in sector order
+			SectorUpdateTask task;
+			task.game = this;
+			task.client_player = human_player;
 			for(int y=0;y<map_height_c;y++) {
 				for(int x=0;x<map_width_c;x++) {
 					/*if( map->sectors[x][y] != NULL )
 					map->sectors[x][y]->update();*/
 					Sector *sector = map->getSector(x, y);
 					if( sector != NULL ) {
-						sector->update(human_player);
+						sector->setDeferEffects(true);
+						task.sectors.push_back(sector);
 					}
 				}
 			}
+			if( worker_pool != NULL ) {
+				worker_pool->run(updateSector, &task, (int)task.sectors.size());
+			}
+			else {
+				for(size_t i=0;i<task.sectors.size();i++) {
+					updateSector(&task, (int)i);
+				}
+			}
+			// bring the map's index up to date first, as applying effects may look at other sectors (see playerAlive())
+			for(size_t i=0;i<task.sectors.size();i++) {
+				task.sectors[i]->updateMapIndex();
+			}
+			for(size_t i=0;i<task.sectors.size();i++) {
+				Sector *sector = task.sectors[i];
+				sector->applyEffects();
+				sector->setDeferEffects(false);
+				sector->updateParticleSystems();
+			}
 		}
 	}
 
@@ -4166,6 +4680,7 @@ void Game::updateGame() {
 }
 
 void Game::drawGame() const {
+	ProfileScope profile_scope(profiler, PROFILE_DRAW);
 	// we now redraw even when paused, to display paused message
 	gamestate->draw();
 }
@@ -4177,14 +4692,6 @@ const char sound_on_key[] = "sound_on";
 const char music_on_key[] = "music_on";
 const char disallow_nukes_key[] = "disallow_nukes";
 
-bool Game::createApplication() {
-	application = new Application();
-	if( !application->init() ) {
-		return false;
-	}
-	return true;
-}
-
 void Game::loadPrefs() {
 	const char *prefs_fullfilename = getApplicationFilename(prefs_filename, prefs_survive_uninstall);
 	SDL_RWops *prefs_file = SDL_RWFromFile(prefs_fullfilename, "rb");
@@ -4274,7 +4781,7 @@ bool Game::testFindSoldiersBuildingNewTower(const Sector *sector, int *total, in
 	*squares = 0;
 	for(int cx=0;cx<map_width_c && !found;cx++) {
 		for(int cy=0;cy<map_height_c && !found;cy++) {
-			Sector *c_sector = game_g->getMap()->getSector(cx, cy);
+			const Sector *c_sector = this->getMap()->getSector(cx, cy);
 			if( sector != c_sector ) {
 				if( c_sector->getArmy(sector->getPlayer())->any(true) ) {
 					found = true;
@@ -4296,9 +4803,9 @@ bool Game::testFindSoldiersBuildingNewTower(const Sector *sector, int *total, in
 }
 
 void Game::runTests() {
-	game_g->setTesting(true);
+	this->setTesting(true);
 
-	human_player = rand() % 4;
+	human_player = random(RANDOM_SIMULATION) % 4;
 	//human_player = 0;
 	//human_player = 1;
 	map = maps[start_epoch][selected_island];
@@ -4504,7 +5011,7 @@ void Game::runTests() {
 			}
 			// test time with and without sleep for mining:
 			for(int type=0;type<2;type++) {
-				unsigned int time_s = game_g->getApplication()->getTicks();
+				unsigned int time_s = this->getApplication()->getTicks();
 				unsigned int elapsed_time = time_s;
 				int i_mined = 0, i_mined_fraction = 0;
 				start_sector->getElementStocks(&i_mined, &i_mined_fraction, ROCK);
@@ -4512,9 +5019,9 @@ void Game::runTests() {
 				const int n_steps_c = 22; // must not be greater than element_multiplier_c*max_gatherables_stored_c/2
 				for(;;) {
 					if( type == 0 ) {
-						game_g->getApplication()->wait();
+						this->getApplication()->wait();
 					}
-					unsigned int new_time = game_g->getApplication()->getTicks();
+					unsigned int new_time = this->getApplication()->getTicks();
 					updateTime(new_time - elapsed_time);
 					elapsed_time = new_time;
 					updateGame();
@@ -4525,7 +5032,7 @@ void Game::runTests() {
 						break;
 					}
 				}
-				int time = game_g->getApplication()->getTicks() - time_s;
+				int time = this->getApplication()->getTicks() - time_s;
 				int expected_time = (int)(( mine_rate_c * gameticks_per_hour_c * n_steps_c ) / ( element_multiplier_c * n_gatherable_rate_c * time_ratio_c ));
 				int allowed_error = 20;
 				if( abs(time - expected_time) > allowed_error ) {
@@ -4548,7 +5055,7 @@ void Game::runTests() {
 			playingGameState->setNDesigners(sx, sy, 1);
 			// test time with and without sleep for designing:
 			for(int type=0;type<2;type++) {
-				unsigned int time_s = game_g->getApplication()->getTicks();
+				unsigned int time_s = this->getApplication()->getTicks();
 				unsigned int elapsed_time = time_s;
 				int i_halfdays = 0, i_hours = 0;
 				start_sector->inventionTimeLeft(&i_halfdays, &i_hours);
@@ -4556,9 +5063,9 @@ void Game::runTests() {
 				const int n_steps_c = 3;
 				for(;;) {
 					if( type == 0 ) {
-						game_g->getApplication()->wait();
+						this->getApplication()->wait();
 					}
-					unsigned int new_time = game_g->getApplication()->getTicks();
+					unsigned int new_time = this->getApplication()->getTicks();
 					updateTime(new_time - elapsed_time);
 					elapsed_time = new_time;
 					updateGame();
@@ -4569,7 +5076,7 @@ void Game::runTests() {
 						break;
 					}
 				}
-				int time = game_g->getApplication()->getTicks() - time_s;
+				int time = this->getApplication()->getTicks() - time_s;
 				int expected_time = (int)(( gameticks_per_hour_c * n_steps_c ) / time_ratio_c);
 				int allowed_error = 100;
 				if( abs(time - expected_time) > allowed_error ) {
@@ -5170,6 +5677,112 @@ void Game::runTests() {
 	}
 }
 
+const int headless_frame_time_c = 16; // simulate the same step per frame as when running at the normal frame rate
+
+/* Plays an AI-only (demo) game on the given island, without drawing or waiting between frames. Returns the
+ * winning player, or -1 if there was no single winner before max_game_time. If time_rate is 0, the normal
+ * demo time rate is used. The lowest numbered player stands in for the human, starting with the men they
+ * would have at the current difficulty level. If frame_times is non-NULL, the time taken to simulate each
+ * frame is added to it, in microseconds.
+ */
+int Game::runHeadlessGame(int epoch, int island, int max_game_time, int time_rate, bool skip_to_events, vector<int> *frame_times) {
+	LOG("runHeadlessGame(%d, %d)\n", epoch, island);
+	ASSERT( is_headless );
+	real_time = 0;
+	game_time = 0;
+	accumulated_time = 0.0f;
+	setClientPlayer(PLAYER_DEMO);
+	gameType = GAMETYPE_SINGLEISLAND;
+	setCurrentIsand(epoch, island);
+	setGameStateID(GAMESTATEID_PLACEMEN);
+	setupPlayers();
+	standin_player = -1;
+	for(int i=0;i<n_players_c && standin_player == -1;i++) {
+		if( players[i] != NULL )
+			standin_player = i;
+	}
+	int sx = 0, sy = 0;
+	map->findRandomSector(&sx, &sy);
+	static_cast<PlaceMenGameState *>(gamestate)->setStartMapPos(sx, sy); // will automatically switch to playing gamestate
+	updateGame(); // needed to dispose the gamestate
+	ASSERT( gameStateID == GAMESTATEID_PLAYING );
+	if( time_rate > 0 )
+		setTimeRate(time_rate);
+	if( skip_to_events )
+		setSkipToEvents(true);
+
+	int winner = -1;
+	while( gameStateID == GAMESTATEID_PLAYING && getGameTime() < max_game_time ) {
+		if( profiler != NULL )
+			profiler->beginFrame();
+#if SDL_MAJOR_VERSION == 1
+		Uint32 frame_s = SDL_GetTicks();
+#else
+		Uint64 frame_s = SDL_GetPerformanceCounter();
+#endif
+		updateTime(headless_frame_time_c);
+		updateGame();
+		if( frame_times != NULL ) {
+#if SDL_MAJOR_VERSION == 1
+			frame_times->push_back( 1000 * (int)(SDL_GetTicks() - frame_s) );
+#else
+			frame_times->push_back( (int)((1000000 * (SDL_GetPerformanceCounter() - frame_s)) / SDL_GetPerformanceFrequency()) );
+#endif
+		}
+
+		// in demo mode, updateGame() never finishes the game, so check for a winner here
+		int n_alive = 0;
+		for(int i=0;i<n_players_c;i++) {
+			if( players[i] != NULL && !players[i]->isDead() ) {
+				n_alive++;
+				winner = i;
+			}
+		}
+		if( n_alive <= 1 )
+			break;
+		winner = -1;
+	}
+
+	setGameStateID(GAMESTATEID_PLACEMEN); // n.b., deleting the PlayingGameState frees the sectors
+	updateGame(); // needed to dispose the gamestate
+	return winner;
+}
+
+/* Microbenchmark of poisson() on its own, both calculating every probability and using the cache. The calls
+ * are a synthetic mix of the rates used during a 4-player battle, not a measurement of a game frame.
+ */
+static void benchmarkPoisson() {
+	const int n_frames_c = 100000;
+	const int n_soldiers_c = 4 * 50;
+	const int n_armies_c = 4;
+	const int n_calls_c = n_soldiers_c + n_armies_c + 2;
+	const char *names[2] = {"exact", "cached"};
+	int (*functions[2])(int, int) = {poissonExact, poisson};
+	for(int pass=0;pass<2;pass++) {
+		int (*function)(int, int) = functions[pass];
+		int checksum = 0;
+		int time_s = clock();
+		for(int frame=0;frame<n_frames_c;frame++) {
+			int time_interval = 11 + frame % 3; // at 16ms per frame, loop time varies due to rounding
+			for(int i=0;i<n_soldiers_c;i++) {
+				// soldier turns or firing
+				checksum += function(soldier_turn_rate_c, time_interval) & 1;
+			}
+			for(int i=0;i<n_armies_c;i++) {
+				// combat deaths in Sector::doCombat()
+				checksum += function(1000 + 250 * i, time_interval) & 1;
+			}
+			// bombardment
+			checksum += function(2500, time_interval) & 1;
+			// breaking alliances in Player::doAIUpdate()
+			checksum += function(20000, time_interval) & 1;
+		}
+		float time_taken = ((float)(clock() - time_s)) / (float)CLOCKS_PER_SEC;
+		printf("poisson microbenchmark, %s: %f microseconds per %d calls (checksum %d)\n", names[pass], (1.0e6f * time_taken) / n_frames_c, n_calls_c, checksum);
+		LOG("poisson microbenchmark, %s: %f microseconds per %d calls (checksum %d)\n", names[pass], (1.0e6f * time_taken) / n_frames_c, n_calls_c, checksum);
+	}
+}
+
 void Game::copyFile(const char *src, const char *dst) const {
 	SDL_RWops *read_file = SDL_RWFromFile(src, "r");
 	if( read_file == NULL ) {
@@ -5198,10 +5811,115 @@ void Game::copyFile(const char *src, const char *dst) const {
 	delete [] buffer;
 }
 
+const int headless_max_game_time_c = 60 * 60 * 1000; // give up on games that stalemate
+
+/* A headless game for runConcurrentHeadlessGames() to run on its own thread, with its own Game.
+ */
+class HeadlessGameRun {
+public:
+	Application *application;
+	int epoch, island, difficulty;
+	int time_rate;
+	bool skip_to_events;
+	unsigned int seed;
+	bool ok;
+	int winner;
+	int game_time;
+
+	HeadlessGameRun() : application(NULL), epoch(0), island(0), difficulty(DIFFICULTY_EASY), time_rate(0), skip_to_events(false), seed(0), ok(false), winner(-1), game_time(0) {
+	}
+};
+
+static int runHeadlessGameThread(void *data) {
+	HeadlessGameRun *run = static_cast<HeadlessGameRun *>(data);
+	game_g = new Game();
+	game_g->setHeadless(true);
+	game_g->setApplication(run->application);
+	game_g->createWorkerPool(0); // the games are already run in parallel
+	game_g->setRandomSeed(run->seed);
+	run->ok = game_g->loadImages() && game_g->createMaps();
+	if( run->ok ) {
+		game_g->loadSamples(); // n.b., may fail if there are no samples, as with the default install
+		game_g->setDifficultyLevel((DifficultyLevel)run->difficulty);
+		run->winner = game_g->runHeadlessGame(run->epoch, run->island, headless_max_game_time_c, run->time_rate, run->skip_to_events, NULL);
+		run->game_time = game_g->getGameTime();
+	}
+	delete game_g;
+	game_g = NULL;
+	return 0;
+}
+
+static SDL_Thread *createHeadlessGameThread(HeadlessGameRun *run) {
+#if SDL_MAJOR_VERSION == 1
+	return SDL_CreateThread(runHeadlessGameThread, run);
+#else
+	return SDL_CreateThread(runHeadlessGameThread, "game", run);
+#endif
+}
+
+/* Checks that games don't interfere with each other: runs n_games headless games, each on its own thread with
+ * its own Game, first one at a time and then all at once, with seeds run.seed, run.seed+1 and so on, and
+ * compares their outcomes. Returns false if any game has a different outcome when run at the same time as
+ * the others.
+ */
+static bool runConcurrentHeadlessGames(int n_games, const HeadlessGameRun &run) {
+	vector<HeadlessGameRun> solo_runs(n_games, run);
+	vector<HeadlessGameRun> concurrent_runs(n_games, run);
+	for(int i=0;i<n_games;i++) {
+		solo_runs[i].seed = run.seed + i;
+		concurrent_runs[i].seed = run.seed + i;
+		SDL_Thread *thread = createHeadlessGameThread(&solo_runs[i]);
+		if( thread == NULL ) {
+			LOG("failed to create game thread: %s\n", SDL_GetError());
+			return false;
+		}
+		SDL_WaitThread(thread, NULL);
+	}
+	vector<SDL_Thread *> threads;
+	for(int i=0;i<n_games;i++) {
+		SDL_Thread *thread = createHeadlessGameThread(&concurrent_runs[i]);
+		if( thread == NULL ) {
+			LOG("failed to create game thread: %s\n", SDL_GetError());
+			break;
+		}
+		threads.push_back(thread);
+	}
+	for(size_t i=0;i<threads.size();i++) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+
+	bool ok = threads.size() == (size_t)n_games;
+	for(int i=0;i<n_games;i++) {
+		const HeadlessGameRun *solo = &solo_runs[i];
+		const HeadlessGameRun *concurrent = &concurrent_runs[i];
+		bool same = solo->ok && concurrent->ok && solo->winner == concurrent->winner && solo->game_time == concurrent->game_time;
+		printf("epoch %d island %d seed %u: winner %d, game time %d; run alone: winner %d, game time %d%s\n", run.epoch, run.island, concurrent->seed, concurrent->winner, concurrent->game_time, solo->winner, solo->game_time, same ? "" : " - MISMATCH");
+		LOG("epoch %d island %d seed %u: winner %d, game time %d; run alone: winner %d, game time %d%s\n", run.epoch, run.island, concurrent->seed, concurrent->winner, concurrent->game_time, solo->winner, solo->game_time, same ? "" : " - MISMATCH");
+		if( !same )
+			ok = false;
+	}
+	printf("%d concurrent games %s\n", n_games, ok ? "match" : "don't match");
+	return ok;
+}
+
+/* Frees what's shared by every game in the process, once they've all been deleted.
+ */
+static void cleanupProcess(Application *application) {
+	LOG("clean up tracked objects\n");
+	TrackedObject::cleanup();
+	LOG("free sound\n");
+	freeSound();
+	LOG("delete application %d\n", application);
+	delete application;
+	LOG("exiting...\n");
+	cleanupLogFile();
+}
+
 void playGame(int n_args, char *args[]) {
     LOG("playGame()\n");
 
-	Player::resetAllAlliances(); // need to reset for Android, where variables aren't reinitialised if the native app restarts!
+	TrackedObject::initialise();
+	Game::setupSharedTables();
 	game_g = new Game();
 
 #ifdef _DEBUG
@@ -5210,6 +5928,18 @@ void playGame(int n_args, char *args[]) {
 #endif
 
 	bool fullscreen = true;
+	bool headless = false;
+	bool benchmark_poisson = false;
+	int headless_epoch = 0, headless_island = 0;
+	int headless_time_rate = 0;
+	bool headless_skip_to_events = false;
+	int headless_difficulty = DIFFICULTY_EASY;
+	bool headless_csv = false;
+	bool have_seed = false;
+	unsigned int seed = 0;
+	int n_threads = -1;
+	int headless_games = 0;
+	bool profile = false;
 #if defined(__amigaos4__) || defined(AROS) || defined(__MORPHOS__)
 	fullscreen = false; // run in windowed mode due to reported performance problems in fullscreen mode on AmigaOS 4; also randomly hangs on AROS in fullscreen mode; also included MorphOS just to be safe
 #endif
@@ -5236,8 +5966,42 @@ void playGame(int n_args, char *args[]) {
 			game_g->setGameMode(GAMEMODE_MULTIPLAYER_SERVER);
 		else if( strcmp(args[i], "client") == 0 )
 			game_g->setGameMode(GAMEMODE_MULTIPLAYER_CLIENT);
-	}
+		else if( strcmp(args[i], "headless") == 0 )
+			headless = true;
+		else if( strcmp(args[i], "benchmark_poisson") == 0 ) {
+			headless = true;
+			benchmark_poisson = true;
+		}
+		else if( strncmp(args[i], "epoch=", 6) == 0 )
+			headless_epoch = atoi(&args[i][6]);
+		else if( strncmp(args[i], "island=", 7) == 0 )
+			headless_island = atoi(&args[i][7]);
+		else if( strcmp(args[i], "speed=event") == 0 )
+			headless_skip_to_events = true;
+		else if( strncmp(args[i], "speed=", 6) == 0 )
+			headless_time_rate = atoi(&args[i][6]);
+		else if( strncmp(args[i], "difficulty=", 11) == 0 )
+			headless_difficulty = atoi(&args[i][11]);
+		else if( strcmp(args[i], "csv") == 0 )
+			headless_csv = true;
+		else if( strncmp(args[i], "seed=", 5) == 0 ) {
+			have_seed = true;
+			seed = (unsigned int)strtoul(&args[i][5], NULL, 10);
+		}
+		else if( strncmp(args[i], "threads=", 8) == 0 )
+			n_threads = atoi(&args[i][8]);
+		else if( strncmp(args[i], "games=", 6) == 0 )
+			headless_games = atoi(&args[i][6]);
+		else if( strcmp(args[i], "profile") == 0 )
+			profile = true;
+	}
+	game_g->setHeadless(headless);
+	Image::setSizeOnly(headless);
 #endif
+	game_g->createWorkerPool(n_threads);
+	if( profile ) {
+		game_g->enableProfiler();
+	}
 
 #ifdef WINRT
 	// @TODO
@@ -5255,10 +6019,11 @@ void playGame(int n_args, char *args[]) {
 	initLogFile();
 
 	// set random seed - recommended way to do it from http://stackoverflow.com/questions/322938/recommended-way-to-initialize-srand
-	unsigned int seed = (unsigned int)time(NULL);
+	if( !have_seed )
+		seed = (unsigned int)time(NULL);
 	//seed = 72638; // test
-	LOG("set random seed to %d\n", seed);
-	srand( seed );
+	game_g->setRandomSeed(seed);
+	srand( seed ); // still used for generating noise images
 
 	//bool run_tests = true;
 	bool run_tests = false;
@@ -5276,14 +6041,19 @@ void playGame(int n_args, char *args[]) {
 	LOG("onemousebutton?: %d\n", game_g->isOneMouseButton());
 	LOG("mobile_ui?: %d\n", game_g->isMobileUI());
 
-	if( !run_tests ) {
+	if( !run_tests && !headless ) {
 		game_g->loadPrefs();
 	}
 
 	// init application
-	if( !game_g->createApplication() ) {
+	Application *application = new Application();
+	game_g->setApplication(application);
+	if( !application->init() ) {
 		LOG("failed to init application\n");
 	}
+	else if( headless ) {
+		// no sound
+	}
 	// init sound
 	else if( !initSound() ) {
 		// don't fail, just warn
@@ -5293,7 +6063,10 @@ void playGame(int n_args, char *args[]) {
 	LOG("successfully opened libraries\n");
 
 	bool ok = true;
-	if( !game_g->openScreen(fullscreen) ) {
+	if( headless ) {
+		// no screen
+	}
+	else if( !game_g->openScreen(fullscreen) ) {
 		LOG("failed to open screen\n");
 		ok = false;
 
@@ -5322,6 +6095,7 @@ void playGame(int n_args, char *args[]) {
 		LOG("delete game %d\n", game_g);
 		delete game_g;
 		game_g = NULL;
+		cleanupProcess(application);
 		return;
 	}
 
@@ -5334,19 +6108,13 @@ void playGame(int n_args, char *args[]) {
 		MessageBoxA(NULL, "Failed to load all samples", "Warning", MB_OK|MB_ICONEXCLAMATION);
 #endif*/
 	}
-	game_g->drawProgress(85);
-
-	game_g->setupInventions();
-	game_g->drawProgress(87);
-	game_g->setupElements();
-	game_g->drawProgress(89);
-	Design::setupDesigns();
 	game_g->drawProgress(90);
 	if( !game_g->createMaps() ) {
 		LOG("failed to create maps\n");
 		LOG("delete game %d\n", game_g);
 		delete game_g;
 		game_g = NULL;
+		cleanupProcess(application);
 #ifdef WINRT
 		// @TODO
 #elif _WIN32
@@ -5356,22 +6124,33 @@ void playGame(int n_args, char *args[]) {
 	}
 	game_g->drawProgress(95);
 
-	for(size_t i=0;i<TrackedObject::getNumTags();i++) {
-		TrackedObject *to = TrackedObject::getTag(i);
-		if( to != NULL && strcmp( to->getClass(), "CLASS_IMAGE" ) == 0 ) {
-			Image *image = (Image *)to;
-			if( !image->convertToDisplayFormat() ) {
-				LOG("failed to convertToDisplayFormat\n");
-				LOG("delete game %d\n", game_g);
-				delete game_g;
-				game_g = NULL;
+	if( !Image::createAtlas() ) {
+		LOG("failed to create atlas\n");
+		LOG("delete game %d\n", game_g);
+		delete game_g;
+		game_g = NULL;
+		cleanupProcess(application);
 #ifdef WINRT
-				//@TODO
+		//@TODO
 #elif _WIN32
-				MessageBoxA(NULL, "Failed to create texture images", "Error", MB_OK|MB_ICONEXCLAMATION);
+		MessageBoxA(NULL, "Failed to create texture images", "Error", MB_OK|MB_ICONEXCLAMATION);
 #endif
-				return;
-			}
+		return;
+	}
+	for(TrackedObject *to = TrackedObject::getFirstOfClass("CLASS_IMAGE");to != NULL;to = to->getNextOfClass()) {
+		Image *image = (Image *)to;
+		if( !image->convertToDisplayFormat() ) {
+			LOG("failed to convertToDisplayFormat\n");
+			LOG("delete game %d\n", game_g);
+			delete game_g;
+			game_g = NULL;
+			cleanupProcess(application);
+#ifdef WINRT
+			//@TODO
+#elif _WIN32
+			MessageBoxA(NULL, "Failed to create texture images", "Error", MB_OK|MB_ICONEXCLAMATION);
+#endif
+			return;
 		}
 	}
 
@@ -5381,13 +6160,63 @@ void playGame(int n_args, char *args[]) {
 
 	char buffer[256] = "";
 	sprintf(buffer, "Gigalomania, version %d.%d", majorVersion, minorVersion);
-	game_g->getScreen()->setTitle(buffer);
+	if( !headless ) {
+		game_g->getScreen()->setTitle(buffer);
+	}
 
     LOG("all done!\n");
 
 	if( run_tests ) {
 		game_g->runTests();
 	}
+	else if( benchmark_poisson ) {
+		benchmarkPoisson();
+	}
+	else if( headless ) {
+		if( headless_epoch < 0 || headless_epoch >= n_epochs_c || headless_island < 0 || headless_island >= max_islands_per_epoch_c || game_g->getMap(headless_epoch, headless_island) == NULL ) {
+			LOG("invalid island: epoch %d island %d\n", headless_epoch, headless_island);
+		}
+		else if( !validDifficulty((DifficultyLevel)headless_difficulty) ) {
+			LOG("invalid difficulty: %d\n", headless_difficulty);
+		}
+		else if( headless_games > 0 ) {
+			HeadlessGameRun run;
+			run.application = application;
+			run.epoch = headless_epoch;
+			run.island = headless_island;
+			run.difficulty = headless_difficulty;
+			run.time_rate = headless_time_rate;
+			run.skip_to_events = headless_skip_to_events;
+			run.seed = seed;
+			runConcurrentHeadlessGames(headless_games, run);
+		}
+		else {
+			game_g->setDifficultyLevel((DifficultyLevel)headless_difficulty);
+			vector<int> frame_times;
+			int time_s = clock();
+			int winner = game_g->runHeadlessGame(headless_epoch, headless_island, headless_max_game_time_c, headless_time_rate, headless_skip_to_events, &frame_times);
+			float time_taken = ((float)(clock() - time_s)) / (float)CLOCKS_PER_SEC;
+			float frame_mean = 0.0f;
+			int frame_p99 = 0;
+			if( frame_times.size() > 0 ) {
+				double total = 0.0;
+				for(size_t i=0;i<frame_times.size();i++)
+					total += frame_times[i];
+				frame_mean = (float)(total / frame_times.size());
+				std::sort(frame_times.begin(), frame_times.end());
+				frame_p99 = frame_times[(99 * (frame_times.size()-1)) / 100];
+			}
+			if( headless_csv ) {
+				// columns: epoch,island,difficulty,seed,standin,winner,game_time,frames,frame_mean_us,frame_p99_us
+				printf("%d,%d,%d,%u,%d,%d,%d,%d,%f,%d\n", headless_epoch, headless_island, headless_difficulty, seed, game_g->getStandInPlayer(), winner, game_g->getGameTime(), (int)frame_times.size(), frame_mean, frame_p99);
+				fflush(stdout); // so that rows from games run in parallel aren't interleaved
+			}
+			else {
+				printf("epoch %d island %d seed %u: winner %d, game time %d, real time %f\n", headless_epoch, headless_island, seed, winner, game_g->getGameTime(), time_taken);
+			}
+			LOG("epoch %d island %d difficulty %d seed %u: stand-in %d, winner %d, game time %d, real time %f, frames %d, mean frame %f us, p99 frame %d us\n", headless_epoch, headless_island, headless_difficulty, seed, game_g->getStandInPlayer(), winner, game_g->getGameTime(), time_taken, (int)frame_times.size(), frame_mean, frame_p99);
+		}
+	}
 	else {
 		if( !game_g->loadState() ) {
 			game_g->setCurrentMap();
@@ -5398,9 +6227,12 @@ void playGame(int n_args, char *args[]) {
 		game_g->getApplication()->runMainLoop();
 	}
 
+	game_g->writeProfilerTrace();
+
 	LOG("delete game %d\n", game_g);
 	delete game_g;
 	game_g = NULL;
+	cleanupProcess(application);
 }
 
 bool Game::playerAlive(int player) const {
@@ -5417,19 +6249,167 @@ bool Game::playerAlive(int player) const {
 	}
 	}
 	return ( n_player_sectors > 0 || n_army > 0 );*/
-	for(int x=0;x<map_width_c;x++) {
-		for(int y=0;y<map_height_c;y++) {
-			//Sector *sector = map->sectors[x][y];
-			Sector *sector = map->getSector(x, y);
-			if( sector != NULL ) {
-				if( player == sector->getActivePlayer() )
-					return true;
-				else if( sector->getArmy(player)->any(true) )
-					return true;
+	const vector<Sector *> &player_sectors = map->getPlayerSectors(player);
+	for(size_t i=0;i<player_sectors.size();i++) {
+		if( !player_sectors[i]->isShutdown() )
+			return true;
+	}
+	return map->getArmySectors(player).size() > 0;
+}
+
+void Game::saveStateAlliances(stringstream &stream) const {
+	stream << "<player_alliances>\n";
+	for(int i=0;i<n_players_c;i++) {
+		for(int j=i+1;j<n_players_c;j++) {
+			stream << "<player_alliance ";
+			stream << "player_id_i=\"" << i << "\" ";
+			stream << "player_id_j=\"" << j << "\" ";
+			stream << "alliances=\"" << (alliances[i][j] ? 1 : 0) << "\" ";
+			stream << "alliance_last_asked=\"" << alliance_last_asked[i][j] << "\" ";
+			stream << "/>\n";
+		}
+	}
+	stream << "</player_alliances>\n";
+}
+
+void Game::loadStateParseXMLNodeAlliances(const TiXmlNode *parent) {
+	if( parent == NULL ) {
+		return;
+	}
+	bool read_children = true;
+
+	switch( parent->Type() ) {
+		case TiXmlNode::TINYXML_DOCUMENT:
+			break;
+		case TiXmlNode::TINYXML_ELEMENT:
+			{
+				const char *element_name = parent->Value();
+				const TiXmlElement *element = parent->ToElement();
+				const TiXmlAttribute *attribute = element->FirstAttribute();
+				if( strcmp(element_name, "player_alliances") == 0 ) {
+					// handled entirely by caller
+				}
+				else if( strcmp(element_name, "player_alliance") == 0 ) {
+					int player_id_i = -1;
+					int player_id_j = -1;
+					bool alliance = false;
+					int last_asked = -1;
+					while( attribute != NULL ) {
+						const char *attribute_name = attribute->Name();
+						if( strcmp(attribute_name, "player_id_i") == 0 ) {
+							player_id_i = atoi(attribute->Value());
+						}
+						else if( strcmp(attribute_name, "player_id_j") == 0 ) {
+							player_id_j = atoi(attribute->Value());
+						}
+						else if( strcmp(attribute_name, "alliances") == 0 ) {
+							alliance = atoi(attribute->Value())==1;
+						}
+						else if( strcmp(attribute_name, "alliance_last_asked") == 0 ) {
+							last_asked = atoi(attribute->Value());
+						}
+						else {
+							// don't throw an error here, to help backwards compatibility, but should throw an error in debug mode in case this is a sign of not loading something that we've saved
+							LOG("unknown player_alliances/player_alliance attribute: %s\n", attribute_name);
+							ASSERT(false);
+						}
+						attribute = attribute->Next();
+					}
+					if( player_id_i < 0 || player_id_i >= n_players_c ) {
+						throw std::runtime_error("player_alliance invalid player_id_i");
+					}
+					else if( player_id_j < 0 || player_id_j >= n_players_c ) {
+						throw std::runtime_error("player_alliance invalid player_id_j");
+					}
+					alliances[player_id_i][player_id_j] = alliance;
+					alliance_last_asked[player_id_i][player_id_j] = last_asked;
+					if( map != NULL ) {
+						map->invalidateReachability();
+					}
+				}
+				else {
+					// don't throw an error here, to help backwards compatibility, but should throw an error in debug mode in case this is a sign of not loading something that we've saved
+					LOG("unknown player_alliances tag: %s\n", element_name);
+					ASSERT(false);
+				}
 			}
+			break;
+		case TiXmlNode::TINYXML_COMMENT:
+			break;
+		case TiXmlNode::TINYXML_UNKNOWN:
+			break;
+		case TiXmlNode::TINYXML_TEXT:
+			{
+			}
+			break;
+		case TiXmlNode::TINYXML_DECLARATION:
+			break;
+	}
+
+	for(const TiXmlNode *child=parent->FirstChild();child!=NULL && read_children;child=child->NextSibling())  {
+		loadStateParseXMLNodeAlliances(child);
+	}
+}
+
+void Game::setAlliance(int a, int b, bool alliance) {
+	LOG("Alliance %s between players %d and %d\n", alliance?"MADE":"BROKEN", a, b);
+	ASSERT(a != b);
+	ASSERT( this->validPlayer(a) );
+	ASSERT( this->validPlayer(b) );
+	if( a > b ) {
+		int dummy = a;
+		a = b;
+		b = dummy;
+	}
+	alliances[a][b] = alliance;
+	if( map != NULL ) {
+		map->invalidateReachability(); // enemies can block moves
+	}
+}
+
+bool Game::isAlliance(int a, int b) const {
+	ASSERT(a != b);
+	ASSERT( this->validPlayer(a) );
+	ASSERT( this->validPlayer(b) );
+	if( a > b ) {
+		int dummy = a;
+		a = b;
+		b = dummy;
+	}
+	return alliances[a][b];
+}
+
+void Game::resetAllAlliances() {
+	for(int i=0;i<n_players_c;i++) {
+		for(int j=i+1;j<n_players_c;j++) {
+			setAlliance(i, j, false);
+			setAllianceLastAsked(i, j, -1);
 		}
 	}
-	return false;
+}
+
+void Game::setAllianceLastAsked(int a, int b,int time) {
+	ASSERT(a != b);
+	ASSERT( this->validPlayer(a) );
+	ASSERT( this->validPlayer(b) );
+	if( a > b ) {
+		int dummy = a;
+		a = b;
+		b = dummy;
+	}
+	alliance_last_asked[a][b] = time;
+}
+
+int Game::allianceLastAsked(int a, int b) const {
+	ASSERT(a != b);
+	ASSERT( this->validPlayer(a) );
+	ASSERT( this->validPlayer(b) );
+	if( a > b ) {
+		int dummy = a;
+		a = b;
+		b = dummy;
+	}
+	return alliance_last_asked[a][b];
 }
 
 #if defined(__ANDROID__)
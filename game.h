@@ -16,6 +16,7 @@ using std::vector;
 using std::stringstream;
 using std::string;
 
+class Game;
 class Invention;
 class Weapon;
 class Element;
@@ -30,6 +31,7 @@ class Tutorial;
 
 #include "common.h"
 #include "image.h"
+#include "utils.h"
 #include "TinyXML/tinyxml.h"
 
 enum GameStateID {
@@ -60,6 +62,14 @@ enum DifficultyLevel {
 	DIFFICULTY_N_LEVELS = 4
 };
 
+enum RandomStream {
+	// separate streams, so that e.g. cosmetic effects (which depend on what's being displayed) don't change the simulation
+	RANDOM_SIMULATION = 0,
+	RANDOM_AI = 1,
+	RANDOM_COSMETIC = 2,
+	N_RANDOM_STREAMS = 3
+};
+
 enum GameMode {
 	GAMEMODE_SINGLEPLAYER = 0,
 	GAMEMODE_MULTIPLAYER_SERVER = 1,
@@ -111,6 +121,8 @@ class Game {
 	bool mobile_ui;
 	bool using_old_gfx;
 	bool is_testing;
+	bool is_headless;
+	int standin_player; // in headless games, the AI player given the human's men for the difficulty level, or -1
 
 	Application *application;
 	Screen *screen;
@@ -121,6 +133,7 @@ class Game {
 
 	int frame_counter;
 	int time_rate; // time factor
+	bool skip_to_events; // fast forward each frame to the next scheduled economy event
 	int real_time;
 	int real_loop_time;
 	int game_time;
@@ -151,6 +164,13 @@ class Game {
 	int n_men_store;
 	int n_player_suspended;
 
+	unsigned int random_seed;
+	Random randoms[N_RANDOM_STREAMS];
+	WorkerPool *worker_pool; // for updating sectors in parallel
+	Profiler *profiler; // NULL unless profiling
+	bool alliances[n_players_c][n_players_c];
+	int alliance_last_asked[n_players_c][n_players_c];
+
 	void calculateScale(const Image *image);
 	void convertToHiColor(Image *image) const;
 	void processImage(Image *image, bool old_smooth = true) const;
@@ -174,6 +194,8 @@ class Game {
 	void updatedEpoch();
 	void setEpoch(int epoch);
 	void cleanupPlayers();
+	static void setupInventions();
+	static void setupElements();
 public:
 	Image *background;
 	Image *player_heads_select[n_players_c];
@@ -304,12 +326,15 @@ public:
 
 	Sample *music;
 
-	Invention *invention_shields[n_epochs_c];
-	Invention *invention_defences[n_epochs_c];
-	Weapon *invention_weapons[n_epochs_c];
-	Element *elements[N_ID];
+	// read only once set up, so shared by all games in the process
+	static Invention *invention_shields[n_epochs_c];
+	static Invention *invention_defences[n_epochs_c];
+	static Weapon *invention_weapons[n_epochs_c];
+	static Element *elements[N_ID];
 	Player *players[n_players_c];
 
+	static void setupSharedTables();
+
 	Game();
 	~Game();
 
@@ -345,8 +370,34 @@ public:
 	bool isTesting() const {
 		return this->is_testing;
 	}
+	void setRandomSeed(unsigned int random_seed);
+	unsigned int getRandomSeed() const {
+		return this->random_seed;
+	}
+	int random(RandomStream stream) {
+		// returns a value in the range [0, RAND_MAX]
+		return this->randoms[stream].rand();
+	}
+	void setHeadless(bool is_headless) {
+		this->is_headless = is_headless;
+	}
+	void createWorkerPool(int n_threads);
+	void enableProfiler();
+	Profiler *getProfiler() const {
+		return this->profiler;
+	}
+	void writeProfilerTrace() const;
+	bool isHeadless() const {
+		return this->is_headless;
+	}
+	int getStandInPlayer() const {
+		return this->standin_player;
+	}
+	int getStandInMen() const;
 	
-	bool createApplication();
+	void setApplication(Application *application) {
+		this->application = application; // n.b., not owned by the game, as it's shared by every game in the process
+	}
 	Application *getApplication() {
 		return this->application;
 	}
@@ -363,15 +414,20 @@ public:
 	bool isPaused() const;
 
 	void cycleTimeRate() {
+		skip_to_events = false;
 		time_rate++;
 		if( time_rate > 3 )
 			time_rate = 1;
 	}
 	void increaseTimeRate() {
-		if( time_rate > 1 )
+		skip_to_events = false;
+		if( time_rate > 3 )
+			time_rate = 3; // leave fast forward
+		else if( time_rate > 1 )
 			time_rate--;
 	}
 	void decreaseTimeRate() {
+		skip_to_events = false;
 		if( time_rate < 3 )
 			time_rate++;
 	}
@@ -379,6 +435,15 @@ public:
 	int getTimeRate() const {
 		return this->time_rate;
 	}
+	int getTimeRateIcon() const {
+		// fast forward rates share the icon for the fastest normal rate
+		return std::min(time_rate, 3) - 1;
+	}
+	void cycleFastForward();
+	void setSkipToEvents(bool skip_to_events);
+	bool isSkipToEvents() const {
+		return this->skip_to_events;
+	}
 	void setRealTime(int real_time);
 	int getRealTime() const;
 	int getRealLoopTime() const;
@@ -514,14 +579,24 @@ public:
 	void playMusic();
 
 	void setupPlayers();
-	void setupInventions();
-	void setupElements();
 	bool playerAlive(int player) const;
+	void saveStateAlliances(stringstream &stream) const;
+	void loadStateParseXMLNodeAlliances(const TiXmlNode *parent);
+	void setAlliance(int a, int b, bool alliance);
+	bool isAlliance(int a, int b) const;
+	void resetAllAlliances();
+	void setAllianceLastAsked(int a, int b,int time);
+	int allianceLastAsked(int a, int b) const;
 
 	void runTests();
+	int runHeadlessGame(int epoch, int island, int max_game_time, int time_rate, bool skip_to_events, vector<int> *frame_times);
 };
 
-extern Game *game_g;
+/** The game being run on the current thread. The simulation (Map, Sector, Army, Building, Player and
+ *  the gamestates) is given its game explicitly; this is only for the user interface code and entry
+ *  points, which aren't. Each thread that runs a game should set this.
+ */
+extern THREAD_LOCAL Game *game_g;
 
 void startIsland_g();
 void endIsland_g();
@@ -541,7 +616,24 @@ enum PlayerMode {
 	PLAYER_NONE = -1
 };
 
+/** A time at which a sector's economy next needs processing.
+*/
+class EconomyEvent {
+public:
+	int time;
+	Sector *sector;
+	int generation;
+
+	EconomyEvent(int time, Sector *sector, int generation) : time(time), sector(sector), generation(generation) {
+	}
+	bool operator<(const EconomyEvent &that) const {
+		// reversed, so that std::priority_queue returns the earliest event first
+		return this->time > that.time;
+	}
+};
+
 class Map {
+	Game *game;
 	string name;
 	string filename;
 	MapColour colour;
@@ -549,10 +641,45 @@ class Map {
 	Sector *sectors[map_width_c][map_height_c];
 	bool sector_at[map_width_c][map_height_c];
 	bool reserved[map_width_c][map_height_c]; // if true, don't use for starting players - used for testing
+	std::priority_queue<EconomyEvent> economy_events;
+
+	// index of the sectors owned by each player (including shut down sectors), and of the sectors where each
+	// player has an army; each list is in the order of a scan over the map (x, then y) - see updateIndex()
+	vector<Sector *> player_sectors[n_players_c];
+	vector<Sector *> army_sectors[n_players_c];
+	void clearIndex();
+
+	// where each player can move to from each square, found by a breadth first search when first asked for, and
+	// kept until something changes that affects it - see invalidateReachability()
+	class Reachability {
+	public:
+		bool valid;
+		bool reachable[map_width_c][map_height_c];
+		int distance[map_width_c][map_height_c]; // number of moves, or -1 if not reachable
+		int parent[map_width_c][map_height_c]; // previous square on a shortest path (as x*map_height_c + y), or -1
+	};
+	mutable Reachability reachability[n_players_c][map_width_c][map_height_c];
+	const Reachability *getReachability(int sx, int sy, int player) const;
+
+	// the island with its coastline, and the same again with the towers and armies on top, cached as render
+	// targets (along with the part of the background underneath) - only one map keeps these at a time, see draw()
+	Image *island_image;
+	Image *overlay_image;
+	const Image *cache_background;
+	int cache_offset_x, cache_offset_y; // where the map was drawn, in the 320x240 coordinate system
+	Rect2D cache_rect; // the area covered by the cached images, in the 320x240 coordinate system
+	int cache_targets_generation;
+	bool island_image_valid;
+	int overlay_generation; // incremented whenever the owners, armies or nuked state of the sectors may have changed
+	int overlay_image_generation;
+	void drawIsland(int offset_x, int offset_y) const;
+	void drawOverlay(int offset_x, int offset_y) const;
+	Rect2D getDrawRect(int offset_x, int offset_y) const;
+	bool prepareIslandImage(int offset_x, int offset_y, const Image *background);
 
 public:
 
-	Map(MapColour colour,int n_opponents,const char *name);
+	Map(Game *game, MapColour colour,int n_opponents,const char *name);
 	~Map();
 
 	MapColour getColour() const {
@@ -581,7 +708,9 @@ public:
 		this->filename = filename;
 	}
 	int getNSquares() const;
-	void draw(int offset_x, int offset_y) const;
+	void draw(int offset_x, int offset_y, const Image *background);
+	void drawWithOverlay(int offset_x, int offset_y, const Image *background);
+	void freeCachedImages();
 	void findRandomSector(int *rx,int *ry) const;
 	bool isReserved(int x, int y) const {
 		return this->reserved[x][y];
@@ -590,8 +719,25 @@ public:
 		this->reserved[x][y] = r;
 	}
 	void canMoveTo(bool temp[map_width_c][map_height_c], int sx,int sy,int player) const;
+	bool canMoveTo(int sx, int sy, int tx, int ty, int player) const;
+	int findPath(int sx, int sy, int tx, int ty, int player, vector<Sector *> *path) const;
+	void invalidateReachability();
 	void calculateStats() const;
 
+	void updateIndex(Sector *sector);
+	const vector<Sector *> &getPlayerSectors(int player) const {
+		return this->player_sectors[player];
+	}
+	const vector<Sector *> &getArmySectors(int player) const {
+		return this->army_sectors[player];
+	}
+	Sector *nextPlayerSector(int player, const Sector *after);
+
+	void scheduleEconomyEvent(int time, Sector *sector, int generation);
+	void processEconomyEvents(int time);
+	int getNextEconomyEventTime() const;
+	bool isFighting() const;
+
 	void saveStateSectors(stringstream &stream) const;
 };
 
@@ -638,3 +784,8 @@ const int BUILDTIME_LAB = 40;
 
 const int ticks_per_frame_c = 100; // game time ticks per frame rate (used for various animated sprites)
 const float time_ratio_c = 0.15f; // game time ticks per time ticks
+const int soldier_turn_rate_c = (int)(50.0 * ticks_per_frame_c * time_ratio_c); // mean ticks per turn
+const int n_fast_forward_rates_c = 2;
+const int fast_forward_rates_c[n_fast_forward_rates_c] = {10, 100};
+const int max_worker_threads_c = 3; // default maximum number of extra threads for updating sectors
+const int max_event_skip_c = 10 * gameticks_per_hour_c; // longest single step when skipping to the next event
@@ -7,10 +7,11 @@
 #include <stdexcept> // needed for Android at least
 
 #include <sstream>
+#include <algorithm>
 
-#include "gamestate.h"
 #include "game.h"
 #include "utils.h"
+#include "gamestate.h"
 #include "sector.h"
 #include "gui.h"
 #include "player.h"
@@ -26,44 +27,15 @@ const int defenders_ticks_per_update_c = (int)(60.0 * ticks_per_frame_c * time_r
 const int soldier_move_rate_c = (int)(1.8 * ticks_per_frame_c * time_ratio_c); // ticks per pixel - needs to be in sync with the animation!
 const int cannon_move_rate_c = (int)(0.6 * ticks_per_frame_c * time_ratio_c); // ticks per pixel - needs to be in sync with the animation!
 const int air_move_rate_c = (int)(0.2 * ticks_per_frame_c * time_ratio_c); // ticks per pixel
-const int soldier_turn_rate_c = (int)(50.0 * ticks_per_frame_c * time_ratio_c); // mean ticks per turn
 
 const int shield_step_y_c = 20;
 
-class Soldier {
-	static int sort_soldier_pair(const void *v1,const void *v2);
-public:
-	int player;
-	int epoch;
-	int xpos, ypos;
-	AmmoDirection dir;
-	Soldier(int player,int epoch,int xpos,int ypos) {
-		ASSERT_S_EPOCH(epoch);
-		this->player = player;
-		this->epoch = epoch;
-		this->xpos = xpos;
-		this->ypos = ypos;
-		this->dir = (AmmoDirection)(rand() % 4);
-	}
-	static void sortSoldiers(Soldier **soldiers,int n_soldiers) {
-		qsort(soldiers, n_soldiers, sizeof( Soldier *), sort_soldier_pair);
-	}
-};
-
-int Soldier::sort_soldier_pair(const void *v1,const void *v2) {
-	Soldier *s1 = *(Soldier **)v1;
-	Soldier *s2 = *(Soldier **)v2;
-	/*if( s1->epoch >= 6 )
-	return 1;
-	else if( s2->epoch >= 6 )
-	return -1;
-	else*/
-	return (s1->ypos - s2->ypos);
+int Feature::getAnimationCounter() {
+	const int ticks_per_frame_c = 110; // tree animation looks better if offset from main animation, and if slightly slower
+	return ( game_g->getRealTime() * game_g->getTimeRate() ) / ticks_per_frame_c;
 }
 
-void Feature::draw() const {
-	const int ticks_per_frame_c = 110; // tree animation looks better if offset from main animation, and if slightly slower
-	int counter = ( game_g->getRealTime() * game_g->getTimeRate() ) / ticks_per_frame_c;
+void Feature::draw(int counter) const {
 	image[counter % n_frames]->draw(xpos, ypos);
 }
 
@@ -80,6 +52,32 @@ TimedEffect::TimedEffect(int delay, void (*func_finish)()) {
 const int ammo_time_c = 1000;
 const float ammo_speed_c = 1.5f; // higher is faster
 
+void *AmmoEffect::operator new(size_t size, AmmoEffectPool *pool) {
+	ASSERT( size == sizeof(AmmoEffect) );
+	return pool->allocate();
+}
+
+void AmmoEffect::operator delete(void *ptr, AmmoEffectPool *) {
+	AmmoEffectPool::release(ptr);
+}
+
+void AmmoEffect::operator delete(void *ptr) {
+	AmmoEffectPool::release(ptr);
+}
+
+void *AnimationEffect::operator new(size_t size, AnimationEffectPool *pool) {
+	ASSERT( size == sizeof(AnimationEffect) );
+	return pool->allocate();
+}
+
+void AnimationEffect::operator delete(void *ptr, AnimationEffectPool *) {
+	AnimationEffectPool::release(ptr);
+}
+
+void AnimationEffect::operator delete(void *ptr) {
+	AnimationEffectPool::release(ptr);
+}
+
 AmmoEffect::AmmoEffect(PlayingGameState *gamestate,int epoch, AmmoDirection dir, int xpos, int ypos) : TimedEffect(), gamestate(gamestate) {
 	ASSERT_EPOCH(epoch);
 	this->gametimeset = game_g->getGameTime();
@@ -89,30 +87,37 @@ AmmoEffect::AmmoEffect(PlayingGameState *gamestate,int epoch, AmmoDirection dir,
 	this->ypos = ypos;
 }
 
-bool AmmoEffect::render() const {
-	int time = game_g->getRealTime() - this->timeset;
-	if( time < 0 )
-		return false;
+/** Returns the position of the ammo relative to the land, and how far it has travelled.
+ */
+void AmmoEffect::getPos(int *x, int *y, int *dist) const {
 	int gametime = game_g->getGameTime() - this->gametimeset;
-	int x = xpos;
-	int y = ypos;
-	int dist = (int)(gametime * ammo_speed_c);
+	*x = xpos;
+	*y = ypos;
+	*dist = (int)(gametime * ammo_speed_c);
 	if( dir == ATTACKER_AMMO_BOMB )
-		dist /= 2;
+		*dist /= 2;
 	if( dir == ATTACKER_AMMO_DOWN )
-		y += dist;
+		*y += *dist;
 	else if( dir == ATTACKER_AMMO_UP )
-		y -= dist;
+		*y -= *dist;
 	else if( dir == ATTACKER_AMMO_LEFT )
-		x -= dist;
+		*x -= *dist;
 	else if( dir == ATTACKER_AMMO_RIGHT )
-		x += dist;
+		*x += *dist;
 	else if( dir == ATTACKER_AMMO_BOMB )
-		y += dist;
+		*y += *dist;
 	else {
 		ASSERT(0);
 	}
-	Image *image = game_g->attackers_ammo[epoch][dir];
+}
+
+bool AmmoEffect::update() {
+	int time = game_g->getRealTime() - this->timeset;
+	if( time < 0 )
+		return false;
+	int x = 0, y = 0, dist = 0;
+	getPos(&x, &y, &dist);
+	const Image *image = game_g->attackers_ammo[epoch][dir];
 	if( dir == ATTACKER_AMMO_BOMB && dist > 24 ) {
 		if( game_g->explosions[0] != NULL ) {
 			int w = image->getScaledWidth();
@@ -123,16 +128,23 @@ bool AmmoEffect::render() const {
 	}
 	if( x < 0 || y < 0 )
 		return true;
-	x += offset_land_x_c;
-	y += offset_land_y_c;
-	if( x + image->getScaledWidth() >= game_g->getScreen()->getWidth() || y + image->getScaledHeight() >= game_g->getScreen()->getHeight() )
+	// n.b., compare with the logical resolution rather than the screen, so this doesn't depend on having a screen
+	if( offset_land_x_c + x + image->getScaledWidth() >= default_width_c || offset_land_y_c + y + image->getScaledHeight() >= default_height_c )
 		return true;
-	image->draw(x, y);
 	if( time > ammo_time_c )
 		return true;
 	return false;
 }
 
+void AmmoEffect::draw() const {
+	int time = game_g->getRealTime() - this->timeset;
+	if( time < 0 )
+		return;
+	int x = 0, y = 0, dist = 0;
+	getPos(&x, &y, &dist);
+	game_g->attackers_ammo[epoch][dir]->draw(offset_land_x_c + x, offset_land_y_c + y);
+}
+
 const int fade_time_c = 1000;
 const int whitefade_time_c = 1000;
 
@@ -161,11 +173,17 @@ FadeEffect::~FadeEffect() {
 #endif
 }
 
-bool FadeEffect::render() const {
+bool FadeEffect::update() {
+	int time = game_g->getRealTime() - this->timeset;
+	int length = white ? whitefade_time_c : fade_time_c;
+	return time > length; // n.b., render() still draws the fade on the last time
+}
+
+void FadeEffect::draw() const {
 	int time = game_g->getRealTime() - this->timeset;
 	int length = white ? whitefade_time_c : fade_time_c;
 	if( time < 0 )
-		return false;
+		return;
 	double alpha = 0.0;
 	if( white ) {
 		alpha = ((double)time) / (0.5 * (double)length);
@@ -188,58 +206,61 @@ bool FadeEffect::render() const {
 	unsigned char value = white ? 255 : 0;
 	game_g->getScreen()->fillRectWithAlpha(0, 0, game_g->getScreen()->getWidth(), game_g->getScreen()->getHeight(), value, value, value, (unsigned char)(alpha * 255));
 #endif
-	if( time > length ) // we still need to draw the fade, on the last time
-		return true;
-	return false;
 }
 
 const int flashingsquare_flash_time_c = 250;
 const int flashing_square_n_flashes_c = 8;
 
-bool FlashingSquare::render() const {
+bool FlashingSquare::update() {
 	int time = game_g->getRealTime() - this->timeset;
-	if( time < 0 )
-		return false;
-	if( time > flashingsquare_flash_time_c * flashing_square_n_flashes_c ) {
-		return true;
-	}
+	return time > flashingsquare_flash_time_c * flashing_square_n_flashes_c;
+}
 
+void FlashingSquare::draw() const {
+	int time = game_g->getRealTime() - this->timeset;
+	if( time < 0 )
+		return;
 	bool flash = ( time / flashingsquare_flash_time_c ) % 2 == 0;
 	if( flash ) {
 		int map_x = offset_map_x_c + 16 * this->xpos;
 		int map_y = offset_map_y_c + 16 * this->ypos;
 		game_g->flashingmapsquare->draw(map_x, map_y);
 	}
-	return false;
 }
 
-bool AnimationEffect::render() const {
+bool AnimationEffect::update() {
 	int time = game_g->getRealTime() - this->timeset;
 	if( time < 0 )
 		return false;
 	int frame = time / time_per_frame;
-	if( frame >= n_images )
-		return true;
-	//this->finished = true;
-	else {
+	return frame >= n_images;
+}
+
+void AnimationEffect::draw() const {
+	int time = game_g->getRealTime() - this->timeset;
+	if( time < 0 )
+		return;
+	int frame = time / time_per_frame;
+	if( frame < n_images ) {
 		if( !dir )
 			frame = n_images - 1 - frame;
 		images[frame]->draw(xpos, ypos);
 	}
-	return false;
 }
 
-bool TextEffect::render() const {
+bool TextEffect::update() {
 	int time = game_g->getRealTime() - this->timeset;
-	if( time < 0 )
-		return false;
-	else if( time > duration )
-		return true;
+	return time > duration;
+}
+
+void TextEffect::draw() const {
+	int time = game_g->getRealTime() - this->timeset;
+	if( time < 0 || time > duration )
+		return;
 	Image::write(xpos, ypos, game_g->letters_small, text.c_str(), Image::JUSTIFY_CENTRE);
-	return false;
 }
 
-GameState::GameState(int client_player) : client_player(client_player) {
+GameState::GameState(Game *game, int client_player) : game(game), client_player(client_player) {
 	this->fade = NULL;
 	this->whitefade = NULL;
 	this->screen_page = new PanelPage(0, 0);
@@ -274,24 +295,24 @@ void GameState::reset() {
 }
 
 void GameState::setDefaultMouseImage() {
-	if( game_g->isDemo() )
-		mouse_image = game_g->mouse_pointers[0];
+	if( game->isDemo() )
+		mouse_image = game->mouse_pointers[0];
 	else
-		mouse_image = game_g->mouse_pointers[client_player];
+		mouse_image = game->mouse_pointers[client_player];
 	mobile_ui_display_mouse = false;
 }
 
 void GameState::draw() {
 	if( mouse_image != NULL ) {
-		bool touch_mode = game_g->isMobileUI() || game_g->getApplication()->isBlankMouse();
+		bool touch_mode = game->isMobileUI() || game->getApplication()->isBlankMouse();
 		if( touch_mode && mobile_ui_display_mouse ) {
 			mouse_image->draw(default_width_c - mouse_image->getScaledWidth(), 0);
 		}
 		else if( !touch_mode ) {
 			int m_x = 0, m_y = 0;
-			game_g->getScreen()->getMouseCoords(&m_x, &m_y);
-			m_x = (int)(m_x / game_g->getScaleWidth());
-			m_y = (int)(m_y / game_g->getScaleHeight());
+			game->getScreen()->getMouseCoords(&m_x, &m_y);
+			m_x = (int)(m_x / game->getScaleWidth());
+			m_y = (int)(m_y / game->getScaleHeight());
 			m_x += mouse_off_x;
 			m_y += mouse_off_y;
 			mouse_image->draw(m_x, m_y);
@@ -315,23 +336,43 @@ void GameState::draw() {
 		}
 	}
 
-	if( game_g->isPaused() ) {
-		string str = game_g->isMobileUI() ? "touch screen\nto unpause game" : "press p or click\nmouse to unpause game";
+	if( game->isPaused() ) {
+		string str = game->isMobileUI() ? "touch screen\nto unpause game" : "press p or click\nmouse to unpause game";
 		// n.b., don't use 120 for y pos, need to avoid collision with quit game message
 		// and offset x pos slightly, to avoid overlapping with GUI
-		Image::write(120, 100, game_g->letters_large, str.c_str(), Image::JUSTIFY_LEFT);
+		Image::write(120, 100, game->letters_large, str.c_str(), Image::JUSTIFY_LEFT);
 	}
 
-	if( game_g->getApplication()->hasFPS() ) {
-		float fps = game_g->getApplication()->getFPS();
+	if( game->getApplication()->hasFPS() ) {
+		float fps = game->getApplication()->getFPS();
 		if( fps > 0.0f ) {
 			stringstream str;
 			str << fps;
-			Image::writeMixedCase(4, default_height_c - 16, game_g->letters_large, game_g->letters_small, game_g->numbers_white, str.str().c_str(), Image::JUSTIFY_LEFT);
+			Image::writeMixedCase(4, default_height_c - 16, game->letters_large, game->letters_small, game->numbers_white, str.str().c_str(), Image::JUSTIFY_LEFT);
 		}
 	}
 
-	game_g->getScreen()->refresh();
+	if( game->getProfiler() != NULL ) {
+		// mean and worst time per frame for each phase, in ms
+		const Profiler *profiler = game->getProfiler();
+		int n_frames = std::min(profiler->getFrame() - 1, (int)Profiler::n_overlay_frames_c);
+		if( n_frames > 0 ) {
+			float mean_ms[PROFILE_N_PHASES], max_ms[PROFILE_N_PHASES];
+			profiler->getPhaseTimes(mean_ms, max_ms, n_frames);
+			stringstream str;
+			str.setf(std::ios::fixed);
+			str.precision(2);
+			for(int i=0;i<PROFILE_N_PHASES;i++) {
+				str << Profiler::getPhaseName((ProfilePhase)i) << " " << mean_ms[i] << " " << max_ms[i] << "\n";
+			}
+			Image::writeMixedCase(default_width_c - 4, 4, game->letters_large, game->letters_small, game->numbers_white, str.str().c_str(), Image::JUSTIFY_RIGHT);
+		}
+	}
+
+	{
+		ProfileScope profile_scope(game->getProfiler(), PROFILE_PRESENT);
+		game->getScreen()->refresh();
+	}
 }
 
 void GameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool m_right,bool click) {
@@ -339,24 +380,24 @@ void GameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool m_righ
 }
 
 void GameState::requestQuit(bool force_quit) {
-	game_g->getApplication()->setQuit();
+	game->getApplication()->setQuit();
 }
 
 void GameState::createQuitWindow() {
-    if( confirm_window == NULL && !game_g->isStateChanged() ) {
+    if( confirm_window == NULL && !game->isStateChanged() ) {
 		confirm_type = CONFIRMTYPE_QUITGAME;
 		confirm_window = new PanelPage(0, 0, default_width_c, default_height_c);
 		confirm_window->setBackground(0, 0, 0, 200);
 		const int offset_x_c = 120, offset_y_c = 120;
-		Button *text_button = new Button(offset_x_c, offset_y_c, "REALLY QUIT?", game_g->letters_large);
+		Button *text_button = new Button(offset_x_c, offset_y_c, "REALLY QUIT?", game->letters_large);
 		confirm_window->add(text_button);
-		confirm_button_1 = new Button(offset_x_c, offset_y_c+16, "YES", game_g->letters_large);
+		confirm_button_1 = new Button(offset_x_c, offset_y_c+16, "YES", game->letters_large);
 		confirm_window->add(confirm_button_1);
-		confirm_button_2 = new Button(offset_x_c+32, offset_y_c+16, "NO", game_g->letters_large);
+		confirm_button_2 = new Button(offset_x_c+32, offset_y_c+16, "NO", game->letters_large);
 		confirm_window->add(confirm_button_2);
 		screen_page->add(confirm_window);
 	}
-	else if( confirm_window != NULL && !game_g->isStateChanged() ) {
+	else if( confirm_window != NULL && !game->isStateChanged() ) {
 		closeConfirmWindow();
 	}
 }
@@ -373,9 +414,9 @@ void GameState::closeConfirmWindow() {
     //LOG("GameState::closeConfirmWindow() done\n");
 }
 
-ChooseGameTypeGameState::ChooseGameTypeGameState(int client_player) : GameState(client_player) {
+ChooseGameTypeGameState::ChooseGameTypeGameState(Game *game, int client_player) : GameState(game, client_player) {
 	this->choosegametypePanel = NULL;
-	T_ASSERT(game_g->getTutorial() == NULL);
+	T_ASSERT(game->getTutorial() == NULL);
 }
 
 ChooseGameTypeGameState::~ChooseGameTypeGameState() {
@@ -402,9 +443,9 @@ void ChooseGameTypeGameState::reset() {
 
 void ChooseGameTypeGameState::draw() {
 #if defined(__ANDROID__)
-	game_g->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
+	game->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
 #endif
-	game_g->background->draw(0, 0);
+	game->background->draw(0, 0);
 
 	this->choosegametypePanel->draw();
 
@@ -421,7 +462,7 @@ void ChooseGameTypeGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_midd
 	this->choosegametypePanel->input(m_x, m_y, m_left, m_middle, m_right, click);
 }
 
-ChooseDifficultyGameState::ChooseDifficultyGameState(int client_player) : GameState(client_player) {
+ChooseDifficultyGameState::ChooseDifficultyGameState(Game *game, int client_player) : GameState(game, client_player) {
 	this->choosedifficultyPanel = NULL;
 }
 
@@ -449,9 +490,9 @@ void ChooseDifficultyGameState::reset() {
 
 void ChooseDifficultyGameState::draw() {
 #if defined(__ANDROID__)
-	game_g->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
+	game->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
 #endif
-	game_g->background->draw(0, 0);
+	game->background->draw(0, 0);
 
 	this->choosedifficultyPanel->draw();
 
@@ -467,7 +508,7 @@ void ChooseDifficultyGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_mi
 	this->choosedifficultyPanel->input(m_x, m_y, m_left, m_middle, m_right, click);
 }
 
-ChoosePlayerGameState::ChoosePlayerGameState(int client_player) : GameState(client_player), button_red(NULL), button_yellow(NULL), button_green(NULL), button_blue(NULL) {
+ChoosePlayerGameState::ChoosePlayerGameState(Game *game, int client_player) : GameState(game, client_player), button_red(NULL), button_yellow(NULL), button_green(NULL), button_blue(NULL) {
 }
 
 ChoosePlayerGameState::~ChoosePlayerGameState() {
@@ -482,52 +523,52 @@ void ChoosePlayerGameState::reset() {
 	int ypos = 48;
 	const int ydiff = 48;
 	const int xindent = 8;
-	const int ylargediff = game_g->letters_large[0]->getScaledHeight() + 2;
-	const int ysmalldiff = game_g->letters_small[0]->getScaledHeight() + 2;
+	const int ylargediff = game->letters_large[0]->getScaledHeight() + 2;
+	const int ysmalldiff = game->letters_small[0]->getScaledHeight() + 2;
 	const int draw_offset_x = 32;
 
-	button_red = new Button(xpos-draw_offset_x, ypos, draw_offset_x, ylargediff + 2*ysmalldiff, "CONTROLLER OF THE RED PEOPLE", game_g->letters_large);
-	screen_page->add(new Button(xpos+xindent, ypos+ylargediff, "SPECIAL SKILL STRENGTH", game_g->letters_small));
-	screen_page->add(new Button(xpos+xindent, ypos+ylargediff+ysmalldiff, "UNARMED MEN ARE STRONGER IN COMBAT", game_g->letters_small));
+	button_red = new Button(xpos-draw_offset_x, ypos, draw_offset_x, ylargediff + 2*ysmalldiff, "CONTROLLER OF THE RED PEOPLE", game->letters_large);
+	screen_page->add(new Button(xpos+xindent, ypos+ylargediff, "SPECIAL SKILL STRENGTH", game->letters_small));
+	screen_page->add(new Button(xpos+xindent, ypos+ylargediff+ysmalldiff, "UNARMED MEN ARE STRONGER IN COMBAT", game->letters_small));
 	ypos += ydiff;
 	screen_page->add(button_red);
 
-	button_green = new Button(xpos-draw_offset_x, ypos, draw_offset_x, ylargediff + 2*ysmalldiff, "CONTROLLER OF THE GREEN PEOPLE", game_g->letters_large);
-	screen_page->add(new Button(xpos+xindent, ypos+ylargediff, "SPECIAL SKILL CONSTRUCTION", game_g->letters_small));
-	screen_page->add(new Button(xpos+xindent, ypos+ylargediff+ysmalldiff, "FASTER AT BUILDING NEW TOWERS", game_g->letters_small));
+	button_green = new Button(xpos-draw_offset_x, ypos, draw_offset_x, ylargediff + 2*ysmalldiff, "CONTROLLER OF THE GREEN PEOPLE", game->letters_large);
+	screen_page->add(new Button(xpos+xindent, ypos+ylargediff, "SPECIAL SKILL CONSTRUCTION", game->letters_small));
+	screen_page->add(new Button(xpos+xindent, ypos+ylargediff+ysmalldiff, "FASTER AT BUILDING NEW TOWERS", game->letters_small));
 	ypos += ydiff;
 	screen_page->add(button_green);
 
-	button_yellow = new Button(xpos-draw_offset_x, ypos, draw_offset_x, ylargediff + 2*ysmalldiff, "CONTROLLER OF THE YELLOW PEOPLE", game_g->letters_large);
-	screen_page->add(new Button(xpos+xindent, ypos+ylargediff, "SPECIAL SKILL DIPLOMACY", game_g->letters_small));
-	screen_page->add(new Button(xpos+xindent, ypos+ylargediff+ysmalldiff, "EASIER TO FORM ALLIANCES", game_g->letters_small));
+	button_yellow = new Button(xpos-draw_offset_x, ypos, draw_offset_x, ylargediff + 2*ysmalldiff, "CONTROLLER OF THE YELLOW PEOPLE", game->letters_large);
+	screen_page->add(new Button(xpos+xindent, ypos+ylargediff, "SPECIAL SKILL DIPLOMACY", game->letters_small));
+	screen_page->add(new Button(xpos+xindent, ypos+ylargediff+ysmalldiff, "EASIER TO FORM ALLIANCES", game->letters_small));
 	ypos += ydiff;
 	screen_page->add(button_yellow);
 
-	button_blue = new Button(xpos-draw_offset_x, ypos, draw_offset_x, ylargediff + 2*ysmalldiff, "CONTROLLER OF THE BLUE PEOPLE", game_g->letters_large);
-	screen_page->add(new Button(xpos+xindent, ypos+ylargediff, "SPECIAL SKILL DEFENCE", game_g->letters_small));
-	screen_page->add(new Button(xpos+xindent, ypos+ylargediff+ysmalldiff, "BUILDINGS STRONGER AGAINST ATTACK", game_g->letters_small));
+	button_blue = new Button(xpos-draw_offset_x, ypos, draw_offset_x, ylargediff + 2*ysmalldiff, "CONTROLLER OF THE BLUE PEOPLE", game->letters_large);
+	screen_page->add(new Button(xpos+xindent, ypos+ylargediff, "SPECIAL SKILL DEFENCE", game->letters_small));
+	screen_page->add(new Button(xpos+xindent, ypos+ylargediff+ysmalldiff, "BUILDINGS STRONGER AGAINST ATTACK", game->letters_small));
 	ypos += ydiff;
 	screen_page->add(button_blue);
 }
 
 void ChoosePlayerGameState::draw() {
 #if defined(__ANDROID__)
-	game_g->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
+	game->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
 #endif
 	//player_select->draw(0, 0, false);
-	game_g->background->draw(0, 0);
-    Image::writeMixedCase(160, 16, game_g->letters_large, game_g->letters_small, NULL, "Select a Player", Image::JUSTIFY_CENTRE);
+	game->background->draw(0, 0);
+    Image::writeMixedCase(160, 16, game->letters_large, game->letters_small, NULL, "Select a Player", Image::JUSTIFY_CENTRE);
 
 	const int y_offset = 2; // must be even, otherwise we have graphical problems when running at 1280x1024 mode
-	if( game_g->player_heads_select[0] != NULL )
-		game_g->player_heads_select[0]->draw(button_red->getLeft(), button_red->getTop()+y_offset);
-	if( game_g->player_heads_select[1] != NULL )
-		game_g->player_heads_select[1]->draw(button_green->getLeft(), button_green->getTop()+y_offset);
-	if( game_g->player_heads_select[2] != NULL )
-		game_g->player_heads_select[2]->draw(button_yellow->getLeft(), button_yellow->getTop()+y_offset);
-	if( game_g->player_heads_select[3] != NULL )
-		game_g->player_heads_select[3]->draw(button_blue->getLeft(), button_blue->getTop()+y_offset);
+	if( game->player_heads_select[0] != NULL )
+		game->player_heads_select[0]->draw(button_red->getLeft(), button_red->getTop()+y_offset);
+	if( game->player_heads_select[1] != NULL )
+		game->player_heads_select[1]->draw(button_green->getLeft(), button_green->getTop()+y_offset);
+	if( game->player_heads_select[2] != NULL )
+		game->player_heads_select[2]->draw(button_yellow->getLeft(), button_yellow->getTop()+y_offset);
+	if( game->player_heads_select[3] != NULL )
+		game->player_heads_select[3]->draw(button_blue->getLeft(), button_blue->getTop()+y_offset);
 
 	this->screen_page->draw();
 
@@ -553,18 +594,18 @@ void ChoosePlayerGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle
 	}
 
 	if( player != -1 ) {
-		game_g->setClientPlayer(player);
-		if( game_g->getGameType() == GAMETYPE_TUTORIAL ) {
-			game_g->setGameStateID(GAMESTATEID_CHOOSETUTORIAL);
+		game->setClientPlayer(player);
+		if( game->getGameType() == GAMETYPE_TUTORIAL ) {
+			game->setGameStateID(GAMESTATEID_CHOOSETUTORIAL);
 		}
 		else {
-			game_g->setGameStateID(GAMESTATEID_PLACEMEN);
-			game_g->newGame();
+			game->setGameStateID(GAMESTATEID_PLACEMEN);
+			game->newGame();
 		}
 	}
 }
 
-ChooseTutorialGameState::ChooseTutorialGameState(int client_player) : GameState(client_player) {
+ChooseTutorialGameState::ChooseTutorialGameState(Game *game, int client_player) : GameState(game, client_player) {
 }
 
 void ChooseTutorialGameState::reset() {
@@ -577,7 +618,7 @@ void ChooseTutorialGameState::reset() {
 	vector<TutorialInfo> infos = TutorialManager::getTutorialInfo();
 	for(vector<TutorialInfo>::const_iterator iter = infos.begin(); iter != infos.end(); ++iter) {
 		TutorialInfo info = *iter;
-		Button *button = new Button(xpos, ypos, info.text.c_str(), game_g->letters_large);
+		Button *button = new Button(xpos, ypos, info.text.c_str(), game->letters_large);
 		button->setId(info.id);
 		ypos += ydiff;
 		screen_page->add(button);
@@ -587,10 +628,10 @@ void ChooseTutorialGameState::reset() {
 
 void ChooseTutorialGameState::draw() {
 #if defined(__ANDROID__)
-	game_g->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
+	game->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
 #endif
-	game_g->background->draw(0, 0);
-    Image::writeMixedCase(160, 16, game_g->letters_large, game_g->letters_small, NULL, "Select a Tutorial", Image::JUSTIFY_CENTRE);
+	game->background->draw(0, 0);
+    Image::writeMixedCase(160, 16, game->letters_large, game->letters_small, NULL, "Select a Tutorial", Image::JUSTIFY_CENTRE);
 
 	this->screen_page->draw();
 
@@ -604,16 +645,16 @@ void ChooseTutorialGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_midd
 	for(vector<Button *>::const_iterator iter = buttons.begin(); iter != buttons.end(); ++iter) {
 		const Button *button = *iter;
 	    if( m_left && click && button->mouseOver(m_x, m_y) ) {
-			game_g->setupTutorial(button->getId());
-			game_g->setCurrentIsand(game_g->getTutorial()->getStartEpoch(), game_g->getTutorial()->getIsland());
-			game_g->setupPlayers();
-			game_g->setGameStateID(GAMESTATEID_PLAYING);
+			game->setupTutorial(button->getId());
+			game->setCurrentIsand(game->getTutorial()->getStartEpoch(), game->getTutorial()->getIsland());
+			game->setupPlayers();
+			game->setGameStateID(GAMESTATEID_PLAYING);
 			break;
 		}
 	}
 }
 
-PlaceMenGameState::PlaceMenGameState(int client_player) : GameState(client_player), start_map_x(-1), start_map_y(-1) {
+PlaceMenGameState::PlaceMenGameState(Game *game, int client_player) : GameState(game, client_player), start_map_x(-1), start_map_y(-1) {
 	this->off_x = 220;
 	this->off_y = 32;
 	this->choosemenPanel = NULL;
@@ -665,7 +706,7 @@ void PlaceMenGameState::reset() {
 	for(int y=0;y<map_height_c;y++) {
 		for(int x=0;x<map_width_c;x++) {
 			map_panels[x][y] = NULL;
-			if( game_g->getMap()->isSectorAt(x, y) ) {
+			if( game->getMap()->isSectorAt(x, y) ) {
 				//int map_x = offset_map_x_c + 16 * x;
 				int map_x = this->off_x - 8 * map_width_c + 16 * x;
 				int map_y = this->off_y + 16 * y;
@@ -686,13 +727,13 @@ void PlaceMenGameState::draw() {
 	char buffer[256] = "";
 
 #if defined(__ANDROID__)
-	game_g->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
+	game->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
 #endif
-	game_g->background_islands->draw(0, 0);
+	game->background_islands->draw(0, 0);
 
-	if( !game_g->isUsingOldGfx() ) {
+	if( !game->isUsingOldGfx() ) {
 		sprintf(buffer, "Gigalomania v%d.%d", majorVersion, minorVersion);
-	    Image::writeMixedCase(160, 228, game_g->letters_large, game_g->letters_small, game_g->numbers_white, buffer, Image::JUSTIFY_CENTRE);
+	    Image::writeMixedCase(160, 228, game->letters_large, game->letters_small, game->numbers_white, buffer, Image::JUSTIFY_CENTRE);
 	}
 
     /*this->choosemenPanel->draw();
@@ -700,65 +741,65 @@ void PlaceMenGameState::draw() {
     GameState::draw();
     return;*/
 
-    int l_h = game_g->letters_large[0]->getScaledHeight();
-	int s_h = game_g->letters_small[0]->getScaledHeight();
+    int l_h = game->letters_large[0]->getScaledHeight();
+	int s_h = game->letters_small[0]->getScaledHeight();
 	const int cx = this->off_x;
     int cy = this->off_y + 104;
-	Image::writeMixedCase(cx, cy, game_g->letters_large, game_g->letters_small, NULL, game_g->getMap()->getName(), Image::JUSTIFY_CENTRE);
+	Image::writeMixedCase(cx, cy, game->letters_large, game->letters_small, NULL, game->getMap()->getName(), Image::JUSTIFY_CENTRE);
 	cy += s_h + 2;
-	Image::writeMixedCase(cx, cy, game_g->letters_large, game_g->letters_small, NULL, "of the", Image::JUSTIFY_CENTRE);
+	Image::writeMixedCase(cx, cy, game->letters_large, game->letters_small, NULL, "of the", Image::JUSTIFY_CENTRE);
 	cy += l_h + 2;
-	sprintf(buffer, "%s AGE", epoch_names[game_g->getStartEpoch()]);
-	Image::writeMixedCase(cx, cy, game_g->letters_large, game_g->letters_small, NULL, buffer, Image::JUSTIFY_CENTRE);
+	sprintf(buffer, "%s AGE", epoch_names[game->getStartEpoch()]);
+	Image::writeMixedCase(cx, cy, game->letters_large, game->letters_small, NULL, buffer, Image::JUSTIFY_CENTRE);
     cy += l_h + 2;
 
-	int year = epoch_dates[game_g->getStartEpoch()];
-	bool shiny = game_g->getStartEpoch() == n_epochs_c-1;
-	Image::writeNumbers(cx+8, cy, shiny ? game_g->numbers_largeshiny : game_g->numbers_largegrey, abs(year),Image::JUSTIFY_RIGHT);
-	Image *era = ( year < 0 ) ? game_g->icon_bc :
-		shiny ? game_g->icon_ad_shiny : game_g->icon_ad;
+	int year = epoch_dates[game->getStartEpoch()];
+	bool shiny = game->getStartEpoch() == n_epochs_c-1;
+	Image::writeNumbers(cx+8, cy, shiny ? game->numbers_largeshiny : game->numbers_largegrey, abs(year),Image::JUSTIFY_RIGHT);
+	Image *era = ( year < 0 ) ? game->icon_bc :
+		shiny ? game->icon_ad_shiny : game->icon_ad;
 	if( era != NULL )
 		era->draw(cx+8, cy);
 	else {
-		Image::write(cx+8, cy, game_g->letters_small, ( year < 0 ) ? "BC" : "AD", Image::JUSTIFY_LEFT);
+		Image::write(cx+8, cy, game->letters_small, ( year < 0 ) ? "BC" : "AD", Image::JUSTIFY_LEFT);
 	}
     cy += l_h + 2;
 
-	if( !game_g->isDemo() && game_g->getGameType() == GAMETYPE_ALLISLANDS ) {
-		int n_suspended = game_g->getNSuspended();
+	if( !game->isDemo() && game->getGameType() == GAMETYPE_ALLISLANDS ) {
+		int n_suspended = game->getNSuspended();
         if( n_suspended > 0 )
 		{
 			sprintf(buffer, "Saved Men %d", n_suspended);
-            Image::writeMixedCase(cx, cy, game_g->letters_large, game_g->letters_small, game_g->numbers_white, buffer, Image::JUSTIFY_CENTRE);
+            Image::writeMixedCase(cx, cy, game->letters_large, game->letters_small, game->numbers_white, buffer, Image::JUSTIFY_CENTRE);
 		}
 	}
 
     /*cy += l_h + 2;
 	cy += l_h + 2;
 	if( choosemenPanel->getPage() == ChooseMenPanel::STATE_LOADGAME ) {
-		Image::write(cx, cy, game_g->letters_large, "LOAD", Image::JUSTIFY_CENTRE, true);
+		Image::write(cx, cy, game->letters_large, "LOAD", Image::JUSTIFY_CENTRE, true);
 	}
 	else if( choosemenPanel->getPage() == ChooseMenPanel::STATE_SAVEGAME ) {
-		Image::write(cx, cy, game_g->letters_large, "SAVE", Image::JUSTIFY_CENTRE, true);
+		Image::write(cx, cy, game->letters_large, "SAVE", Image::JUSTIFY_CENTRE, true);
 	}
     cy += s_h + 2;*/
 
 	if( choosemenPanel->getPage() == ChooseMenPanel::STATE_CHOOSEMEN ) {
 		cy = 100;
 		const int xpos = 80;
-		Image::writeMixedCase(xpos, cy, game_g->letters_large, game_g->letters_small, NULL, "Click on the icon below", Image::JUSTIFY_CENTRE);
+		Image::writeMixedCase(xpos, cy, game->letters_large, game->letters_small, NULL, "Click on the icon below", Image::JUSTIFY_CENTRE);
 		cy += l_h + 2;
-		Image::writeMixedCase(xpos, cy, game_g->letters_large, game_g->letters_small, NULL, "to choose how many men", Image::JUSTIFY_CENTRE);
+		Image::writeMixedCase(xpos, cy, game->letters_large, game->letters_small, NULL, "to choose how many men", Image::JUSTIFY_CENTRE);
 		cy += l_h + 2;
-		Image::writeMixedCase(xpos, cy, game_g->letters_large, game_g->letters_small, NULL, "to play with", Image::JUSTIFY_CENTRE);
+		Image::writeMixedCase(xpos, cy, game->letters_large, game->letters_small, NULL, "to play with", Image::JUSTIFY_CENTRE);
 		cy += l_h + 2;
-		Image::writeMixedCase(xpos, cy, game_g->letters_large, game_g->letters_small, NULL, "then click on the map", Image::JUSTIFY_CENTRE);
+		Image::writeMixedCase(xpos, cy, game->letters_large, game->letters_small, NULL, "then click on the map", Image::JUSTIFY_CENTRE);
 		cy += l_h + 2;
-		Image::writeMixedCase(xpos, cy, game_g->letters_large, game_g->letters_small, NULL, "to the right", Image::JUSTIFY_CENTRE);
+		Image::writeMixedCase(xpos, cy, game->letters_large, game->letters_small, NULL, "to the right", Image::JUSTIFY_CENTRE);
 		cy += l_h + 2;
 	}
 
-	game_g->getMap()->draw(cx - 8*map_width_c, off_y);
+	game->getMap()->draw(cx - 8*map_width_c, off_y, game->background_islands);
 
 	this->choosemenPanel->draw();
 	//this->choosemenPanel->drawPopups();
@@ -795,7 +836,7 @@ void PlaceMenGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,boo
 		int map_y = -1;
 		for(int y=0;y<map_height_c && !found;y++) {
 			for(int x=0;x<map_width_c && !found;x++) {
-				if( game_g->getMap()->isSectorAt(x, y) ) {
+				if( game->getMap()->isSectorAt(x, y) ) {
 					ASSERT( this->map_panels[x][y] != NULL );
 					if( this->map_panels[x][y]->mouseOver(m_x, m_y) ) {
 						found = true;
@@ -806,7 +847,7 @@ void PlaceMenGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,boo
 			}
 		}
 		if( found ) {
-			LOG("starting epoch %d island %s at %d, %d\n", game_g->getStartEpoch(), game_g->getMap()->getName(), map_x, map_y);
+			LOG("starting epoch %d island %s at %d, %d\n", game->getStartEpoch(), game->getMap()->getName(), map_x, map_y);
 			this->setStartMapPos(map_x, map_y);
 			return;
 		}
@@ -818,10 +859,10 @@ void PlaceMenGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,boo
 
 void PlaceMenGameState::requestQuit(bool force_quit) {
 	if( force_quit ) {
-		game_g->saveState();
-	    game_g->getApplication()->setQuit();
+		game->saveState();
+	    game->getApplication()->setQuit();
 	}
-	else if( choosemenPanel->getPage() == ChooseMenPanel::STATE_CHOOSEMEN && !game_g->isStateChanged() ) {
+	else if( choosemenPanel->getPage() == ChooseMenPanel::STATE_CHOOSEMEN && !game->isStateChanged() ) {
 		choosemenPanel->setPage(ChooseMenPanel::STATE_CHOOSEISLAND);
 	}
 	else {
@@ -833,10 +874,10 @@ void PlaceMenGameState::requestConfirm() {
 	if( confirm_window != NULL ) {
         this->closeConfirmWindow();
 		if( confirm_type == CONFIRMTYPE_NEWGAME ) {
-			game_g->setGameStateID(GAMESTATEID_CHOOSEGAMETYPE);
+			game->setGameStateID(GAMESTATEID_CHOOSEGAMETYPE);
 		}
 		else if( confirm_type == CONFIRMTYPE_QUITGAME ) {
-	        game_g->getApplication()->setQuit();
+	        game->getApplication()->setQuit();
 		}
 		else {
 			T_ASSERT(false);
@@ -847,16 +888,16 @@ void PlaceMenGameState::requestConfirm() {
 void PlaceMenGameState::setStartMapPos(int start_map_x, int start_map_y ) {
 	this->start_map_x = start_map_x;
 	this->start_map_y = start_map_y;
-	if( !game_g->isDemo() ) {
-		game_g->players[client_player]->setNMenForThisIsland( this->choosemenPanel->getNMen() );
-		ASSERT( game_g->players[client_player]->getNMenForThisIsland() <= game_g->getMenAvailable() );
-		LOG("human is player %d, starting with %d men\n", client_player, game_g->players[client_player]->getNMenForThisIsland());
+	if( !game->isDemo() ) {
+		game->players[client_player]->setNMenForThisIsland( this->choosemenPanel->getNMen() );
+		ASSERT( game->players[client_player]->getNMenForThisIsland() <= game->getMenAvailable() );
+		LOG("human is player %d, starting with %d men\n", client_player, game->players[client_player]->getNMenForThisIsland());
 	}
 	else {
 		LOG("DEMO mode\n");
 		//placeTower(map_x, map_y, 0);
 	}
-	game_g->placeTower();
+	game->placeTower();
 }
 
 void PlaceMenGameState::requestNewGame() {
@@ -867,17 +908,17 @@ void PlaceMenGameState::requestNewGame() {
 	confirm_type = CONFIRMTYPE_NEWGAME;
 	confirm_window->setBackground(0, 0, 0, 200);
 	const int offset_x_c = 120, offset_y_c = 120;
-	Button *text_button = new Button(offset_x_c, offset_y_c, "NEW GAME?", game_g->letters_large);
+	Button *text_button = new Button(offset_x_c, offset_y_c, "NEW GAME?", game->letters_large);
 	confirm_window->add(text_button);
-	confirm_button_1 = new Button(offset_x_c, offset_y_c+16, "YES", game_g->letters_large);
+	confirm_button_1 = new Button(offset_x_c, offset_y_c+16, "YES", game->letters_large);
 	confirm_window->add(confirm_button_1);
-	confirm_button_2 = new Button(offset_x_c+32, offset_y_c+16, "NO", game_g->letters_large);
+	confirm_button_2 = new Button(offset_x_c+32, offset_y_c+16, "NO", game->letters_large);
 	confirm_window->add(confirm_button_2);
 	this->screen_page->add(confirm_window);
 }
 
 
-PlayingGameState::PlayingGameState(int client_player) : GameState(client_player) {
+PlayingGameState::PlayingGameState(Game *game, int client_player) : GameState(game, client_player) {
 	this->current_sector = NULL;
 	this->flag_frame_step = 0;
 	this->defenders_last_time_update = 0;
@@ -909,6 +950,28 @@ PlayingGameState::PlayingGameState(int client_player) : GameState(client_player)
 	for(int i=0;i<n_players_c;i++)
 		for(int j=0;j<=n_epochs_c;j++)
 			this->n_deaths[i][j] = 0;
+	for(int i=0;i<=n_epochs_c;i++)
+		this->land_occupancy_index[i] = -1;
+	this->land_occupancy_sector = NULL;
+	if( game->getScreen() != NULL ) {
+		for(int i=0;i<n_tree_frames_c;i++) {
+			Image *layer = Image::createRenderTarget(game->getScreen()->getWidth(), game->getScreen()->getHeight());
+			if( layer == NULL ) {
+				// just draw everything each frame
+				for(size_t j=0;j<static_layers.size();j++) {
+					delete static_layers[j];
+				}
+				static_layers.clear();
+				break;
+			}
+			static_layers.push_back(layer);
+		}
+	}
+	this->static_layer_valid.resize(static_layers.size(), false);
+	this->static_layer_sector = NULL;
+	this->static_layer_generation = 0;
+	this->static_layer_open_pit_mine = false;
+	this->static_layer_targets_generation = 0;
 	//this->refreshSoldiers(false);
 	for(int y=0;y<map_height_c;y++) {
 		for(int x=0;x<map_width_c;x++) {
@@ -917,18 +980,21 @@ PlayingGameState::PlayingGameState(int client_player) : GameState(client_player)
 	}
 	alliance_yes = NULL;
 	alliance_no = NULL;
+	// so that adding effects doesn't need to allocate
+	this->effects.reserve(animation_effect_pool_size_c);
+	this->ammo_effects.reserve(ammo_effect_pool_size_c);
 
-	game_g->setTimeRate(client_player == PLAYER_DEMO ? 5 : 1);
+	game->setTimeRate(client_player == PLAYER_DEMO ? 5 : 1);
 }
 
 PlayingGameState::~PlayingGameState() {
 	LOG("~PlayingGameState()\n");
-	if( game_g->getMap() != NULL ) { // check needed if the current map failed to load, and we're resuming from saved state with that island
-		game_g->getMap()->freeSectors(); // needed to avoid crash for tests, and exiting to desktop
+	if( game->getMap() != NULL ) { // check needed if the current map failed to load, and we're resuming from saved state with that island
+		game->getMap()->freeSectors(); // needed to avoid crash for tests, and exiting to desktop
 	}
-	game_g->s_biplane->fadeOut(500);
-	game_g->s_jetplane->fadeOut(500);
-	game_g->s_spaceship->fadeOut(500);
+	game->s_biplane->fadeOut(500);
+	game->s_jetplane->fadeOut(500);
+	game->s_spaceship->fadeOut(500);
 	for(size_t i=0;i<effects.size();i++) {
 		TimedEffect *effect = effects.at(i);
 		delete effect;
@@ -942,11 +1008,18 @@ PlayingGameState::~PlayingGameState() {
 	}
 	if( this->gamePanel )
 		delete gamePanel;
+	for(size_t i=0;i<static_layers.size();i++) {
+		delete static_layers[i];
+	}
+	const PoolCounters &ammo_counters = ammo_effect_pool.getCounters();
+	const PoolCounters &animation_counters = animation_effect_pool.getCounters();
+	LOG("ammo effects: %d allocated, %d from heap, peak %d\n", ammo_counters.n_allocations, ammo_counters.n_heap_allocations, ammo_counters.peak_in_use);
+	LOG("animation effects: %d allocated, %d from heap, peak %d\n", animation_counters.n_allocations, animation_counters.n_heap_allocations, animation_counters.peak_in_use);
 	LOG("~PlayingGameState() done\n");
 }
 
 void PlayingGameState::createQuitWindow() {
-    if( confirm_window == NULL && !game_g->isStateChanged() ) {
+    if( confirm_window == NULL && !game->isStateChanged() ) {
 		confirm_type = CONFIRMTYPE_QUITGAME;
 		confirm_window = new PanelPage(0, 0, default_width_c, default_height_c);
 		confirm_window->setBackground(0, 0, 0, 200);
@@ -954,16 +1027,16 @@ void PlayingGameState::createQuitWindow() {
 #if defined(__ANDROID__)
 		confirm_button_1 = NULL; // if user wants to exit to homescreen, they can just press the Home button
 #else
-		confirm_button_1 = new Button(offset_x_c, offset_y_c, "SAVE GAME AND QUIT TO DESKTOP", game_g->letters_large);
+		confirm_button_1 = new Button(offset_x_c, offset_y_c, "SAVE GAME AND QUIT TO DESKTOP", game->letters_large);
 		confirm_window->add(confirm_button_1);
 #endif
-		confirm_button_2 = new Button(offset_x_c, offset_y_c+16, "EXIT BATTLE", game_g->letters_large);
+		confirm_button_2 = new Button(offset_x_c, offset_y_c+16, "EXIT BATTLE", game->letters_large);
 		confirm_window->add(confirm_button_2);
-		confirm_button_3 = new Button(offset_x_c, offset_y_c+32, "CANCEL", game_g->letters_large);
+		confirm_button_3 = new Button(offset_x_c, offset_y_c+32, "CANCEL", game->letters_large);
 		confirm_window->add(confirm_button_3);
 		screen_page->add(confirm_window);
 	}
-	else if( confirm_window != NULL && !game_g->isStateChanged() ) {
+	else if( confirm_window != NULL && !game->isStateChanged() ) {
 		closeConfirmWindow();
 	}
 }
@@ -971,7 +1044,8 @@ void PlayingGameState::createQuitWindow() {
 bool PlayingGameState::readSectorsProcessLine(Map *map, char *line, bool *done_header, int *sec_x, int *sec_y) {
 	bool ok = true;
 	line[ strlen(line) - 1 ] = '\0'; // trim new line
-	line[ strlen(line) - 1 ] = '\0'; // trim carriage return
+	if( strlen(line) > 0 && line[ strlen(line) - 1 ] == '\r' )
+		line[ strlen(line) - 1 ] = '\0'; // trim carriage return (n.b., files may have been checked out with unix line endings)
 	if( !(*done_header) ) {
 		if( line[0] != '#' ) {
 			LOG("expected first character to be '#'\n");
@@ -1046,7 +1120,7 @@ bool PlayingGameState::readSectorsProcessLine(Map *map, char *line, bool *done_h
 
 			Id element = UNDEFINED;
 			for(int i=0;i<N_ID;i++) {
-				if( strcmp( game_g->elements[i]->getName(), elementname.c_str() ) == 0 ) {
+				if( strcmp( game->elements[i]->getName(), elementname.c_str() ) == 0 ) {
 					element = (Id)i;
 				}
 			}
@@ -1056,7 +1130,7 @@ bool PlayingGameState::readSectorsProcessLine(Map *map, char *line, bool *done_h
 				return ok;
 			}
 
-			game_g->getMap()->getSector(*sec_x, *sec_y)->setElements(element, n_elements);
+			game->getMap()->getSector(*sec_x, *sec_y)->setElements(element, n_elements);
 		}
 		else {
 			LOG("unknown word: %s\n", ptr);
@@ -1075,7 +1149,7 @@ bool PlayingGameState::readSectors(Map *map) {
 	bool done_header = false;
 
     char fullname[4096] = "";
-	sprintf(fullname, "%s/%s", maps_dirname, game_g->getMap()->getFilename());
+	sprintf(fullname, "%s/%s", maps_dirname, game->getMap()->getFilename());
 	// open in binary mode, so that we parse files in an OS-independent manner
 	// (otherwise, Windows will parse "\r\n" as being "\n", but Linux will still read it as "\n")
 	//FILE *file = fopen(fullname, "rb");
@@ -1083,7 +1157,7 @@ bool PlayingGameState::readSectors(Map *map) {
 #if !defined(__ANDROID__) && defined(__linux)
 	if( file == NULL ) {
 		LOG("searching in /usr/share/gigalomania/ for islands folder\n");
-		sprintf(fullname, "%s/%s", alt_maps_dirname, game_g->getMap()->getFilename());
+		sprintf(fullname, "%s/%s", alt_maps_dirname, game->getMap()->getFilename());
 		file = SDL_RWFromFile(fullname, "rb");
 	}
 #endif
@@ -1097,7 +1171,7 @@ bool PlayingGameState::readSectors(Map *map) {
 	bool reached_end = false;
 	int newline_index = 0;
 	while( ok ) {
-		bool done = game_g->readLineFromRWOps(ok, file, buffer, line, MAX_LINE, buffer_offset, newline_index, reached_end);
+		bool done = game->readLineFromRWOps(ok, file, buffer, line, MAX_LINE, buffer_offset, newline_index, reached_end);
 		if( !ok )  {
 			LOG("failed to read line\n");
 		}
@@ -1116,48 +1190,51 @@ bool PlayingGameState::readSectors(Map *map) {
 void PlayingGameState::createSectors(int x, int y, int n_men) {
 	LOG("PlayingGameState::createSectors(%d, %d, %d)\n", x, y, n_men);
 
-	game_g->getMap()->createSectors(this, game_g->getStartEpoch());
-	Sector *sector = game_g->getMap()->getSector(x, y);
+	game->getMap()->createSectors(this, game->getStartEpoch());
+	Sector *sector = game->getMap()->getSector(x, y);
 	current_sector = sector;
-	if( !game_g->isDemo() ) {
+	if( !game->isDemo() ) {
 		sector->createTower(client_player, n_men);
 	}
 	//current_sector->createTower(human_player, 10);
 
 	//current_sector->getArmy(enemy_player)->soldiers[10] = 0;
-	//game_g->getMap()->sectors[2][2]->getArmy(enemy_player)->soldiers[0] = 10;
+	//game->getMap()->sectors[2][2]->getArmy(enemy_player)->soldiers[0] = 10;
 
-	//Sector *enemy_sector = game_g->getMap()->sectors[1][2];
+	//Sector *enemy_sector = game->getMap()->sectors[1][2];
 
 	for(int i=0;i<n_players_c;i++) {
-		if( i == client_player || game_g->players[i] == NULL )
+		if( i == client_player || game->players[i] == NULL )
 			continue;
 		int ex = 0, ey = 0;
 		while( true ) {
-			game_g->getMap()->findRandomSector(&ex, &ey);
-			ASSERT( game_g->getMap()->isSectorAt(ex, ey) );
-			if( game_g->getMap()->getSector(ex, ey)->getPlayer() == -1 && !game_g->getMap()->isReserved(ex, ey) )
+			game->getMap()->findRandomSector(&ex, &ey);
+			ASSERT( game->getMap()->isSectorAt(ex, ey) );
+			if( game->getMap()->getSector(ex, ey)->getPlayer() == -1 && !game->getMap()->isReserved(ex, ey) )
 				break;
 		}
-		//Sector *enemy_sector = game_g->getMap()->sectors[ex][ey];
-		Sector *enemy_sector = game_g->getMap()->getSector(ex, ey);
+		//Sector *enemy_sector = game->getMap()->sectors[ex][ey];
+		Sector *enemy_sector = game->getMap()->getSector(ex, ey);
 		//enemy_sector->getArmy(enemy_player)->soldiers[10] = 30;
 		//enemy_sector->createTower(enemy_player, 12);
-		if( game_g->getStartEpoch() == end_epoch_c ) {
-			//game_g->players[i]->n_men_for_this_island = n_suspended[i];
-			game_g->players[i]->setNMenForThisIsland(100);
+		if( game->getStartEpoch() == end_epoch_c ) {
+			//game->players[i]->n_men_for_this_island = n_suspended[i];
+			game->players[i]->setNMenForThisIsland(100);
+		}
+		else if( i == game->getStandInPlayer() ) {
+			game->players[i]->setNMenForThisIsland(game->getStandInMen());
 		}
 		else {
-			game_g->players[i]->setNMenForThisIsland(20 + 5*game_g->getStartEpoch());
+			game->players[i]->setNMenForThisIsland(20 + 5*game->getStartEpoch());
 			// total: 360*3 + 65 = 1145 men
 		}
 		LOG("Enemy %d created at %d , %d\n", i, ex, ey);
-		enemy_sector->createTower(i, game_g->players[i]->getNMenForThisIsland());
+		enemy_sector->createTower(i, game->players[i]->getNMenForThisIsland());
 		//enemy_sector->createTower(enemy_player, 20);
 		//enemy_sector->createTower(enemy_player, 200);
 	}
 
-	if( !readSectors(game_g->getMap()) ) {
+	if( !readSectors(game->getMap()) ) {
 		LOG("failed to read map sector info!\n");
 		ASSERT(false);
 	}
@@ -1188,7 +1265,7 @@ bool PlayingGameState::openPitMine() {
 	if( current_sector->getActivePlayer() != -1 && current_sector->getBuilding(BUILDING_MINE) == NULL && current_sector->getEpoch() >= 1 ) {
 		for(int i=0;i<N_ID;i++) {
 			if( current_sector->anyElements((Id)i) ) {
-				Element *element = game_g->elements[i];
+				Element *element = game->elements[i];
 				if( element->getType() == Element::OPENPITMINE )
 					return true;
 			}
@@ -1215,24 +1292,24 @@ void PlayingGameState::setupMapGUI() {
 		}
 	}
 	if( this->player_asking_alliance != -1 ) {
-		alliance_yes = new Button(24, 82, "YES", game_g->letters_large);
+		alliance_yes = new Button(24, 82, "YES", game->letters_large);
 		alliance_yes->setInfoLMB("join the alliance");
 		screen_page->add(alliance_yes);
-		alliance_no = new Button(56, 82, "NO", game_g->letters_large);
+		alliance_no = new Button(56, 82, "NO", game->letters_large);
 		alliance_no->setInfoLMB("refuse the alliance");
 		screen_page->add(alliance_no);
 	}
 	else if( this->map_display == MAPDISPLAY_MAP ) {
 		for(int y=0;y<map_height_c;y++) {
 			for(int x=0;x<map_width_c;x++) {
-				if( game_g->getMap()->isSectorAt(x, y) ) {
+				if( game->getMap()->isSectorAt(x, y) ) {
 					int map_x = offset_map_x_c + 16 * x;
 					int map_y = offset_map_y_c + 16 * y;
 					PanelPage *panel = new PanelPage(map_x, map_y, 16, 16);
 					panel->setTolerance(0); // since map sectors are aligned, better for touchscreens not to use the "tolerance"
 					panel->setInfoLMB("view this sector");
 					screen_page->add(panel);
-					//game_g->getMap()->panels[x][y] = panel;
+					//game->getMap()->panels[x][y] = panel;
 					map_panels[x][y] = panel;
 					char buffer[256] = "";
 					sprintf(buffer, "map_%d_%d", x, y);
@@ -1274,10 +1351,10 @@ void PlayingGameState::reset() {
 	// setup screen_page buttons
 	this->setupMapGUI();
 
-	if( !game_g->isDemo() ) {
-		speed_button = new ImageButton(offset_map_x_c + 16 * map_width_c + 4, 4, game_g->icon_speeds[game_g->getTimeRate()-1]);
+	if( !game->isDemo() ) {
+		speed_button = new ImageButton(offset_map_x_c + 16 * map_width_c + 4, 4, game->icon_speeds[game->getTimeRateIcon()]);
 		speed_button->setId("speed_button");
-		if( game_g->isOneMouseButton() ) {
+		if( game->isOneMouseButton() ) {
 			speed_button->setInfoLMB("cycle through different time rates");
 		}
 		else {
@@ -1288,10 +1365,10 @@ void PlayingGameState::reset() {
 
 		//if( mobile_ui )
 		{
-			pause_button = new Button(default_width_c - 80, default_height_c - quit_button_offset_c, "PAUSE", game_g->letters_large);
+			pause_button = new Button(default_width_c - 80, default_height_c - quit_button_offset_c, "PAUSE", game->letters_large);
 			pause_button->setId("pause_button");
 			screen_page->add(pause_button);
-			quit_button = new Button(default_width_c - 32, default_height_c - quit_button_offset_c, "QUIT", game_g->letters_large);
+			quit_button = new Button(default_width_c - 32, default_height_c - quit_button_offset_c, "QUIT", game->letters_large);
 			quit_button->setId("quit_button");
 			screen_page->add(quit_button);
 		}
@@ -1332,8 +1409,8 @@ void PlayingGameState::reset() {
 	// must call setup last, in case it recalls member functions of PlayingGameState, that requires the buttons to have been initialised
 	this->gamePanel->setup();
 
-	if( game_g->getTutorial() != NULL ) {
-		const TutorialCard *card = game_g->getTutorial()->getCard();
+	if( game->getTutorial() != NULL ) {
+		const TutorialCard *card = game->getTutorial()->getCard();
 		if( card != NULL ) {
 			card->setGUI(this);
 		}
@@ -1369,45 +1446,45 @@ void PlayingGameState::resetShieldButtons() {
 	}
 	int n_sides = 0;
 	for(int i=0;i<n_players_c;i++) {
-		if( !done_shield[i] && game_g->players[i] != NULL && !game_g->players[i]->isDead() ) {
+		if( !done_shield[i] && game->players[i] != NULL && !game->players[i]->isDead() ) {
 			bool allied[n_players_c];
 			for(int j=0;j<n_players_c;j++)
 				allied[j] = false;
 			allied[i] = true;
 			done_shield[i] = true;
 			for(int j=i+1;j<n_players_c;j++) {
-				if( Player::isAlliance(i, j) ) {
-					ASSERT( game_g->players[j] != NULL );
-					ASSERT( !game_g->players[j]->isDead() );
+				if( game->isAlliance(i, j) ) {
+					ASSERT( game->players[j] != NULL );
+					ASSERT( !game->players[j]->isDead() );
 					allied[j] = true;
 					done_shield[j] = true;
 				}
 			}
 			n_sides++;
-			shield_buttons[i] = new ImageButton(offset_map_x_c + 16 * map_width_c + 4, offset_map_y_c + shield_step_y_c * i + 8, game_g->playershields[ Player::getShieldIndex(allied) ]);
+			shield_buttons[i] = new ImageButton(offset_map_x_c + 16 * map_width_c + 4, offset_map_y_c + shield_step_y_c * i + 8, game->playershields[ Player::getShieldIndex(allied) ]);
 			screen_page->add(shield_buttons[i]);
 			//shield_number_panels[i] = new PanelPage(offset_map_x_c + 16 * map_width_c + 4 + 16, offset_map_y_c + shield_step_y_c * i + 8, 20, 10);
 			shield_number_panels[i] = new PanelPage(offset_map_x_c + 16 * map_width_c + 4 + 16, offset_map_y_c + shield_step_y_c * i + 8, 20, shield_step_y_c);
 			screen_page->add(shield_number_panels[i]);
 		}
 	}
-	if( !game_g->isDemo() && n_sides > 2 ) {
+	if( !game->isDemo() && n_sides > 2 ) {
 		for(int i=0;i<n_players_c;i++) {
-			if( shield_buttons[i] != NULL && i != client_player && !Player::isAlliance(i, client_player) ) {
+			if( shield_buttons[i] != NULL && i != client_player && !game->isAlliance(i, client_player) ) {
 				shield_buttons[i]->setInfoLMB("make an alliance");
 			}
 		}
 	}
 	bool any_alliances = false;
-	for(int i=0;i<n_players_c && !any_alliances && !game_g->isDemo();i++) {
-		if( i != client_player && Player::isAlliance(i, client_player) ) {
+	for(int i=0;i<n_players_c && !any_alliances && !game->isDemo();i++) {
+		if( i != client_player && game->isAlliance(i, client_player) ) {
 			any_alliances = true;
-			ASSERT( game_g->players[i] != NULL );
-			ASSERT( !game_g->players[i]->isDead() );
+			ASSERT( game->players[i] != NULL );
+			ASSERT( !game->players[i]->isDead() );
 		}
 	}
 	if( any_alliances ) {
-		shield_blank_button = new ImageButton(offset_map_x_c + 16 * map_width_c + 4, offset_map_y_c + 4*shield_step_y_c + 8, game_g->playershields[0]);
+		shield_blank_button = new ImageButton(offset_map_x_c + 16 * map_width_c + 4, offset_map_y_c + 4*shield_step_y_c + 8, game->playershields[0]);
 		shield_blank_button->setInfoLMB("break current alliance");
 		screen_page->add(shield_blank_button);
 	}
@@ -1433,7 +1510,7 @@ void PlayingGameState::setFlashingSquare(int xpos,int ypos) {
 void GameState::fadeScreen(bool out, int delay, void (*func_finish)()) {
     if( fade != NULL )
         delete fade;
-	if( game_g->isTesting() ) {
+	if( game->isTesting() || game->isHeadless() ) {
 		if( func_finish != NULL ) {
 			func_finish();
 		}
@@ -1447,13 +1524,13 @@ void GameState::whiteFlash() {
 	//ASSERT( whitefade == NULL );
     if( whitefade != NULL )
         delete whitefade;
-	if( !game_g->isTesting() ) {
+	if( !game->isTesting() && !game->isHeadless() ) {
 	    whitefade = new FadeEffect(true, false, 0, NULL);
 	}
 }
 
 void PlayingGameState::getFlagOffset(int *offset_x, int *offset_y, int epoch) const {
-	if( game_g->isUsingOldGfx() ) {
+	if( game->isUsingOldGfx() ) {
 		*offset_x = 22;
 		*offset_y = 6;
 	}
@@ -1470,10 +1547,10 @@ void PlayingGameState::getFlagOffset(int *offset_x, int *offset_y, int epoch) co
 
 void PlayingGameState::draw() {
 #if defined(__ANDROID__)
-	game_g->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
+	game->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
 #endif
 
-	game_g->background->draw(0, 0);
+	this->drawStaticLayer();
 	//background->draw(0, 0, true);
 
 	bool no_armies = true;
@@ -1490,57 +1567,28 @@ void PlayingGameState::draw() {
 
 	if( this->player_asking_alliance != -1 ) {
 		// ask alliance
-		if( game_g->player_heads_alliance[player_asking_alliance] != NULL ) {
-			game_g->player_heads_alliance[player_asking_alliance]->draw(offset_map_x_c + 24, offset_map_y_c + 24);
+		if( game->player_heads_alliance[player_asking_alliance] != NULL ) {
+			game->player_heads_alliance[player_asking_alliance]->draw(offset_map_x_c + 24, offset_map_y_c + 24);
 		}
-		stringstream str;
-		str << PlayerType::getName((PlayerType::PlayerTypeID)player_asking_alliance);
-		Image::write(offset_map_x_c + 8, offset_map_y_c + 0, game_g->letters_small, str.str().c_str(), Image::JUSTIFY_LEFT);
-		str.str("asks for an");
-		Image::write(offset_map_x_c + 8, offset_map_y_c + 8, game_g->letters_small, str.str().c_str(), Image::JUSTIFY_LEFT);
-		str.str("alliance");
-		Image::write(offset_map_x_c + 8, offset_map_y_c + 16, game_g->letters_small, str.str().c_str(), Image::JUSTIFY_LEFT);
+		Image::write(offset_map_x_c + 8, offset_map_y_c + 0, game->letters_small, PlayerType::getName((PlayerType::PlayerTypeID)player_asking_alliance), Image::JUSTIFY_LEFT);
+		Image::write(offset_map_x_c + 8, offset_map_y_c + 8, game->letters_small, "asks for an", Image::JUSTIFY_LEFT);
+		Image::write(offset_map_x_c + 8, offset_map_y_c + 16, game->letters_small, "alliance", Image::JUSTIFY_LEFT);
 	}
 	else if( this->map_display == MAPDISPLAY_MAP ) {
 		// map
 
-		game_g->getMap()->draw(offset_map_x_c, offset_map_y_c);
-		for(int y=0;y<map_height_c;y++) {
-			for(int x=0;x<map_width_c;x++) {
-				if( game_g->getMap()->getSector(x, y) != NULL ) {
-					int map_x = offset_map_x_c + 16 * x;
-					int map_y = offset_map_y_c + 16 * y;
-					//map_sq[15]->draw(map_x, map_y, true);
-					if( game_g->getMap()->getSector(x, y)->getPlayer() != -1 ) {
-						game_g->icon_towers[ game_g->getMap()->getSector(x, y)->getPlayer() ]->draw(map_x + 5, map_y + 5);
-					}
-					else if( game_g->getMap()->getSector(x, y)->isNuked() ) {
-						game_g->icon_nuke_hole->draw(map_x + 4, map_y + 4);
-					}
-					for(int i=0;i<n_players_c;i++) {
-						Army *army = game_g->getMap()->getSector(x, y)->getArmy(i);
-						int n_army = army->getTotal();
-						if( n_army > 0 ) {
-							int off_step = 5;
-							int off_step_x = ( i == 0 || i == 2 ) ? -off_step : off_step;
-							int off_step_y = ( i == 0 || i == 1 ) ? -off_step : off_step;
-							game_g->icon_armies[i]->draw(map_x + 6 + off_step_x, map_y + 6 + off_step_y);
-						}
-					}
-				}
-			}
-		}
+		game->getMap()->drawWithOverlay(offset_map_x_c, offset_map_y_c, game->background);
 		int map_x = offset_map_x_c + 16 * current_sector->getXPos();
 		int map_y = offset_map_y_c + 16 * current_sector->getYPos();
-		game_g->mapsquare->draw(map_x, map_y);
+		game->mapsquare->draw(map_x, map_y);
 	}
 	else if( this->map_display == MAPDISPLAY_UNITS ) {
 		// unit stats
 		const int gap = 18;
 		const int extra = 0;
-		for(int i=0;i<=game_g->getNSubEpochs();i++) {
-			Image *image = (i==0) ? game_g->unarmed_man : game_g->numbered_weapons[game_g->getStartEpoch() + i - 1];
-			//Image *image = (i==0) ? men[game_g->getStartEpoch()] : numbered_weapons[game_g->getStartEpoch() + i - 1];
+		for(int i=0;i<=game->getNSubEpochs();i++) {
+			Image *image = (i==0) ? game->unarmed_man : game->numbered_weapons[game->getStartEpoch() + i - 1];
+			//Image *image = (i==0) ? men[game->getStartEpoch()] : numbered_weapons[game->getStartEpoch() + i - 1];
 			image->draw(offset_map_x_c + gap * i + extra, offset_map_y_c + 2 - 16 + 8);
 		}
 		for(int i=0;i<n_players_c;i++) {
@@ -1549,15 +1597,15 @@ void PlayingGameState::draw() {
 			}
 			int off = 0;
 			for(int j=i;j<n_players_c;j++) {
-				if( j == i || Player::isAlliance(i, j) ) {
+				if( j == i || game->isAlliance(i, j) ) {
 					const Army *army = current_sector->getArmy(j);
 					if( army->getTotal() > 0 ) {
-						for(int k=0;k<=game_g->getNSubEpochs();k++) {
-							int idx = (k==0) ? 10 : game_g->getStartEpoch() + k - 1;
+						for(int k=0;k<=game->getNSubEpochs();k++) {
+							int idx = (k==0) ? 10 : game->getStartEpoch() + k - 1;
 							int n_men = army->getSoldiers(idx);
 							if( n_men > 0 ) {
-								//Image::writeNumbers(offset_map_x_c + 16 * k + 4, offset_map_y_c + 2 + 16 * i + 8 * off + 8, game_g->numbers_small[j], n_men, Image::JUSTIFY_LEFT, true);
-								Image::writeNumbers(offset_map_x_c + gap * k + extra, offset_map_y_c + 2 + 16 * i + 8 * off + 8, game_g->numbers_small[j], n_men, Image::JUSTIFY_LEFT);
+								//Image::writeNumbers(offset_map_x_c + 16 * k + 4, offset_map_y_c + 2 + 16 * i + 8 * off + 8, game->numbers_small[j], n_men, Image::JUSTIFY_LEFT, true);
+								Image::writeNumbers(offset_map_x_c + gap * k + extra, offset_map_y_c + 2 + 16 * i + 8 * off + 8, game->numbers_small[j], n_men, Image::JUSTIFY_LEFT);
 							}
 						}
 						off++;
@@ -1567,26 +1615,13 @@ void PlayingGameState::draw() {
 		}
 	}
 
-	// land area
-	game_g->land[game_g->getMap()->getColour()]->draw(offset_land_x_c, offset_land_y_c);
-
-	// trees etc (not at front)
-	for(int i=0;i<current_sector->getNFeatures();i++) {
-		const Feature *feature = current_sector->getFeature(i);
-		if( !feature->isAtFront() ) {
-			feature->draw();
-		}
-	}
-
+	// land area, features behind the soldiers, and the building images were drawn with the static layer
 	if( current_sector->getActivePlayer() != -1 )
 	{
-		if( openPitMine() )
-			game_g->icon_openpitmine->draw(offset_land_x_c + offset_openpitmine_x_c, offset_land_y_c + offset_openpitmine_y_c);
-
 		bool rotate_defenders = false;
-		if( game_g->getGameTime() - defenders_last_time_update > defenders_ticks_per_update_c ) {
+		if( game->getGameTime() - defenders_last_time_update > defenders_ticks_per_update_c ) {
 			rotate_defenders = true;
-			defenders_last_time_update = game_g->getGameTime();
+			defenders_last_time_update = game->getGameTime();
 		}
 
 		for(int i=0;i<N_BUILDINGS;i++) {
@@ -1594,10 +1629,7 @@ void PlayingGameState::draw() {
 			if( building == NULL )
 				continue;
 
-			// draw building
 			Image **images = building->getImages();
-			images[ current_sector->getBuildingEpoch() ]->draw(offset_land_x_c + building->getX(), offset_land_y_c + building->getY());
-
 			if( rotate_defenders )
 				building->rotateDefenders();
 
@@ -1606,17 +1638,17 @@ void PlayingGameState::draw() {
 				// uncomment to draw turrent button regions:
 				/*{
 					PanelPage *button = building->getTurretButton(j);
-					game_g->getScreen()->fillRectWithAlpha(game_g->getScaleWidth()*button->getLeft(), game_g->getScaleHeight()*button->getTop(), game_g->getScaleWidth()*button->getWidth(), game_g->getScaleHeight()*button->getHeight(), 255, 0, 0, 127);
+					game->getScreen()->fillRectWithAlpha(game->getScaleWidth()*button->getLeft(), game->getScaleHeight()*button->getTop(), game->getScaleWidth()*button->getWidth(), game->getScaleHeight()*button->getHeight(), 255, 0, 0, 127);
 				}*/
 
 				if( building->getTurretMan(j) != -1 ) {
 					Image *image = NULL;
 					int defender_epoch = building->getTurretMan(j);
 					if( defender_epoch == nuclear_epoch_c ) {
-						image = game_g->nuke_defences[current_sector->getPlayer()];
+						image = game->nuke_defences[current_sector->getPlayer()];
 					}
 					else {
-						image = game_g->defenders[current_sector->getPlayer()][defender_epoch][ building->getTurretManFrame(j) % game_g->n_defender_frames[defender_epoch] ];
+						image = game->defenders[current_sector->getPlayer()][defender_epoch][ building->getTurretManFrame(j) % game->n_defender_frames[defender_epoch] ];
 					}
 					image->draw(building->getTurretButton(j)->getLeft(), building->getTurretButton(j)->getTop() - 4);
 				}
@@ -1625,58 +1657,41 @@ void PlayingGameState::draw() {
 			if( i == BUILDING_TOWER ) {
 				int offset_x = 0, offset_y = 0;
 				getFlagOffset(&offset_x, &offset_y, current_sector->getBuildingEpoch());
-				game_g->flags[ current_sector->getPlayer() ][game_g->getFrameCounter() % n_flag_frames_c]->draw(offset_land_x_c + building->getX() + offset_x, offset_land_y_c + building->getY() + offset_y);
+				game->flags[ current_sector->getPlayer() ][game->getFrameCounter() % n_flag_frames_c]->draw(offset_land_x_c + building->getX() + offset_x, offset_land_y_c + building->getY() + offset_y);
 			}
 
-			int width = game_g->building_health->getScaledWidth();
+			int width = game->building_health->getScaledWidth();
 			int health = building->getHealth();
 			int max_health = building->getMaxHealth();
 			int offx = offset_land_x_c + building->getX() + 4;
 			int offy = offset_land_y_c + building->getY() + images[ current_sector->getBuildingEpoch() ]->getScaledHeight() + 2;
-			game_g->building_health->draw(offx, offy, (int)((width*health)/(float)max_health), game_g->building_health->getScaledHeight());
+			game->building_health->draw(offx, offy, (int)((width*health)/(float)max_health), game->building_health->getScaledHeight());
 		}
 	}
 	else if( current_sector->getPlayer() != -1 ) {
 		ASSERT( current_sector->isShutdown() );
 		Building *building = current_sector->getBuilding(BUILDING_TOWER);
 		ASSERT( building != NULL );
-		Image **images = building->getImages();
-		images[ current_sector->getBuildingEpoch() ]->draw(offset_land_x_c + building->getX(), offset_land_y_c + building->getY());
 		int offset_x = 0, offset_y = 0;
 		getFlagOffset(&offset_x, &offset_y, current_sector->getBuildingEpoch());
-		game_g->flags[ current_sector->getPlayer() ][game_g->getFrameCounter() % n_flag_frames_c]->draw(offset_land_x_c + building->getX() + offset_x, offset_land_y_c + building->getY() + offset_y);
+		game->flags[ current_sector->getPlayer() ][game->getFrameCounter() % n_flag_frames_c]->draw(offset_land_x_c + building->getX() + offset_x, offset_land_y_c + building->getY() + offset_y);
 	}
 
-	//Vector soldier_list(n_players_c * 250);
-	int n_total_soldiers = 0;
-	for(int i=0;i<n_players_c;i++) {
-		n_total_soldiers += soldiers[i].size();
-	}
-	Soldier **soldier_list = new Soldier *[n_total_soldiers];
-	for(int i=0,c=0;i<n_players_c;i++) {
-		//for(int j=0;j<n_soldiers[i];j++) {
-		for(size_t j=0;j<soldiers[i].size();j++) {
-			//Soldier *soldier = soldiers[i][j];
-			//Soldier *soldier = (Soldier *)soldiers[i]->get(j);
-			Soldier *soldier = soldiers[i].at(j);
-			//soldier_list.add(soldier);
-			soldier_list[c++] = soldier;
-		}
-	}
-	//Soldier::sortSoldiers((Soldier **)soldier_list.getData(), soldier_list.size());
-	Soldier::sortSoldiers(soldier_list, n_total_soldiers);
+	this->sortSoldiers();
 	// draw land units
-	/*for(int i=0;i<soldier_list.size();i++) {
-	Soldier *soldier = (Soldier *)soldier_list.elementAt(i);*/
-	for(int i=0;i<n_total_soldiers;i++) {
-		Soldier *soldier = soldier_list[i];
-		ASSERT(soldier->epoch != nuclear_epoch_c);
-		if( !isAirUnit(soldier->epoch) ) {
-			//int frame = soldier->dir * 4 + ( game_g->getFrameCounter() % 3 );
+	for(size_t i=0;i<soldier_draw_order.size();i++) {
+		int player = soldier_draw_order[i] % n_players_c;
+		const SoldierList *list = &soldiers[player];
+		size_t index = soldier_draw_order[i] / n_players_c;
+		int epoch = list->epoch[index];
+		ASSERT(epoch != nuclear_epoch_c);
+		if( !isAirUnit(epoch) ) {
+			//int frame = soldier->dir * 4 + ( game->getFrameCounter() % 3 );
 			//Image *image = attackers_walking[soldier->player][soldier->epoch][frame];
-			int n_frames = game_g->n_attacker_frames[soldier->epoch][soldier->dir];
-			Image *image = game_g->attackers_walking[soldier->player][soldier->epoch][soldier->dir][game_g->getFrameCounter() % n_frames];
-			image->draw(offset_land_x_c + soldier->xpos, offset_land_y_c + soldier->ypos);
+			AmmoDirection dir = list->dir[index];
+			int n_frames = game->n_attacker_frames[epoch][dir];
+			Image *image = game->attackers_walking[player][epoch][dir][game->getFrameCounter() % n_frames];
+			image->draw(offset_land_x_c + list->xpos[index], offset_land_y_c + list->ypos[index]);
 		}
 	}
 
@@ -1688,46 +1703,40 @@ void PlayingGameState::draw() {
 		}
 	}
 
+	// effects are advanced in update()
 	for(int i=effects.size()-1;i>=0;i--) {
-		TimedEffect *effect = effects.at(i);
-		if( effect->render() ) {
-			effects.erase(effects.begin() + i);
-			delete effect;
-		}
+		effects.at(i)->draw();
 	}
 	for(int i=ammo_effects.size()-1;i>=0;i--) {
-		TimedEffect *effect = ammo_effects.at(i);
-		if( effect->render() ) {
-			ammo_effects.erase(ammo_effects.begin() + i);
-			delete effect;
-		}
+		ammo_effects.at(i)->draw();
 	}
 
 	// draw air units
-	/*for(int i=0;i<soldier_list.size();i++) {
-	Soldier *soldier = (Soldier *)soldier_list.elementAt(i);*/
-	for(int i=0;i<n_total_soldiers;i++) {
-		Soldier *soldier = soldier_list[i];
-		ASSERT(soldier->epoch != nuclear_epoch_c);
-		if( isAirUnit(soldier->epoch) ) {
+	for(size_t i=0;i<soldier_draw_order.size();i++) {
+		int player = soldier_draw_order[i] % n_players_c;
+		const SoldierList *list = &soldiers[player];
+		size_t index = soldier_draw_order[i] / n_players_c;
+		int epoch = list->epoch[index];
+		if( isAirUnit(epoch) ) {
+			int xpos = list->xpos[index];
+			int ypos = list->ypos[index];
 			Image *image = NULL;
-			if( soldier->epoch == 6 || soldier->epoch == 7 ) {
-				image = game_g->planes[soldier->player][soldier->epoch];
+			if( epoch == 6 || epoch == 7 ) {
+				image = game->planes[player][epoch];
 			}
-			else if( soldier->epoch == 9 ) {
-				int frame = game_g->getFrameCounter() % 3;
-				image = game_g->saucers[soldier->player][frame];
+			else if( epoch == 9 ) {
+				int frame = game->getFrameCounter() % 3;
+				image = game->saucers[player][frame];
 			}
 			ASSERT(image != NULL);
-			image->draw(offset_land_x_c + soldier->xpos, offset_land_y_c + soldier->ypos);
-			if( soldier->epoch == 7 ) {
+			image->draw(offset_land_x_c + xpos, offset_land_y_c + ypos);
+			if( epoch == 7 ) {
 				if( current_sector->getJetParticleSystem() != NULL ) {
-					current_sector->getJetParticleSystem()->draw(offset_land_x_c + soldier->xpos + 17, offset_land_y_c + soldier->ypos + 17);
+					current_sector->getJetParticleSystem()->draw(offset_land_x_c + xpos + 17, offset_land_y_c + ypos + 17);
 				}
 			}
 		}
 	}
-	delete [] soldier_list;
 
 	// nuke
 	int nuke_time = -1;
@@ -1735,7 +1744,7 @@ void PlayingGameState::draw() {
 	if( nuke_by_player != -1 ) {
 		int xpos = -1, ypos = -1;
 		current_sector->getNukePos(&xpos, &ypos);
-		game_g->nukes[nuke_by_player][1]->draw(xpos, ypos);
+		game->nukes[nuke_by_player][1]->draw(xpos, ypos);
 		if( current_sector->getNukeParticleSystem() != NULL ) {
 			current_sector->getNukeParticleSystem()->draw(xpos + 23 - 4, ypos + 2 - 4);
 		}
@@ -1746,13 +1755,13 @@ void PlayingGameState::draw() {
 	int nuke_defence_y = 0;
 	if( current_sector->hasNuclearDefenceAnimation(&nuke_defence_time, &nuke_defence_x, &nuke_defence_y) ) {
 		ASSERT( nuke_defence_time != -1 );
-		float alpha = ((float)( game_g->getGameTime() - nuke_defence_time )) / (float)nuke_delay_c;
+		float alpha = ((float)( game->getGameTime() - nuke_defence_time )) / (float)nuke_delay_c;
 		ASSERT( alpha >= 0.0 );
 		if( alpha > 1.0 )
 			alpha = 1.0;
 		int ey = nuke_defence_y - 200;
 		int ypos = (int)(alpha * ey + (1.0 - alpha) * nuke_defence_y);
-		game_g->nukes[current_sector->getPlayer()][0]->draw(nuke_defence_x, ypos);
+		game->nukes[current_sector->getPlayer()][0]->draw(nuke_defence_x, ypos);
 		if( current_sector->getNukeDefenceParticleSystem() != NULL ) {
 			current_sector->getNukeDefenceParticleSystem()->draw(nuke_defence_x + 4 - 4, ypos + 31 - 4);
 		}
@@ -1760,7 +1769,7 @@ void PlayingGameState::draw() {
 
 	// playershields etc
 	for(int i=0;i<n_players_c;i++) {
-		if( game_g->players[i] != NULL && !game_g->players[i]->isDead() ) {
+		if( game->players[i] != NULL && !game->players[i]->isDead() ) {
 			//ASSERT( shield_buttons[i] != NULL );
 			if( shield_buttons[i] == NULL ) {
 				continue;
@@ -1768,20 +1777,20 @@ void PlayingGameState::draw() {
 			shield_number_panels[i]->setVisible(false);
 			/*int n_allied = 1;
 			for(j=i+1;j<n_players_c;j++) {
-			if( Player::isAlliance(i, j) ) {
+			if( game->isAlliance(i, j) ) {
 			n_allied++;
 			}
 			}*/
-			//playershields[ game_g->players[i]->getShieldIndex()  ]->draw(offset_map_x_c + 16 * map_width_c + 4, offset_map_y_c + shield_step_y_c * i + 8, true);
+			//playershields[ game->players[i]->getShieldIndex()  ]->draw(offset_map_x_c + 16 * map_width_c + 4, offset_map_y_c + shield_step_y_c * i + 8, true);
 			int off = 0;
 			for(int j=i;j<n_players_c;j++) {
-				if( j == i || Player::isAlliance(i, j) ) {
+				if( j == i || game->isAlliance(i, j) ) {
 					const Army *army = current_sector->getArmy(j);
 					int n_army = army->getTotal();
 					if( n_army > 0 ) {
 						shield_number_panels[i]->setVisible(true);
-						//Image::writeNumbers(offset_map_x_c + 16 * map_width_c + 20, offset_map_y_c + 2 + shield_step_y_c * i + 8, game_g->numbers_small[i], n_army, Image::JUSTIFY_LEFT, true);
-						Image::writeNumbers(offset_map_x_c + 16 * map_width_c + 20, offset_map_y_c + 2 + shield_step_y_c * i + 8 * off + 8, game_g->numbers_small[j], n_army, Image::JUSTIFY_LEFT);
+						//Image::writeNumbers(offset_map_x_c + 16 * map_width_c + 20, offset_map_y_c + 2 + shield_step_y_c * i + 8, game->numbers_small[i], n_army, Image::JUSTIFY_LEFT, true);
+						Image::writeNumbers(offset_map_x_c + 16 * map_width_c + 20, offset_map_y_c + 2 + shield_step_y_c * i + 8 * off + 8, game->numbers_small[j], n_army, Image::JUSTIFY_LEFT);
 						off++;
 					}
 				}
@@ -1790,14 +1799,14 @@ void PlayingGameState::draw() {
 	}
 
 	// panel
-	if( game_g->getTutorial() != NULL ) {
-		const TutorialCard *card = game_g->getTutorial()->getCard();
+	if( game->getTutorial() != NULL ) {
+		const TutorialCard *card = game->getTutorial()->getCard();
 		if( card != NULL ) {
 			const unsigned char tutorial_alpha_c = 127;
 			int n_lines = 0, max_wid = 0;
-			int s_w = game_g->letters_small[0]->getScaledWidth();
-			int l_w = game_g->letters_large[0]->getScaledWidth();
-			int l_h = game_g->letters_large[0]->getScaledHeight();
+			int s_w = game->letters_small[0]->getScaledWidth();
+			int l_w = game->letters_large[0]->getScaledWidth();
+			int l_h = game->letters_large[0]->getScaledHeight();
 			textLines(&n_lines, &max_wid, card->getText().c_str(), s_w, l_w);
 
 			Rect2D rect;
@@ -1805,20 +1814,20 @@ void PlayingGameState::draw() {
 			rect.y = 130;
 			rect.w = max_wid;
 			rect.h = n_lines * (l_h + 2);
-			const Image *player_image = game_g->player_heads_alliance[client_player];
+			const Image *player_image = game->player_heads_alliance[client_player];
 			if( player_image != NULL ) {
 				player_image->draw(rect.x, rect.y - player_image->getScaledHeight());
 			}
 #if SDL_MAJOR_VERSION == 1
-			Image *fill_rect = Image::createBlankImage(game_g->getScaleWidth()*rect.w, game_g->getScaleHeight()*rect.h, 24);
-			fill_rect->fillRect(0, 0, game_g->getScaleWidth()*rect.w, game_g->getScaleHeight()*rect.h, 0, 0, 0);
+			Image *fill_rect = Image::createBlankImage(game->getScaleWidth()*rect.w, game->getScaleHeight()*rect.h, 24);
+			fill_rect->fillRect(0, 0, game->getScaleWidth()*rect.w, game->getScaleHeight()*rect.h, 0, 0, 0);
 			fill_rect->convertToDisplayFormat();
-			fill_rect->drawWithAlpha(game_g->getScaleWidth()*rect.x, game_g->getScaleHeight()*rect.y, tutorial_alpha_c);
+			fill_rect->drawWithAlpha(game->getScaleWidth()*rect.x, game->getScaleHeight()*rect.y, tutorial_alpha_c);
 			delete fill_rect;
 #else
-			game_g->getScreen()->fillRectWithAlpha((short)(game_g->getScaleWidth()*rect.x), (short)(game_g->getScaleHeight()*rect.y), (short)(game_g->getScaleWidth()*rect.w), (short)(game_g->getScaleHeight()*rect.h), 0, 0, 0, tutorial_alpha_c);
+			game->getScreen()->fillRectWithAlpha((short)(game->getScaleWidth()*rect.x), (short)(game->getScaleHeight()*rect.y), (short)(game->getScaleWidth()*rect.w), (short)(game->getScaleHeight()*rect.h), 0, 0, 0, tutorial_alpha_c);
 #endif
-			Image::writeMixedCase(rect.x, rect.y, game_g->letters_large, game_g->letters_small, game_g->numbers_white, card->getText().c_str(), Image::JUSTIFY_LEFT);
+			Image::writeMixedCase(rect.x, rect.y, game->letters_large, game->letters_small, game->numbers_white, card->getText().c_str(), Image::JUSTIFY_LEFT);
 			if( card->hasArrow(this) ) {
 				int arrow_x = card->getArrowX();
 				int arrow_y = card->getArrowY();
@@ -1836,13 +1845,13 @@ void PlayingGameState::draw() {
 						src_y = rect.y + rect.h + 4;
 					}
 				}
-				game_g->getScreen()->drawLine((short)(game_g->getScaleWidth()*src_x), (short)(game_g->getScaleHeight()*src_y), (short)(game_g->getScaleWidth()*arrow_x), (short)(game_g->getScaleHeight()*arrow_y), 255, 255, 255);
+				game->getScreen()->drawLine((short)(game->getScaleWidth()*src_x), (short)(game->getScaleHeight()*src_y), (short)(game->getScaleWidth()*arrow_x), (short)(game->getScaleHeight()*arrow_y), 255, 255, 255);
 			}
 
 			if( !card->autoProceed() && card->canProceed(this) ) {
 				if( tutorial_next_button == NULL ) {
 					textLines(&n_lines, &max_wid, card->getNextText().c_str(), l_w, l_w);
-					tutorial_next_button = new Button(rect.x + rect.w - max_wid, rect.y + rect.h + 4, card->getNextText().c_str(), game_g->letters_large);
+					tutorial_next_button = new Button(rect.x + rect.w - max_wid, rect.y + rect.h + 4, card->getNextText().c_str(), game->letters_large);
 					tutorial_next_button->setBackground(0, 0, 0, tutorial_alpha_c);
 					screen_page->add(tutorial_next_button);
 				}
@@ -1854,8 +1863,8 @@ void PlayingGameState::draw() {
 				}
 			}
 			if( card->autoProceed() && card->canProceed(this) ) {
-				game_g->getTutorial()->proceed();
-				const TutorialCard *new_card = game_g->getTutorial()->getCard();
+				game->getTutorial()->proceed();
+				const TutorialCard *new_card = game->getTutorial()->getCard();
 				if( new_card != NULL ) {
 					new_card->setGUI(this);
 				}
@@ -1866,7 +1875,10 @@ void PlayingGameState::draw() {
 		}
 	}
 
-	this->gamePanel->draw();
+	{
+		ProfileScope profile_scope(game->getProfiler(), PROFILE_PANEL_DRAW);
+		this->gamePanel->draw();
+	}
 	//this->gamePanel->drawPopups();
 
 	this->screen_page->draw();
@@ -1897,30 +1909,30 @@ void PlayingGameState::draw() {
 	GameState::setDefaultMouseImage();
 	mouse_off_x = 0;
 	mouse_off_y = 0;
-	if( game_g->getGameStateID() == GAMESTATEID_PLAYING ) {
+	if( game->getGameStateID() == GAMESTATEID_PLAYING ) {
 		GamePanel::MouseState mousestate = gamePanel->getMouseState();
 		if( mousestate == GamePanel::MOUSESTATE_DEPLOY_WEAPON || selected_army != NULL ) {
 			ASSERT( mousestate != GamePanel::MOUSESTATE_DEPLOY_WEAPON || selected_army == NULL );
 			bool bloody = false;
 			const Sector *this_sector = ( selected_army == NULL ) ? current_sector : selected_army->getSector();
 			if( this_sector->getPlayer() != client_player ) {
-				if( this_sector->getPlayer() != PLAYER_NONE && !Player::isAlliance(this_sector->getPlayer(), client_player) )
+				if( this_sector->getPlayer() != PLAYER_NONE && !game->isAlliance(this_sector->getPlayer(), client_player) )
 					bloody = true;
 				for(int i=0;i<n_players_c && !bloody;i++) {
-					if( i != client_player && !Player::isAlliance(i, client_player) ) {
+					if( i != client_player && !game->isAlliance(i, client_player) ) {
 						if( this_sector->getArmy(i)->any(true) )
 							bloody = true;
 					}
 				}
 			}
 			if( bloody )
-				mouse_image = game_g->panel_bloody_attack;
+				mouse_image = game->panel_bloody_attack;
 			else
-				mouse_image = game_g->panel_attack;
+				mouse_image = game->panel_attack;
 			mobile_ui_display_mouse = true;
 		}
 		else if( mousestate == GamePanel::MOUSESTATE_DEPLOY_DEFENCE ) {
-			mouse_image = game_g->panel_defence;
+			mouse_image = game->panel_defence;
 			//m_x -= mouse_image->getScaledWidth() / 2;
 			//m_y -= mouse_image->getScaledHeight() / 2;
 			mouse_off_x = - mouse_image->getScaledWidth() / 2;
@@ -1928,7 +1940,7 @@ void PlayingGameState::draw() {
 			mobile_ui_display_mouse = true;
 		}
 		else if( mousestate == GamePanel::MOUSESTATE_DEPLOY_SHIELD ) {
-			mouse_image = game_g->panel_shield;
+			mouse_image = game->panel_shield;
 			mobile_ui_display_mouse = true;
 			//m_x -= mouse_image->getScaledWidth() / 2;
 			//m_y -= mouse_image->getScaledHeight() / 2;
@@ -1936,7 +1948,7 @@ void PlayingGameState::draw() {
 			mouse_off_y = - mouse_image->getScaledHeight() / 2;
 		}
 		else if( mousestate == GamePanel::MOUSESTATE_SHUTDOWN ) {
-			mouse_image = game_g->men[n_epochs_c-1];
+			mouse_image = game->men[n_epochs_c-1];
 			mouse_off_x = - mouse_image->getScaledWidth() / 2;
 			mouse_off_y = - mouse_image->getScaledHeight() / 2;
 			mobile_ui_display_mouse = true;
@@ -1946,6 +1958,79 @@ void PlayingGameState::draw() {
 	GameState::draw();
 }
 
+/** Draws the parts of the sector view that don't change from frame to frame, other than the tree animation:
+ *  the background, land, features behind the soldiers, and the building images. These are drawn to a render
+ *  target for each frame of the tree animation, which is reused until the current sector or its appearance
+ *  changes. The buildings don't overlap, so their defenders, flags and health bars are drawn afterwards.
+ */
+void PlayingGameState::drawStaticLayer() {
+	int frame = Feature::getAnimationCounter() % n_tree_frames_c;
+	if( static_layers.size() == 0 ) {
+		this->drawStaticLayer(frame);
+		return;
+	}
+
+	bool open_pit_mine = this->openPitMine();
+	if( static_layer_sector != current_sector || static_layer_generation != current_sector->getAppearanceGeneration() || static_layer_open_pit_mine != open_pit_mine || static_layer_targets_generation != Image::getRenderTargetsGeneration() ) {
+		static_layer_sector = current_sector;
+		static_layer_generation = current_sector->getAppearanceGeneration();
+		static_layer_open_pit_mine = open_pit_mine;
+		static_layer_targets_generation = Image::getRenderTargetsGeneration();
+		for(size_t i=0;i<static_layer_valid.size();i++) {
+			static_layer_valid[i] = false;
+		}
+	}
+	if( !static_layer_valid[frame] ) {
+		if( !static_layers[frame]->setRenderTarget() ) {
+			this->drawStaticLayer(frame);
+			return;
+		}
+		game->getScreen()->clear();
+		this->drawStaticLayer(frame);
+		Image::resetRenderTarget();
+		static_layer_valid[frame] = true;
+	}
+	static_layers[frame]->draw(0, 0);
+}
+
+/** Draws the static layer directly, with the given frame of the tree animation.
+ */
+void PlayingGameState::drawStaticLayer(int frame) {
+	game->background->draw(0, 0);
+
+	// land area
+	game->land[game->getMap()->getColour()]->draw(offset_land_x_c, offset_land_y_c);
+
+	// trees etc (not at front)
+	for(int i=0;i<current_sector->getNFeatures();i++) {
+		const Feature *feature = current_sector->getFeature(i);
+		if( !feature->isAtFront() ) {
+			ASSERT( n_tree_frames_c % feature->getNFrames() == 0 );
+			feature->draw(frame);
+		}
+	}
+
+	if( current_sector->getActivePlayer() != -1 ) {
+		if( openPitMine() )
+			game->icon_openpitmine->draw(offset_land_x_c + offset_openpitmine_x_c, offset_land_y_c + offset_openpitmine_y_c);
+
+		for(int i=0;i<N_BUILDINGS;i++) {
+			Building *building = current_sector->getBuilding((Type)i);
+			if( building != NULL ) {
+				Image **images = building->getImages();
+				images[ current_sector->getBuildingEpoch() ]->draw(offset_land_x_c + building->getX(), offset_land_y_c + building->getY());
+			}
+		}
+	}
+	else if( current_sector->getPlayer() != -1 ) {
+		ASSERT( current_sector->isShutdown() );
+		Building *building = current_sector->getBuilding(BUILDING_TOWER);
+		ASSERT( building != NULL );
+		Image **images = building->getImages();
+		images[ current_sector->getBuildingEpoch() ]->draw(offset_land_x_c + building->getX(), offset_land_y_c + building->getY());
+	}
+}
+
 void PlayingGameState::update() {
 	/*if( this->smokeParticleSystem != NULL ) {
 		if( current_sector->getWorkers() > 0 ) {
@@ -1961,43 +2046,43 @@ void PlayingGameState::update() {
 	int move_cannon_step_y = 0;
 	int move_air_step = 0;
 	if( soldier_last_time_moved_x == -1 )
-		soldier_last_time_moved_x = game_g->getGameTime();
+		soldier_last_time_moved_x = game->getGameTime();
 	if( soldier_last_time_moved_y == -1 )
-		soldier_last_time_moved_y = game_g->getGameTime();
+		soldier_last_time_moved_y = game->getGameTime();
 	if( cannon_last_time_moved_x == -1 )
-		cannon_last_time_moved_x = game_g->getGameTime();
+		cannon_last_time_moved_x = game->getGameTime();
 	if( cannon_last_time_moved_y == -1 )
-		cannon_last_time_moved_y = game_g->getGameTime();
+		cannon_last_time_moved_y = game->getGameTime();
 	if( air_last_time_moved == -1 )
-		air_last_time_moved = game_g->getGameTime();
+		air_last_time_moved = game->getGameTime();
 	// move twice as fast in x direction, to simulate 3D look
-	while( game_g->getGameTime() - soldier_last_time_moved_x > soldier_move_rate_c ) {
+	while( game->getGameTime() - soldier_last_time_moved_x > soldier_move_rate_c ) {
 		move_soldier_step_x++;
 		soldier_last_time_moved_x += soldier_move_rate_c;
 	}
-	while( game_g->getGameTime() - soldier_last_time_moved_y > 2*soldier_move_rate_c ) {
+	while( game->getGameTime() - soldier_last_time_moved_y > 2*soldier_move_rate_c ) {
 		move_soldier_step_y++;
 		soldier_last_time_moved_y += 2*soldier_move_rate_c;
 	}
-	while( game_g->getGameTime() - cannon_last_time_moved_x > cannon_move_rate_c ) {
+	while( game->getGameTime() - cannon_last_time_moved_x > cannon_move_rate_c ) {
 		move_cannon_step_x++;
 		cannon_last_time_moved_x += cannon_move_rate_c;
 	}
-	while( game_g->getGameTime() - cannon_last_time_moved_y > 2*cannon_move_rate_c ) {
+	while( game->getGameTime() - cannon_last_time_moved_y > 2*cannon_move_rate_c ) {
 		move_cannon_step_y++;
 		cannon_last_time_moved_y += 2*cannon_move_rate_c;
 	}
-	while( game_g->getGameTime() - air_last_time_moved > air_move_rate_c ) {
+	while( game->getGameTime() - air_last_time_moved > air_move_rate_c ) {
 		move_air_step++;
 		air_last_time_moved += air_move_rate_c;
 	}
-	/*bool move_soldiers = ( game_g->getGameTime() - soldiers_last_time_moved > soldier_move_rate_c );
-	bool move_air = ( game_g->getGameTime() - air_last_time_moved > air_move_rate_c );
+	/*bool move_soldiers = ( game->getGameTime() - soldiers_last_time_moved > soldier_move_rate_c );
+	bool move_air = ( game->getGameTime() - air_last_time_moved > air_move_rate_c );
 	if( move_soldiers )
-	soldiers_last_time_moved = game_g->getGameTime();
+	soldiers_last_time_moved = game->getGameTime();
 	if( move_air )
-	air_last_time_moved = game_g->getGameTime();*/
-	int time_interval = game_g->getLoopTime();
+	air_last_time_moved = game->getGameTime();*/
+	int time_interval = game->getLoopTime();
 
 	int n_armies = 0;
 	for(int i=0;i<n_players_c;i++) {
@@ -2010,44 +2095,44 @@ void PlayingGameState::update() {
 		combat = true;
 	}
 
+	// soldiers fire and turn at the same rate, and it's the same for every soldier, so only look up once per frame
 	int fire_prob = poisson(soldier_turn_rate_c, time_interval);
+	int turn_prob = fire_prob;
+	this->updateLandOccupancy(); // buildings may have been built or destroyed since the last update
 	for(int i=0;i<n_players_c;i++) {
 		//for(int j=0;j<n_soldiers[i];j++) {
-		for(size_t j=0;j<soldiers[i].size();j++) {
-			//Soldier *soldier = soldiers[i][j];
-			//Soldier *soldier = (Soldier *)soldiers[i]->get(j);
-			Soldier *soldier = soldiers[i].at(j);
-			//if( soldier->epoch == 6 || soldier->epoch == 7 || soldier->epoch == 9 ) {
-			if( isAirUnit(soldier->epoch) ) {
+		SoldierList *list = &soldiers[i];
+		for(size_t j=0;j<list->size();j++) {
+			int soldier_epoch = list->epoch[j];
+			int &soldier_x = list->xpos[j];
+			int &soldier_y = list->ypos[j];
+			AmmoDirection &soldier_dir = list->dir[j];
+			//if( soldier_epoch == 6 || soldier_epoch == 7 || soldier_epoch == 9 ) {
+			if( isAirUnit(soldier_epoch) ) {
 				// air unit
 				if( move_air_step > 0 ) {
-					soldier->xpos -= move_air_step;
-					soldier->ypos -= move_air_step;
-					while( soldier->xpos < - offset_land_x_c - 32 )
-						soldier->xpos += default_width_c + 64;
-					while( soldier->ypos < - offset_land_y_c - 32 )
-						soldier->ypos += default_height_c + 64;
+					soldier_x -= move_air_step;
+					soldier_y -= move_air_step;
+					while( soldier_x < - offset_land_x_c - 32 )
+						soldier_x += default_width_c + 64;
+					while( soldier_y < - offset_land_y_c - 32 )
+						soldier_y += default_height_c + 64;
 				}
 				if( combat ) {
-					int fire_random = rand() % RAND_MAX;
+					int fire_random = game->random(RANDOM_COSMETIC) % RAND_MAX;
 					if( fire_random <= fire_prob ) {
 						// fire!
-						AmmoEffect *ammoeffect = new AmmoEffect( this, soldier->epoch, ATTACKER_AMMO_BOMB, soldier->xpos + 4, soldier->ypos + 8 );
+						AmmoEffect *ammoeffect = new (&ammo_effect_pool) AmmoEffect( this, soldier_epoch, ATTACKER_AMMO_BOMB, soldier_x + 4, soldier_y + 8 );
 						this->ammo_effects.push_back(ammoeffect);
 					}
 				}
 			}
 			else {
-				if( !validSoldierLocation(soldier->epoch,soldier->xpos, soldier->ypos) ) {
+				if( !validSoldierLocation(soldier_epoch,soldier_x, soldier_y) ) {
 					/* Soldier is already invalid location. This usually happens if the scenery suddenly
 					* changes (eg, new building appearing). If this happens, find a new valid locaation.
 					*/
-					bool found_loc = false;
-					while(!found_loc) {
-						soldier->xpos = rand() % land_width_c;
-						soldier->ypos = rand() % land_height_c;
-						found_loc = validSoldierLocation(soldier->epoch, soldier->xpos, soldier->ypos);
-					}
+					randomSoldierLocation(soldier_epoch, &soldier_x, &soldier_y);
 				}
 				/* Turns are modelled as a Poisson distribution - so soldier_turn_rate_c is the mean number of
 				* ticks that elapse per turn. Therefore we are interested in the probability that at least one
@@ -2056,85 +2141,105 @@ void PlayingGameState::update() {
 				/*double prob = 1.0 - exp( - ((double)time_interval) / soldier_turn_rate_c );
 				double random = ((double)( rand() % RAND_MAX )) / (double)RAND_MAX;*/
 				//double prob = RAND_MAX * ( 1.0 - exp( - ((double)time_interval) / soldier_turn_rate_c ) );
-				int prob = poisson(soldier_turn_rate_c, time_interval);
-				int random = rand() % RAND_MAX;
-				if( random <= prob ) {
+				int random = game->random(RANDOM_COSMETIC) % RAND_MAX;
+				if( random <= turn_prob ) {
 					// turn!
-					soldier->dir = (AmmoDirection)(rand() % 4);
+					soldier_dir = (AmmoDirection)(game->random(RANDOM_COSMETIC) % 4);
 				}
 				int move_step = 0;
-				if( soldier->epoch == cannon_epoch_c )
-					move_step = (soldier->dir == 0 || soldier->dir == 1) ? move_cannon_step_y : move_cannon_step_x;
+				if( soldier_epoch == cannon_epoch_c )
+					move_step = (soldier_dir == 0 || soldier_dir == 1) ? move_cannon_step_y : move_cannon_step_x;
 				else
-					move_step = (soldier->dir == 0 || soldier->dir == 1) ? move_soldier_step_y : move_soldier_step_x;
+					move_step = (soldier_dir == 0 || soldier_dir == 1) ? move_soldier_step_y : move_soldier_step_x;
 				if( move_step > 0  ) {
 					int step_x = 0;
 					int step_y = 0;
-					if( soldier->dir == 0 )
+					if( soldier_dir == 0 )
 						step_y = move_step;
-					else if( soldier->dir == 1 )
+					else if( soldier_dir == 1 )
 						step_y = - move_step;
-					else if( soldier->dir == 2 )
+					else if( soldier_dir == 2 )
 						step_x = move_step;
-					else if( soldier->dir == 3 )
+					else if( soldier_dir == 3 )
 						step_x = - move_step;
 
-					int new_xpos = soldier->xpos + step_x;
-					int new_ypos = soldier->ypos + step_y;
-					if( !validSoldierLocation(soldier->epoch,new_xpos, new_ypos) ) {
+					int new_xpos = soldier_x + step_x;
+					int new_ypos = soldier_y + step_y;
+					if( !validSoldierLocation(soldier_epoch,new_xpos, new_ypos) ) {
 						// path blocked, so turn around
-						new_xpos = soldier->xpos;
-						new_ypos = soldier->ypos;
-						if( soldier->dir == 0 )
-							soldier->dir = (AmmoDirection)1;
-						else if( soldier->dir == 1 )
-							soldier->dir = (AmmoDirection)0;
-						else if( soldier->dir == 2 )
-							soldier->dir = (AmmoDirection)3;
-						else if( soldier->dir == 3 )
-							soldier->dir = (AmmoDirection)2;
+						new_xpos = soldier_x;
+						new_ypos = soldier_y;
+						if( soldier_dir == 0 )
+							soldier_dir = (AmmoDirection)1;
+						else if( soldier_dir == 1 )
+							soldier_dir = (AmmoDirection)0;
+						else if( soldier_dir == 2 )
+							soldier_dir = (AmmoDirection)3;
+						else if( soldier_dir == 3 )
+							soldier_dir = (AmmoDirection)2;
 					}
-					soldier->xpos = new_xpos;
-					soldier->ypos = new_ypos;
+					soldier_x = new_xpos;
+					soldier_y = new_ypos;
 				}
 
-				if( combat && soldier->epoch != n_epochs_c ) {
-					int fire_random = rand() % RAND_MAX;
+				if( combat && soldier_epoch != n_epochs_c ) {
+					int fire_random = game->random(RANDOM_COSMETIC) % RAND_MAX;
 					if( fire_random <= fire_prob ) {
 						// fire!
-						Image *image = game_g->attackers_walking[soldier->player][soldier->epoch][soldier->dir][0];
+						Image *image = game->attackers_walking[i][soldier_epoch][soldier_dir][0];
 						int xpos = 0, ypos = 0;
-						if( soldier->epoch == cannon_epoch_c ) {
-							xpos = soldier->xpos;
-							ypos = soldier->ypos;
-							if( soldier->dir == ATTACKER_AMMO_LEFT ) {
-								xpos = soldier->xpos;
-								ypos = soldier->ypos;
+						if( soldier_epoch == cannon_epoch_c ) {
+							xpos = soldier_x;
+							ypos = soldier_y;
+							if( soldier_dir == ATTACKER_AMMO_LEFT ) {
+								xpos = soldier_x;
+								ypos = soldier_y;
 							}
-							else if( soldier->dir == ATTACKER_AMMO_RIGHT ) {
-								xpos = soldier->xpos + image->getScaledWidth();
-								ypos = soldier->ypos;
+							else if( soldier_dir == ATTACKER_AMMO_RIGHT ) {
+								xpos = soldier_x + image->getScaledWidth();
+								ypos = soldier_y;
 							}
-							else if( soldier->dir == ATTACKER_AMMO_UP ) {
-								xpos = soldier->xpos + image->getScaledWidth()/4;
-								ypos = soldier->ypos;
+							else if( soldier_dir == ATTACKER_AMMO_UP ) {
+								xpos = soldier_x + image->getScaledWidth()/4;
+								ypos = soldier_y;
 							}
-							else if( soldier->dir == ATTACKER_AMMO_DOWN ) {
-								xpos = soldier->xpos + image->getScaledWidth()/4;
-								ypos = soldier->ypos + image->getScaledHeight();
+							else if( soldier_dir == ATTACKER_AMMO_DOWN ) {
+								xpos = soldier_x + image->getScaledWidth()/4;
+								ypos = soldier_y + image->getScaledHeight();
 							}
 						}
 						else {
-							xpos = soldier->xpos + image->getScaledWidth()/2;
-							ypos = soldier->ypos;
+							xpos = soldier_x + image->getScaledWidth()/2;
+							ypos = soldier_y;
 						}
-						AmmoEffect *ammoeffect = new AmmoEffect( this, soldier->epoch, soldier->dir, xpos, ypos );
+						AmmoEffect *ammoeffect = new (&ammo_effect_pool) AmmoEffect( this, soldier_epoch, soldier_dir, xpos, ypos );
 						this->ammo_effects.push_back(ammoeffect);
 					}
 				}
 			}
 		}
 	}
+
+	// advance the effects here rather than when drawing, so they last the same however often (if at all) the
+	// game is drawn; n.b., ammo may add explosions to effects, which start from the next update
+	updateEffects(&effects);
+	updateEffects(&ammo_effects);
+}
+
+/** Updates the effects, removing those that have finished, while keeping the rest in order.
+ */
+void PlayingGameState::updateEffects(vector<TimedEffect *> *effects) {
+	size_t n_kept = 0;
+	for(size_t i=0;i<effects->size();i++) {
+		TimedEffect *effect = effects->at(i);
+		if( effect->update() ) {
+			delete effect;
+		}
+		else {
+			(*effects)[n_kept++] = effect;
+		}
+	}
+	effects->resize(n_kept);
 }
 
 bool PlayingGameState::buildingMouseClick(int s_m_x,int s_m_y,bool m_left,bool m_right,Building *building) {
@@ -2200,7 +2305,7 @@ bool PlayingGameState::buildingMouseClick(int s_m_x,int s_m_y,bool m_left,bool m
 }
 
 void PlayingGameState::moveTo(int map_x,int map_y) {
-	current_sector = game_g->getMap()->getSector(map_x, map_y);
+	current_sector = game->getMap()->getSector(map_x, map_y);
 	if( this->getGamePanel() != NULL )
 		this->getGamePanel()->setPage( GamePanel::STATE_SECTORCONTROL );
 	this->reset();
@@ -2218,15 +2323,15 @@ void PlayingGameState::moveTo(int map_x,int map_y) {
 
 bool PlayingGameState::canRequestAlliance(int player,int i) const {
 	ASSERT(player != i);
-	ASSERT(game_g->players[player] != NULL);
-	ASSERT(!game_g->players[player]->isDead());
+	ASSERT(game->players[player] != NULL);
+	ASSERT(!game->players[player]->isDead());
 	bool ok = true;
 	// check not already allied
 	for(int j=0;j<n_players_c && ok;j++) {
-		if( j == player || game_g->players[j] == NULL || game_g->players[j]->isDead() ) {
+		if( j == player || game->players[j] == NULL || game->players[j]->isDead() ) {
 		}
-		else if( j == i || Player::isAlliance(i, j) ) {
-			if( Player::isAlliance(player, j) )
+		else if( j == i || game->isAlliance(i, j) ) {
+			if( game->isAlliance(player, j) )
 				ok = false;
 		}
 	}
@@ -2234,12 +2339,12 @@ bool PlayingGameState::canRequestAlliance(int player,int i) const {
 	// check still two sides
 	bool allied_all_others = ok;
 	for(int j=0;j<n_players_c && allied_all_others;j++) {
-		if( j == player || game_g->players[j] == NULL || game_g->players[j]->isDead() ) {
+		if( j == player || game->players[j] == NULL || game->players[j]->isDead() ) {
 		}
-		else if( j == i || Player::isAlliance(i, j) ) {
+		else if( j == i || game->isAlliance(i, j) ) {
 			// player on the side that we are requesting an alliance with
 		}
-		else if( !Player::isAlliance(player, j) ) {
+		else if( !game->isAlliance(player, j) ) {
 			allied_all_others = false;
 		}
 	}
@@ -2254,10 +2359,10 @@ void PlayingGameState::requestAlliance(int player,int i,bool human) {
 		// AIs only supported in non-player mode
 		ASSERT(gameMode == GAMEMODE_SINGLEPLAYER);
 	}*/
-	ASSERT(game_g->getGameMode() == GAMEMODE_SINGLEPLAYER); // blocked for now
+	ASSERT(game->getGameMode() == GAMEMODE_SINGLEPLAYER); // blocked for now
 	ASSERT(player != i);
-	ASSERT(game_g->players[player] != NULL);
-	ASSERT(!game_g->players[player]->isDead());
+	ASSERT(game->players[player] != NULL);
+	ASSERT(!game->players[player]->isDead());
 	//ASSERT(i != human_player); // todo: for requesting with human player
 	bool ok = true;
 	bool ask_human_player = false;
@@ -2266,40 +2371,40 @@ void PlayingGameState::requestAlliance(int player,int i,bool human) {
 	// okay to request?
 	// check i, and those who are allied with i
 	for(int j=0;j<n_players_c && ok;j++) {
-		if( j == player || game_g->players[j] == NULL || game_g->players[j]->isDead() ) {
+		if( j == player || game->players[j] == NULL || game->players[j]->isDead() ) {
 		}
-		else if( j == i || Player::isAlliance(i, j) ) {
+		else if( j == i || game->isAlliance(i, j) ) {
 			//if( j == human_player ) {
-			if( game_g->players[j]->isHuman() ) {
+			if( game->players[j]->isHuman() ) {
 				// request if human is part of alliance
 				ask_human_player = true;
 				playing_asking_human = player;
 				human_player = j;
 			}
-			else if( !game_g->players[j]->requestAlliance(player) ) {
+			else if( !game->players[j]->requestAlliance(player) ) {
 				ok = false;
 				if( human )
-					playSample(game_g->s_alliance_no[j]);
+					playSample(game->s_alliance_no[j]);
 			}
 		}
 	}
 	// check those who are allied with player
 	for(int j=0;j<n_players_c && ok;j++) {
-		if( j == player || game_g->players[j] == NULL || game_g->players[j]->isDead() ) {
+		if( j == player || game->players[j] == NULL || game->players[j]->isDead() ) {
 		}
-		else if( Player::isAlliance(player, j) ) {
+		else if( game->isAlliance(player, j) ) {
 			//if( j == human_player ) {
-			if( game_g->players[j]->isHuman() ) {
+			if( game->players[j]->isHuman() ) {
 				// request if human is part of alliance
 				//ok = false;
 				ask_human_player = true;
 				playing_asking_human = i;
 				human_player = j;
 			}
-			else if( !game_g->players[j]->requestAlliance(i) ) {
+			else if( !game->players[j]->requestAlliance(i) ) {
 				ok = false;
 				if( human )
-					playSample(game_g->s_alliance_no[j]);
+					playSample(game->s_alliance_no[j]);
 			}
 		}
 	}
@@ -2310,8 +2415,8 @@ void PlayingGameState::requestAlliance(int player,int i,bool human) {
 		}
 		else {
 			// askHuman() is called to avoid the cpu player repeatedly asking
-			if( game_g->players[playing_asking_human]->askHuman() && game_g->players[playing_asking_human]->requestAlliance(human_player) ) {
-				playSample(game_g->s_alliance_ask[playing_asking_human]);
+			if( game->players[playing_asking_human]->askHuman() && game->players[playing_asking_human]->requestAlliance(human_player) ) {
+				playSample(game->s_alliance_ask[playing_asking_human]);
 				this->player_asking_alliance = playing_asking_human;
 				//this->reset();
 				this->setupMapGUI(); // needed to change the map GUI to ask player; call this rather than reset(), to avoid resetting the entire GUI (which causes the GUI to return to main sector control)
@@ -2320,20 +2425,20 @@ void PlayingGameState::requestAlliance(int player,int i,bool human) {
 	}
 	else if( ok ) {
 		if( human )
-			playSample(game_g->s_alliance_yes[i]);
+			playSample(game->s_alliance_yes[i]);
 		makeAlliance(player, i);
 	}
 }
 
 void PlayingGameState::makeAlliance(int player,int i) {
 	for(int j=0;j<n_players_c;j++) {
-		if( j == player || game_g->players[j] == NULL || game_g->players[j]->isDead() ) {
+		if( j == player || game->players[j] == NULL || game->players[j]->isDead() ) {
 		}
-		else if( j == i || Player::isAlliance(i, j) ) {
+		else if( j == i || game->isAlliance(i, j) ) {
 			// bring player j into the alliance
 			for(int k=0;k<n_players_c;k++) {
-				if( k != j && ( k == player || Player::isAlliance(k, player) ) ) {
-					Player::setAlliance(k, j, true);
+				if( k != j && ( k == player || game->isAlliance(k, player) ) ) {
+					game->setAlliance(k, j, true);
 				}
 			}
 		}
@@ -2353,19 +2458,19 @@ void PlayingGameState::cancelPlayerAskingAlliance() {
 }
 
 void PlayingGameState::refreshTimeRate() {
-	speed_button->setImage( game_g->icon_speeds[ game_g->getTimeRate()-1 ] );
+	speed_button->setImage( game->icon_speeds[ game->getTimeRateIcon() ] );
 }
 
 void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool m_right,bool click) {
-	if( !game_g->isDemo() && game_g->players[client_player]->isDead() ) {
+	if( !game->isDemo() && game->players[client_player]->isDead() ) {
 		return;
 	}
 	GameState::mouseClick(m_x, m_y, m_left, m_middle, m_right, click);
 
 	//bool m_left = mouse_left(m_b);
 	//bool m_right = mouse_right(m_b);
-	int s_m_x = (int)(m_x / game_g->getScaleWidth());
-	int s_m_y = (int)(m_y / game_g->getScaleHeight());
+	int s_m_x = (int)(m_x / game->getScaleWidth());
+	int s_m_y = (int)(m_y / game->getScaleHeight());
 
 	bool done = false;
 	bool clear_selected_army = true;
@@ -2380,8 +2485,8 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 		ASSERT( this->alliance_yes != NULL );
 		ASSERT( this->alliance_no != NULL );
 		if( this->alliance_yes->mouseOver(m_x, m_y) ) {
-			ASSERT( game_g->players[player_asking_alliance] != NULL );
-			ASSERT( !game_g->players[player_asking_alliance]->isDead() );
+			ASSERT( game->players[player_asking_alliance] != NULL );
+			ASSERT( !game->players[player_asking_alliance]->isDead() );
 			this->makeAlliance(player_asking_alliance, client_player);
 			// makeAlliance also cancels
 			done = true;
@@ -2395,15 +2500,15 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 		}
 	}
 	if( !done && click && map_x >= 0 && map_x < map_width_c && map_y >= 0 && map_y < map_height_c ) {
-		if( this->player_asking_alliance == -1 && map_display == MAPDISPLAY_MAP && game_g->getMap()->isSectorAt(map_x, map_y) && this->map_panels[map_x][map_y]->mouseOver(m_x, m_y) ) {
+		if( this->player_asking_alliance == -1 && map_display == MAPDISPLAY_MAP && game->getMap()->isSectorAt(map_x, map_y) && this->map_panels[map_x][map_y]->mouseOver(m_x, m_y) ) {
 			// although the mouse should always be over the map square, we call mouseOver so that the enabled flag is checked
 			done = true;
 			if( m_left && selected_army != NULL ) {
-				if( selected_army->getSector() != game_g->getMap()->getSector(map_x, map_y) ) {
+				if( selected_army->getSector() != game->getMap()->getSector(map_x, map_y) ) {
 					int n_nukes = selected_army->getSoldiers(nuclear_epoch_c);
 					ASSERT( n_nukes == 0 );
 					// move selected army
-					/*if( game_g->getMap()->getSector(map_x, map_y)->moveArmy(selected_army) ) {
+					/*if( game->getMap()->getSector(map_x, map_y)->moveArmy(selected_army) ) {
 						this->moveTo(map_x,map_y);
 					}*/
 					if( this->moveArmyTo(selected_army->getSector()->getXPos(), selected_army->getSector()->getYPos(), map_x, map_y) ) {
@@ -2418,7 +2523,7 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 			else if( m_left && this->getGamePanel()->getMouseState() == GamePanel::MOUSESTATE_DEPLOY_WEAPON ) {
 				// deploy assembled army
 				ASSERT( current_sector->getAssembledArmy() != NULL );
-				Sector *target_sector = game_g->getMap()->getSector(map_x, map_y);
+				Sector *target_sector = game->getMap()->getSector(map_x, map_y);
 				if( target_sector->isNuked() ) {
 					//clear_selected_army = false;
 				}
@@ -2432,10 +2537,10 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 							// don't nuke own sector
 							LOG("don't nuke own sector: %d\n", target_sector->getActivePlayer());
 						}
-						else if( target_sector->getActivePlayer() != -1 && Player::isAlliance(current_sector->getPlayer(), target_sector->getPlayer()) ) {
+						else if( target_sector->getActivePlayer() != -1 && game->isAlliance(current_sector->getPlayer(), target_sector->getPlayer()) ) {
 							// don't nuke allied sectors
 							LOG("don't nuke allied sector\n");
-							playSample(game_g->s_cant_nuke_ally);
+							playSample(game->s_cant_nuke_ally);
 						}
 						else {
 							if( this->nukeSector(current_sector->getXPos(), current_sector->getYPos(), map_x, map_y) ) {
@@ -2443,7 +2548,7 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 							}
 						}
 					}
-					//else if( game_g->getMap()->getSector(map_x, map_y)->moveArmy(current_sector->getAssembledArmy() ) ) {
+					//else if( game->getMap()->getSector(map_x, map_y)->moveArmy(current_sector->getAssembledArmy() ) ) {
 					else if( this->moveAssembledArmyTo(current_sector->getXPos(), current_sector->getYPos(), map_x, map_y) ) {
 						this->getGamePanel()->setMouseState(GamePanel::MOUSESTATE_NORMAL);
 						this->moveTo(map_x,map_y);
@@ -2451,7 +2556,7 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 				}
 			}
 			else if( m_left ) {
-				//if( game_g->getMap()->sectors[map_x][map_y] != current_sector )
+				//if( game->getMap()->sectors[map_x][map_y] != current_sector )
 				{
 					// move to viewing a different sector
 					if( current_sector->getPlayer() == client_player ) {
@@ -2462,9 +2567,9 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 					this->moveTo(map_x,map_y);
 				}
 			}
-			else if( m_right && !game_g->isDemo() ) {
+			else if( m_right && !game->isDemo() ) {
 				// select an army
-				Army *army = game_g->getMap()->getSector(map_x, map_y)->getArmy(client_player);
+				Army *army = game->getMap()->getSector(map_x, map_y)->getArmy(client_player);
 				if( army->getTotal() > 0 ) {
 					done = true;
 					selected_army = army;
@@ -2477,19 +2582,19 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 	if( !done && ( m_left || m_right ) && click && speed_button != NULL && speed_button->mouseOver(m_x, m_y) ) {
         done = true;
         registerClick();
-        if( game_g->oneMouseButtonMode() ) {
+        if( game->oneMouseButtonMode() ) {
 			// cycle through the speeds
-			game_g->cycleTimeRate();
+			game->cycleTimeRate();
 		}
 		else {
 			if( m_left ) {
-				game_g->increaseTimeRate();
+				game->increaseTimeRate();
 			}
 			else if( m_right ) {
-				game_g->decreaseTimeRate();
+				game->decreaseTimeRate();
 			}
 		}
-		LOG("set time_rate to %d\n", game_g->getTimeRate());
+		LOG("set time_rate to %d\n", game->getTimeRate());
 		refreshTimeRate();
 		//processClick(buttonSpeedClick, this->screen_page, this, 0, speed_button, m_left, m_middle, m_right);
 	}
@@ -2503,8 +2608,8 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
         done = true;
         registerClick();
         ASSERT( confirm_window != NULL );
-		game_g->saveState();
-	    game_g->getApplication()->setQuit();
+		game->saveState();
+	    game->getApplication()->setQuit();
 	}
 	else if( !done && m_left && click && confirm_button_2 != NULL && confirm_button_2->mouseOver(m_x, m_y) ) {
 		// exit battle
@@ -2522,15 +2627,15 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
     }
 	else if( !done && m_left && click && pause_button != NULL && pause_button->mouseOver(m_x, m_y) ) {
 		// should always be non-paused if we are here!
-		if( !game_g->isPaused() ) {
+		if( !game->isPaused() ) {
             done = true;
             registerClick();
-			game_g->togglePause();
+			game->togglePause();
 		}
 	}
 	else if( !done && m_left && click && tutorial_next_button != NULL && tutorial_next_button->mouseOver(m_x, m_y) ) {
-		game_g->getTutorial()->proceed();
-		const TutorialCard *new_card = game_g->getTutorial()->getCard();
+		game->getTutorial()->proceed();
+		const TutorialCard *new_card = game->getTutorial()->getCard();
 		if( new_card != NULL ) {
 			new_card->setGUI(this);
 		}
@@ -2557,7 +2662,7 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 		if( shield_number_panels[i]->mouseOver(m_x, m_y) ) {
 			bool ok = false;
 			for(int j=i;j<n_players_c && !ok;j++) {
-				if( j == i || Player::isAlliance(i, j) ) {
+				if( j == i || game->isAlliance(i, j) ) {
 					const Army *army = current_sector->getArmy(j);
 					if( army->getTotal() > 0 )
 						ok = true;
@@ -2577,8 +2682,8 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 	}
 
 	// alliances
-	for(int i=0;i<n_players_c && !done && m_left && click && !game_g->isDemo();i++) {
-		if( i != client_player && game_g->players[i] != NULL && !game_g->players[i]->isDead() ) {
+	for(int i=0;i<n_players_c && !done && m_left && click && !game->isDemo();i++) {
+		if( i != client_player && game->players[i] != NULL && !game->players[i]->isDead() ) {
 			if( shield_buttons[i] != NULL && shield_buttons[i]->mouseOver(m_x, m_y) ) {
 				if( this->player_asking_alliance != -1 && this->player_asking_alliance == i ) {
 					// automatically accept
@@ -2602,8 +2707,8 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 		// break alliance
 		bool any = false;
 		for(int i=0;i<n_players_c;i++) {
-			if( i != client_player && Player::isAlliance(i, client_player) ) {
-				Player::setAlliance(i, client_player, false);
+			if( i != client_player && game->isAlliance(i, client_player) ) {
+				game->setAlliance(i, client_player, false);
 				any = true;
 			}
 		}
@@ -2615,11 +2720,11 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 	}
 
 	//if( !done && s_m_x >= offset_land_x_c + 16 && s_m_y >= offset_land_y_c ) {
-	if( !done && click && !game_g->isDemo() && this->land_panel->mouseOver(m_x, m_y) ) {
+	if( !done && click && !game->isDemo() && this->land_panel->mouseOver(m_x, m_y) ) {
 		const Army *army_in_sector = current_sector->getArmy(client_player);
 		Building *building = current_sector->getBuilding(BUILDING_TOWER);
-		bool clicked_fortress = building != NULL && s_m_x >= offset_land_x_c + building->getX() && s_m_x < offset_land_x_c + building->getX() + game_g->fortress[ current_sector->getBuildingEpoch() ]->getScaledWidth() &&
-			s_m_y >= offset_land_y_c + building->getY() && s_m_y < offset_land_y_c + building->getY() + game_g->fortress[ current_sector->getBuildingEpoch() ]->getScaledHeight();
+		bool clicked_fortress = building != NULL && s_m_x >= offset_land_x_c + building->getX() && s_m_x < offset_land_x_c + building->getX() + game->fortress[ current_sector->getBuildingEpoch() ]->getScaledWidth() &&
+			s_m_y >= offset_land_y_c + building->getY() && s_m_y < offset_land_y_c + building->getY() + game->fortress[ current_sector->getBuildingEpoch() ]->getScaledHeight();
 		if( m_left ) {
             if( this->getGamePanel()->getMouseState() == GamePanel::MOUSESTATE_DEPLOY_WEAPON ) {
                 ASSERT( current_sector->getAssembledArmy() != NULL );
@@ -2654,11 +2759,11 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 				}
 			}
 		}
-		if( !done && ( game_g->oneMouseButtonMode() ? m_left : m_right ) && !clicked_fortress && army_in_sector->getTotal() > 0 ) {
+		if( !done && ( game->oneMouseButtonMode() ? m_left : m_right ) && !clicked_fortress && army_in_sector->getTotal() > 0 ) {
 			done = true;
             registerClick();
             //selected_army = army_in_sector;
-			selected_army = game_g->getMap()->getSector(current_sector->getXPos(), current_sector->getYPos())->getArmy(client_player);
+			selected_army = game->getMap()->getSector(current_sector->getXPos(), current_sector->getYPos())->getArmy(client_player);
 			clear_selected_army = false;
 			if( current_sector->getPlayer() == client_player ) {
 				//current_sector->returnAssembledArmy();
@@ -2689,8 +2794,8 @@ void PlayingGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bool
 
 void PlayingGameState::requestQuit(bool force_quit) {
 	if( force_quit ) {
-		game_g->saveState();
-	    game_g->getApplication()->setQuit();
+		game->saveState();
+	    game->getApplication()->setQuit();
 	}
 	else {
 		this->createQuitWindow();
@@ -2700,63 +2805,176 @@ void PlayingGameState::requestQuit(bool force_quit) {
 void PlayingGameState::requestConfirm() {
 	if( confirm_window != NULL ) {
         this->closeConfirmWindow();
-        if( !game_g->isStateChanged() ) {
-			game_g->setGameResult(GAMERESULT_QUIT);
-			game_g->fadeMusic(1000);
-			game_g->setStateChanged(true);
+        if( !game->isStateChanged() ) {
+			game->setGameResult(GAMERESULT_QUIT);
+			game->fadeMusic(1000);
+			game->setStateChanged(true);
 			this->fadeScreen(true, 0, endIsland_g);
 		}
 	}
 }
 
-bool PlayingGameState::validSoldierLocation(int epoch,int xpos,int ypos) {
-	ASSERT_S_EPOCH(epoch);
-	bool okay = true;
-	if( epoch == 6 || epoch == 7 || epoch == 9 )
-		return true;
+/** Sorts the soldiers into soldier_draw_order by ypos, so that those further back are drawn first. A counting
+ *  sort is used, as the range of ypos is small.
+ */
+void PlayingGameState::sortSoldiers() {
+	int n_total_soldiers = 0;
+	int min_y = 0, max_y = 0;
+	for(int i=0;i<n_players_c;i++) {
+		const SoldierList *list = &soldiers[i];
+		for(size_t j=0;j<list->size();j++) {
+			int ypos = list->ypos[j];
+			if( n_total_soldiers == 0 || ypos < min_y )
+				min_y = ypos;
+			if( n_total_soldiers == 0 || ypos > max_y )
+				max_y = ypos;
+			n_total_soldiers++;
+		}
+	}
+	// soldier_y_counts[y - min_y] ends up as the position in the draw order of the first soldier with that ypos
+	soldier_y_counts.assign(max_y - min_y + 2, 0);
+	for(int i=0;i<n_players_c;i++) {
+		const SoldierList *list = &soldiers[i];
+		for(size_t j=0;j<list->size();j++) {
+			soldier_y_counts[list->ypos[j] - min_y + 1]++;
+		}
+	}
+	for(size_t i=1;i<soldier_y_counts.size();i++) {
+		soldier_y_counts[i] += soldier_y_counts[i-1];
+	}
+	soldier_draw_order.resize(n_total_soldiers);
+	for(int i=0;i<n_players_c;i++) {
+		const SoldierList *list = &soldiers[i];
+		for(size_t j=0;j<list->size();j++) {
+			soldier_draw_order[ soldier_y_counts[list->ypos[j] - min_y]++ ] = (int)j * n_players_c + i;
+		}
+	}
+}
 
-	//int size_x = attackers_walking[0][ epoch ][0]->getScaledWidth();
-	//int size_y = attackers_walking[0][ epoch ][0]->getScaledHeight();
-	int size_x = game_g->attackers_walking[0][ epoch ][0][0]->getScaledWidth();
-	int size_y = game_g->attackers_walking[0][ epoch ][0][0]->getScaledHeight();
-	if( xpos < 0 || xpos + size_x >= land_width_c || ypos < 0 || ypos + size_y >= land_height_c )
-		okay = false;
-	else if( current_sector->getPlayer() != -1 ) {
-		for(int i=0;i<N_BUILDINGS && okay;i++) {
+/** Works out the land occupancy again if the current sector, or the areas that soldiers have to avoid, have
+ *  changed. Should be called before validSoldierLocation() or randomSoldierLocation() are used.
+ */
+void PlayingGameState::updateLandOccupancy() {
+	vector<Rect2D> &blocked = this->land_occupancy_new_blocked;
+	blocked.clear();
+	if( current_sector->getPlayer() != -1 ) {
+		for(int i=0;i<N_BUILDINGS;i++) {
 			Building *building = current_sector->getBuilding((Type)i);
 			if( building == NULL )
 				continue;
 			Image *image = building->getImages()[current_sector->getBuildingEpoch()];
-			if( xpos + size_x >= building->getX() && xpos < building->getX() + image->getScaledWidth() &&
-				ypos + size_y >= building->getY() && ypos < building->getY() + image->getScaledHeight() )
-				okay = false;
-		}
-		if( okay && openPitMine() && xpos + size_x >= offset_openpitmine_x_c && xpos < offset_openpitmine_x_c + game_g->icon_openpitmine->getScaledWidth() &&
-			ypos + size_y >= offset_openpitmine_y_c && ypos < offset_openpitmine_y_c + game_g->icon_openpitmine->getScaledHeight() )
-			okay = false;
-		/*Building *building = current_sector->getBuilding(BUILDING_TOWER);
-		Building *building_mine = current_sector->getBuilding(BUILDING_MINE);
-		if( xpos + size_x >= building->pos_x && xpos < building->pos_x + fortress[ current_sector->getBuildingEpoch() ]->getScaledWidth() &&
-		ypos + size_y >= building->pos_y && ypos < building->pos_y + fortress[ current_sector->getBuildingEpoch() ]->getScaledHeight() )
-		okay = false;
-		else if( building_mine != NULL && xpos + size_x >= building_mine->pos_x && xpos < building_mine->pos_x + mine[ current_sector->getBuildingEpoch() ]->getScaledWidth() &&
-		ypos + size_y >= building_mine->pos_y && ypos < building_mine->pos_y + mine[ current_sector->getBuildingEpoch() ]->getScaledHeight() )
-		okay = false;
-		else if( openPitMine() && xpos + size_x >= offset_openpitmine_x_c && xpos < offset_openpitmine_x_c + icon_openpitmine->getScaledWidth() &&
-		ypos + size_y >= offset_openpitmine_y_c && ypos < offset_openpitmine_y_c + icon_openpitmine->getScaledHeight() )
-		okay = false;*/
-	}
-	return okay;
+			blocked.push_back(Rect2D(building->getX(), building->getY(), image->getScaledWidth(), image->getScaledHeight()));
+		}
+		if( openPitMine() ) {
+			blocked.push_back(Rect2D(offset_openpitmine_x_c, offset_openpitmine_y_c, game->icon_openpitmine->getScaledWidth(), game->icon_openpitmine->getScaledHeight()));
+		}
+	}
+
+	bool changed = this->land_occupancy_sector != current_sector || blocked.size() != this->land_occupancy_blocked.size();
+	for(size_t i=0;i<blocked.size() && !changed;i++) {
+		const Rect2D &a = blocked[i];
+		const Rect2D &b = this->land_occupancy_blocked[i];
+		changed = a.x != b.x || a.y != b.y || a.w != b.w || a.h != b.h;
+	}
+	if( changed ) {
+		this->land_occupancy.clear();
+		for(int i=0;i<=n_epochs_c;i++)
+			this->land_occupancy_index[i] = -1;
+		this->land_occupancy_sector = current_sector;
+		this->land_occupancy_blocked.swap(blocked);
+	}
+}
+
+/** Returns the land occupancy for ground soldiers of the supplied epoch, working it out if need be.
+ */
+const PlayingGameState::LandOccupancy *PlayingGameState::getLandOccupancy(int epoch) {
+	ASSERT_S_EPOCH(epoch);
+	ASSERT( this->land_occupancy_sector == current_sector );
+	if( this->land_occupancy_index[epoch] != -1 ) {
+		return &this->land_occupancy[ this->land_occupancy_index[epoch] ];
+	}
+
+	int size_x = game->attackers_walking[0][ epoch ][0][0]->getScaledWidth();
+	int size_y = game->attackers_walking[0][ epoch ][0][0]->getScaledHeight();
+	// soldiers of different epochs are often the same size, so can share
+	for(size_t i=0;i<this->land_occupancy.size();i++) {
+		if( this->land_occupancy[i].size_x == size_x && this->land_occupancy[i].size_y == size_y ) {
+			this->land_occupancy_index[epoch] = (int)i;
+			return &this->land_occupancy[i];
+		}
+	}
+
+	LandOccupancy occupancy;
+	occupancy.size_x = size_x;
+	occupancy.size_y = size_y;
+	occupancy.free.resize(land_width_c * land_height_c, false);
+	for(int y=0;y + size_y < land_height_c;y++) {
+		for(int x=0;x + size_x < land_width_c;x++) {
+			occupancy.free[y*land_width_c + x] = true;
+		}
+	}
+	for(size_t i=0;i<this->land_occupancy_blocked.size();i++) {
+		// a soldier overlaps the area if xpos + size_x >= rect.x && xpos < rect.x + rect.w, and similarly for y
+		const Rect2D &rect = this->land_occupancy_blocked[i];
+		int min_x = std::max(0, rect.x - size_x), max_x = std::min(land_width_c, rect.getRight());
+		int min_y = std::max(0, rect.y - size_y), max_y = std::min(land_height_c, rect.getBottom());
+		for(int y=min_y;y<max_y;y++) {
+			for(int x=min_x;x<max_x;x++) {
+				occupancy.free[y*land_width_c + x] = false;
+			}
+		}
+	}
+	for(int i=0;i<land_width_c * land_height_c;i++) {
+		if( occupancy.free[i] )
+			occupancy.free_cells.push_back(i);
+	}
+
+	this->land_occupancy_index[epoch] = (int)this->land_occupancy.size();
+	this->land_occupancy.push_back(occupancy);
+	return &this->land_occupancy.back();
+}
+
+bool PlayingGameState::validSoldierLocation(int epoch,int xpos,int ypos) {
+	ASSERT_S_EPOCH(epoch);
+	if( epoch == 6 || epoch == 7 || epoch == 9 )
+		return true;
+	if( xpos < 0 || xpos >= land_width_c || ypos < 0 || ypos >= land_height_c )
+		return false;
+	const LandOccupancy *occupancy = this->getLandOccupancy(epoch);
+	return occupancy->free[ypos*land_width_c + xpos];
+}
+
+/** Picks a random valid location for a soldier.
+ */
+void PlayingGameState::randomSoldierLocation(int epoch, int *xpos, int *ypos) {
+	ASSERT_S_EPOCH(epoch);
+	if( epoch == 6 || epoch == 7 || epoch == 9 ) {
+		*xpos = game->random(RANDOM_COSMETIC) % land_width_c;
+		*ypos = game->random(RANDOM_COSMETIC) % land_height_c;
+		return;
+	}
+	const LandOccupancy *occupancy = this->getLandOccupancy(epoch);
+	if( occupancy->free_cells.size() == 0 ) {
+		// shouldn't happen, but we have to put the soldier somewhere
+		LOG("no free location for soldiers of epoch %d\n", epoch);
+		*xpos = 0;
+		*ypos = 0;
+		return;
+	}
+	int cell = occupancy->free_cells[ game->random(RANDOM_COSMETIC) % occupancy->free_cells.size() ];
+	*xpos = cell % land_width_c;
+	*ypos = cell / land_width_c;
 }
 
 void PlayingGameState::refreshSoldiers(bool flash) {
+	this->updateLandOccupancy();
 	for(int i=0;i<n_players_c;i++) {
 		int n_soldiers_type[n_epochs_c+1];
 		for(int j=0;j<=n_epochs_c;j++)
 			n_soldiers_type[j] = 0;
-		for(size_t j=0;j<soldiers[i].size();j++) {
-			Soldier *soldier = soldiers[i].at(j);
-			n_soldiers_type[ soldier->epoch ]++;
+		SoldierList *list = &soldiers[i];
+		for(size_t j=0;j<list->size();j++) {
+			n_soldiers_type[ list->epoch[j] ]++;
 		}
 		const Army *army = current_sector->getArmy(i);
 		for(int j=0;j<=n_epochs_c;j++) {
@@ -2765,48 +2983,40 @@ void PlayingGameState::refreshSoldiers(bool flash) {
 				// create some more
 				for(int k=0;k<diff;k++) {
 					int xpos = 0, ypos = 0;
-					bool found_loc = false;
-					while(!found_loc) {
-						xpos = rand() % land_width_c;
-						ypos = rand() % land_height_c;
-						found_loc = validSoldierLocation(j, xpos, ypos);
-					}
-					Soldier *soldier = new Soldier(i, j, xpos, ypos);
-					soldiers[i].push_back( soldier );
-					if( flash && !isAirUnit( soldier->epoch ) ) {
-						blueEffect(offset_land_x_c + soldier->xpos, offset_land_y_c + soldier->ypos, true);
+					randomSoldierLocation(j, &xpos, &ypos);
+					list->add(j, xpos, ypos, (AmmoDirection)(game->random(RANDOM_COSMETIC) % 4));
+					if( flash && !isAirUnit(j) ) {
+						blueEffect(offset_land_x_c + xpos, offset_land_y_c + ypos, true);
 					}
 				}
 				if( j == biplane_epoch_c ) {
-					playSample(game_g->s_biplane, SOUND_CHANNEL_BIPLANE, -1); // n.b., doesn't matter if this restarts the currently playing sample
+					playSample(game->s_biplane, SOUND_CHANNEL_BIPLANE, -1); // n.b., doesn't matter if this restarts the currently playing sample
 				}
 				else if( j == jetplane_epoch_c ) {
-					playSample(game_g->s_jetplane, SOUND_CHANNEL_BOMBER, -1); // n.b., doesn't matter if this restarts the currently playing sample
+					playSample(game->s_jetplane, SOUND_CHANNEL_BOMBER, -1); // n.b., doesn't matter if this restarts the currently playing sample
 				}
 				else if( j == spaceship_epoch_c ) {
-					playSample(game_g->s_spaceship, SOUND_CHANNEL_SPACESHIP, -1); // n.b., doesn't matter if this restarts the currently playing sample
+					playSample(game->s_spaceship, SOUND_CHANNEL_SPACESHIP, -1); // n.b., doesn't matter if this restarts the currently playing sample
 				}
 			}
 			else if( diff < 0 ) {
 				// remove some
-				for(size_t k=0;k<soldiers[i].size();) {
-					Soldier *soldier = soldiers[i].at(k);
-					if( soldier->epoch == j ) {
+				for(size_t k=0;k<list->size();) {
+					if( list->epoch[k] == j ) {
 						if( n_deaths[i][j] > 0 ) {
-							if( flash && !isAirUnit( soldier->epoch ) ) {
-								deathEffect(offset_land_x_c + soldier->xpos, offset_land_y_c + soldier->ypos);
+							if( flash && !isAirUnit(j) ) {
+								deathEffect(offset_land_x_c + list->xpos[k], offset_land_y_c + list->ypos[k]);
 								if( !isPlaying(SOUND_CHANNEL_FX) ) {
 									// only play if sound fx channel is free, to avoid too many death samples sounding
-									playSample(game_g->s_scream, SOUND_CHANNEL_FX);
+									playSample(game->s_scream, SOUND_CHANNEL_FX);
 								}
 							}
 							n_deaths[i][j]--;
 						}
-						else if( flash && !isAirUnit( soldier->epoch ) ) {
-							blueEffect(offset_land_x_c + soldier->xpos, offset_land_y_c + soldier->ypos, false);
+						else if( flash && !isAirUnit(j) ) {
+							blueEffect(offset_land_x_c + list->xpos[k], offset_land_y_c + list->ypos[k], false);
 						}
-						soldiers[i].erase(soldiers[i].begin() + k);
-						delete soldier;
+						list->remove(k);
 						diff++;
 						if( diff == 0 )
 							break;
@@ -2816,13 +3026,13 @@ void PlayingGameState::refreshSoldiers(bool flash) {
 				}
 				if( army->getSoldiers(j) == 0 ) {
 					if( j == biplane_epoch_c ) {
-						game_g->s_biplane->fadeOut(500);
+						game->s_biplane->fadeOut(500);
 					}
 					else if( j == jetplane_epoch_c ) {
-						game_g->s_jetplane->fadeOut(500);
+						game->s_jetplane->fadeOut(500);
 					}
 					else if( j == spaceship_epoch_c ) {
-						game_g->s_spaceship->fadeOut(500);
+						game->s_spaceship->fadeOut(500);
 					}
 				}
 			}
@@ -2839,18 +3049,18 @@ n_soldiers[i] = 0;
 }*/
 
 void PlayingGameState::deathEffect(int xpos,int ypos) {
-	AnimationEffect *animationeffect = new AnimationEffect(xpos, ypos, game_g->death_flashes, n_death_flashes_c, 100, true);
+	AnimationEffect *animationeffect = new (&animation_effect_pool) AnimationEffect(xpos, ypos, game->death_flashes, n_death_flashes_c, 100, true);
 	this->effects.push_back(animationeffect);
 }
 
 void PlayingGameState::blueEffect(int xpos,int ypos,bool dir) {
-	AnimationEffect *animationeffect = new AnimationEffect(xpos, ypos, game_g->blue_flashes, n_blue_flashes_c, 50, dir);
+	AnimationEffect *animationeffect = new (&animation_effect_pool) AnimationEffect(xpos, ypos, game->blue_flashes, n_blue_flashes_c, 50, dir);
 	this->effects.push_back(animationeffect);
 }
 
 void PlayingGameState::explosionEffect(int xpos,int ypos) {
-	if( game_g->explosions[0] != NULL ) { // not available with "old" graphics
-		AnimationEffect *animationeffect = new AnimationEffect(xpos, ypos, game_g->explosions, n_explosions_c, 50, true);
+	if( game->explosions[0] != NULL ) { // not available with "old" graphics
+		AnimationEffect *animationeffect = new (&animation_effect_pool) AnimationEffect(xpos, ypos, game->explosions, n_explosions_c, 50, true);
 		this->effects.push_back(animationeffect);
 	}
 }
@@ -2895,9 +3105,9 @@ void PlayingGameState::refreshButtons() {
 		if( this->player_asking_alliance == -1 && this->map_display == MAPDISPLAY_MAP ) {
 			for(int y=0;y<map_height_c;y++) {
 				for(int x=0;x<map_width_c;x++) {
-					if( game_g->getMap()->isSectorAt(x, y) ) {
+					if( game->getMap()->isSectorAt(x, y) ) {
 						if( is_nukes ) {
-							if( game_g->getMap()->getSector(x, y)->getPlayer() == current_sector->getPlayer() || game_g->getMap()->getSector(x, y)->isBeingNuked() || game_g->getMap()->getSector(x, y)->isNuked() ) {
+							if( game->getMap()->getSector(x, y)->getPlayer() == current_sector->getPlayer() || game->getMap()->getSector(x, y)->isBeingNuked() || game->getMap()->getSector(x, y)->isNuked() ) {
 								map_panels[x][y]->setInfoLMB("");
 							}
 							else {
@@ -2907,7 +3117,7 @@ void PlayingGameState::refreshButtons() {
 						else {
 							map_panels[x][y]->setInfoLMB("move army to this sector");
 						}
-						//map_panels[x][y]->setInfoLMB(!is_nukes ? "move army to this sector" : game_g->getMap()->getSector(x, y) == current_sector ? "" : "nuke sector");
+						//map_panels[x][y]->setInfoLMB(!is_nukes ? "move army to this sector" : game->getMap()->getSector(x, y) == current_sector ? "" : "nuke sector");
 					}
 				}
 			}
@@ -2918,7 +3128,7 @@ void PlayingGameState::refreshButtons() {
 		if( this->player_asking_alliance == -1 && this->map_display == MAPDISPLAY_MAP ) {
 			for(int y=0;y<map_height_c;y++) {
 				for(int x=0;x<map_width_c;x++) {
-					if( game_g->getMap()->isSectorAt(x, y) ) {
+					if( game->getMap()->isSectorAt(x, y) ) {
 						map_panels[x][y]->setInfoLMB("view this sector");
 					}
 				}
@@ -2946,7 +3156,7 @@ void PlayingGameState::refreshShieldNumberPanels() {
 }
 
 void PlayingGameState::setNDesigners(int sector_x, int sector_y, int n_designers) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		if( sector->getCurrentDesign() != NULL ) {
@@ -2956,7 +3166,7 @@ void PlayingGameState::setNDesigners(int sector_x, int sector_y, int n_designers
 }
 
 void PlayingGameState::setNWorkers(int sector_x, int sector_y, int n_workers) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		if( sector->getCurrentManufacture() != NULL ) {
@@ -2966,7 +3176,7 @@ void PlayingGameState::setNWorkers(int sector_x, int sector_y, int n_workers) {
 }
 
 void PlayingGameState::setFAmount(int sector_x, int sector_y, int n_famount) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		if( sector->getCurrentManufacture() != NULL ) {
@@ -2976,7 +3186,7 @@ void PlayingGameState::setFAmount(int sector_x, int sector_y, int n_famount) {
 }
 
 void PlayingGameState::setNMiners(int sector_x, int sector_y, Id element, int n_miners) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		if( sector->canMine(element) ) {
@@ -2986,7 +3196,7 @@ void PlayingGameState::setNMiners(int sector_x, int sector_y, Id element, int n_
 }
 
 void PlayingGameState::setNBuilders(int sector_x, int sector_y, Type type, int n_builders) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		if( sector->canBuild(type) ) {
@@ -2996,7 +3206,7 @@ void PlayingGameState::setNBuilders(int sector_x, int sector_y, Type type, int n
 }
 
 void PlayingGameState::setCurrentDesign(int sector_x, int sector_y, Design *design) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		sector->setCurrentDesign(design);
@@ -3004,7 +3214,7 @@ void PlayingGameState::setCurrentDesign(int sector_x, int sector_y, Design *desi
 }
 
 void PlayingGameState::setCurrentManufacture(int sector_x, int sector_y, Design *design) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		sector->setCurrentManufacture(design);
@@ -3012,7 +3222,7 @@ void PlayingGameState::setCurrentManufacture(int sector_x, int sector_y, Design
 }
 
 void PlayingGameState::assembledArmyEmpty(int sector_x, int sector_y) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		sector->getAssembledArmy()->empty();
@@ -3020,7 +3230,7 @@ void PlayingGameState::assembledArmyEmpty(int sector_x, int sector_y) {
 }
 
 bool PlayingGameState::assembleArmyUnarmed(int sector_x, int sector_y, int n) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		int n_spare = sector->getAvailablePopulation();
@@ -3035,7 +3245,7 @@ bool PlayingGameState::assembleArmyUnarmed(int sector_x, int sector_y, int n) {
 }
 
 bool PlayingGameState::assembleArmy(int sector_x, int sector_y, int epoch, int n) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		if( sector->assembleArmy(epoch, n) ) {
@@ -3046,7 +3256,7 @@ bool PlayingGameState::assembleArmy(int sector_x, int sector_y, int epoch, int n
 }
 
 bool PlayingGameState::assembleAll(int sector_x, int sector_y, bool include_unarmed) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		sector->assembleAll(include_unarmed);
@@ -3055,7 +3265,7 @@ bool PlayingGameState::assembleAll(int sector_x, int sector_y, bool include_unar
 }
 
 void PlayingGameState::returnAssembledArmy(int sector_x, int sector_y) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		sector->returnAssembledArmy();
@@ -3063,10 +3273,10 @@ void PlayingGameState::returnAssembledArmy(int sector_x, int sector_y) {
 }
 
 bool PlayingGameState::returnArmy(int sector_x, int sector_y, int src_x, int src_y) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
-		Sector *src = game_g->getMap()->getSector(src_x, src_y);
+		Sector *src = game->getMap()->getSector(src_x, src_y);
 		Army *army = src->getArmy(client_player);
 		return sector->returnArmy(army);
 	}
@@ -3074,8 +3284,8 @@ bool PlayingGameState::returnArmy(int sector_x, int sector_y, int src_x, int src
 }
 
 bool PlayingGameState::moveArmyTo(int src_x, int src_y, int target_x, int target_y) {
-	Sector *src = game_g->getMap()->getSector(src_x, src_y);
-	Sector *target = game_g->getMap()->getSector(target_x, target_y);
+	Sector *src = game->getMap()->getSector(src_x, src_y);
+	Sector *target = game->getMap()->getSector(target_x, target_y);
 	ASSERT(src != NULL);
 	ASSERT(target != NULL);
 	Army *army = src->getArmy(client_player);
@@ -3083,11 +3293,11 @@ bool PlayingGameState::moveArmyTo(int src_x, int src_y, int target_x, int target
 }
 
 bool PlayingGameState::moveAssembledArmyTo(int src_x, int src_y, int target_x, int target_y) {
-	Sector *src = game_g->getMap()->getSector(src_x, src_y);
+	Sector *src = game->getMap()->getSector(src_x, src_y);
 	ASSERT(src != NULL);
 	if( src->getActivePlayer() == client_player ) {
 		Army *army = src->getAssembledArmy();
-		Sector *target = game_g->getMap()->getSector(target_x, target_y);
+		Sector *target = game->getMap()->getSector(target_x, target_y);
 		ASSERT(target != NULL);
 		return target->moveArmy(army);
 	}
@@ -3095,8 +3305,8 @@ bool PlayingGameState::moveAssembledArmyTo(int src_x, int src_y, int target_x, i
 }
 
 bool PlayingGameState::nukeSector(int src_x, int src_y, int target_x, int target_y) {
-	Sector *src = game_g->getMap()->getSector(src_x, src_y);
-	Sector *target = game_g->getMap()->getSector(target_x, target_y);
+	Sector *src = game->getMap()->getSector(src_x, src_y);
+	Sector *target = game->getMap()->getSector(target_x, target_y);
 	ASSERT(src != NULL);
 	ASSERT(target != NULL);
 	if( src->getActivePlayer() == client_player ) {
@@ -3109,7 +3319,7 @@ bool PlayingGameState::nukeSector(int src_x, int src_y, int target_x, int target
 }
 
 void PlayingGameState::deployDefender(int sector_x, int sector_y, Type type, int turret, int epoch) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		Building *building = sector->getBuilding(type);
@@ -3120,7 +3330,7 @@ void PlayingGameState::deployDefender(int sector_x, int sector_y, Type type, int
 }
 
 void PlayingGameState::returnDefender(int sector_x, int sector_y, Type type, int turret) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		Building *building = sector->getBuilding(type);
@@ -3131,7 +3341,7 @@ void PlayingGameState::returnDefender(int sector_x, int sector_y, Type type, int
 }
 
 void PlayingGameState::useShield(int sector_x, int sector_y, Type type, int shield) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		Building *building = sector->getBuilding(type);
@@ -3142,7 +3352,7 @@ void PlayingGameState::useShield(int sector_x, int sector_y, Type type, int shie
 }
 
 void PlayingGameState::trashDesign(int sector_x, int sector_y, Invention *invention) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		sector->trashDesign(invention);
@@ -3150,7 +3360,7 @@ void PlayingGameState::trashDesign(int sector_x, int sector_y, Invention *invent
 }
 
 void PlayingGameState::shutdown(int sector_x, int sector_y) {
-	Sector *sector = game_g->getMap()->getSector(sector_x, sector_y);
+	Sector *sector = game->getMap()->getSector(sector_x, sector_y);
 	ASSERT(sector != NULL);
 	if( sector->getActivePlayer() == client_player ) {
 		sector->shutdown(client_player);
@@ -3159,11 +3369,11 @@ void PlayingGameState::shutdown(int sector_x, int sector_y) {
 
 void PlayingGameState::saveState(stringstream &stream) const {
 	stream << "<playing_gamestate>\n";
-	if( game_g->getGameType() == GAMETYPE_TUTORIAL ) {
+	if( game->getGameType() == GAMETYPE_TUTORIAL ) {
 		stream << "<tutorial ";
-		stream << "name=\"" << game_g->getTutorial()->getId().c_str() << "\" ";
-		if( game_g->getTutorial()->getCard() != NULL ) {
-			stream << "current_card_name=\"" << game_g->getTutorial()->getCard()->getId().c_str() << "\" ";
+		stream << "name=\"" << game->getTutorial()->getId().c_str() << "\" ";
+		if( game->getTutorial()->getCard() != NULL ) {
+			stream << "current_card_name=\"" << game->getTutorial()->getCard()->getId().c_str() << "\" ";
 		}
 		stream << "/>\n";
 	}
@@ -3172,17 +3382,17 @@ void PlayingGameState::saveState(stringstream &stream) const {
 	stream << "<player_asking_alliance player_id=\"" << player_asking_alliance << "\" />\n";
 
 	for(int i=0;i<n_players_c;i++) {
-		if( game_g->players[i] != NULL ) {
-			game_g->players[i]->saveState(stream);
+		if( game->players[i] != NULL ) {
+			game->players[i]->saveState(stream);
 		}
 	}
-	Player::saveStateAlliances(stream);
+	game->saveStateAlliances(stream);
 	for(int i=0;i<n_players_c;i++) {
 		for(int j=0;j<n_epochs_c+1;j++) {
 			stream << "<n_deaths player_id=\"" << i << "\" epoch=\"" << j << "\" n=\"" << n_deaths[i][j] << "\" />\n";
 		}
 	}
-	game_g->getMap()->saveStateSectors(stream);
+	game->getMap()->saveStateSectors(stream);
 	stream << "</playing_gamestate>\n";
 }
 
@@ -3205,7 +3415,7 @@ void PlayingGameState::loadStateParseXMLMapXY(int *map_x, int *map_y, const TiXm
 	if( *map_x < 0 || *map_x >= map_width_c || *map_y < 0 || *map_y >= map_height_c ) {
 		throw std::runtime_error("current_sector invalid map reference");
 	}
-	else if( !game_g->getMap()->isSectorAt(*map_x, *map_y) ) {
+	else if( !game->getMap()->isSectorAt(*map_x, *map_y) ) {
 		throw std::runtime_error("current_sector map reference doesn't exist");
 	}
 }
@@ -3229,7 +3439,7 @@ void PlayingGameState::loadStateParseXMLNode(const TiXmlNode *parent) {
 					// handled entirely by caller
 				}
 				else if( strcmp(element_name, "tutorial") == 0 ) {
-					if( game_g->getGameType() != GAMETYPE_TUTORIAL ) {
+					if( game->getGameType() != GAMETYPE_TUTORIAL ) {
 						throw std::runtime_error("wrong game type for tutorial");
 					}
 					bool has_card_name = false;
@@ -3238,7 +3448,7 @@ void PlayingGameState::loadStateParseXMLNode(const TiXmlNode *parent) {
 						const char *attribute_name = attribute->Name();
 						if( strcmp(attribute_name, "name") == 0 ) {
 							string name = attribute->Value();
-							game_g->setupTutorial(name);
+							game->setupTutorial(name);
 						}
 						else if( strcmp(attribute_name, "current_card_name") == 0 ) {
 							has_card_name = true;
@@ -3251,17 +3461,17 @@ void PlayingGameState::loadStateParseXMLNode(const TiXmlNode *parent) {
 						}
 						attribute = attribute->Next();
 					}
-					if( game_g->getTutorial() == NULL ) {
+					if( game->getTutorial() == NULL ) {
 						throw std::runtime_error("unknown tutorial name");
 					}
-					game_g->getTutorial()->initCards();
+					game->getTutorial()->initCards();
 					if( has_card_name ) {
-						if( !game_g->getTutorial()->jumpTo(card_name) ) {
+						if( !game->getTutorial()->jumpTo(card_name) ) {
 							throw std::runtime_error("unknown tutorial card name");
 						}
 					}
 					else
-						game_g->getTutorial()->jumpToEnd();
+						game->getTutorial()->jumpToEnd();
 				}
 				else if( strcmp(element_name, "player_asking_alliance") == 0 ) {
 					while( attribute != NULL ) {
@@ -3336,7 +3546,7 @@ void PlayingGameState::loadStateParseXMLNode(const TiXmlNode *parent) {
 				else if( strcmp(element_name, "sector") == 0 ) {
 					int map_x = -1, map_y = -1;
 					loadStateParseXMLMapXY(&map_x, &map_y, attribute);
-					game_g->getMap()->getSector(map_x, map_y)->loadStateParseXMLNode(parent);
+					game->getMap()->getSector(map_x, map_y)->loadStateParseXMLNode(parent);
 					read_children = false;
 				}
 				else if( strcmp(element_name, "player") == 0 ) {
@@ -3354,12 +3564,12 @@ void PlayingGameState::loadStateParseXMLNode(const TiXmlNode *parent) {
 					if( player_id < 0 || player_id >= n_players_c ) {
 						throw std::runtime_error("player invalid player_id");
 					}
-					game_g->players[player_id] = new Player(player_id == this->client_player, player_id);
-					game_g->players[player_id]->loadStateParseXMLNode(parent);
+					game->players[player_id] = new Player(game, player_id == this->client_player, player_id);
+					game->players[player_id]->loadStateParseXMLNode(parent);
 					read_children = false;
 				}
 				else if( strcmp(element_name, "player_alliances") == 0 ) {
-					Player::loadStateParseXMLNodeAlliances(parent);
+					game->loadStateParseXMLNodeAlliances(parent);
 					read_children = false;
 				}
 				else {
@@ -3402,100 +3612,100 @@ void EndIslandGameState::reset() {
 
 void EndIslandGameState::draw() {
 #if defined(__ANDROID__)
-	game_g->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
+	game->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
 #endif
-	game_g->background->draw(0, 0);
-	game_g->getScreen()->fillRectWithAlpha((short)(game_g->getScaleWidth()*40), (short)(game_g->getScaleHeight()*120), (short)(game_g->getScaleWidth()*240), (short)(game_g->getScaleHeight()*70), 0, 0, 0, 127);
+	game->background->draw(0, 0);
+	game->getScreen()->fillRectWithAlpha((short)(game->getScaleWidth()*40), (short)(game->getScaleHeight()*120), (short)(game->getScaleWidth()*240), (short)(game->getScaleHeight()*70), 0, 0, 0, 127);
 	char text[4096] = "";
-	if( game_g->getGameResult() == GAMERESULT_QUIT )
+	if( game->getGameResult() == GAMERESULT_QUIT )
 		strcpy(text, "QUITTER!");
-	else if( game_g->getGameResult() == GAMERESULT_LOST )
+	else if( game->getGameResult() == GAMERESULT_LOST )
 		strcpy(text, "LOSER!");
-	else if( game_g->getGameResult() == GAMERESULT_WON )
+	else if( game->getGameResult() == GAMERESULT_WON )
 		strcpy(text, "CONGRATULATIONS!");
 	else {
 		ASSERT(false);
 	}
-	Image::write(160, 122, game_g->letters_large, text, Image::JUSTIFY_CENTRE);
+	Image::write(160, 122, game->letters_large, text, Image::JUSTIFY_CENTRE);
 
 	bool suspend = false;
-	if( game_g->getStartEpoch() >= 6 && game_g->getGameResult() == GAMERESULT_WON )
+	if( game->getStartEpoch() >= 6 && game->getGameResult() == GAMERESULT_WON )
 		suspend = true;
 
-	if( !game_g->isDemo() ) {
-		if( game_g->player_heads_select[client_player] != NULL ) {
-			game_g->player_heads_select[client_player]->draw(40, 96);
-			if( game_g->getGameResult() == GAMERESULT_LOST ) {
-				game_g->grave->draw(42, 64);
+	if( !game->isDemo() ) {
+		if( game->player_heads_select[client_player] != NULL ) {
+			game->player_heads_select[client_player]->draw(40, 96);
+			if( game->getGameResult() == GAMERESULT_LOST ) {
+				game->grave->draw(42, 64);
 			}
 		}
 	}
 	const int xstep = 40;
 	for(int i=0,xpos=96;i<n_players_c;i++) {
-		if( i == client_player || game_g->players[i] == NULL )
+		if( i == client_player || game->players[i] == NULL )
 			continue;
-		if( game_g->player_heads_select[i] != NULL ) {
-			game_g->player_heads_select[i]->draw(xpos, 96);
-			if( game_g->getGameResult() == GAMERESULT_WON || game_g->players[i]->getFinalMen() == 0 ) {
-				game_g->grave->draw(xpos+2, 64);
+		if( game->player_heads_select[i] != NULL ) {
+			game->player_heads_select[i]->draw(xpos, 96);
+			if( game->getGameResult() == GAMERESULT_WON || game->players[i]->getFinalMen() == 0 ) {
+				game->grave->draw(xpos+2, 64);
 			}
 		}
 		xpos += xstep;
 	}
 
-	Image::write(40, 140, game_g->letters_small, "PLAYER", Image::JUSTIFY_LEFT);
-	Image::write(100, 140, game_g->letters_small, "START", Image::JUSTIFY_LEFT);
-	Image::write(140, 140, game_g->letters_small, "BIRTHS", Image::JUSTIFY_LEFT);
-	Image::write(180, 140, game_g->letters_small, "DEATHS", Image::JUSTIFY_LEFT);
-	Image::write(220, 140, game_g->letters_small, "END", Image::JUSTIFY_LEFT);
+	Image::write(40, 140, game->letters_small, "PLAYER", Image::JUSTIFY_LEFT);
+	Image::write(100, 140, game->letters_small, "START", Image::JUSTIFY_LEFT);
+	Image::write(140, 140, game->letters_small, "BIRTHS", Image::JUSTIFY_LEFT);
+	Image::write(180, 140, game->letters_small, "DEATHS", Image::JUSTIFY_LEFT);
+	Image::write(220, 140, game->letters_small, "END", Image::JUSTIFY_LEFT);
 	if( suspend )
-		Image::write(260, 140, game_g->letters_small, "SAVED", Image::JUSTIFY_LEFT);
+		Image::write(260, 140, game->letters_small, "SAVED", Image::JUSTIFY_LEFT);
 
 	int ypos = 150;
 	int rect_y_offset = 2;
 	//int r = 0, g = 0, b = 0, col = 0;
 	int r = 0, g = 0, b = 0;
-	int rect_x = (int)(20 * game_g->getScaleWidth());
-	int rect_y = (int)((ypos-rect_y_offset) * game_g->getScaleHeight());
-	int rect_w = (int)(16 * game_g->getScaleWidth());
-	int rect_h = (int)(8 * game_g->getScaleHeight());
+	int rect_x = (int)(20 * game->getScaleWidth());
+	int rect_y = (int)((ypos-rect_y_offset) * game->getScaleHeight());
+	int rect_w = (int)(16 * game->getScaleWidth());
+	int rect_h = (int)(8 * game->getScaleHeight());
 
-	if( !game_g->isDemo() ) {
+	if( !game->isDemo() ) {
 		PlayerType::getColour(&r, &g, &b, (PlayerType::PlayerTypeID)client_player);
-		/*col = SDL_MapRGB(game_g->getScreen()->getSurface()->format, r, g, b);
-		SDL_FillRect(game_g->getScreen()->getSurface(), &rect, col);*/
-		game_g->getScreen()->fillRect(rect_x, rect_y, rect_w, rect_h, r, g, b);
+		/*col = SDL_MapRGB(game->getScreen()->getSurface()->format, r, g, b);
+		SDL_FillRect(game->getScreen()->getSurface(), &rect, col);*/
+		game->getScreen()->fillRect(rect_x, rect_y, rect_w, rect_h, r, g, b);
 
-		//Image::write(40, ypos, game_g->letters_small, "HUMAN", Image::JUSTIFY_LEFT, true);
-		Image::write(40, ypos, game_g->letters_small, PlayerType::getName((PlayerType::PlayerTypeID)client_player), Image::JUSTIFY_LEFT);
+		//Image::write(40, ypos, game->letters_small, "HUMAN", Image::JUSTIFY_LEFT, true);
+		Image::write(40, ypos, game->letters_small, PlayerType::getName((PlayerType::PlayerTypeID)client_player), Image::JUSTIFY_LEFT);
 
-		Image::writeNumbers(110, ypos, game_g->numbers_yellow, game_g->players[client_player]->getNMenForThisIsland(), Image::JUSTIFY_LEFT);
-		Image::writeNumbers(150, ypos, game_g->numbers_yellow, game_g->players[client_player]->getNBirths(), Image::JUSTIFY_LEFT);
-		Image::writeNumbers(190, ypos, game_g->numbers_yellow, game_g->players[client_player]->getNDeaths(), Image::JUSTIFY_LEFT);
-		Image::writeNumbers(230, ypos, game_g->numbers_yellow, game_g->players[client_player]->getFinalMen(), Image::JUSTIFY_LEFT);
+		Image::writeNumbers(110, ypos, game->numbers_yellow, game->players[client_player]->getNMenForThisIsland(), Image::JUSTIFY_LEFT);
+		Image::writeNumbers(150, ypos, game->numbers_yellow, game->players[client_player]->getNBirths(), Image::JUSTIFY_LEFT);
+		Image::writeNumbers(190, ypos, game->numbers_yellow, game->players[client_player]->getNDeaths(), Image::JUSTIFY_LEFT);
+		Image::writeNumbers(230, ypos, game->numbers_yellow, game->players[client_player]->getFinalMen(), Image::JUSTIFY_LEFT);
 		if( suspend )
-			Image::writeNumbers(270, ypos, game_g->numbers_yellow, game_g->players[client_player]->getNSuspended(), Image::JUSTIFY_LEFT);
+			Image::writeNumbers(270, ypos, game->numbers_yellow, game->players[client_player]->getNSuspended(), Image::JUSTIFY_LEFT);
 		ypos += 10;
 	}
 
 	for(int i=0;i<n_players_c;i++) {
-		if( i == client_player || game_g->players[i] == NULL )
+		if( i == client_player || game->players[i] == NULL )
 			continue;
 		PlayerType::getColour(&r, &g, &b, (PlayerType::PlayerTypeID)i);
-		/*col = SDL_MapRGB(game_g->getScreen()->getSurface()->format, r, g, b);
-		rect.y = (Sint16)(ypos * game_g->getScaleHeight());
-		SDL_FillRect(game_g->getScreen()->getSurface(), &rect, col);*/
-		rect_y = (int)((ypos-rect_y_offset) * game_g->getScaleHeight());
-		game_g->getScreen()->fillRect(rect_x, rect_y, rect_w, rect_h, r, g, b);
-
-		//Image::write(40, ypos, game_g->letters_small, "COMPUTER", Image::JUSTIFY_LEFT, true);
-		Image::write(40, ypos, game_g->letters_small, PlayerType::getName((PlayerType::PlayerTypeID)i), Image::JUSTIFY_LEFT);
-		Image::writeNumbers(110, ypos, game_g->numbers_yellow, game_g->players[i]->getNMenForThisIsland(), Image::JUSTIFY_LEFT);
-		Image::writeNumbers(150, ypos, game_g->numbers_yellow, game_g->players[i]->getNBirths(), Image::JUSTIFY_LEFT);
-		Image::writeNumbers(190, ypos, game_g->numbers_yellow, game_g->players[i]->getNDeaths(), Image::JUSTIFY_LEFT);
-		Image::writeNumbers(230, ypos, game_g->numbers_yellow, game_g->players[i]->getFinalMen(), Image::JUSTIFY_LEFT);
+		/*col = SDL_MapRGB(game->getScreen()->getSurface()->format, r, g, b);
+		rect.y = (Sint16)(ypos * game->getScaleHeight());
+		SDL_FillRect(game->getScreen()->getSurface(), &rect, col);*/
+		rect_y = (int)((ypos-rect_y_offset) * game->getScaleHeight());
+		game->getScreen()->fillRect(rect_x, rect_y, rect_w, rect_h, r, g, b);
+
+		//Image::write(40, ypos, game->letters_small, "COMPUTER", Image::JUSTIFY_LEFT, true);
+		Image::write(40, ypos, game->letters_small, PlayerType::getName((PlayerType::PlayerTypeID)i), Image::JUSTIFY_LEFT);
+		Image::writeNumbers(110, ypos, game->numbers_yellow, game->players[i]->getNMenForThisIsland(), Image::JUSTIFY_LEFT);
+		Image::writeNumbers(150, ypos, game->numbers_yellow, game->players[i]->getNBirths(), Image::JUSTIFY_LEFT);
+		Image::writeNumbers(190, ypos, game->numbers_yellow, game->players[i]->getNDeaths(), Image::JUSTIFY_LEFT);
+		Image::writeNumbers(230, ypos, game->numbers_yellow, game->players[i]->getFinalMen(), Image::JUSTIFY_LEFT);
 		if( suspend )
-			Image::writeNumbers(270, ypos, game_g->numbers_yellow, game_g->players[i]->getNSuspended(), Image::JUSTIFY_LEFT);
+			Image::writeNumbers(270, ypos, game->numbers_yellow, game->players[i]->getNSuspended(), Image::JUSTIFY_LEFT);
 		ypos += 10;
 	}
 
@@ -3512,18 +3722,18 @@ void EndIslandGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle,bo
 	//bool m_left = mouse_left(m_b);
 	//bool m_right = mouse_right(m_b);
 
-	if( ( m_left || m_right ) && click && !game_g->isStateChanged() ) {
+	if( ( m_left || m_right ) && click && !game->isStateChanged() ) {
 		this->requestQuit(false);
 	}
 }
 
 void EndIslandGameState::requestQuit(bool force_quit) {
 	if( force_quit ) {
-		game_g->saveState();
-	    game_g->getApplication()->setQuit();
+		game->saveState();
+	    game->getApplication()->setQuit();
 	}
 	else {
-		game_g->setStateChanged(true);
+		game->setStateChanged(true);
 		this->fadeScreen(true, 0, returnToChooseIsland_g);
 	}
 }
@@ -3535,50 +3745,50 @@ void GameCompleteGameState::reset() {
 
 void GameCompleteGameState::draw() {
 #if defined(__ANDROID__)
-	game_g->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
+	game->getScreen()->clear(); // SDL on Android requires screen be cleared (otherwise we get corrupt regions outside of the main area)
 #endif
-	game_g->background->draw(0, 0);
+	game->background->draw(0, 0);
 
 	this->screen_page->draw();
 	//this->screen_page->drawPopups();
 
-	if( !game_g->isDemo() ) {
+	if( !game->isDemo() ) {
 		stringstream str;
-		int l_h = game_g->letters_large[0]->getScaledHeight();
+		int l_h = game->letters_large[0]->getScaledHeight();
 		int y = 80;
 
-		Image::writeMixedCase(160, y, game_g->letters_large, game_g->letters_small, game_g->numbers_white, "GAME COMPLETE", Image::JUSTIFY_CENTRE);
+		Image::writeMixedCase(160, y, game->letters_large, game->letters_small, game->numbers_white, "GAME COMPLETE", Image::JUSTIFY_CENTRE);
 		y += l_h + 2;
 
-		if( game_g->getDifficultyLevel() == DIFFICULTY_EASY )
+		if( game->getDifficultyLevel() == DIFFICULTY_EASY )
 			str.str("Easy");
-		else if( game_g->getDifficultyLevel() == DIFFICULTY_MEDIUM )
+		else if( game->getDifficultyLevel() == DIFFICULTY_MEDIUM )
 			str.str("Medium");
-		else if( game_g->getDifficultyLevel() == DIFFICULTY_HARD )
+		else if( game->getDifficultyLevel() == DIFFICULTY_HARD )
 			str.str("Hard");
-		else if( game_g->getDifficultyLevel() == DIFFICULTY_ULTRA )
+		else if( game->getDifficultyLevel() == DIFFICULTY_ULTRA )
 			str.str("Ultra");
 		else {
 			ASSERT(false);
 		}
-		Image::writeMixedCase(160, y, game_g->letters_large, game_g->letters_small, game_g->numbers_white, str.str().c_str(), Image::JUSTIFY_CENTRE);
+		Image::writeMixedCase(160, y, game->letters_large, game->letters_small, game->numbers_white, str.str().c_str(), Image::JUSTIFY_CENTRE);
 		y += l_h + 2;
 
 		y += l_h + 2;
 
-		str << "Men Remaining " << game_g->getMenAvailable();
-		Image::writeMixedCase(160, y, game_g->letters_large, game_g->letters_small, game_g->numbers_white, str.str().c_str(), Image::JUSTIFY_CENTRE);
+		str << "Men Remaining " << game->getMenAvailable();
+		Image::writeMixedCase(160, y, game->letters_large, game->letters_small, game->numbers_white, str.str().c_str(), Image::JUSTIFY_CENTRE);
 		y += l_h + 2;
 
 		str.str("");
-		str << "Men Saved " << game_g->getNSuspended();
-		Image::writeMixedCase(160, y, game_g->letters_large, game_g->letters_small, game_g->numbers_white, str.str().c_str(), Image::JUSTIFY_CENTRE);
+		str << "Men Saved " << game->getNSuspended();
+		Image::writeMixedCase(160, y, game->letters_large, game->letters_small, game->numbers_white, str.str().c_str(), Image::JUSTIFY_CENTRE);
 		y += l_h + 2;
 
-		int score = game_g->getMenAvailable() + game_g->getNSuspended();
+		int score = game->getMenAvailable() + game->getNSuspended();
 		str.str("");
 		str << "Total Score " << score;
-		Image::writeMixedCase(160, y, game_g->letters_large, game_g->letters_small, game_g->numbers_white, str.str().c_str(), Image::JUSTIFY_CENTRE);
+		Image::writeMixedCase(160, y, game->letters_large, game->letters_small, game->numbers_white, str.str().c_str(), Image::JUSTIFY_CENTRE);
 		y += l_h + 2;
 	}
 
@@ -3592,18 +3802,18 @@ void GameCompleteGameState::mouseClick(int m_x,int m_y,bool m_left,bool m_middle
 	//bool m_left = mouse_left(m_b);
 	//bool m_right = mouse_right(m_b);
 
-	if( ( m_left || m_right ) && click && !game_g->isStateChanged() ) {
+	if( ( m_left || m_right ) && click && !game->isStateChanged() ) {
 		this->requestQuit(false);
 	}
 }
 
 void GameCompleteGameState::requestQuit(bool force_quit) {
 	if( force_quit ) {
-		game_g->saveState();
-	    game_g->getApplication()->setQuit();
+		game->saveState();
+	    game->getApplication()->setQuit();
 	}
 	else {
-		game_g->setStateChanged(true);
+		game->setStateChanged(true);
 		this->fadeScreen(true, 0, startNewGame_g);
 	}
 }
@@ -21,6 +21,7 @@ namespace Gigalomania {
 
 using namespace Gigalomania;
 
+class Game;
 class PlayingGameState;
 class ChooseGameTypePanel;
 class ChooseDifficultyPanel;
@@ -28,7 +29,6 @@ class ChooseMenPanel;
 class GamePanel;
 class Sector;
 class Army;
-class Soldier;
 class Building;
 class Map;
 class Design;
@@ -77,7 +77,14 @@ public:
 		this->image = image;
 		this->n_frames = n_frames;
 	}
-	void draw() const;
+	static int getAnimationCounter();
+	int getNFrames() const {
+		return this->n_frames;
+	}
+	void draw() const {
+		this->draw(getAnimationCounter());
+	}
+	void draw(int counter) const;
 	int getX() const {
 		return this->xpos;
 	}
@@ -92,6 +99,47 @@ public:
 	}
 };
 
+/* The soldiers of one player shown in the current sector, kept as an array for each field so they're
+ * contiguous. Their order doesn't matter, so a soldier is removed by moving the last one into its place.
+ */
+class SoldierList {
+public:
+	vector<int> epoch;
+	vector<int> xpos;
+	vector<int> ypos;
+	vector<AmmoDirection> dir;
+
+	size_t size() const {
+		return this->epoch.size();
+	}
+	void add(int epoch, int xpos, int ypos, AmmoDirection dir) {
+		this->epoch.push_back(epoch);
+		this->xpos.push_back(xpos);
+		this->ypos.push_back(ypos);
+		this->dir.push_back(dir);
+	}
+	void remove(size_t index) {
+		size_t last = this->size() - 1;
+		this->epoch[index] = this->epoch[last];
+		this->xpos[index] = this->xpos[last];
+		this->ypos[index] = this->ypos[last];
+		this->dir[index] = this->dir[last];
+		this->epoch.pop_back();
+		this->xpos.pop_back();
+		this->ypos.pop_back();
+		this->dir.pop_back();
+	}
+};
+
+class AmmoEffect;
+class AnimationEffect;
+
+// enough for a full scale battle; any more come from the heap
+const int ammo_effect_pool_size_c = 1024;
+const int animation_effect_pool_size_c = 512;
+typedef Pool<AmmoEffect, ammo_effect_pool_size_c> AmmoEffectPool;
+typedef Pool<AnimationEffect, animation_effect_pool_size_c> AnimationEffectPool;
+
 class TimedEffect {
 protected:
 	int timeset;
@@ -109,9 +157,20 @@ public:
 			temp_func_finish();
 		}
 	}
-	virtual bool render() const {
+	/* Advances the effect, returning true once it's finished. In-game effects are updated from
+	 * PlayingGameState::update(), so they last the same however often they're drawn.
+	 */
+	virtual bool update() {
 		return false;
 	}
+	virtual void draw() const {
+	}
+	/* For effects that are only advanced when drawn, such as screen fades.
+	 */
+	bool render() {
+		this->draw();
+		return this->update();
+	}
 };
 
 class AmmoEffect : public TimedEffect {
@@ -120,9 +179,17 @@ class AmmoEffect : public TimedEffect {
 	int epoch;
 	AmmoDirection dir;
 	int xpos, ypos;
+
+	void getPos(int *x, int *y, int *dist) const;
 public:
 	AmmoEffect(PlayingGameState *gamestate, int epoch, AmmoDirection dir, int xpos, int ypos);
-	virtual bool render() const;
+	virtual bool update();
+	virtual void draw() const;
+
+	// allocated from the PlayingGameState's pool, as there are many of these in a battle
+	static void *operator new(size_t size, AmmoEffectPool *pool);
+	static void operator delete(void *ptr, AmmoEffectPool *pool); // only called if the constructor throws
+	static void operator delete(void *ptr);
 };
 
 class FadeEffect : public TimedEffect {
@@ -132,7 +199,8 @@ class FadeEffect : public TimedEffect {
 public:
 	FadeEffect(bool white,bool out,int delay, void (*func_finish)());
 	virtual ~FadeEffect();
-	virtual bool render() const;
+	virtual bool update();
+	virtual void draw() const;
 };
 
 class FlashingSquare : public TimedEffect {
@@ -143,7 +211,8 @@ public:
 		this->ypos = ypos;
 	}
 
-	virtual bool render() const;
+	virtual bool update();
+	virtual void draw() const;
 };
 
 class AnimationEffect : public TimedEffect {
@@ -161,7 +230,13 @@ public:
 		this->time_per_frame = time_per_frame;
 		this->dir = dir;
 	}
-	virtual bool render() const;
+	virtual bool update();
+	virtual void draw() const;
+
+	// allocated from the PlayingGameState's pool, as there are many of these in a battle
+	static void *operator new(size_t size, AnimationEffectPool *pool);
+	static void operator delete(void *ptr, AnimationEffectPool *pool); // only called if the constructor throws
+	static void operator delete(void *ptr);
 };
 
 class TextEffect : public TimedEffect {
@@ -171,11 +246,13 @@ class TextEffect : public TimedEffect {
 public:
 	TextEffect(string text, int xpos, int ypos, int duration) : TimedEffect(), xpos(xpos), ypos(ypos), text(text), duration(duration) {
 	}
-	virtual bool render() const;
+	virtual bool update();
+	virtual void draw() const;
 };
 
 class GameState {
 protected:
+	Game *game;
 	int client_player;
 	FadeEffect *fade;
 	FadeEffect *whitefade;
@@ -198,7 +275,7 @@ protected:
     virtual void createQuitWindow();
 
 public:
-	GameState(int client_player);
+	GameState(Game *game, int client_player);
 	virtual ~GameState();
 
 	PanelPage *getScreenPage() {
@@ -210,6 +287,9 @@ public:
 	int getClientPlayer() const {
 		return this->client_player;
 	}
+	Game *getGame() {
+		return this->game;
+	}
 	virtual void reset();
 	virtual void draw();
 	virtual void update() {};
@@ -236,7 +316,7 @@ class ChooseGameTypeGameState : public GameState {
 	ChooseGameTypePanel *choosegametypePanel;
 
 public:
-	ChooseGameTypeGameState(int client_player);
+	ChooseGameTypeGameState(Game *game, int client_player);
 	virtual ~ChooseGameTypeGameState();
 
 	virtual void reset();
@@ -250,7 +330,7 @@ class ChooseDifficultyGameState : public GameState {
 	ChooseDifficultyPanel *choosedifficultyPanel;
 
 public:
-	ChooseDifficultyGameState(int client_player);
+	ChooseDifficultyGameState(Game *game, int client_player);
 	virtual ~ChooseDifficultyGameState();
 
 	virtual void reset();
@@ -266,7 +346,7 @@ class ChoosePlayerGameState : public GameState {
 	Button *button_green;
 	Button *button_blue;
 public:
-	ChoosePlayerGameState(int client_player);
+	ChoosePlayerGameState(Game *game, int client_player);
 	virtual ~ChoosePlayerGameState();
 
 	virtual void reset();
@@ -277,7 +357,7 @@ public:
 class ChooseTutorialGameState : public GameState {
 	vector<Button *> buttons;
 public:
-	ChooseTutorialGameState(int client_player);
+	ChooseTutorialGameState(Game *game, int client_player);
 	virtual ~ChooseTutorialGameState() {
 	}
 
@@ -293,7 +373,7 @@ class PlaceMenGameState : public GameState {
 	int start_map_x, start_map_y;
 
 public:
-	PlaceMenGameState(int client_player);
+	PlaceMenGameState(Game *game, int client_player);
 	virtual ~PlaceMenGameState();
 
 	virtual void reset();
@@ -337,10 +417,15 @@ class PlayingGameState : public GameState {
 	const Army *selected_army;
 	//int n_soldiers[n_players_c];
 	//Vector *soldiers[n_players_c];
-	vector<Soldier *> soldiers[n_players_c];
+	SoldierList soldiers[n_players_c];
+	vector<int> soldier_draw_order; // soldiers sorted by ypos, each as index*n_players_c + player - see sortSoldiers()
+	vector<int> soldier_y_counts;
 	vector<TimedEffect *> effects;
 	//Vector *ammo_effects;
 	vector<TimedEffect *> ammo_effects;
+	// the pools for the effects, which must all be deleted before these are
+	AmmoEffectPool ammo_effect_pool;
+	AnimationEffectPool animation_effect_pool;
 	TextEffect *text_effect;
 	/*SmokeParticleSystem *smokeParticleSystem;
 	SmokeParticleSystem *smokeParticleSystem_busy;*/
@@ -355,9 +440,40 @@ class PlayingGameState : public GameState {
 	Button *alliance_no;
 	int n_deaths[n_players_c][n_epochs_c+1]; // saved
 
+	// where on the land soldiers of each size can stand, in the current sector, worked out again only when the
+	// buildings (or open pit mine) that they have to avoid change - see updateLandOccupancy(); not saved
+	class LandOccupancy {
+	public:
+		int size_x, size_y;
+		vector<bool> free; // indexed by ypos*land_width_c + xpos
+		vector<int> free_cells; // the free positions, as ypos*land_width_c + xpos
+	};
+	vector<LandOccupancy> land_occupancy;
+	int land_occupancy_index[n_epochs_c+1]; // index into land_occupancy for soldiers of each epoch, or -1 if not yet worked out
+	const Sector *land_occupancy_sector;
+	vector<Rect2D> land_occupancy_blocked; // the areas soldiers have to avoid
+	vector<Rect2D> land_occupancy_new_blocked; // kept to avoid allocating on every update
+
+	// the background, land, features behind the soldiers, and building images for the current sector, drawn once
+	// for each frame of the tree animation, and only drawn again when the sector's appearance changes - see
+	// drawStaticLayer(); not saved
+	vector<Image *> static_layers; // empty if render targets aren't available
+	vector<bool> static_layer_valid;
+	const Sector *static_layer_sector;
+	int static_layer_generation; // of the sector's appearance
+	bool static_layer_open_pit_mine;
+	int static_layer_targets_generation;
+
 	void getFlagOffset(int *offset_x, int *offset_y, int epoch) const;
+	void updateEffects(vector<TimedEffect *> *effects);
+	void sortSoldiers();
+	void drawStaticLayer();
+	void drawStaticLayer(int frame);
 	bool openPitMine();
+	void updateLandOccupancy();
+	const LandOccupancy *getLandOccupancy(int epoch);
 	bool validSoldierLocation(int epoch,int xpos,int ypos);
+	void randomSoldierLocation(int epoch, int *xpos, int *ypos);
 	bool buildingMouseClick(int s_m_x,int s_m_y,bool m_left,bool m_right,Building *building);
 	void moveTo(int map_x,int map_y);
 	void blueEffect(int xpos,int ypos,bool dir);
@@ -371,7 +487,7 @@ class PlayingGameState : public GameState {
 	//static void buttonSpeedClick(void *data, int arg, bool m_left, bool m_middle, bool m_right);
 public:
 
-	PlayingGameState(int client_player);
+	PlayingGameState(Game *game, int client_player);
 	virtual ~PlayingGameState();
 
 	void createSectors( int x, int y, int n_men);
@@ -455,7 +571,7 @@ public:
 
 class EndIslandGameState : public GameState {
 public:
-	EndIslandGameState(int client_player) : GameState(client_player) {
+	EndIslandGameState(Game *game, int client_player) : GameState(game, client_player) {
 	}
 	virtual ~EndIslandGameState() {
 	}
@@ -468,7 +584,7 @@ public:
 
 class GameCompleteGameState : public GameState {
 public:
-	GameCompleteGameState(int client_player) : GameState(client_player) {
+	GameCompleteGameState(Game *game, int client_player) : GameState(game, client_player) {
 	}
 	virtual ~GameCompleteGameState() {
 	}
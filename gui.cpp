@@ -1490,22 +1490,19 @@ void GamePanel::draw() {
 		ASSERT(this->designinfo != NULL);
 		Design *design = gamestate->getCurrentSector()->knownDesign( this->designinfo->getType(), this->designinfo->getEpoch() );
 		ASSERT(design != NULL);
-		int cnt = 0;
-		for(int i=0;i<N_ID;i++) {
-			int cost = design->getCost((Id)i);
-			if( cost > 0 ) {
-				int whole = cost / element_multiplier_c;
-				int frac = cost % element_multiplier_c;
-				game_g->icon_elements[i]->draw(offset_panel_x_c + 16, offset_panel_y_c + 32 + 18 * cnt);
-				int off = 0;
-				if( whole > 0 ) {
-					Image::writeNumbers(offset_panel_x_c + 36, offset_panel_y_c + 34 + 18 * cnt, game_g->numbers_blue, whole, Image::JUSTIFY_LEFT);
-					off += game_g->numbers_blue[0]->getScaledWidth() * n_digits(whole);
-				}
-				if( frac == 1 ) {
-					game_g->numbers_half->draw(offset_panel_x_c + 36 + off + 1, offset_panel_y_c + 34 + 18 * cnt);
-				}
-				cnt++;
+		for(int cnt=0;cnt<design->getNCosts();cnt++) {
+			Id id = design->getCostId(cnt);
+			int cost = design->getCost(id);
+			int whole = cost / element_multiplier_c;
+			int frac = cost % element_multiplier_c;
+			game_g->icon_elements[id]->draw(offset_panel_x_c + 16, offset_panel_y_c + 32 + 18 * cnt);
+			int off = 0;
+			if( whole > 0 ) {
+				Image::writeNumbers(offset_panel_x_c + 36, offset_panel_y_c + 34 + 18 * cnt, game_g->numbers_blue, whole, Image::JUSTIFY_LEFT);
+				off += game_g->numbers_blue[0]->getScaledWidth() * n_digits(whole);
+			}
+			if( frac == 1 ) {
+				game_g->numbers_half->draw(offset_panel_x_c + 36 + off + 1, offset_panel_y_c + 34 + 18 * cnt);
 			}
 		}
 		if( design->isErgonomicallyTerrific() ) {
@@ -3,6 +3,7 @@
 
 #include <cassert>
 #include <cmath> // n.b., needed on Linux at least
+#include <cstring>
 
 //#define TIMING
 
@@ -51,6 +52,99 @@ using namespace Gigalomania;
 SDL_Surface *Image::dest_surf = NULL;
 #else
 SDL_Renderer *Image::sdlRenderer = NULL;
+SpriteBatch Image::sprite_batch;
+TextCache Image::text_cache;
+#endif
+bool Image::size_only = false;
+int Image::render_targets_generation = 0;
+
+#if SDL_MAJOR_VERSION == 1
+#else
+void SpriteBatch::add(SDL_Texture *texture, const SDL_Rect &srcrect, const SDL_Rect &dstrect, int alpha, bool reset_alpha) {
+	if( renderer == NULL ) {
+		// nothing to draw to
+		return;
+	}
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	Sprite sprite;
+	sprite.texture = texture;
+	sprite.srcrect = srcrect;
+	sprite.dstrect = dstrect;
+	sprite.alpha = alpha;
+	sprite.reset_alpha = reset_alpha;
+	sprites.push_back(sprite);
+#else
+	if( alpha != -1 )
+		SDL_SetTextureAlphaMod(texture, (Uint8)alpha);
+	SDL_RenderCopy(renderer, texture, &srcrect, &dstrect);
+	if( reset_alpha )
+		SDL_SetTextureAlphaMod(texture, 255);
+#endif
+}
+
+/** Draws the recorded sprites, in order.
+ */
+void SpriteBatch::flush() {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	size_t start = 0;
+	while( start < sprites.size() ) {
+		// a run continues while the texture and its alpha mod stay the same
+		size_t end = start+1;
+		if( !sprites[start].reset_alpha ) {
+			while( end < sprites.size() && sprites[end].texture == sprites[start].texture && sprites[end].alpha == -1 )
+				end++;
+		}
+		submitRun(start, end);
+		start = end;
+	}
+	sprites.clear();
+#endif
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+void SpriteBatch::submitRun(size_t start, size_t end) {
+	const Sprite *first = &sprites[start];
+	if( first->alpha != -1 )
+		SDL_SetTextureAlphaMod(first->texture, (Uint8)first->alpha);
+	if( end == start+1 ) {
+		SDL_RenderCopy(renderer, first->texture, &first->srcrect, &first->dstrect);
+	}
+	else {
+		int texture_w = 0, texture_h = 0;
+		SDL_QueryTexture(first->texture, NULL, NULL, &texture_w, &texture_h);
+		// the texture's colour and alpha mods are ignored for geometry, so are applied through the vertices
+		SDL_Color color;
+		SDL_GetTextureColorMod(first->texture, &color.r, &color.g, &color.b);
+		SDL_GetTextureAlphaMod(first->texture, &color.a);
+		vertices.clear();
+		indices.clear();
+		for(size_t i=start;i<end;i++) {
+			const Sprite *sprite = &sprites[i];
+			int base = (int)vertices.size();
+			for(int corner=0;corner<4;corner++) {
+				int cx = ( corner == 1 || corner == 2 ) ? 1 : 0;
+				int cy = ( corner >= 2 ) ? 1 : 0;
+				SDL_Vertex vertex;
+				vertex.position.x = (float)(sprite->dstrect.x + cx * sprite->dstrect.w);
+				vertex.position.y = (float)(sprite->dstrect.y + cy * sprite->dstrect.h);
+				vertex.color = color;
+				vertex.tex_coord.x = (float)(sprite->srcrect.x + cx * sprite->srcrect.w) / (float)texture_w;
+				vertex.tex_coord.y = (float)(sprite->srcrect.y + cy * sprite->srcrect.h) / (float)texture_h;
+				vertices.push_back(vertex);
+			}
+			indices.push_back(base);
+			indices.push_back(base+1);
+			indices.push_back(base+2);
+			indices.push_back(base);
+			indices.push_back(base+2);
+			indices.push_back(base+3);
+		}
+		SDL_RenderGeometry(renderer, first->texture, &vertices[0], (int)vertices.size(), &indices[0], (int)indices.size());
+	}
+	if( first->reset_alpha )
+		SDL_SetTextureAlphaMod(first->texture, 255);
+}
+#endif
 #endif
 
 Image::Image() {
@@ -60,11 +154,16 @@ Image::Image() {
 #if SDL_MAJOR_VERSION == 1
 #else
 	this->texture = NULL;
+	this->atlas_page = NULL;
+	this->atlas_x = 0;
+	this->atlas_y = 0;
 #endif
 	this->scale_x = 1;
 	this->scale_y = 1;
 	this->offset_x = 0;
 	this->offset_y = 0;
+	this->size_only_w = 0;
+	this->size_only_h = 0;
 }
 
 Image::~Image() {
@@ -79,6 +178,8 @@ void Image::free() {
 #if SDL_MAJOR_VERSION == 1
 #else
 	if( this->texture != NULL ) {
+		// the batch may still have sprites using the texture
+		sprite_batch.flush();
 		SDL_DestroyTexture(this->texture);
 		this->texture = NULL;
 	}
@@ -90,6 +191,12 @@ void Image::free() {
 }
 
 void Image::draw(int x, int y) const {
+	this->drawAt(x, y, -1);
+}
+
+/** Draws the image at (x, y). With SDL 2, the texture's alpha mod is first set to alpha, unless it's -1.
+ */
+void Image::drawAt(int x, int y, int alpha) const {
 	x += offset_x;
 	y += offset_y;
 	x = (int)(x * scale_x);
@@ -107,12 +214,18 @@ void Image::draw(int x, int y) const {
 	dstrect.h = 0;
 	SDL_BlitSurface(surface, &srcrect, dest_surf, &dstrect);
 #else
+	SDL_Rect srcrect;
+	srcrect.x = atlas_x;
+	srcrect.y = atlas_y;
+	srcrect.w = this->getWidth();
+	srcrect.h = this->getHeight();
 	SDL_Rect dstrect;
 	dstrect.x = (short)x;
 	dstrect.y = (short)y;
 	dstrect.w = (short)this->getWidth();
 	dstrect.h = (short)this->getHeight();
-	SDL_RenderCopy(sdlRenderer, texture, NULL, &dstrect);
+	// an atlas page is shared with other images, so its alpha mod is put back afterwards
+	sprite_batch.add(getTexture(), srcrect, dstrect, alpha, alpha != -1 && atlas_page != NULL);
 #endif
 }
 
@@ -136,9 +249,12 @@ void Image::draw(int x, int y, int sw, int sh) const {
 	dstrect.h = 0;
 	SDL_BlitSurface(surface, &srcrect, dest_surf, &dstrect);
 #else
+	// clip to the image ourselves, as an image in an atlas doesn't cover the whole texture
+	sw = min(sw, this->getWidth());
+	sh = min(sh, this->getHeight());
 	SDL_Rect srcrect;
-	srcrect.x = 0;
-	srcrect.y = 0;
+	srcrect.x = atlas_x;
+	srcrect.y = atlas_y;
 	srcrect.w = sw;
 	srcrect.h = sh;
 	SDL_Rect dstrect;
@@ -146,7 +262,7 @@ void Image::draw(int x, int y, int sw, int sh) const {
 	dstrect.y = (short)y;
 	dstrect.w = sw;
 	dstrect.h = sh;
-	SDL_RenderCopy(sdlRenderer, texture, &srcrect, &dstrect);
+	sprite_batch.add(getTexture(), srcrect, dstrect, -1, false);
 #endif
 }
 
@@ -169,12 +285,17 @@ void Image::draw(int x, int y, float scale_w, float scale_h) const {
 	SDL_BlitSurface(surface, &srcrect, dest_surf, &dstrect);
 	}
 #else
+	SDL_Rect srcrect;
+	srcrect.x = atlas_x;
+	srcrect.y = atlas_y;
+	srcrect.w = this->getWidth();
+	srcrect.h = this->getHeight();
 	SDL_Rect dstrect;
 	dstrect.x = (short)x;
 	dstrect.y = (short)y;
 	dstrect.w = (short)(this->getWidth()*scale_w);
 	dstrect.h = (short)(this->getHeight()*scale_h);
-	SDL_RenderCopy(sdlRenderer, texture, NULL, &dstrect);
+	sprite_batch.add(getTexture(), srcrect, dstrect, -1, false);
 #endif
 }
 
@@ -182,17 +303,21 @@ void Image::drawWithAlpha(int x, int y, unsigned char alpha) const {
 	// n.b., only works if the image doesn't have per-pixel alpha channel
 #if SDL_MAJOR_VERSION == 1
 	SDL_SetAlpha(this->surface, SDL_SRCALPHA|SDL_RLEACCEL, alpha);
+	this->drawAt(x, y, -1);
 #else
-	SDL_SetTextureAlphaMod(texture, alpha);
+	this->drawAt(x, y, alpha);
 #endif
-	this->draw(x, y);
 }
 
 int Image::getWidth() const {
+	if( this->surface == NULL )
+		return this->size_only_w;
 	return this->surface->w;
 }
 
 int Image::getHeight() const {
+	if( this->surface == NULL )
+		return this->size_only_h;
 	return this->surface->h;
 }
 
@@ -310,6 +435,10 @@ void putpixel(SDL_Surface *surface, int x, int y, Uint32 pixel) {
 
 // Creates an alpha from the mask; also adds in shadow effect based on supplied ar/ag/ab colour
 bool Image::createAlphaForColor(bool mask, unsigned char mr, unsigned char mg, unsigned char mb, unsigned char ar, unsigned char ag, unsigned char ab, unsigned char alpha) {
+	if( this->surface == NULL ) {
+		// size-only image
+		return true;
+	}
 	int w = this->getWidth();
 	int h = this->getHeight();
 
@@ -357,6 +486,10 @@ bool Image::createAlphaForColor(bool mask, unsigned char mr, unsigned char mg, u
 }
 
 void Image::scaleAlpha(float scale) {
+	if( this->surface == NULL ) {
+		// size-only image
+		return;
+	}
 	int bpp = this->surface->format->BitsPerPixel;
 	if( bpp != 32 )
 		return;
@@ -391,6 +524,10 @@ void Image::scaleAlpha(float scale) {
 }
 
 bool Image::convertToHiColor(bool alpha) {
+	if( this->surface == NULL ) {
+		// size-only image
+		return false;
+	}
 #ifdef TIMING
 	int time_s = clock();
 #endif
@@ -419,6 +556,10 @@ bool Image::convertToHiColor(bool alpha) {
 }
 
 bool Image::convertToDisplayFormat() {
+	if( size_only ) {
+		// nothing to display
+		return true;
+	}
 #if SDL_MAJOR_VERSION == 1
 	SDL_Surface *new_surf = NULL;
 	int bpp = this->surface->format->BitsPerPixel;
@@ -429,6 +570,10 @@ bool Image::convertToDisplayFormat() {
 	SDL_FreeSurface(this->surface);
 	this->surface = new_surf;
 #else
+	if( atlas_page != NULL ) {
+		// already converted, as part of the atlas
+		return true;
+	}
 	texture = SDL_CreateTextureFromSurface(sdlRenderer, surface);
 	if( texture == NULL ) {
 		LOG("SDL_CreateTextureFromSurface failed\n");
@@ -444,7 +589,151 @@ bool Image::convertToDisplayFormat() {
 	return true;
 }
 
+#if SDL_MAJOR_VERSION == 1
+#else
+const int atlas_page_size_c = 2048;
+const int atlas_max_image_size_c = 256; // larger images keep their own textures
+const int atlas_padding_c = 1; // around each image, so that filtering when scaled doesn't pick up the neighbouring images
+
+class AtlasEntry {
+public:
+	Image *image;
+	int page;
+	int x, y;
+
+	AtlasEntry(Image *image) : image(image), page(0), x(0), y(0) {
+	}
+};
+
+static bool atlasEntryTaller(const AtlasEntry &a, const AtlasEntry &b) {
+	return a.image->getHeight() > b.image->getHeight();
+}
+
+/* Fills the padding around the w x h region at (x, y) of a 32 bit surface by repeating the region's edge
+ * pixels, so that filtering at the edges gives the same result as for a texture of its own.
+ */
+static void extrudeEdges(SDL_Surface *surface, int x, int y, int w, int h) {
+	SDL_LockSurface(surface);
+	for(int cy=y-atlas_padding_c;cy<y+h+atlas_padding_c;cy++) {
+		int sy = min(max(cy, y), y+h-1);
+		Uint32 *src_row = (Uint32 *)((Uint8 *)surface->pixels + sy * surface->pitch);
+		Uint32 *dst_row = (Uint32 *)((Uint8 *)surface->pixels + cy * surface->pitch);
+		for(int cx=x-atlas_padding_c;cx<x+w+atlas_padding_c;cx++) {
+			if( cy >= y && cy < y+h && cx >= x && cx < x+w ) {
+				cx = x+w-1; // skip the image itself
+				continue;
+			}
+			int sx = min(max(cx, x), x+w-1);
+			dst_row[cx] = src_row[sx];
+		}
+	}
+	SDL_UnlockSurface(surface);
+}
+#endif
+
+/** Packs the images that don't have textures yet into a few large textures, so that drawing them doesn't
+ *  need to keep switching textures. Images too large for the atlas are left alone. Should be called once all
+ *  the images are loaded and processed, before calling convertToDisplayFormat() on them, which also creates
+ *  the textures for the atlas pages.
+ */
+bool Image::createAtlas() {
+#if SDL_MAJOR_VERSION == 1
+	// SDL 1 blits directly from each image's surface
+	return true;
+#else
+	if( size_only ) {
+		return true;
+	}
+	int page_size = atlas_page_size_c;
+	SDL_RendererInfo info;
+	if( SDL_GetRendererInfo(sdlRenderer, &info) == 0 && info.max_texture_width > 0 && info.max_texture_height > 0 ) {
+		page_size = min(page_size, min(info.max_texture_width, info.max_texture_height));
+	}
+
+	vector<AtlasEntry> entries;
+	for(TrackedObject *to = TrackedObject::getFirstOfClass("CLASS_IMAGE");to != NULL;to = to->getNextOfClass()) {
+		Image *image = (Image *)to;
+		if( image->surface == NULL || image->texture != NULL || image->atlas_page != NULL )
+			continue;
+		int w = image->getWidth(), h = image->getHeight();
+		if( w <= 0 || h <= 0 || w > atlas_max_image_size_c || h > atlas_max_image_size_c || w + 2*atlas_padding_c > page_size || h + 2*atlas_padding_c > page_size )
+			continue;
+		entries.push_back(AtlasEntry(image));
+	}
+	if( entries.size() == 0 ) {
+		return true;
+	}
+
+	// place the images along shelves, tallest first, each shelf being as tall as its first image
+	std::stable_sort(entries.begin(), entries.end(), atlasEntryTaller);
+	vector<int> page_heights;
+	page_heights.push_back(0);
+	int shelf_x = 0, shelf_y = 0, shelf_h = 0;
+	for(size_t i=0;i<entries.size();i++) {
+		AtlasEntry *entry = &entries[i];
+		int w = entry->image->getWidth() + 2*atlas_padding_c;
+		int h = entry->image->getHeight() + 2*atlas_padding_c;
+		if( shelf_x + w > page_size ) {
+			shelf_y += shelf_h;
+			shelf_x = 0;
+			shelf_h = 0;
+		}
+		if( shelf_y + h > page_size ) {
+			page_heights.push_back(0);
+			shelf_x = 0;
+			shelf_y = 0;
+			shelf_h = 0;
+		}
+		entry->page = (int)page_heights.size()-1;
+		entry->x = shelf_x + atlas_padding_c;
+		entry->y = shelf_y + atlas_padding_c;
+		shelf_x += w;
+		shelf_h = max(shelf_h, h);
+		page_heights[entry->page] = shelf_y + shelf_h;
+	}
+
+	vector<Image *> pages;
+	for(size_t i=0;i<page_heights.size();i++) {
+		Image *page = createBlankImage(page_size, page_heights[i], 32);
+		if( page->surface == NULL ) {
+			LOG("failed to create atlas page %d x %d\n", page_size, page_heights[i]);
+			return false;
+		}
+		pages.push_back(page);
+	}
+	for(size_t i=0;i<entries.size();i++) {
+		const AtlasEntry *entry = &entries[i];
+		Image *image = entry->image;
+		Image *page = pages[entry->page];
+		SDL_BlendMode blend_mode = SDL_BLENDMODE_NONE;
+		SDL_GetSurfaceBlendMode(image->surface, &blend_mode);
+		// copy the alpha channel as is
+		SDL_SetSurfaceBlendMode(image->surface, SDL_BLENDMODE_NONE);
+		SDL_Rect dst_rect;
+		dst_rect.x = entry->x;
+		dst_rect.y = entry->y;
+		dst_rect.w = 0;
+		dst_rect.h = 0;
+		int result = SDL_BlitSurface(image->surface, NULL, page->surface, &dst_rect);
+		SDL_SetSurfaceBlendMode(image->surface, blend_mode);
+		if( result < 0 ) {
+			LOG("failed to copy image to atlas: %s\n", SDL_GetError());
+			return false;
+		}
+		extrudeEdges(page->surface, entry->x, entry->y, image->getWidth(), image->getHeight());
+		image->atlas_page = page;
+		image->atlas_x = entry->x;
+		image->atlas_y = entry->y;
+	}
+	// the pages get their textures along with the other images, in convertToDisplayFormat()
+	LOG("packed %d images into %d atlas pages of width %d\n", (int)entries.size(), (int)pages.size(), page_size);
+	return true;
+#endif
+}
+
 bool Image::copyPalette(const Image *image) {
+	if( this->surface == NULL || image->surface == NULL )
+		return false;
 	if( this->surface->format->palette == NULL || image->surface->format->palette == NULL )
 		return false;
 
@@ -466,6 +755,12 @@ void Image::scale(float sx,float sy) {
 		return;
 	}
 	//LOG("having to scale %f x %f\n", sx, sy);
+	if( this->surface == NULL ) {
+		// size-only image
+		this->size_only_w = (int)(this->size_only_w * sx);
+		this->size_only_h = (int)(this->size_only_h * sy);
+		return;
+	}
 	// only supported for either reducing or englarging the size - this is all we need, and is easier to optimise for performance
 	bool enlarging = false;
 	if( sx > 1.0f || sy > 1.0f ) {
@@ -603,6 +898,10 @@ bool Image::scaleTo(int n_w) {
 }
 
 void Image::remap(unsigned char sr,unsigned char sg,unsigned char sb,unsigned char rr,unsigned char rg,unsigned char rb) {
+	if( this->surface == NULL ) {
+		// size-only image
+		return;
+	}
 	if( this->surface->format->BitsPerPixel != 24 && this->surface->format->BitsPerPixel != 32 ) {
 		return;
 	}
@@ -666,6 +965,10 @@ void Image::remap(unsigned char sr,unsigned char sg,unsigned char sb,unsigned ch
 }
 
 void Image::reshadeRGB(int from, bool to_r, bool to_g, bool to_b) {
+	if( this->surface == NULL ) {
+		// size-only image
+		return;
+	}
 	ASSERT(from >= 0 && from < 3);
 	if( this->surface->format->BitsPerPixel != 24 && this->surface->format->BitsPerPixel != 32 ) {
 		return;
@@ -707,6 +1010,10 @@ void Image::reshadeRGB(int from, bool to_r, bool to_g, bool to_b) {
 }
 
 void Image::brighten(float sr, float sg, float sb) {
+	if( this->surface == NULL ) {
+		// size-only image
+		return;
+	}
 	if( this->surface->format->BitsPerPixel != 24 && this->surface->format->BitsPerPixel != 32 ) {
 		return;
 	}
@@ -747,6 +1054,10 @@ void Image::brighten(float sr, float sg, float sb) {
 }
 
 void Image::fadeAlpha(bool x_dir, bool fwd) {
+	if( this->surface == NULL ) {
+		// size-only image
+		return;
+	}
 	if( this->surface->format->BitsPerPixel != 24 && this->surface->format->BitsPerPixel != 32 ) {
 		return;
 	}
@@ -820,6 +1131,14 @@ Image *Image::copy(int x, int y, int w, int h) const {
 	w = (int)(w * scale_x);
 	h = (int)(h * scale_y);
 
+	if( this->surface == NULL ) {
+		// size-only image
+		Image *copy_image = createSizeOnlyImage(w, h);
+		copy_image->scale_x = scale_x;
+		copy_image->scale_y = scale_y;
+		return copy_image;
+	}
+
 	Image *copy_image = NULL;
 	{
 		SDL_Surface *surface = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, this->surface->format->BitsPerPixel, this->surface->format->Rmask, this->surface->format->Gmask, this->surface->format->Bmask, this->surface->format->Amask);
@@ -1337,6 +1656,15 @@ Image *Image::loadImage(const char *filename) {
 		LOG("SDL_RWFromFile failed: %s\n", SDL_GetError());
 		return NULL;
 	}
+	if( size_only ) {
+		int width = 0, height = 0;
+		if( readImageSize(src, &width, &height) ) {
+			src->close(src);
+			return createSizeOnlyImage(width, height);
+		}
+		// unknown format, so fall back to loading the image fully
+		SDL_RWseek(src, 0, RW_SEEK_SET);
+	}
 	Image *image = new Image();
 #if SDL_MAJOR_VERSION == 1
 #else
@@ -1376,7 +1704,55 @@ Image *Image::loadImage(const char *filename) {
 	return image;
 }
 
+Image *Image::createSizeOnlyImage(int width, int height) {
+	Image *image = new Image();
+	image->size_only_w = width;
+	image->size_only_h = height;
+	return image;
+}
+
+/* Reads just the dimensions from the header of a PNG or JPEG file, without decoding the image.
+ * Returns false if the format isn't recognised. The read position of src is left undefined.
+ */
+bool Image::readImageSize(SDL_RWops *src, int *width, int *height) {
+	unsigned char header[24];
+	if( SDL_RWread(src, header, 1, 4) != 4 )
+		return false;
+	if( header[0] == 0x89 && header[1] == 'P' && header[2] == 'N' && header[3] == 'G' ) {
+		// PNG: the IHDR chunk is always first, with big endian width and height
+		if( SDL_RWread(src, &header[4], 1, 20) != 20 )
+			return false;
+		*width = (header[16] << 24) | (header[17] << 16) | (header[18] << 8) | header[19];
+		*height = (header[20] << 24) | (header[21] << 16) | (header[22] << 8) | header[23];
+		return true;
+	}
+	else if( header[0] == 0xff && header[1] == 0xd8 ) {
+		// JPEG: walk the segments until we find a start of frame marker
+		SDL_RWseek(src, 2, RW_SEEK_SET);
+		for(;;) {
+			unsigned char marker[4];
+			if( SDL_RWread(src, marker, 1, 4) != 4 || marker[0] != 0xff )
+				return false;
+			int length = (marker[2] << 8) | marker[3];
+			if( marker[1] >= 0xc0 && marker[1] <= 0xcf && marker[1] != 0xc4 && marker[1] != 0xc8 && marker[1] != 0xcc ) {
+				unsigned char sof[5];
+				if( SDL_RWread(src, sof, 1, 5) != 5 )
+					return false;
+				*height = (sof[1] << 8) | sof[2];
+				*width = (sof[3] << 8) | sof[4];
+				return true;
+			}
+			if( length < 2 || SDL_RWseek(src, length - 2, RW_SEEK_CUR) < 0 )
+				return false;
+		}
+	}
+	return false;
+}
+
 Image *Image::createBlankImage(int width,int height, int bpp) {
+	if( size_only ) {
+		return createSizeOnlyImage(width, height);
+	}
 	Uint32 rmask, gmask, bmask, amask;
 	CreateMask(rmask, gmask, bmask, amask);
 
@@ -1392,6 +1768,10 @@ Image *Image::createBlankImage(int width,int height, int bpp) {
 
 Image *Image::createNoise(int w,int h,float scale_u,float scale_v,const unsigned char filter_max[3],const unsigned char filter_min[3],NOISEMODE_t noisemode,int n_iterations) {
 	Image *image = Image::createBlankImage(w, h, 32);
+	if( image->surface == NULL ) {
+		// size-only image
+		return image;
+	}
 	SDL_LockSurface(image->surface);
 	float fvec[2] = {0.0f, 0.0f};
 	for(int y=0;y<h;y++) {
@@ -1459,6 +1839,10 @@ Image * Image::createRadial(int w,int h,float alpha_scale) {
 
 Image * Image::createRadial(int w,int h,float alpha_scale, Uint8 r, Uint8 g, Uint8 b) {
 	Image *image = Image::createBlankImage(w, h, 32);
+	if( image->surface == NULL ) {
+		// size-only image
+		return image;
+	}
 	SDL_LockSurface(image->surface);
 	int radius = min(w/2, h/2);
 	for(int y=0;y<h;y++) {
@@ -1482,6 +1866,55 @@ Image * Image::createRadial(int w,int h,float alpha_scale, Uint8 r, Uint8 g, Uin
 	return image;
 }
 
+/** Returns an image that can be drawn to, after calling setRenderTarget(), or NULL if render targets aren't
+ *  available.
+ */
+Image *Image::createRenderTarget(int width, int height) {
+#if SDL_MAJOR_VERSION == 1
+	// not supported with SDL 1.2
+	return NULL;
+#else
+	if( size_only || sdlRenderer == NULL || !SDL_RenderTargetSupported(sdlRenderer) ) {
+		return NULL;
+	}
+	SDL_Texture *texture = SDL_CreateTexture(sdlRenderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+	if( texture == NULL ) {
+		LOG("SDL_CreateTexture failed: %s\n", SDL_GetError());
+		return NULL;
+	}
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	Image *image = new Image();
+	image->texture = texture;
+	image->size_only_w = width;
+	image->size_only_h = height;
+	return image;
+#endif
+}
+
+/** Makes drawing go to this image, which must have been created with createRenderTarget(), until
+ *  resetRenderTarget() is called.
+ */
+bool Image::setRenderTarget() {
+#if SDL_MAJOR_VERSION == 1
+	return false;
+#else
+	sprite_batch.flush();
+	if( SDL_SetRenderTarget(sdlRenderer, texture) != 0 ) {
+		LOG("SDL_SetRenderTarget failed: %s\n", SDL_GetError());
+		return false;
+	}
+	return true;
+#endif
+}
+
+void Image::resetRenderTarget() {
+#if SDL_MAJOR_VERSION == 1
+#else
+	sprite_batch.flush();
+	SDL_SetRenderTarget(sdlRenderer, NULL);
+#endif
+}
+
 #if SDL_MAJOR_VERSION == 1
 void Image::setGraphicsOutput(SDL_Surface *dest_surf) {
 	Image::dest_surf = dest_surf;
@@ -1489,24 +1922,41 @@ void Image::setGraphicsOutput(SDL_Surface *dest_surf) {
 #else
 void Image::setGraphicsOutput(SDL_Renderer *sdlRenderer) {
 	Image::sdlRenderer = sdlRenderer;
+	sprite_batch.setRenderer(sdlRenderer);
 }
 #endif
 
 void Image::writeNumbers(int x,int y,Image *images[10],int number,Justify justify) {
+#if SDL_MAJOR_VERSION == 1
+	vector<TextGlyph> glyphs;
+	layoutNumbers(&glyphs, images, number, justify);
+	drawGlyphs(x, y, glyphs);
+#else
+	TextCache::Key key(images, NULL, NULL, "", number, justify);
+	TextCache::Entry *entry = text_cache.find(key);
+	if( entry == NULL ) {
+		entry = text_cache.add(key);
+		layoutNumbers(&entry->glyphs, images, number, justify);
+	}
+	writeCached(x, y, entry);
+#endif
+}
+
+void Image::layoutNumbers(vector<TextGlyph> *glyphs,Image *images[10],int number,Justify justify) {
 	char buffer[16] = "";
 	sprintf(buffer,"%d",number);
 	int len = strlen(buffer);
 	int w = images[0]->getScaledWidth();
 	int sx = 0;
 	if( justify == JUSTIFY_LEFT )
-		sx = x;
+		sx = 0;
 	else if( justify == JUSTIFY_CENTRE )
-		sx = x - ( w * len ) / 2;
+		sx = - ( w * len ) / 2;
 	else if( justify == JUSTIFY_RIGHT )
-		sx = x - w * len;
+		sx = - w * len;
 
 	for(int i=0;i<len;i++) {
-		images[ buffer[i] - '0' ]->draw(sx, y);
+		glyphs->push_back(TextGlyph(images[ buffer[i] - '0' ], sx, 0));
 		sx += w;
 	}
 }
@@ -1516,6 +1966,24 @@ void Image::write(int x,int y,Image *images[n_font_chars_c],const char *text,Jus
 }
 
 void Image::writeMixedCase(int x,int y,Image *large[n_font_chars_c],Image *little[n_font_chars_c],Image *numbers[10],const char *text,Justify justify) {
+#if SDL_MAJOR_VERSION == 1
+	vector<TextGlyph> glyphs;
+	layoutMixedCase(&glyphs, large, little, numbers, text, justify);
+	drawGlyphs(x, y, glyphs);
+#else
+	TextCache::Key key(large, little, numbers, text, 0, justify);
+	TextCache::Entry *entry = text_cache.find(key);
+	if( entry == NULL ) {
+		entry = text_cache.add(key);
+		layoutMixedCase(&entry->glyphs, large, little, numbers, text, justify);
+	}
+	writeCached(x, y, entry);
+#endif
+}
+
+/** Lays out the text as it's drawn by writeMixedCase(), relative to where it's written.
+ */
+void Image::layoutMixedCase(vector<TextGlyph> *glyphs,Image *large[n_font_chars_c],Image *little[n_font_chars_c],Image *numbers[10],const char *text,Justify justify) {
 	int len = strlen(text);
 	int n_lines = 0;
 	int s_w = little[0]->getScaledWidth();
@@ -1529,12 +1997,13 @@ void Image::writeMixedCase(int x,int y,Image *large[n_font_chars_c],Image *littl
 	int l_h = large[0]->getScaledHeight();
 	int sx = 0;
 	if( justify == JUSTIFY_LEFT )
-		sx = x;
+		sx = 0;
 	else if( justify == JUSTIFY_CENTRE )
-		sx = x - max_wid / 2;
+		sx = - max_wid / 2;
 	else if( justify == JUSTIFY_RIGHT )
-		sx = x - max_wid;
+		sx = - max_wid;
 	int cx = sx;
+	int y = 0;
 
 	for(int i=0;i<len;i++) {
 		char ch = text[i];
@@ -1553,60 +2022,213 @@ void Image::writeMixedCase(int x,int y,Image *large[n_font_chars_c],Image *littl
 		else if( ch >= '0' && ch <= '9' ) {
 			ASSERT( numbers != NULL );
 			int indx = ch - '0';
-			numbers[indx]->draw(cx, y + l_h - n_h);
+			glyphs->push_back(TextGlyph(numbers[indx], cx, y + l_h - n_h));
 		}
 		else if( isupper( ch ) ) {
 			int indx = ch - 'A';
-			large[indx]->draw(cx, y);
+			glyphs->push_back(TextGlyph(large[indx], cx, y));
 			was_large = true;
 		}
 		else if( islower( ch ) ) {
-			little[ ch - 'a' ]->draw(cx, y + l_h - s_h);
+			glyphs->push_back(TextGlyph(little[ ch - 'a' ], cx, y + l_h - s_h));
 		}
-		else if( ch == '.' ) {
-			if( little[font_index_period_c] != NULL )
-				little[font_index_period_c]->draw(cx, y + l_h - s_h);
-			else if( large[font_index_period_c] != NULL )
-				large[font_index_period_c]->draw(cx, y);
+		else if( ch == '.' || ch == ',' || ch == '\'' || ch == '!' || ch == '?' || ch == '-' ) {
+			int indx = ch == '.' ? font_index_period_c :
+				ch == ',' ? font_index_comma_c :
+				ch == '\'' ? font_index_apostrophe_c :
+				ch == '!' ? font_index_exclamation_c :
+				ch == '?' ? font_index_question_c : font_index_dash_c;
+			if( little[indx] != NULL )
+				glyphs->push_back(TextGlyph(little[indx], cx, y + l_h - s_h));
+			else if( large[indx] != NULL )
+				glyphs->push_back(TextGlyph(large[indx], cx, y));
 		}
-		else if( ch == ',' ) {
-			if( little[font_index_comma_c] != NULL )
-				little[font_index_comma_c]->draw(cx, y + l_h - s_h);
-			else if( large[font_index_comma_c] != NULL )
-				large[font_index_comma_c]->draw(cx, y);
+		else {
+			continue; // don't increase cx
 		}
-		else if( ch == '\'' ) {
-			if( little[font_index_apostrophe_c] != NULL )
-				little[font_index_apostrophe_c]->draw(cx, y + l_h - s_h);
-			else if( large[font_index_apostrophe_c] != NULL )
-				large[font_index_apostrophe_c]->draw(cx, y);
+		cx += was_large ? l_w : s_w;
+	}
+}
+
+void Image::drawGlyphs(int x,int y,const vector<TextGlyph> &glyphs) {
+	for(size_t i=0;i<glyphs.size();i++) {
+		const TextGlyph *glyph = &glyphs[i];
+		glyph->image->draw(x + glyph->x, y + glyph->y);
+	}
+}
+
+#if SDL_MAJOR_VERSION == 1
+#else
+const size_t text_cache_size_c = 128;
+
+bool TextCache::Key::operator<(const Key &that) const {
+	for(int i=0;i<3;i++) {
+		if( fonts[i] != that.fonts[i] )
+			return fonts[i] < that.fonts[i];
+	}
+	if( number != that.number )
+		return number < that.number;
+	if( justify != that.justify )
+		return justify < that.justify;
+	return text < that.text;
+}
+
+TextCache::Entry *TextCache::find(const Key &key) {
+	std::map<Key, Entry>::iterator iter = entries.find(key);
+	if( iter == entries.end() )
+		return NULL;
+	iter->second.last_used = ++n_uses;
+	return &iter->second;
+}
+
+/** Adds an empty entry for the key, which mustn't already be in the cache.
+ */
+TextCache::Entry *TextCache::add(const Key &key) {
+	if( entries.size() >= text_cache_size_c ) {
+		std::map<Key, Entry>::iterator oldest = entries.begin();
+		for(std::map<Key, Entry>::iterator iter = entries.begin();iter != entries.end();++iter) {
+			if( iter->second.last_used < oldest->second.last_used )
+				oldest = iter;
 		}
-		else if( ch == '!' ) {
-			if( little[font_index_exclamation_c] != NULL )
-				little[font_index_exclamation_c]->draw(cx, y + l_h - s_h);
-			else if( large[font_index_exclamation_c] != NULL )
-				large[font_index_exclamation_c]->draw(cx, y);
+		delete oldest->second.image;
+		entries.erase(oldest);
+	}
+	Entry *new_entry = &entries[key];
+	new_entry->last_used = ++n_uses;
+	return new_entry;
+}
+
+void TextCache::clear() {
+	for(std::map<Key, Entry>::iterator iter = entries.begin();iter != entries.end();++iter) {
+		delete iter->second.image;
+	}
+	entries.clear();
+}
+
+/** Composes the glyphs into a single image, setting (*x, *y) to where it should be drawn relative to where
+ *  the text is written. Returns NULL if the image wouldn't look exactly the same as drawing the glyphs one
+ *  by one - e.g., if partly transparent pixels of two glyphs overlap.
+ */
+Image *Image::composeGlyphs(const vector<TextGlyph> &glyphs, int *x, int *y) {
+	if( size_only || glyphs.size() == 0 ) {
+		return NULL;
+	}
+	// the glyphs only keep the same positions relative to each other, wherever the text is written, if they
+	// line up with whole pixels
+	float scale_x = glyphs[0].image->scale_x;
+	float scale_y = glyphs[0].image->scale_y;
+	if( scale_x != (int)scale_x || scale_y != (int)scale_y ) {
+		return NULL;
+	}
+	int left = 0, top = 0, right = 0, bottom = 0;
+	for(size_t i=0;i<glyphs.size();i++) {
+		const Image *image = glyphs[i].image;
+		if( image->surface == NULL || image->scale_x != scale_x || image->scale_y != scale_y ) {
+			return NULL;
 		}
-		else if( ch == '?' ) {
-			if( little[font_index_question_c] != NULL )
-				little[font_index_question_c]->draw(cx, y + l_h - s_h);
-			else if( large[font_index_question_c] != NULL )
-				large[font_index_question_c]->draw(cx, y);
+		int gx = ( glyphs[i].x + image->offset_x ) * (int)scale_x;
+		int gy = ( glyphs[i].y + image->offset_y ) * (int)scale_y;
+		if( i == 0 || gx < left )
+			left = gx;
+		if( i == 0 || gy < top )
+			top = gy;
+		if( i == 0 || gx + image->getWidth() > right )
+			right = gx + image->getWidth();
+		if( i == 0 || gy + image->getHeight() > bottom )
+			bottom = gy + image->getHeight();
+	}
+
+	Image *text_image = createBlankImage(right - left, bottom - top, 32);
+	if( text_image->surface == NULL ) {
+		delete text_image;
+		return NULL;
+	}
+	SDL_Surface *surface = text_image->surface;
+	const Uint32 amask = surface->format->Amask;
+	bool ok = true;
+	SDL_LockSurface(surface);
+	for(size_t i=0;i<glyphs.size() && ok;i++) {
+		const Image *image = glyphs[i].image;
+		SDL_Surface *glyph_surface = image->surface;
+		// take the glyph's pixels as they are, the same as when it's put in the atlas, leaving out colour keyed pixels
+		Uint8 alpha_mod = 255;
+		SDL_GetSurfaceAlphaMod(glyph_surface, &alpha_mod);
+		if( alpha_mod != 255 ) {
+			ok = false;
+			break;
 		}
-		else if( ch == '-' ) {
-			if( little[font_index_dash_c] != NULL )
-				little[font_index_dash_c]->draw(cx, y + l_h - s_h);
-			else if( large[font_index_dash_c] != NULL )
-				large[font_index_dash_c]->draw(cx, y);
+		const Uint32 glyph_rgbmask = ~glyph_surface->format->Amask;
+		Uint32 colorkey = 0;
+		bool has_colorkey = SDL_GetColorKey(glyph_surface, &colorkey) == 0;
+
+		// where glyphs overlap, drawing the later one over the earlier one can only be done in advance where
+		// at most one of them is partly transparent
+		int gx = ( glyphs[i].x + image->offset_x ) * (int)scale_x - left;
+		int gy = ( glyphs[i].y + image->offset_y ) * (int)scale_y - top;
+		SDL_LockSurface(glyph_surface);
+		for(int cy=0;cy<glyph_surface->h && ok;cy++) {
+			Uint32 *dst_row = (Uint32 *)((Uint8 *)surface->pixels + (gy + cy) * surface->pitch) + gx;
+			for(int cx=0;cx<glyph_surface->w;cx++) {
+				Uint32 pixel = getpixel(glyph_surface, cx, cy);
+				if( has_colorkey && ( pixel & glyph_rgbmask ) == ( colorkey & glyph_rgbmask ) )
+					continue;
+				Uint8 r = 0, g = 0, b = 0, a = 0;
+				SDL_GetRGBA(pixel, glyph_surface->format, &r, &g, &b, &a);
+				if( a == 0 )
+					continue;
+				if( ( dst_row[cx] & amask ) == 0 || a == 255 )
+					dst_row[cx] = SDL_MapRGBA(surface->format, r, g, b, a);
+				else {
+					ok = false;
+					break;
+				}
+			}
 		}
-		else {
-			continue; // don't increase cx
+		SDL_UnlockSurface(glyph_surface);
+	}
+	SDL_UnlockSurface(surface);
+	if( !ok || !text_image->convertToDisplayFormat() ) {
+		delete text_image;
+		return NULL;
+	}
+	text_image->setScale(scale_x, scale_y);
+	// only the texture is needed from now on
+	text_image->size_only_w = text_image->getWidth();
+	text_image->size_only_h = text_image->getHeight();
+	SDL_FreeSurface(text_image->surface);
+	text_image->surface = NULL;
+	text_image->data = NULL;
+
+	*x = left / (int)scale_x;
+	*y = top / (int)scale_y;
+	return text_image;
+}
+
+const int text_cache_compose_writes_c = 2; // how many times text is written before it's composed into a single image
+
+/** Writes the text from the cache. Text is only composed once it's written again, so that text that's different
+ *  each frame (such as the frame rate) isn't composed only to be thrown away.
+ */
+void Image::writeCached(int x,int y,TextCache::Entry *entry) {
+	if( !entry->tried_compose && ++entry->n_writes >= text_cache_compose_writes_c ) {
+		entry->tried_compose = true;
+		entry->image = composeGlyphs(entry->glyphs, &entry->x, &entry->y);
+		if( entry->image != NULL ) {
+			entry->glyphs.clear();
 		}
-		cx += was_large ? l_w : s_w;
 	}
+	if( entry->image != NULL )
+		entry->image->draw(x + entry->x, y + entry->y);
+	else
+		drawGlyphs(x, y, entry->glyphs);
 }
+#endif
 
 void Image::smooth() {
+	if( this->surface == NULL ) {
+		// size-only image
+		return;
+	}
 	if( this->surface->format->BitsPerPixel != 24 && this->surface->format->BitsPerPixel != 32 ) {
 		return;
 	}
@@ -5,6 +5,8 @@
 
 #include "resources.h"
 
+#include <map>
+
 using std::string;
 
 #if defined(__ANDROID__)
@@ -26,6 +28,101 @@ const int font_index_dash_c = 31;
 const int n_font_chars_c = 32;
 
 namespace Gigalomania {
+	class Image;
+
+	/** A character of text, as laid out by Image::writeMixedCase() or writeNumbers(), at a position relative to
+	*   where the text is written.
+	*/
+	class TextGlyph {
+	public:
+		const Image *image;
+		int x, y;
+
+		TextGlyph(const Image *image, int x, int y) : image(image), x(x), y(y) {
+		}
+	};
+
+#if SDL_MAJOR_VERSION == 1
+#else
+	/** Text that has been written before, with each string that's written again composed into a single image,
+	*   so that it's then a single sprite. Once full, the least recently used entries are dropped.
+	*/
+	class TextCache {
+	public:
+		class Key {
+		public:
+			const void *fonts[3];
+			string text;
+			int number; // for text written with writeNumbers()
+			int justify;
+
+			Key(const void *font0, const void *font1, const void *font2, const char *text, int number, int justify) : text(text), number(number), justify(justify) {
+				fonts[0] = font0;
+				fonts[1] = font1;
+				fonts[2] = font2;
+			}
+			bool operator<(const Key &that) const;
+		};
+		class Entry {
+		public:
+			Image *image; // NULL if the glyphs haven't been or couldn't be composed, in which case they're drawn one by one
+			int x, y; // where image is drawn, relative to where the text is written
+			vector<TextGlyph> glyphs;
+			unsigned int last_used;
+			int n_writes;
+			bool tried_compose;
+
+			Entry() : image(NULL), x(0), y(0), last_used(0), n_writes(0), tried_compose(false) {
+			}
+		};
+	private:
+		std::map<Key, Entry> entries;
+		unsigned int n_uses;
+
+	public:
+		TextCache() : n_uses(0) {
+		}
+
+		Entry *find(const Key &key);
+		Entry *add(const Key &key);
+		void clear();
+	};
+
+	/** Records the sprites drawn by Images, so that runs of sprites from the same texture can be submitted
+	*   together. Sprites are always drawn in the order they were added, so anything else that draws with the
+	*   renderer must call flush() first. Before SDL 2.0.18 there's no way of submitting more than one sprite
+	*   in a call, so sprites are drawn straight away instead, and flush() does nothing.
+	*/
+	class SpriteBatch {
+		SDL_Renderer *renderer;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+		class Sprite {
+		public:
+			SDL_Texture *texture;
+			SDL_Rect srcrect, dstrect;
+			int alpha; // alpha mod to set on the texture before drawing, or -1 to leave it as it is
+			bool reset_alpha; // whether to set the alpha mod back to 255 afterwards
+		};
+		vector<Sprite> sprites;
+		vector<SDL_Vertex> vertices;
+		vector<int> indices;
+
+		void submitRun(size_t start, size_t end);
+#endif
+
+	public:
+		SpriteBatch() : renderer(NULL) {
+		}
+
+		void setRenderer(SDL_Renderer *renderer) {
+			this->flush();
+			this->renderer = renderer;
+		}
+		void add(SDL_Texture *texture, const SDL_Rect &srcrect, const SDL_Rect &dstrect, int alpha, bool reset_alpha);
+		void flush();
+	};
+#endif
+
 	class Image : public TrackedObject {
 		unsigned char *data;
 		bool need_to_free_data;
@@ -35,13 +132,29 @@ namespace Gigalomania {
 #else
 		SDL_Texture *texture;
 		static SDL_Renderer *sdlRenderer;
+		const Image *atlas_page; // if not NULL, this image is drawn from a region of atlas_page's texture, and has no texture of its own
+		int atlas_x, atlas_y;
+
+		static SpriteBatch sprite_batch;
+		static TextCache text_cache;
+
+		SDL_Texture *getTexture() const {
+			return atlas_page != NULL ? atlas_page->texture : texture;
+		}
 #endif
 		float scale_x, scale_y;
 		int offset_x, offset_y;
+		int size_only_w, size_only_h; // dimensions for size-only images and render targets, which have no surface
+
+		static bool size_only;
+		static int render_targets_generation;
 
 		Image();
+		static Image *createSizeOnlyImage(int width, int height);
+		static bool readImageSize(SDL_RWops *src, int *width, int *height);
 
 		void free();
+		void drawAt(int x, int y, int alpha) const;
 
 	public:
 		virtual ~Image();
@@ -60,6 +173,7 @@ namespace Gigalomania {
 			return (int)(this->getHeight() / scale_y);
 		}
 		bool convertToDisplayFormat();
+		static bool createAtlas();
 		bool copyPalette(const Image *image);
 		float getScaleX() const {
 			return scale_x;
@@ -114,6 +228,16 @@ namespace Gigalomania {
 		static Image * createNoise(int w,int h,float scale_u,float scale_v,const unsigned char filter_max[3],const unsigned char filter_min[3],NOISEMODE_t noisemode,int n_iterations);
 		static Image * createRadial(int w,int h,float alpha_scale);
 		static Image * createRadial(int w,int h,float alpha_scale, Uint8 r, Uint8 g, Uint8 b);
+		static Image * createRenderTarget(int width, int height);
+		bool setRenderTarget();
+		static void resetRenderTarget();
+		// incremented when the contents of render targets are lost, and so need drawing again
+		static int getRenderTargetsGeneration() {
+			return render_targets_generation;
+		}
+		static void renderTargetsLost() {
+			render_targets_generation++;
+		}
 
 		enum Justify {
 			JUSTIFY_LEFT = 0,
@@ -123,12 +247,45 @@ namespace Gigalomania {
 		static void writeNumbers(int x,int y,Image *images[10],int number,Justify justify);
 		static void write(int x,int y,Image *images[n_font_chars_c],const char *text,Justify justify);
 		static void writeMixedCase(int x,int y,Image *large[n_font_chars_c],Image *little[n_font_chars_c],Image *numbers[10],const char *text,Justify justify);
+	private:
+		static void layoutNumbers(vector<TextGlyph> *glyphs,Image *images[10],int number,Justify justify);
+		static void layoutMixedCase(vector<TextGlyph> *glyphs,Image *large[n_font_chars_c],Image *little[n_font_chars_c],Image *numbers[10],const char *text,Justify justify);
+		static void drawGlyphs(int x,int y,const vector<TextGlyph> &glyphs);
+#if SDL_MAJOR_VERSION == 1
+#else
+		static Image *composeGlyphs(const vector<TextGlyph> &glyphs, int *x, int *y);
+		static void writeCached(int x,int y,TextCache::Entry *entry);
+#endif
+	public:
+
+		// In size-only mode (used for headless running), images only record their dimensions; no pixel data is
+		// loaded or processed, and nothing is drawn.
+		static void setSizeOnly(bool size_only) {
+			Image::size_only = size_only;
+		}
+		static bool isSizeOnly() {
+			return size_only;
+		}
 
 		// SDL specific
 #if SDL_MAJOR_VERSION == 1
 		static void setGraphicsOutput(SDL_Surface *dest_surf);
+		static void flushSprites() {
+			// images are blitted straight away
+		}
+		static void clearTextCache() {
+			// text isn't cached
+		}
 #else
 		static void setGraphicsOutput(SDL_Renderer *sdlRenderer);
+		// must be called before drawing with the renderer other than through an Image
+		static void flushSprites() {
+			sprite_batch.flush();
+		}
+		// must be called before the fonts the text was written with are deleted
+		static void clearTextCache() {
+			text_cache.clear();
+		}
 #endif
 	};
 }
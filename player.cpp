@@ -18,8 +18,6 @@
 #include "tutorial.h"
 //---------------------------------------------------------------------------
 
-bool Player::alliances[n_players_c][n_players_c];
-int Player::alliance_last_asked[n_players_c][n_players_c];
 
 const char *PlayerType::getName(PlayerTypeID id) {
 	if( id == PLAYER_RED )
@@ -63,13 +61,13 @@ void PlayerType::getColour(int *r,int *g,int *b,PlayerTypeID id) {
 
 //Player::Player(int index, char *name) {
 //Player::Player(int index, int personality) {
-Player::Player(bool is_human, int index) :
-index(index), dead(false), n_births(0), n_deaths(0), n_men_for_this_island(0), n_suspended(0), is_human(is_human), alliance_last_asked_human(-1)
+Player::Player(Game *game, bool is_human, int index) :
+game(game), index(index), dead(false), n_births(0), n_deaths(0), n_men_for_this_island(0), n_suspended(0), is_human(is_human), alliance_last_asked_human(-1)
 {
 	for(int i=0;i<n_players_c;i++) {
-		if( i != index && game_g->players[i] != NULL && !game_g->players[i]->isDead() ) {
-			setAlliance(index, i, false);
-			setAllianceLastAsked(index, i, -1);
+		if( i != index && game->players[i] != NULL && !game->players[i]->isDead() ) {
+			game->setAlliance(index, i, false);
+			game->setAllianceLastAsked(index, i, -1);
 		}
 	}
 }
@@ -160,172 +158,23 @@ void Player::loadStateParseXMLNode(const TiXmlNode *parent) {
 	}
 }
 
-void Player::saveStateAlliances(stringstream &stream) {
-	stream << "<player_alliances>\n";
-	for(int i=0;i<n_players_c;i++) {
-		for(int j=i+1;j<n_players_c;j++) {
-			stream << "<player_alliance ";
-			stream << "player_id_i=\"" << i << "\" ";
-			stream << "player_id_j=\"" << j << "\" ";
-			stream << "alliances=\"" << (alliances[i][j] ? 1 : 0) << "\" ";
-			stream << "alliance_last_asked=\"" << alliance_last_asked[i][j] << "\" ";
-			stream << "/>\n";
-		}
-	}
-	stream << "</player_alliances>\n";
-}
-
-void Player::loadStateParseXMLNodeAlliances(const TiXmlNode *parent) {
-	if( parent == NULL ) {
-		return;
-	}
-	bool read_children = true;
-
-	switch( parent->Type() ) {
-		case TiXmlNode::TINYXML_DOCUMENT:
-			break;
-		case TiXmlNode::TINYXML_ELEMENT:
-			{
-				const char *element_name = parent->Value();
-				const TiXmlElement *element = parent->ToElement();
-				const TiXmlAttribute *attribute = element->FirstAttribute();
-				if( strcmp(element_name, "player_alliances") == 0 ) {
-					// handled entirely by caller
-				}
-				else if( strcmp(element_name, "player_alliance") == 0 ) {
-					int player_id_i = -1;
-					int player_id_j = -1;
-					bool alliance = false;
-					int last_asked = -1;
-					while( attribute != NULL ) {
-						const char *attribute_name = attribute->Name();
-						if( strcmp(attribute_name, "player_id_i") == 0 ) {
-							player_id_i = atoi(attribute->Value());
-						}
-						else if( strcmp(attribute_name, "player_id_j") == 0 ) {
-							player_id_j = atoi(attribute->Value());
-						}
-						else if( strcmp(attribute_name, "alliances") == 0 ) {
-							alliance = atoi(attribute->Value())==1;
-						}
-						else if( strcmp(attribute_name, "alliance_last_asked") == 0 ) {
-							last_asked = atoi(attribute->Value());
-						}
-						else {
-							// don't throw an error here, to help backwards compatibility, but should throw an error in debug mode in case this is a sign of not loading something that we've saved
-							LOG("unknown player_alliances/player_alliance attribute: %s\n", attribute_name);
-							ASSERT(false);
-						}
-						attribute = attribute->Next();
-					}
-					if( player_id_i < 0 || player_id_i >= n_players_c ) {
-						throw std::runtime_error("player_alliance invalid player_id_i");
-					}
-					else if( player_id_j < 0 || player_id_j >= n_players_c ) {
-						throw std::runtime_error("player_alliance invalid player_id_j");
-					}
-					alliances[player_id_i][player_id_j] = alliance;
-					alliance_last_asked[player_id_i][player_id_j] = last_asked;
-				}
-				else {
-					// don't throw an error here, to help backwards compatibility, but should throw an error in debug mode in case this is a sign of not loading something that we've saved
-					LOG("unknown player_alliances tag: %s\n", element_name);
-					ASSERT(false);
-				}
-			}
-			break;
-		case TiXmlNode::TINYXML_COMMENT:
-			break;
-		case TiXmlNode::TINYXML_UNKNOWN:
-			break;
-		case TiXmlNode::TINYXML_TEXT:
-			{
-			}
-			break;
-		case TiXmlNode::TINYXML_DECLARATION:
-			break;
-	}
-
-	for(const TiXmlNode *child=parent->FirstChild();child!=NULL && read_children;child=child->NextSibling())  {
-		loadStateParseXMLNodeAlliances(child);
-	}
-}
-
-void Player::setAlliance(int a, int b, bool alliance) {
-	LOG("Alliance %s between players %d and %d\n", alliance?"MADE":"BROKEN", a, b);
-	ASSERT(a != b);
-	ASSERT_PLAYER(a);
-	ASSERT_PLAYER(b);
-	if( a > b ) {
-		int dummy = a;
-		a = b;
-		b = dummy;
-	}
-	alliances[a][b] = alliance;
-}
-
-bool Player::isAlliance(int a, int b) {
-	ASSERT(a != b);
-	ASSERT_PLAYER(a);
-	ASSERT_PLAYER(b);
-	if( a > b ) {
-		int dummy = a;
-		a = b;
-		b = dummy;
-	}
-	return alliances[a][b];
-}
-
-void Player::resetAllAlliances() {
-	for(int i=0;i<n_players_c;i++) {
-		for(int j=i+1;j<n_players_c;j++) {
-			setAlliance(i, j, false);
-			setAllianceLastAsked(i, j, -1);
-		}
-	}
-}
-
-void Player::setAllianceLastAsked(int a, int b,int time) {
-	ASSERT(a != b);
-	ASSERT_PLAYER(a);
-	ASSERT_PLAYER(b);
-	if( a > b ) {
-		int dummy = a;
-		a = b;
-		b = dummy;
-	}
-	alliance_last_asked[a][b] = time;
-}
-
-int Player::allianceLastAsked(int a, int b) {
-	ASSERT(a != b);
-	ASSERT_PLAYER(a);
-	ASSERT_PLAYER(b);
-	if( a > b ) {
-		int dummy = a;
-		a = b;
-		b = dummy;
-	}
-	return alliance_last_asked[a][b];
-}
-
 bool Player::askHuman() {
 	const int wait_time_human_c = 5000;
-	//ASSERT( !isAlliance(index, human_player) );
+	//ASSERT( !game->isAlliance(index, human_player) );
 	//ASSERT( index != human_player );
 	ASSERT( !this->is_human );
 	// whether to _consider_ asking the human player - we still have to go through the requestAlliance test afterwards
-	if( game_g->getTutorial() != NULL && !game_g->getTutorial()->aiAllowAskAlliance() ) {
+	if( game->getTutorial() != NULL && !game->getTutorial()->aiAllowAskAlliance() ) {
 		return false;
 	}
-	int time = game_g->getGameTime();
+	int time = game->getGameTime();
 	if( alliance_last_asked_human == -1 ) {
 		// note - don't ask if alliance_last_asked_human==-1, to avoid being asked straight away
 		alliance_last_asked_human = time;
 	}
 	else if( time >= alliance_last_asked_human + wait_time_human_c ) {
 		alliance_last_asked_human = time;
-		if( rand() % 2 == 0 )
+		if( game->random(RANDOM_AI) % 2 == 0 )
 		{
 			return true;
 		}
@@ -336,16 +185,16 @@ bool Player::askHuman() {
 bool Player::requestAlliance(int player) {
 	// 'player' requests alliance with 'this'
 	const int wait_time_c = 5000;
-	ASSERT( !isAlliance(index, player) );
+	ASSERT( !game->isAlliance(index, player) );
 	//ASSERT( index != player );
 	//ASSERT(this->index != human_player);
 	ASSERT( !this->is_human );
-	int last_asked = Player::allianceLastAsked(index, player);
-	int time = game_g->getGameTime();
+	int last_asked = game->allianceLastAsked(index, player);
+	int time = game->getGameTime();
 	if( last_asked == -1 || time >= last_asked + wait_time_c ) {
-		Player::setAllianceLastAsked(index, player, time);
+		game->setAllianceLastAsked(index, player, time);
 		bool has_diplomatic_bonus = player == PlayerType::PLAYER_YELLOW;
-		if( has_diplomatic_bonus ? (rand() % 2 == 0)  : (rand() % 3 == 0) )
+		if( has_diplomatic_bonus ? (game->random(RANDOM_AI) % 2 == 0)  : (game->random(RANDOM_AI) % 3 == 0) )
 		{
 			return true;
 		}
@@ -419,7 +268,7 @@ void Player::kill(PlayingGameState *gamestate) {
 	// break alliances
 	for(int i=0;i<n_players_c;i++) {
 		if( i != this->index )
-			Player::setAlliance(i, index, false);
+			game->setAlliance(i, index, false);
 	}
 
 	/*if( ((PlayingGameState *)gamestate)->getPlayerAskingAlliance() == this->index ) {
@@ -434,10 +283,10 @@ void Player::kill(PlayingGameState *gamestate) {
 	// check for only being one side
 	bool one_side = true;
 	for(int i=0;i<n_players_c && one_side;i++) {
-		if( game_g->players[i] != NULL && !game_g->players[i]->isDead() ) {
+		if( game->players[i] != NULL && !game->players[i]->isDead() ) {
 			for(int j=0;j<n_players_c && one_side;j++) {
-				if( game_g->players[j] != NULL && !game_g->players[j]->isDead() ) {
-					if( i != j && !Player::isAlliance(i,j) ) {
+				if( game->players[j] != NULL && !game->players[j]->isDead() ) {
+					if( i != j && !game->isAlliance(i,j) ) {
 						one_side = false;
 					}
 				}
@@ -447,11 +296,11 @@ void Player::kill(PlayingGameState *gamestate) {
 	if( one_side ) {
 		// break all alliances
 		for(int i=0;i<n_players_c;i++) {
-			if( game_g->players[i] != NULL && !game_g->players[i]->isDead() ) {
+			if( game->players[i] != NULL && !game->players[i]->isDead() ) {
 				for(int j=0;j<n_players_c && one_side;j++) {
-					if( game_g->players[j] != NULL && !game_g->players[j]->isDead() ) {
+					if( game->players[j] != NULL && !game->players[j]->isDead() ) {
 						if( i != j ) {
-							Player::setAlliance(i, j, false);
+							game->setAlliance(i, j, false);
 						}
 					}
 				}
@@ -473,7 +322,7 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 	// reset to zero
 	sector->setDesigners( 0 );
 	for(int i=0;i<N_ID;i++) {
-		if( game_g->elements[i]->getType() != Element::GATHERABLE )
+		if( game->elements[i]->getType() != Element::GATHERABLE )
 			sector->setMiners((Id)i, 0);
 	}
 	sector->setWorkers( 0 );
@@ -495,7 +344,7 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 		}
 		for(int i=0;i<n_players_c-1;i++) {
 			int n_choose_from = n_players_c - 1 - i;
-			int c = rand() % n_choose_from;
+			int c = game->random(RANDOM_AI) % n_choose_from;
 			attack_order[i] = choose_from[c];
 			choose_from[c] = choose_from[n_choose_from-1];
 		}
@@ -618,11 +467,11 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 
 	if( sector->getCurrentManufacture() == NULL ) {
 		// defences handled already, above
-		for(int i=game_g->getNSubEpochs()-1;i>=0;i--) {
-			if( game_g->getStartEpoch() + i == nuclear_epoch_c )
+		for(int i=game->getNSubEpochs()-1;i>=0;i--) {
+			if( game->getStartEpoch() + i == nuclear_epoch_c )
 				continue; // nuclear weapons handled later
-			if( game_g->getStartEpoch() + i >= factory_epoch_c ) {
-				Design *design = sector->canBuildDesign(Invention::WEAPON, game_g->getStartEpoch() + i);
+			if( game->getStartEpoch() + i >= factory_epoch_c ) {
+				Design *design = sector->canBuildDesign(Invention::WEAPON, game->getStartEpoch() + i);
 				if( design != NULL ) {
 					sector->setCurrentManufacture(design);
 					sector->setFAmount(1);
@@ -644,8 +493,8 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 			}
 			if( !healed && sector->getCurrentManufacture() != NULL ) {
 				// manufacture a shield
-				for(int j=game_g->getNSubEpochs()-1;j>=0;j--) {
-					Design *design = sector->canBuildDesign(Invention::SHIELD, game_g->getStartEpoch() + j);
+				for(int j=game->getNSubEpochs()-1;j>=0;j--) {
+					Design *design = sector->canBuildDesign(Invention::SHIELD, game->getStartEpoch() + j);
 					if( design != NULL ) {
 						sector->setCurrentManufacture(design);
 						sector->setFAmount(1);
@@ -663,15 +512,15 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 		bool found_tower = false;
 		for(int x=0;x<map_width_c;x++) {
 			for(int y=0;y<map_height_c;y++) {
-				if( game_g->getMap()->isSectorAt(x, y) ) {
-					Sector *c_sector = game_g->getMap()->getSector(x, y);
+				if( game->getMap()->isSectorAt(x, y) ) {
+					Sector *c_sector = game->getMap()->getSector(x, y);
 					int this_strength = c_sector->getArmy(sector->getPlayer())->getStrength();
 					if( this_strength > 0 && ( !enemiesPresentWithBombardment || sector->getBuilding(BUILDING_TOWER)->getHealth() > EVACUATE_LEVEL ) ) {
 						// only nuke our own men if this tower is under attack and nearly destroyed
 						continue;
 					}
 					// prefer nuking towers to men
-					if( c_sector->getActivePlayer() != -1 && c_sector->getPlayer() != sector->getPlayer() && !Player::isAlliance(c_sector->getPlayer(), sector->getPlayer()) ) {
+					if( c_sector->getActivePlayer() != -1 && c_sector->getPlayer() != sector->getPlayer() && !game->isAlliance(c_sector->getPlayer(), sector->getPlayer()) ) {
 						if( nuke_sector == NULL || !found_tower || attack_pref[c_sector->getPlayer()] > attack_pref[nuke_sector->getPlayer()] ) {
 							nuke_sector = c_sector;
 							found_tower = true;
@@ -707,7 +556,7 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 	// trash designs?
 	sector->autoTrashDesigns();
 
-	if( game_g->getTutorial() != NULL && !game_g->getTutorial()->aiAllowDesign() ) {
+	if( game->getTutorial() != NULL && !game->getTutorial()->aiAllowDesign() ) {
 		// don't allow designs
 	}
 	else if( sector->getCurrentDesign() == NULL ) {
@@ -715,13 +564,13 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 		int best_weapon = -1;
 		int best_defence = -1;
 		int best_shield = -1;
-		for(int i=game_g->getNSubEpochs()-1;i>=0;i--) {
-			if( best_weapon == -1 && sector->inventionKnown(Invention::WEAPON, game_g->getStartEpoch() + i) )
-				best_weapon = game_g->getStartEpoch() + i;
-			if( best_defence == -1 && sector->inventionKnown(Invention::DEFENCE, game_g->getStartEpoch() + i) )
-				best_defence = game_g->getStartEpoch() + i;
-			if( best_shield == -1 && sector->inventionKnown(Invention::SHIELD, game_g->getStartEpoch() + i) )
-				best_shield = game_g->getStartEpoch() + i;
+		for(int i=game->getNSubEpochs()-1;i>=0;i--) {
+			if( best_weapon == -1 && sector->inventionKnown(Invention::WEAPON, game->getStartEpoch() + i) )
+				best_weapon = game->getStartEpoch() + i;
+			if( best_defence == -1 && sector->inventionKnown(Invention::DEFENCE, game->getStartEpoch() + i) )
+				best_defence = game->getStartEpoch() + i;
+			if( best_shield == -1 && sector->inventionKnown(Invention::SHIELD, game->getStartEpoch() + i) )
+				best_shield = game->getStartEpoch() + i;
 		}
 		Design *design = NULL;
 		Design *reserve_design = NULL;
@@ -729,8 +578,8 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 		design = sector->canResearch(Invention::WEAPON, nuclear_epoch_c);
 
 		bool try_mining_more = sector->tryMiningMore();
-		for(int i=0;i<game_g->getNSubEpochs() && design == NULL;i++) {
-			int eph = game_g->getStartEpoch() + i;
+		for(int i=0;i<game->getNSubEpochs() && design == NULL;i++) {
+			int eph = game->getStartEpoch() + i;
 			Design *this_design = NULL;
 
 			this_design = sector->canResearch(Invention::WEAPON, eph);
@@ -756,7 +605,7 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 			}
 		}
 
-		if( design == NULL && sector->getEpoch() < game_g->getStartEpoch() + 3 )
+		if( design == NULL && sector->getEpoch() < game->getStartEpoch() + 3 )
 			design = reserve_design;
 
 		if( design != NULL ) {
@@ -764,14 +613,14 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 		}
 	}
 
-	bool used_up = game_g->getStartEpoch() != end_epoch_c && sector->usedUp();
+	bool used_up = game->getStartEpoch() != end_epoch_c && sector->usedUp();
 	bool can_design = sector->getCurrentDesign() != NULL;
 	bool can_mine = false;
 	if( !used_up ) {
 		// even if there are elements remaining to mine, we might still consider a sector "used up" if we've already mined at least 6 of that element, and we still can't design anything
 		//
 		for(int i=0;i<N_ID && !can_mine;i++) {
-			if( sector->canMine((Id)i) && game_g->elements[i]->getType() != Element::GATHERABLE )
+			if( sector->canMine((Id)i) && game->elements[i]->getType() != Element::GATHERABLE )
 				can_mine = true;
 		}
 	}
@@ -826,7 +675,7 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 		int n_miners = 0;
 		while( n_miners < pop/split ) {
 			for(int i=0;i<N_ID && n_miners < pop/split;i++) {
-				if( sector->canMine((Id)i) && game_g->elements[i]->getType() != Element::GATHERABLE ) {
+				if( sector->canMine((Id)i) && game->elements[i]->getType() != Element::GATHERABLE ) {
 					int n = sector->getMiners((Id)i) + 1;
 					sector->setMiners((Id)i, n);
 					n_miners++;
@@ -848,7 +697,7 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 	}
 
 
-	if( game_g->getTutorial() != NULL && !game_g->getTutorial()->aiAllowDeploy() ) {
+	if( game->getTutorial() != NULL && !game->getTutorial()->aiAllowDeploy() ) {
 		// don't allow deployment
 	}
 	else if( sector->getCurrentDesign() == NULL || enemiesPresentWithBombardment ) {
@@ -859,16 +708,16 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 		bool new_sector = false;
 		int strength = 0;
 		bool temp[map_width_c][map_height_c];
-		game_g->getMap()->canMoveTo(temp, sector->getXPos(),sector->getYPos(),sector->getPlayer());
+		game->getMap()->canMoveTo(temp, sector->getXPos(),sector->getYPos(),sector->getPlayer());
 
 		// if used up, look for a new sector
-		bool look_for_new_sector = used_up || ( rand() % 3 == 0 );
+		bool look_for_new_sector = used_up || ( game->random(RANDOM_AI) % 3 == 0 );
 		if( look_for_new_sector ) {
 			vector<Sector *> candidate_sectors;
 			int max_n_men = 0;
 			for(int x=0;x<map_width_c;x++) {
 				for(int y=0;y<map_height_c;y++) {
-					Sector *c_sector = game_g->getMap()->getSector(x, y);
+					Sector *c_sector = game->getMap()->getSector(x, y);
 					if( c_sector == NULL )
 						continue;
 					// Only worth moving to a sector that has no other players
@@ -899,7 +748,7 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 			}
 			if( candidate_sectors.size() > 0 ) {
 				// randomly pick out of the candidate sectors
-				int r = rand() % candidate_sectors.size();
+				int r = game->random(RANDOM_AI) % candidate_sectors.size();
 				target_sector = candidate_sectors.at(r);
 				by_land = true;
 				new_sector = true;
@@ -909,11 +758,11 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 		// look for tower to attack
 		for(int x=0;x<map_width_c;x++) {
 			for(int y=0;y<map_height_c;y++) {
-				Sector *c_sector = game_g->getMap()->getSector(x, y);
+				Sector *c_sector = game->getMap()->getSector(x, y);
 				if( c_sector == NULL )
 					continue;
 				if( c_sector->getActivePlayer() != -1 && c_sector->getPlayer() != sector->getPlayer()
-					&& !Player::isAlliance(c_sector->getPlayer(), sector->getPlayer())
+					&& !game->isAlliance(c_sector->getPlayer(), sector->getPlayer())
 					&& !new_sector // only consider attacking if aren't moving to a new sector
 					) {
 						//int this_strength = c_sector->getArmy(sector->getPlayer())->getTotal();
@@ -934,13 +783,13 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 			// look for men to attack
 			for(int x=0;x<map_width_c;x++) {
 				for(int y=0;y<map_height_c;y++) {
-					Sector *c_sector = game_g->getMap()->getSector(x, y);
+					Sector *c_sector = game->getMap()->getSector(x, y);
 					if( c_sector == NULL )
 						continue;
 					bool enemy = false;
 					for(int i=0;i<n_players_c && !enemy;i++) {
 						if( i != sector->getPlayer() && c_sector->getArmy(i)->getTotal() > 0 &&
-							!Player::isAlliance(i, sector->getPlayer()) )
+							!game->isAlliance(i, sector->getPlayer()) )
 							enemy = true;
 					}
 					if( enemy ) {
@@ -969,7 +818,7 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 			//if( enemiesPresent || new_sector )
 			if( enemiesPresent || used_up )
 				min_pop = 0;
-			for(int i=n_epochs_c-1;i>=game_g->getStartEpoch();i--) {
+			for(int i=n_epochs_c-1;i>=game->getStartEpoch();i--) {
 				if( i == nuclear_epoch_c )
 					continue;
 				if( !by_land && !isAirUnit(i) )
@@ -990,10 +839,10 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 			//int assembled_strength = sector->getAssembledArmy()->getTotal();
 			int assembled_strength = sector->getAssembledArmy()->getStrength();
 			//int min_req = 8;
-			//int min_req = 4 * (game_g->getStartEpoch()+1);
-			int min_req = 8 * (game_g->getStartEpoch()+1);
+			//int min_req = 4 * (game->getStartEpoch()+1);
+			int min_req = 8 * (game->getStartEpoch()+1);
 			min_req = std::min(min_req, 50);
-			for(int i=0;i<=game_g->getStartEpoch();i++)
+			for(int i=0;i<=game->getStartEpoch();i++)
 				min_req *= 2;
 			if( used_up ) {
 				// no point waiting
@@ -1001,12 +850,12 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 			}
 
 			/*if( by_land && sector->getCurrentDesign() == NULL && sector->getCurrentManufacture() == NULL &&
-			( enemiesPresent || assembled_strength > min_req || game_g->getStartEpoch() == end_epoch_c ) ) {
+			( enemiesPresent || assembled_strength > min_req || game->getStartEpoch() == end_epoch_c ) ) {
 			// only use unarmed men if we aren't designing or manufacturing anything
 			// and either we are under attack, or we are able to destroy enemy buildings, or moving to a new sector
 			// assemble unarmed men*/
 			if( by_land && sector->getCurrentDesign() == NULL && sector->getCurrentManufacture() == NULL &&
-				( enemiesPresentWithBombardment || game_g->getStartEpoch() == end_epoch_c || new_sector ) ) {
+				( enemiesPresentWithBombardment || game->getStartEpoch() == end_epoch_c || new_sector ) ) {
 					// only use unarmed men if we aren't designing or manufacturing anything
 					// and either we are under attack, or we are able to destroy enemy buildings, or we are moving to a new sector
 					// assemble unarmed men
@@ -1030,7 +879,7 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 				else if( strength + assembled_strength >= min_req || enemiesPresentWithBombardment ) {
 					ASSERT( !target_sector->isNuked() );
 					if( target_sector->getPlayer() == client_player && !target_sector->getArmy(this->index)->any(true) ) {
-						game_g->setTimeRate(1); // auto-slow if attacking a player sector (but not if already being attacked by this player)
+						game->setTimeRate(1); // auto-slow if attacking a player sector (but not if already being attacked by this player)
 						gamestate->refreshTimeRate();
 					}
 					bool moved_all = target_sector->moveArmy(sector->getAssembledArmy());
@@ -1046,22 +895,22 @@ void Player::doSectorAI(int client_player, PlayingGameState *gamestate, Sector *
 
 
 void Player::doAIUpdate(int client_player, PlayingGameState *gamestate) {
-	if( game_g->players[index]->isDead() ) {
+	if( game->players[index]->isDead() ) {
 		return;
 	}
 	//LOG("Player::doAIUpdate()\n");
 
-	int loop_time = game_g->getLoopTime();
+	int loop_time = game->getLoopTime();
 
 	// TODO: currently breaking/making alliances is entirely random, should improve this...
 
 	// break alliances
 	int p_break_alliance = poisson(20000, loop_time);
 	bool break_alliance = false;
-	if( (rand() % RAND_MAX) <= p_break_alliance ) {
+	if( (game->random(RANDOM_AI) % RAND_MAX) <= p_break_alliance ) {
 		for(int i=0;i<n_players_c;i++) {
-			if( i != index && Player::isAlliance(i, index) ) {
-				Player::setAlliance(i, index, false);
+			if( i != index && game->isAlliance(i, index) ) {
+				game->setAlliance(i, index, false);
 				break_alliance = true;
 			}
 		}
@@ -1074,7 +923,7 @@ void Player::doAIUpdate(int client_player, PlayingGameState *gamestate) {
 
 	// make alliances
 	for(int i=0;i<n_players_c;i++) {
-		if( i != this->index && game_g->players[i] != NULL && !game_g->players[i]->isDead() /*&& i != human_player*/ ) {
+		if( i != this->index && game->players[i] != NULL && !game->players[i]->isDead() /*&& i != human_player*/ ) {
 			//if( this->index == ((PlayingGameState *)gamestate)->getPlayerAskingAlliance() || i == ((PlayingGameState *)gamestate)->getPlayerAskingAlliance() ) {
 			if( this->index == gamestate->getPlayerAskingAlliance() || i == gamestate->getPlayerAskingAlliance() ) {
 				// one of these AIs is asking the player, so don't request
@@ -1090,51 +939,64 @@ void Player::doAIUpdate(int client_player, PlayingGameState *gamestate) {
 		}
 	}
 
-	// update sectors
-	for(int x=0;x<map_width_c;x++) {
-		for(int y=0;y<map_height_c;y++) {
-			Sector *sector = game_g->getMap()->getSector(x, y);
-			if( sector == NULL )
-				continue;
-			if( sector->getActivePlayer() == this->index ) {
-				//game_g->getMap()->sectors[x][y]->doAIUpdate();
-				doSectorAI(client_player, gamestate, sector);
+	// update sectors, in the order of a scan over the map - only the sectors we own or have an army in need looking at
+	Map *map = game->getMap();
+	for(Sector *sector = map->nextPlayerSector(index, NULL); sector != NULL; sector = map->nextPlayerSector(index, sector)) {
+		if( sector->getActivePlayer() == this->index ) {
+			//game->getMap()->sectors[x][y]->doAIUpdate();
+			doSectorAI(client_player, gamestate, sector);
+		}
+		else {
+			Army *army = sector->getArmy(index);
+			if( !army->any(true) ) {
+				// no army to move
+			}
+			else if( !army->canLeaveSafely() ) {
+				// can't retreat safely
 			}
 			else {
-				Army *army = sector->getArmy(index);
-				if( !army->any(true) ) {
-					// no army to move
-				}
-				else if( !army->canLeaveSafely() ) {
-					// can't retreat safely
+				// at this point, we have an army, with no enemies present, so check if we can build here
+				bool move = false;
+				if( sector->isShutdown() )
+					move = true;
+				else if( sector->getPlayer() != -1 ) {
+					ASSERT( game->isAlliance(sector->getPlayer(), index) ); // must be true, otherwise we should not be able to retreat safely
+					move = true;
 				}
-				else {
-					// at this point, we have an army, with no enemies present, so check if we can build here
-					bool move = false;
-					if( sector->isShutdown() )
-						move = true;
-					else if( sector->getPlayer() != -1 ) {
-						ASSERT( Player::isAlliance(sector->getPlayer(), index) ); // must be true, otherwise we should not be able to retreat safely
+				for(int i=0;i<n_players_c && !move;i++) {
+					if( i != index && sector->getArmy(i)->any(true) ) {
+						ASSERT( game->isAlliance(i, index) ); // must be true, otherwise we should not be able to retreat safely
 						move = true;
 					}
-					for(int i=0;i<n_players_c && !move;i++) {
-						if( i != index && sector->getArmy(i)->any(true) ) {
-							ASSERT( Player::isAlliance(i, index) ); // must be true, otherwise we should not be able to retreat safely
-							move = true;
+				}
+				if( move ) {
+					// find somewhere to move
+					// TODO: move to attack players, if can't return to a tower
+					// prefer the nearest of our sectors that the whole army can get to; otherwise take the first
+					// that accepts it (air units can still fly there)
+					const vector<Sector *> &player_sectors = map->getPlayerSectors(index);
+					Sector *nearest_sector = NULL;
+					int nearest_dist = -1;
+					for(size_t i=0;i<player_sectors.size();i++) {
+						Sector *c_sector = player_sectors[i];
+						if( c_sector->getActivePlayer() == this->index ) {
+							int dist = map->findPath(sector->getXPos(), sector->getYPos(), c_sector->getXPos(), c_sector->getYPos(), index, NULL);
+							if( dist != -1 && ( nearest_sector == NULL || dist < nearest_dist ) ) {
+								nearest_sector = c_sector;
+								nearest_dist = dist;
+							}
 						}
 					}
-					if( move ) {
-						// find somewhere to move
-						// TODO: move to attack players, if can't return to a tower
-						bool done = false;
-						for(int cx=0;cx<map_width_c && !done;cx++) {
-							for(int cy=0;cy<map_height_c && !done;cy++) {
-								Sector *c_sector = game_g->getMap()->getSector(cx, cy);
-								if( c_sector != NULL && c_sector->getActivePlayer() == this->index ) {
-									ASSERT( c_sector != sector );
-									done = c_sector->moveArmy(army);
-								}
-							}
+					bool done = false;
+					if( nearest_sector != NULL ) {
+						ASSERT( nearest_sector != sector );
+						done = nearest_sector->moveArmy(army);
+					}
+					for(size_t i=0;i<player_sectors.size() && !done;i++) {
+						Sector *c_sector = player_sectors[i];
+						if( c_sector->getActivePlayer() == this->index ) {
+							ASSERT( c_sector != sector );
+							done = c_sector->moveArmy(army);
 						}
 					}
 				}
@@ -7,6 +7,7 @@
 /** Handles the players, including all the AI.
 */
 
+class Game;
 class Sector;
 class PlayingGameState;
 
@@ -25,6 +26,7 @@ public:
 };
 
 class Player {
+	Game *game;
 	int index; // saved
 	bool dead; // saved
 
@@ -36,17 +38,12 @@ class Player {
 	bool is_human;
 
 	void doSectorAI(int client_player, PlayingGameState *gamestate, Sector *sector);
-	static bool alliances[n_players_c][n_players_c];
-	static int alliance_last_asked[n_players_c][n_players_c];
 
 	int alliance_last_asked_human; // time we last asked human player, to avoid continually asking // aved
-
-	static void setAllianceLastAsked(int a, int b,int time);
-	static int allianceLastAsked(int a, int b);
 public:
 	//Player(int index, char *name);
 	//Player(int index, int personality);
-	Player(bool is_human, int index);
+	Player(Game *game, bool is_human, int index);
 	~Player();
 
 	bool isHuman() const {
@@ -100,10 +97,4 @@ public:
 
 	void saveState(stringstream &stream) const;
 	void loadStateParseXMLNode(const TiXmlNode *parent);
-	static void saveStateAlliances(stringstream &stream);
-	static void loadStateParseXMLNodeAlliances(const TiXmlNode *parent);
-
-	static void setAlliance(int a, int b, bool alliance);
-	static bool isAlliance(int a, int b);
-	static void resetAllAlliances();
 };
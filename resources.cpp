@@ -2,6 +2,8 @@
 #include "stdafx.h"
 
 #include "resources.h"
+#include "game.h"
+#include "image.h"
 #include "utils.h"
 
 #include <cstring>
@@ -13,12 +15,20 @@
 
 using namespace Gigalomania;
 
-vector<TrackedObject *> TrackedObject::tags;
+vector<TrackedObject::Slot> TrackedObject::slots;
+int TrackedObject::first_free_slot = -1;
+int TrackedObject::n_live = 0;
+int TrackedObject::peak_live = 0;
+vector<TrackedObject::TrackedClass> TrackedObject::classes;
+SDL_mutex *TrackedObject::tags_mutex = NULL;
 
-TrackedObject::TrackedObject() {
+static size_t makeTag(int slot, size_t generation, int tag_slot_bits) {
+	return ( generation << tag_slot_bits ) | (size_t)(slot+1);
+}
+
+TrackedObject::TrackedObject() : tag(0), deleteLevel(0), game(game_g), class_index(-1), prev_in_class(NULL), next_in_class(NULL) {
 	this->tag = TrackedObject::addTag(this);
 	//LOG("New Tracked Object, tag = %d\n", this->tag);
-	this->deleteLevel = 0;
 }
 
 TrackedObject::~TrackedObject() {
@@ -28,34 +38,68 @@ TrackedObject::~TrackedObject() {
 
 void TrackedObject::initialise() {
 	// important for Android, where static/globals aren't cleared when native app is restarted
-	tags.clear();
+	Image::clearTextCache(); // while its images are still tracked
+	slots.clear();
+	first_free_slot = -1;
+	n_live = 0;
+	peak_live = 0;
+	classes.clear();
+	if( tags_mutex == NULL ) {
+		tags_mutex = SDL_CreateMutex();
+	}
 }
 
 void TrackedObject::flushAll() {
 	LOG("TrackedObject::flushAll()\n");
-	for(size_t i=0;i<tags.size();i++) {
-		TrackedObject *vo = tags.at(i);
+	for(size_t i=0;i<slots.size();i++) {
+		TrackedObject *vo = slots.at(i).ptr;
 		if(vo != NULL) {
 			delete vo;
-			tags[i] = NULL;
 		}
 	}
-	tags.clear();
+	slots.clear();
+	first_free_slot = -1;
+	for(size_t i=0;i<classes.size();i++) {
+		classes[i].first = NULL;
+		classes[i].n_live = 0;
+	}
+	n_live = 0;
 }
 
 void TrackedObject::flush(int deleteLevel) {
 	LOG("TrackedObject::flush(%d)\n", deleteLevel);
-	for(size_t i=0;i<tags.size();i++) {
-		TrackedObject *vo = tags.at(i);
+	for(size_t i=0;i<slots.size();i++) {
+		TrackedObject *vo = slots.at(i).ptr;
 		if(vo != NULL && vo->deleteLevel >= deleteLevel) {
 			delete vo;
-			tags[i] = NULL;
 		}
 	}
 }
 
+/** Deletes the objects created by the supplied game, such as its images and samples, leaving those of any
+ *  other games in the process.
+ */
+void TrackedObject::flushGame(const Game *game) {
+	LOG("TrackedObject::flushGame(%d)\n", game);
+	// n.b., the mutex is recursive, so objects can still be deleted while it's locked
+	if( tags_mutex != NULL )
+		SDL_LockMutex(tags_mutex);
+	// the cached text may have been written with this game's fonts
+	Image::clearTextCache();
+	for(size_t i=0;i<slots.size();i++) {
+		TrackedObject *vo = slots.at(i).ptr;
+		if(vo != NULL && vo->game == game) {
+			delete vo;
+		}
+	}
+	if( tags_mutex != NULL )
+		SDL_UnlockMutex(tags_mutex);
+}
+
 void TrackedObject::cleanup() {
 	LOG("TrackedObject::cleanup()\n");
+	logMemoryReport();
+	Image::clearTextCache();
 	flushAll();
 
 	/*if(error != NULL)
@@ -66,36 +110,143 @@ void TrackedObject::cleanup() {
 	#endif*/
 }
 
+void TrackedObject::linkToClass(int class_index) {
+	TrackedClass *tracked_class = &classes.at(class_index);
+	this->class_index = class_index;
+	this->prev_in_class = NULL;
+	this->next_in_class = tracked_class->first;
+	if( tracked_class->first != NULL )
+		tracked_class->first->prev_in_class = this;
+	tracked_class->first = this;
+	tracked_class->n_live++;
+	if( tracked_class->n_live > tracked_class->peak_live )
+		tracked_class->peak_live = tracked_class->n_live;
+}
+
+void TrackedObject::unlinkFromClass() {
+	TrackedClass *tracked_class = &classes.at(this->class_index);
+	if( this->prev_in_class != NULL )
+		this->prev_in_class->next_in_class = this->next_in_class;
+	else
+		tracked_class->first = this->next_in_class;
+	if( this->next_in_class != NULL )
+		this->next_in_class->prev_in_class = this->prev_in_class;
+	tracked_class->n_live--;
+	this->class_index = -1;
+	this->prev_in_class = NULL;
+	this->next_in_class = NULL;
+}
+
+/** Moves objects whose class isn't known yet into the lists for their classes. This calls getClass(), so
+ *  mustn't be done while objects may be under construction on other threads.
+ */
+void TrackedObject::classify() {
+	if( tags_mutex != NULL )
+		SDL_LockMutex(tags_mutex);
+	while( classes.size() > 0 && classes[0].first != NULL ) {
+		TrackedObject *vo = classes[0].first;
+		const char *name = vo->getClass();
+		int index = -1;
+		for(size_t i=1;i<classes.size() && index == -1;i++) {
+			if( strcmp(classes[i].name, name) == 0 )
+				index = (int)i;
+		}
+		if( index == -1 ) {
+			index = (int)classes.size();
+			classes.push_back(TrackedClass(name));
+		}
+		vo->unlinkFromClass();
+		vo->linkToClass(index);
+	}
+	if( tags_mutex != NULL )
+		SDL_UnlockMutex(tags_mutex);
+}
+
 size_t TrackedObject::addTag(TrackedObject *ptr) {
-	size_t tag = tags.size() + 1;
-	tags.push_back(ptr);
+	if( tags_mutex != NULL )
+		SDL_LockMutex(tags_mutex);
+	int slot = first_free_slot;
+	if( slot != -1 ) {
+		first_free_slot = slots[slot].next_free;
+		slots[slot].next_free = -1;
+	}
+	else {
+		slot = (int)slots.size();
+		ASSERT( slot + 1 < (1 << tag_slot_bits_c) );
+		slots.push_back(Slot());
+	}
+	slots[slot].ptr = ptr;
+	size_t tag = makeTag(slot, slots[slot].generation, tag_slot_bits_c);
+	if( classes.size() == 0 )
+		classes.push_back(TrackedClass("unclassified"));
+	ptr->linkToClass(0);
+	n_live++;
+	if( n_live > peak_live )
+		peak_live = n_live;
+	if( tags_mutex != NULL )
+		SDL_UnlockMutex(tags_mutex);
 	return tag;
 }
 
 TrackedObject *TrackedObject::ptrFromTag(size_t tag) {
-	TrackedObject *ptr = NULL;
-	if( tag == 0 ||tag > tags.size() ) {
+	int slot = slotFromTag(tag);
+	if( slot < 0 || slot >= (int)slots.size() ) {
 		// error
-		ptr = NULL;
+		return NULL;
 	}
-	else {
-		ptr = tags.at(tag-1);
+	if( tag != makeTag(slot, slots[slot].generation, tag_slot_bits_c) ) {
+		// the object has been deleted, and the slot may since have been reused
+		return NULL;
 	}
-	return ptr;
+	return slots[slot].ptr;
 }
 
 void TrackedObject::removeTag(size_t tag) {
-	//tags.getData()[tag - 1] = NULL;
-	tags[tag-1] = NULL;
+	if( tags_mutex != NULL )
+		SDL_LockMutex(tags_mutex);
+	int slot = slotFromTag(tag);
+	TrackedObject *ptr = slots[slot].ptr;
+	if( ptr->class_index != -1 )
+		ptr->unlinkFromClass();
+	slots[slot].ptr = NULL;
+	slots[slot].generation++;
+	slots[slot].next_free = first_free_slot;
+	first_free_slot = slot;
+	n_live--;
+	if( tags_mutex != NULL )
+		SDL_UnlockMutex(tags_mutex);
 }
 
 size_t TrackedObject::getNumTags() {
-	return tags.size();
+	return slots.size();
 }
 
 TrackedObject *TrackedObject::getTag(size_t index) {
 	//return (TrackedObject *)tags.elementAt(index);
-	return tags.at(index);
+	return slots.at(index).ptr;
+}
+
+/** Returns the first live object of the given class, or NULL if there are none; use getNextOfClass() for the
+ *  rest. Objects mustn't be created or deleted while iterating.
+ */
+TrackedObject *TrackedObject::getFirstOfClass(const char *classname) {
+	classify();
+	for(size_t i=1;i<classes.size();i++) {
+		if( strcmp(classes[i].name, classname) == 0 )
+			return classes[i].first;
+	}
+	return NULL;
+}
+
+/** Logs the number of live objects of each class, and the most there have been at once. Objects deleted
+ *  before they were classified only count towards the totals.
+ */
+void TrackedObject::logMemoryReport() {
+	classify();
+	LOG("tracked objects: %d live, peak %d, %d slots\n", n_live, peak_live, (int)slots.size());
+	for(size_t i=1;i<classes.size();i++) {
+		LOG("    %s: %d live, peak %d\n", classes[i].name, classes[i].n_live, classes[i].peak_live);
+	}
 }
 
 /*VisionException *Vision::getError() {
@@ -6,11 +6,57 @@
 
 using std::vector;
 
+class Game;
+
 namespace Gigalomania {
 	class TrackedObject {
-		static vector<TrackedObject *> tags;
+		/* Slots are reused once their object is deleted, so each keeps a generation count that's part of the
+		 * tag, and a tag for a deleted object is never mistaken for the object that later has its slot.
+		 */
+		class Slot {
+		public:
+			TrackedObject *ptr;
+			size_t generation;
+			int next_free; // next free slot, when this one is free, or -1
+
+			Slot() : ptr(NULL), generation(0), next_free(-1) {
+			}
+		};
+		/* Objects of one class, as an intrusive list through the objects. Class 0 holds the objects whose class
+		 * isn't known yet - getClass() can't be called from the constructor, so objects are sorted into their
+		 * classes by classify().
+		 */
+		class TrackedClass {
+		public:
+			const char *name;
+			TrackedObject *first;
+			int n_live;
+			int peak_live;
+
+			TrackedClass(const char *name) : name(name), first(NULL), n_live(0), peak_live(0) {
+			}
+		};
+		static const int tag_slot_bits_c = 20;
+
+		static vector<Slot> slots;
+		static int first_free_slot;
+		static int n_live;
+		static int peak_live;
+		static vector<TrackedClass> classes;
+		static SDL_mutex *tags_mutex; // objects may be created on worker threads, e.g., buildings made when sectors are updated
 		size_t tag;
 		int deleteLevel;
+		Game *game; // the game being run on the thread that created this object, if any - see flushGame()
+		int class_index;
+		TrackedObject *prev_in_class;
+		TrackedObject *next_in_class;
+
+		static void classify();
+		void linkToClass(int class_index);
+		void unlinkFromClass();
+		static int slotFromTag(size_t tag) {
+			return (int)(tag & ((1 << tag_slot_bits_c) - 1)) - 1;
+		}
 
 	public:
 		TrackedObject();
@@ -19,12 +65,18 @@ namespace Gigalomania {
 		static void initialise();
 		static void flushAll();
 		static void flush(int deleteLevel);
+		static void flushGame(const Game *game);
 		static void cleanup();
 		static size_t addTag(TrackedObject *ptr);
 		static void removeTag(size_t tag);
 		static size_t getNumTags();
 		static TrackedObject *getTag(size_t index);
 		static TrackedObject *ptrFromTag(size_t tag);
+		static TrackedObject *getFirstOfClass(const char *classname);
+		TrackedObject *getNextOfClass() const {
+			return this->next_in_class;
+		}
+		static void logMemoryReport();
 		virtual const char *getClass() const=0;
 		bool isClass(const char *classname) const;
 	};
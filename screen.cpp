@@ -130,6 +130,7 @@ void Screen::clear() {
 	rect.h = getHeight();
 	SDL_FillRect(surface, &rect, 0);
 #else
+	Image::flushSprites();
 	SDL_SetRenderDrawColor(sdlRenderer, 0, 0, 0, 255);
 	SDL_RenderClear(sdlRenderer);
 #endif
@@ -139,6 +140,7 @@ void Screen::refresh() {
 #if SDL_MAJOR_VERSION == 1
 	SDL_Flip(surface);
 #else
+	Image::flushSprites();
 	SDL_RenderPresent(sdlRenderer);
 #endif
 }
@@ -177,6 +179,7 @@ void Screen::fillRect(short x, short y, short w, short h, unsigned char r, unsig
 	Uint32 col = SDL_MapRGB(surface->format, r, g, b);
 	SDL_FillRect(surface, &rect, col);
 #else
+	Image::flushSprites();
 	SDL_SetRenderDrawColor(sdlRenderer, r, g, b, 255);
 	SDL_RenderFillRect(sdlRenderer, &rect);
 #endif
@@ -192,6 +195,7 @@ void Screen::fillRectWithAlpha(short x, short y, short w, short h, unsigned char
 	rect.w = w;
 	rect.h = h;
 	//LOG("fill rect %d %d %d %d\n", r, g, b, alpha);
+	Image::flushSprites();
 	SDL_SetRenderDrawColor(sdlRenderer, r, g, b, alpha);
 	SDL_RenderFillRect(sdlRenderer, &rect);
 }
@@ -201,6 +205,7 @@ void Screen::fillRectWithAlpha(short x, short y, short w, short h, unsigned char
 // not supported with SDL 1.2
 #else
 void Screen::drawLine(short x1, short y1, short x2, short y2, unsigned char r, unsigned char g, unsigned char b) {
+	Image::flushSprites();
 	SDL_SetRenderDrawColor(sdlRenderer, r, g, b, 255);
 	SDL_RenderDrawLine(sdlRenderer, x1, y1, x2, y2);
 }
@@ -282,7 +287,8 @@ bool Application::init() {
 #else
 	setenv("SDL_VIDEO_CENTERED", "0,0", 1);
 #endif
-	if( SDL_Init(SDL_INIT_VIDEO|SDL_INIT_AUDIO) == -1 ) {
+	Uint32 flags = game_g->isHeadless() ? SDL_INIT_TIMER : SDL_INIT_VIDEO|SDL_INIT_AUDIO;
+	if( SDL_Init(flags) == -1 ) {
 		LOG("SDL_Init failed\n");
 		return false;
 	}
@@ -323,6 +329,9 @@ void Application::runMainLoop() {
 	const int fps_frames_c = 50;
 	int frames = 0;
 	while(!quit) {
+		if( game_g->getProfiler() != NULL ) {
+			game_g->getProfiler()->beginFrame();
+		}
 		if( compute_fps && frames == fps_frames_c ) {
 			int new_fps_time = clock();
 			float t = ((float)(new_fps_time - last_fps_time)) / (float)CLOCKS_PER_SEC;
@@ -358,6 +367,8 @@ void Application::runMainLoop() {
 		elapsed_time = new_time;
 
 		// user input
+		Profiler *profiler = game_g->getProfiler();
+		Uint64 input_start_time = profiler != NULL ? profiler->getTime() : 0;
 		while( SDL_PollEvent(&event) == 1 ) {
 			switch (event.type) {
 			case SDL_QUIT:
@@ -385,6 +396,12 @@ void Application::runMainLoop() {
 					else if( key.sym == SDLK_p ) {
 						game_g->togglePause();
 					}
+					else if( key.sym == SDLK_f ) {
+						game_g->cycleFastForward();
+					}
+					else if( key.sym == SDLK_t ) {
+						game_g->writeProfilerTrace();
+					}
 					else if( key.sym == SDLK_RETURN ) {
 						game_g->keypressReturn();
 					}
@@ -530,10 +547,16 @@ void Application::runMainLoop() {
 					game_g->deactivate();
 				}
 				break;
+			case SDL_RENDER_TARGETS_RESET:
+				Image::renderTargetsLost();
+				break;
 #endif
 			}
 		}
 		SDL_PumpEvents();
+		if( profiler != NULL ) {
+			profiler->addSample(PROFILE_INPUT, input_start_time, profiler->getTime());
+		}
 
 		game_g->updateGame();
 	}
@@ -99,7 +99,7 @@ void SmokeParticleSystem::update() {
 		float ypos = particles.at(i).getY();
 		float ydiff = real_loop_time * yspeed;
 		float xdiff = real_loop_time * xspeed;
-		if( rand() % 2 == 0 ) {
+		if( game_g->random(RANDOM_COSMETIC) % 2 == 0 ) {
 			xdiff = - xdiff;
 		}
 		//xpos += xdiff;
@@ -137,61 +137,99 @@ void SmokeParticleSystem::update() {
 	}
 }
 
-Army::Army(PlayingGameState *gamestate, Sector *sector, int player) :
-player(player), sector(sector), gamestate(gamestate)
+Army::Army(Game *game, PlayingGameState *gamestate, Sector *sector, int player) :
+total(0), player(player), sector(sector), game(game), gamestate(gamestate)
 {
 	ASSERT_PLAYER(player);
 	this->empty();
 }
 
-int Army::getTotal() const {
-	ASSERT_PLAYER(this->player);
-	int n = 0;
+/** Tells the sector when this becomes its army for the player, and is emptied or stops being empty, so that
+ *  the map's index of armies is kept up to date.
+ */
+void Army::presenceChanged() {
+	if( this->sector->getArmy(this->player) == this ) {
+		this->sector->mapIndexChanged();
+	}
+}
+
+/** Adds n (which may be negative) soldiers of epoch i, updating the totals.
+ */
+void Army::changeSoldiers(int i,int n) {
+	if( n == 0 )
+		return;
+	bool was_empty = this->total == 0;
+	this->soldiers[i] += n;
+	this->total += n;
+	this->total_men += n * ( i==n_epochs_c ? 1 : game->invention_weapons[i]->getNMen() );
+	this->strength += n * getIndividualStrength(i);
+	this->bombard_strength += n * getIndividualBombardStrength(this->game, i);
+	if( was_empty != ( this->total == 0 ) ) {
+		this->presenceChanged();
+	}
+}
+
+void Army::empty() {
+	bool was_empty = this->total == 0;
 	for(int i=0;i<n_epochs_c+1;i++)
+		soldiers[i] = 0;
+	total = 0;
+	total_men = 0;
+	strength = 0;
+	bombard_strength = 0;
+	if( !was_empty ) {
+		this->presenceChanged();
+	}
+}
+
+/** Checks the running totals against the soldiers - for debugging.
+ */
+bool Army::totalsValid() const {
+	int n = 0, n_men = 0, str = 0, bombard_str = 0;
+	for(int i=0;i<=n_epochs_c;i++) {
+		if( soldiers[i] == 0 )
+			continue;
 		n += soldiers[i];
-	return n;
+		n_men += soldiers[i] * ( i==n_epochs_c ? 1 : game->invention_weapons[i]->getNMen() );
+		str += soldiers[i] * getIndividualStrength(i);
+		bombard_str += soldiers[i] * getIndividualBombardStrength(this->game, i);
+	}
+	if( n != this->total || n_men != this->total_men || str != this->strength || bombard_str != this->bombard_strength ) {
+		LOG("army totals out of date: %d %d %d %d vs %d %d %d %d\n", total, total_men, strength, bombard_strength, n, n_men, str, bombard_str);
+		return false;
+	}
+	return true;
+}
+
+int Army::getTotal() const {
+	ASSERT_PLAYER(this->player);
+	T_ASSERT( this->totalsValid() );
+	return this->total;
 }
 
 int Army::getTotalMen() const {
 	ASSERT_PLAYER(this->player);
-	int n = 0;
-	for(int i=0;i<n_epochs_c+1;i++) {
-		int n_men = ( i==n_epochs_c ? 1 : game_g->invention_weapons[i]->getNMen() );
-		n += soldiers[i] * n_men;
-	}
-	return n;
+	T_ASSERT( this->totalsValid() );
+	return this->total_men;
 }
 
 bool Army::any(bool include_unarmed) const {
 	ASSERT_PLAYER(this->player);
-	int until = include_unarmed ? n_epochs_c : n_epochs_c-1;
-	for(int i=0;i<=until;i++) {
-		if( soldiers[i] > 0 )
-			return true;
-	}
-	return false;
+	int n = include_unarmed ? this->total : this->total - this->soldiers[n_epochs_c];
+	return n > 0;
 }
 
 int Army::getStrength() const {
 	ASSERT_PLAYER(this->player);
-	int n = 0;
-	for(int i=0;i<=n_epochs_c;i++) {
-		if( soldiers[i] > 0 ) {
-			ASSERT(i != nuclear_epoch_c);
-			n += getIndividualStrength(i) * soldiers[i];
-		}
-	}
-	return n;
+	ASSERT( soldiers[nuclear_epoch_c] == 0 );
+	T_ASSERT( this->totalsValid() );
+	return this->strength;
 }
 
 int Army::getBombardStrength() const {
 	ASSERT_PLAYER(this->player);
-	int n = 0;
-	for(int i=0;i<=n_epochs_c;i++) {
-		if( soldiers[i] > 0 )
-			n += getIndividualBombardStrength(i) * soldiers[i];
-	}
-	return n;
+	T_ASSERT( this->totalsValid() );
+	return this->bombard_strength;
 }
 
 void Army::add(int i,int n) {
@@ -199,7 +237,7 @@ void Army::add(int i,int n) {
 	ASSERT_S_EPOCH(i);
 	ASSERT(n > 0);
 	ASSERT( !this->sector->isNuked() );
-	this->soldiers[i] += n;
+	this->changeSoldiers(i, n);
 }
 
 void Army::add(Army *army) {
@@ -209,13 +247,13 @@ void Army::add(Army *army) {
 	for(int i=0;i<=n_epochs_c;i++) {
 		ASSERT(army->soldiers[i] >= 0);
 		any = any || army->soldiers[i] > 0;
-		this->soldiers[i] += army->soldiers[i];
-		army->soldiers[i] = 0;
+		this->changeSoldiers(i, army->soldiers[i]);
 	}
+	army->empty();
 	if( any && ( this->sector == gamestate->getCurrentSector() || army->getSector() == gamestate->getCurrentSector() ) ) {
 		ASSERT( !this->sector->isNuked() );
 		//((PlayingGameState *)gamestate)->refreshSoldiers(true);
-		gamestate->refreshSoldiers(true);
+		this->sector->addEffect(SectorEffect::TYPE_REFRESH_SOLDIERS);
 	}
 }
 
@@ -223,7 +261,7 @@ void Army::remove(int i,int n) {
 	ASSERT_PLAYER(this->player);
 	ASSERT_S_EPOCH(i);
 	ASSERT(n > 0);
-	this->soldiers[i] -= n;
+	this->changeSoldiers(i, -n);
 	ASSERT(this->soldiers[i] >= 0);
 }
 
@@ -233,12 +271,16 @@ void Army::kill(int index) {
 	int saved_index = index;
 	for(int i=0;i<=n_epochs_c && !done;i++) {
 		if( index < soldiers[i] ) {
-			soldiers[i]--;
+			this->changeSoldiers(i, -1);
 			done = true;
 			if( this->sector == gamestate->getCurrentSector() ) {
 				//((PlayingGameState *)gamestate)->n_deaths[player][i]++;
 				//((PlayingGameState *)gamestate)->registerDeath(player, i);
-				gamestate->registerDeath(player, i);
+				SectorEffect effect(SectorEffect::TYPE_DEATHS);
+				effect.player = player;
+				effect.x = i;
+				effect.value = 1;
+				this->sector->addEffect(effect);
 			}
 		}
 		index -= soldiers[i];
@@ -249,28 +291,71 @@ void Army::kill(int index) {
 	}
 	if( this->sector == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->refreshSoldiers(true);
-		gamestate->refreshSoldiers(true);
+		this->sector->addEffect(SectorEffect::TYPE_REFRESH_SOLDIERS);
 	}
 	//((PlayingGameState *)gamestate)->getGamePanel()->refreshShutdown();
-	gamestate->getGamePanel()->refreshShutdown();
+	this->sector->addEffect(SectorEffect::TYPE_REFRESH_SHUTDOWN);
+}
+
+/** Kills n_killed[i] soldiers of each epoch i at once.
+*/
+void Army::kill(const int n_killed[n_epochs_c+1]) {
+	ASSERT_PLAYER(this->player);
+	bool any_killed = false;
+	for(int i=0;i<=n_epochs_c;i++) {
+		if( n_killed[i] == 0 )
+			continue;
+		ASSERT( n_killed[i] <= soldiers[i] );
+		this->changeSoldiers(i, -n_killed[i]);
+		any_killed = true;
+		if( this->sector == gamestate->getCurrentSector() ) {
+			SectorEffect effect(SectorEffect::TYPE_DEATHS);
+			effect.player = player;
+			effect.x = i;
+			effect.value = n_killed[i];
+			this->sector->addEffect(effect);
+		}
+	}
+	if( !any_killed ) {
+		return;
+	}
+	if( this->sector == gamestate->getCurrentSector() ) {
+		this->sector->addEffect(SectorEffect::TYPE_REFRESH_SOLDIERS);
+	}
+	this->sector->addEffect(SectorEffect::TYPE_REFRESH_SHUTDOWN);
+}
+
+/** Returns the epoch of the index-th soldier, not counting the n_killed[i] soldiers of each epoch i
+ *  already chosen to be killed; n.b., picks the same soldier as kill(int) does when none are chosen.
+ */
+int Army::findSoldier(int index, const int n_killed[n_epochs_c+1]) const {
+	for(int i=0;i<=n_epochs_c;i++) {
+		int n_soldiers = soldiers[i] - n_killed[i];
+		if( index < n_soldiers ) {
+			return i;
+		}
+		index -= n_soldiers;
+	}
+	ASSERT(0);
+	return -1;
 }
 
 bool Army::canLeaveSafely() const {
 	bool any_enemy_attackers = false;
 	for(int i=0;i<n_players_c && !any_enemy_attackers;i++) {
-		if( i != this->player && !Player::isAlliance(i, this->player) )
+		if( i != this->player && !game->isAlliance(i, this->player) )
 			any_enemy_attackers = this->sector->getArmy(i)->any(true);
 	}
 	//if( n_enemy_attackers > 0 || ( src_sector->player != -1 && src_sector->player != a_player ) ) {
 	//if( any_enemy_attackers || ( src_sector->player != -1 && src_sector->player != a_player ) ) {
-	if( this->sector->getPlayer() != this->player && ( any_enemy_attackers || ( this->sector->getPlayer() != -1 && !Player::isAlliance(this->sector->getPlayer(), this->player) ) ) ) {
+	if( this->sector->getPlayer() != this->player && ( any_enemy_attackers || ( this->sector->getPlayer() != -1 && !game->isAlliance(this->sector->getPlayer(), this->player) ) ) ) {
 		return false;
 	}
 	return true;
 }
 
 void Army::retreat(bool only_air) {
-	if( game_g->getTutorial() != NULL && !game_g->getTutorial()->allowRetreatLoss() ) {
+	if( game->getTutorial() != NULL && !game->getTutorial()->allowRetreatLoss() ) {
 		return;
 	}
 	for(int i=0;i<=n_epochs_c;i++) {
@@ -281,21 +366,22 @@ void Army::retreat(bool only_air) {
 			}
 			else {
 				//this->soldiers[i] *= 0.6;
-				this->soldiers[i] = (int)(this->soldiers[i] * 0.6);
+				int n_survivors = (int)(this->soldiers[i] * 0.6);
+				this->changeSoldiers(i, n_survivors - this->soldiers[i]);
 			}
 		}
 	}
 }
 
 int Army::getIndividualStrength(int i) const {
-	return getIndividualStrength(this->player, i);
+	return getIndividualStrength(this->game, this->player, i);
 }
 
-int Army::getIndividualStrength(int player, int i) {
+int Army::getIndividualStrength(const Game *game, int player, int i) {
 	ASSERT_S_EPOCH(i);
 	ASSERT_PLAYER(player);
 	int str = 0;
-	if( i == n_epochs_c && game_g->getStartEpoch() != end_epoch_c ) {
+	if( i == n_epochs_c && game->getStartEpoch() != end_epoch_c ) {
 		// unarmed
 		if( player == PlayerType::PLAYER_RED )
 			str = 2;
@@ -315,10 +401,10 @@ int Army::getIndividualStrength(int player, int i) {
 	return str;
 }
 
-int Army::getIndividualBombardStrength(int i) {
+int Army::getIndividualBombardStrength(const Game *game, int i) {
 	ASSERT_S_EPOCH(i);
 	int str = 0;
-	if( game_g->getStartEpoch() == end_epoch_c ) {
+	if( game->getStartEpoch() == end_epoch_c ) {
 		str = 1;
 	}
 	else if( i != n_epochs_c ) {
@@ -326,7 +412,7 @@ int Army::getIndividualBombardStrength(int i) {
 		/*int n_men = invention_weapons[i]->n_men;
 		str = (i+1) * n_men;*/
 		//str = i+1;
-		str = i - game_g->getStartEpoch() + 1;
+		str = i - game->getStartEpoch() + 1;
 		/*str = 1;
 		for(int j=0;j<i;j++)
 		str *= 2;
@@ -386,7 +472,7 @@ void Army::loadStateParseXMLNode(const TiXmlNode *parent) {
 					else if( epoch < 0 || epoch > n_epochs_c ) {
 						throw std::runtime_error("soldiers invalid epoch");
 					}
-					this->soldiers[epoch] = n;
+					this->changeSoldiers(epoch, n - this->soldiers[epoch]);
 				}
 				else {
 					// don't throw an error here, to help backwards compatibility, but should throw an error in debug mode in case this is a sign of not loading something that we've saved
@@ -432,11 +518,45 @@ Design::Design(Invention *invention,bool ergonomically_terrific) {
 	this->save_id = -1;
 	for(int i=0;i<N_ID;i++)
 		this->cost[i] = 0;
+	this->n_costs = 0;
 	//invention->designs->add(this);
 	//invention->designs->push_back(this);
 	invention->addDesign(this);
 };
 
+void Design::setCost(Id id, float cost) {
+	ASSERT_ELEMENT_ID(id);
+	this->cost[(int)id] = (int)(cost * element_multiplier_c);
+	this->n_costs = 0;
+	for(int i=0;i<N_ID;i++) {
+		if( this->cost[i] != 0 ) {
+			this->cost_ids[this->n_costs++] = (Id)i;
+		}
+	}
+}
+
+/** Returns whether stocks has at least the cost of every element. All N_ID elements are compared without
+ *  branching, so that the compiler can vectorise the loop; this is quicker than looking up the elements in
+ *  cost_ids, even though most of the costs are 0.
+ */
+bool Design::canAfford(const int stocks[N_ID]) const {
+	int short_of = 0;
+	for(int i=0;i<N_ID;i++) {
+		short_of |= stocks[i] < this->cost[i];
+	}
+	return short_of == 0;
+}
+
+/** As canAfford(stocks), but for the combined amounts in stocks and extra_stocks.
+ */
+bool Design::canAfford(const int stocks[N_ID], const int extra_stocks[N_ID]) const {
+	int short_of = 0;
+	for(int i=0;i<N_ID;i++) {
+		short_of |= stocks[i] + extra_stocks[i] < this->cost[i];
+	}
+	return short_of == 0;
+}
+
 Invention::Invention(const char *name,Type type,int epoch) {
 	ASSERT_ANY_EPOCH(epoch);
 	//strcpy(this->name,name);
@@ -487,17 +607,17 @@ Invention *Invention::getInvention(Invention::Type type,int epoch) {
 	ASSERT_EPOCH(epoch);
 	Invention *invention = NULL;
 	if( type == SHIELD )
-		invention = game_g->invention_shields[epoch];
+		invention = Game::invention_shields[epoch];
 	else if( type == DEFENCE )
-		invention = game_g->invention_defences[epoch];
+		invention = Game::invention_defences[epoch];
 	else if( type == WEAPON )
-		invention = game_g->invention_weapons[epoch];
+		invention = Game::invention_weapons[epoch];
 	ASSERT(invention != NULL);
 	return invention;
 }
 
-Building::Building(PlayingGameState *gamestate, Sector *sector, Type type) :
-type(type), sector(sector), health(0), max_health(0), pos_x(0), pos_y(0), n_turrets(0), building_button(NULL), gamestate(gamestate)
+Building::Building(Game *game, PlayingGameState *gamestate, Sector *sector, Type type) :
+type(type), sector(sector), health(0), max_health(0), pos_x(0), pos_y(0), n_turrets(0), building_button(NULL), game(game), gamestate(gamestate)
 {
     //LOG("Building::Building(Sector [%d: %d, %d], Type %d)\n", sector->getPlayer(), sector->getXPos(), sector->getYPos(), type);
 	Rect2D turret_pos[max_building_turrets_c];
@@ -517,7 +637,7 @@ type(type), sector(sector), health(0), max_health(0), pos_x(0), pos_y(0), n_turr
 		this->pos_x = offset_fortress_x_c;
 		this->pos_y = offset_fortress_y_c;
 		this->n_turrets = 4;
-		if( game_g->isUsingOldGfx() ) {
+		if( game->isUsingOldGfx() ) {
 			turret_pos[0].set(0, 0, 15, 12);
 			turret_pos[1].set(27, 0, 15, 12);
 			turret_pos[2].set(0, 24, 15, 12);
@@ -534,7 +654,7 @@ type(type), sector(sector), health(0), max_health(0), pos_x(0), pos_y(0), n_turr
 		this->pos_x = offset_mine_x_c;
 		this->pos_y = offset_mine_y_c;
 		this->n_turrets = 2;
-		if( game_g->isUsingOldGfx() ) {
+		if( game->isUsingOldGfx() ) {
 			turret_pos[0].set(0, 17, 15, 12);
 			turret_pos[1].set(27, 17, 15, 12);
 		}
@@ -547,7 +667,7 @@ type(type), sector(sector), health(0), max_health(0), pos_x(0), pos_y(0), n_turr
 		this->pos_x = offset_factory_x_c;
 		this->pos_y = offset_factory_y_c;
 		this->n_turrets = 3;
-		if( game_g->isUsingOldGfx() ) {
+		if( game->isUsingOldGfx() ) {
 			turret_pos[0].set(1, 9, 15, 12);
 			turret_pos[1].set(33, 9, 15, 12);
 			turret_pos[2].set(16, 26, 15, 12);
@@ -562,7 +682,7 @@ type(type), sector(sector), health(0), max_health(0), pos_x(0), pos_y(0), n_turr
 		this->pos_x = offset_lab_x_c;
 		this->pos_y = offset_lab_y_c;
 		this->n_turrets = 1;
-		if( game_g->isUsingOldGfx() ) {
+		if( game->isUsingOldGfx() ) {
 			turret_pos[0].set(10, 4, 15, 12);
 		}
 		else {
@@ -585,7 +705,10 @@ type(type), sector(sector), health(0), max_health(0), pos_x(0), pos_y(0), n_turr
 	}
 	if( sector == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->addBuilding(this);
-		gamestate->addBuilding(this);
+		SectorEffect effect(SectorEffect::TYPE_ADD_BUILDING);
+		effect.building = this;
+		effect.value = this->type;
+		sector->addEffect(effect);
 	}
     //LOG("Building::Building done\n");
 }
@@ -603,20 +726,20 @@ Building::~Building() {
 Image **Building::getImages() {
 	Image **images = NULL;
 	if( type == BUILDING_TOWER )
-		images = game_g->fortress;
+		images = game->fortress;
 	else if( type == BUILDING_MINE )
-		images = game_g->mine;
+		images = game->mine;
 	else if( type == BUILDING_FACTORY )
-		images = game_g->factory;
+		images = game->factory;
 	else if( type == BUILDING_LAB )
-		images = game_g->lab;
+		images = game->lab;
 	ASSERT(images != NULL);
 	return images;
 }
 
 void Building::rotateDefenders() {
 	for(int i=0;i<this->n_turrets;i++) {
-		this->turret_man_frame[i] = rand();
+		this->turret_man_frame[i] = game->random(RANDOM_COSMETIC);
 	}
 	/*if( this->type == BUILDING_TOWER ) {
 		this->turret_mandir[0] = ( rand() % 2 ) == 0 ? DEFENDER_DIR_W : DEFENDER_DIR_N;
@@ -659,7 +782,7 @@ int Building::getDefenderStrength() const {
 	int n = 0;
 	for(int i=0;i<n_turrets;i++) {
 		if( turret_man[i] != -1 )
-			n += Army::getIndividualStrength( sector->getPlayer(), turret_man[i] );
+			n += Army::getIndividualStrength( game, sector->getPlayer(), turret_man[i] );
 	}
 	//n *= 2;
 	n *= 4;
@@ -672,7 +795,10 @@ void Building::killIthDefender(int i) {
 		int xpos = this->turret_buttons[i]->getLeft();
 		int ypos = this->turret_buttons[i]->getTop();
 		//((PlayingGameState *)gamestate)->deathEffect(xpos, ypos - 4);
-		gamestate->deathEffect(xpos, ypos - 4);
+		SectorEffect effect(SectorEffect::TYPE_DEATH_EFFECT);
+		effect.x = xpos;
+		effect.y = ypos - 4;
+		this->sector->addEffect(effect);
 	}
 }
 
@@ -809,15 +935,16 @@ void Building::loadStateParseXMLNode(const TiXmlNode *parent) {
 	}
 }
 
-Sector::Sector(PlayingGameState *gamestate, int epoch, int xpos, int ypos, MapColour map_colour) :
+Sector::Sector(Game *game, PlayingGameState *gamestate, int epoch, int xpos, int ypos, MapColour map_colour) :
 xpos(xpos), ypos(ypos), epoch(epoch), player(PLAYER_NONE), is_shutdown(false), nuked(false),
 nuke_by_player(-1), nuke_time(-1),
 nuke_defence_animation(false), nuke_defence_time(-1), nuke_defence_x(0), nuke_defence_y(0),
 population(0), n_designers(0), n_workers(0), n_famount(0),
 current_design(NULL), current_manufacture(NULL),
 researched(0), researched_lasttime(-1), manufactured(0), manufactured_lasttime(-1), growth_lasttime(-1), mined_lasttime(-1), built_lasttime(-1),
+economy_time(-1), economy_due(true), economy_generation(0), defer_effects(false), map_index_due(false), appearance_generation(0),
 assembled_army(NULL), stored_army(NULL), smokeParticleSystem(NULL), jetParticleSystem(NULL), nukeParticleSystem(NULL), nukeDefenceParticleSystem(NULL),
-gamestate(gamestate)
+game(game), gamestate(gamestate)
 {
     //LOG("Sector::Sector(%d,%d,%d)\n",epoch,xpos,ypos);
 	ASSERT_EPOCH(epoch);
@@ -826,71 +953,73 @@ gamestate(gamestate)
 		this->elements[i] = 0;
 	}
 	for(int i=0;i<n_players_c;i++) {
-		this->armies[i] = new Army(gamestate, this, i);
+		this->armies[i] = new Army(game, gamestate, this, i);
 	}
+	this->random_simulation.seed( game->random(RANDOM_SIMULATION) );
+	this->random_cosmetic.seed( game->random(RANDOM_COSMETIC) );
 
 	// rocks etc
-	int n_clutter = game_g->icon_clutter.size() > 0 ? (1 + rand() % 4) : 0;
+	int n_clutter = game->icon_clutter.size() > 0 ? (1 + game->random(RANDOM_COSMETIC) % 4) : 0;
 	for(int i=0;i<n_clutter;i++) {
-		int land_width = game_g->land[(int)map_colour]->getScaledWidth() - 32;
-		int land_height = game_g->land[(int)map_colour]->getScaledHeight() - 32;
-		int xpos = offset_land_x_c + rand() % land_width;
-		int ypos = offset_land_y_c + rand() % land_height;
-		Image **image_ptr = &game_g->icon_clutter[rand() % game_g->icon_clutter.size()];
+		int land_width = game->land[(int)map_colour]->getScaledWidth() - 32;
+		int land_height = game->land[(int)map_colour]->getScaledHeight() - 32;
+		int xpos = offset_land_x_c + game->random(RANDOM_COSMETIC) % land_width;
+		int ypos = offset_land_y_c + game->random(RANDOM_COSMETIC) % land_height;
+		Image **image_ptr = &game->icon_clutter[game->random(RANDOM_COSMETIC) % game->icon_clutter.size()];
 		Feature *feature = new Feature(image_ptr, 1, xpos, ypos);
 		this->features.push_back(feature);
 	}
 	// trees (should be after clutter, so they are drawn over them if overlapping)
 	int cx = offset_land_x_c + 16;
 	for(;;) {
-		int treetype = rand() % 3;
+		int treetype = game->random(RANDOM_COSMETIC) % 3;
 		if( treetype == 2 )
 			treetype = 3;
 		//Image *image = icon_trees[treetype];
-		Image *image = game_g->icon_trees[treetype][0];
-		cx += rand() % 16;
+		Image *image = game->icon_trees[treetype][0];
+		cx += game->random(RANDOM_COSMETIC) % 16;
 		if( cx + image->getScaledWidth() > offset_land_x_c + land_width_c )
 			break;
 		//int ypos = offset_land_y_c - image->getScaledHeight() + 12 + rand() % 12;
-		int ypos = offset_land_y_c - image->getScaledHeight() + 16 + rand() % 8;
+		int ypos = offset_land_y_c - image->getScaledHeight() + 16 + game->random(RANDOM_COSMETIC) % 8;
 		//Feature *feature = new Feature(icon_trees[treetype], cx, ypos);
-		Feature *feature = new Feature(game_g->icon_trees[treetype], n_tree_frames_c, cx, ypos);
+		Feature *feature = new Feature(game->icon_trees[treetype], n_tree_frames_c, cx, ypos);
 		//Feature *feature = new Feature(image, cx, ypos);
 		this->features.push_back(feature);
 		cx += image->getScaledWidth() - 8;
 	}
 	cx = offset_land_x_c + 16;
 	for(;;) {
-		int treetype = rand() % 3;
+		int treetype = game->random(RANDOM_COSMETIC) % 3;
 		if( treetype == 2 )
 			treetype = 3;
-		Image *image = game_g->icon_trees[treetype][0];
-		cx += rand() % 32;
+		Image *image = game->icon_trees[treetype][0];
+		cx += game->random(RANDOM_COSMETIC) % 32;
 		if( cx + image->getScaledWidth() > offset_land_x_c + land_width_c )
 			break;
-		int ypos = offset_land_y_c + game_g->land[(int)map_colour]->getScaledHeight() - image->getScaledHeight() - 8 - rand() % 4;
-		Feature *feature = new Feature(game_g->icon_trees[treetype], n_tree_frames_c, cx, ypos);
+		int ypos = offset_land_y_c + game->land[(int)map_colour]->getScaledHeight() - image->getScaledHeight() - 8 - game->random(RANDOM_COSMETIC) % 4;
+		Feature *feature = new Feature(game->icon_trees[treetype], n_tree_frames_c, cx, ypos);
 		feature->setAtFront(true);
 		this->features.push_back(feature);
 		cx += image->getScaledWidth() - 8;
 	}
 
-	if( game_g->smoke_image != NULL ) {
-		this->smokeParticleSystem = new SmokeParticleSystem(game_g->smoke_image);
+	if( game->smoke_image != NULL ) {
+		this->smokeParticleSystem = new SmokeParticleSystem(game->smoke_image);
 
-		this->jetParticleSystem = new SmokeParticleSystem(game_g->smoke_image);
+		this->jetParticleSystem = new SmokeParticleSystem(game->smoke_image);
 		this->jetParticleSystem->setMove(10.0f, 10.0f);
 		this->jetParticleSystem->setBirthRate(1.667f);
 		this->jetParticleSystem->setLifeExp(90);
 		this->jetParticleSystem->setSize(0.5f);
 
-		this->nukeParticleSystem = new SmokeParticleSystem(game_g->smoke_image);
+		this->nukeParticleSystem = new SmokeParticleSystem(game->smoke_image);
 		this->nukeParticleSystem->setMove(10.0f, -10.0f);
 		this->nukeParticleSystem->setBirthRate(1.667f);
 		this->nukeParticleSystem->setLifeExp(90);
 		this->nukeParticleSystem->setSize(0.5f);
 
-		this->nukeDefenceParticleSystem = new SmokeParticleSystem(game_g->smoke_image);
+		this->nukeDefenceParticleSystem = new SmokeParticleSystem(game->smoke_image);
 		this->nukeDefenceParticleSystem->setMove(0.0f, 10.0f);
 		this->nukeDefenceParticleSystem->setBirthRate(1.667f);
 		this->nukeDefenceParticleSystem->setLifeExp(90);
@@ -937,6 +1066,8 @@ void Sector::initTowerStuff() {
 		this->elementstocks[i] = 0;
 		this->partial_elementstocks[i] = 0;
 	}
+	this->design_cache_disallow_nukes = false;
+	this->invalidateDesignCache();
 
 	//this->assembled_army = new Army(this, this->getPlayer());
 	//this->stored_army = new Army(this, this->getPlayer());
@@ -986,11 +1117,14 @@ Sector::~Sector() {
 void Sector::createTower(int player,int population) {
     //LOG("Sector::createTower(%d,%d) [%d, %d]\n", player, population, xpos, ypos);
 	ASSERT( !nuked );
+	this->economyChanged();
 	this->player = player;
-	this->assembled_army = new Army(gamestate, this, this->getPlayer());
-	this->stored_army = new Army(gamestate, this, this->getPlayer());
+	this->assembled_army = new Army(game, gamestate, this, this->getPlayer());
+	this->stored_army = new Army(game, gamestate, this, this->getPlayer());
 	this->population = population;
-	this->buildings[BUILDING_TOWER] = new Building(gamestate, this, BUILDING_TOWER);
+	this->buildings[BUILDING_TOWER] = new Building(game, gamestate, this, BUILDING_TOWER);
+	this->mapIndexChanged();
+	this->appearanceChanged();
 }
 
 void Sector::destroyTower(bool nuked, int client_player) {
@@ -1016,33 +1150,27 @@ void Sector::destroyTower(bool nuked, int client_player) {
 	int this_player = this->player; // keep a copy
 
 	initTowerStuff();
+	this->mapIndexChanged();
+	this->appearanceChanged();
 	if( this == gamestate->getCurrentSector() ) {
-		gamestate->getGamePanel()->setPage(GamePanel::STATE_SECTORCONTROL);
-		gamestate->getGamePanel()->setup();
+		this->addEffect(SectorEffect::TYPE_RESET_PANEL);
 	}
-	gamestate->getGamePanel()->refreshShutdown();
+	this->addEffect(SectorEffect::TYPE_REFRESH_SHUTDOWN);
 
-	if( nuked || game_g->playerAlive(this_player) ) {
-		// player has other sectors
-		if( game_g->isDemo() ) {
-		}
-		else if( this_player == client_player ) {
-			if( nuked )
-				playSample(game_g->s_weve_been_nuked);
-			else
-				playSample(game_g->s_sector_destroyed);
-			//((PlayingGameState *)gamestate)->setFlashingSquare(this->xpos, this->ypos);
-			gamestate->setFlashingSquare(this->xpos, this->ypos);
-		}
-		else if( ( nuked && nuke_by_player == client_player ) || ( !nuked && this->getArmy(client_player)->getTotal() > 0 ) ) {
-			if( nuked && nuke_by_player == client_player )
-				playSample(game_g->s_weve_nuked_them);
-			else
-				playSample(game_g->s_conquered);
-			//((PlayingGameState *)gamestate)->setFlashingSquare(this->xpos, this->ypos);
-			gamestate->setFlashingSquare(this->xpos, this->ypos);
-		}
+	// whether the player is still alive depends on other sectors, so the announcement is decided when the effect is applied
+	SectorEffect effect(SectorEffect::TYPE_TOWER_DESTROYED);
+	effect.player = this_player;
+	effect.value = nuked ? 1 : 0;
+	if( game->isDemo() ) {
+	}
+	else if( this_player == client_player ) {
+		effect.sample = nuked ? game->s_weve_been_nuked : game->s_sector_destroyed;
+	}
+	else if( ( nuked && nuke_by_player == client_player ) || ( !nuked && this->getArmy(client_player)->getTotal() > 0 ) ) {
+		effect.sample = ( nuked && nuke_by_player == client_player ) ? game->s_weve_nuked_them : game->s_conquered;
 	}
+	effect.channel = SOUND_CHANNEL_SAMPLES;
+	this->addEffect(effect);
 	// game win/lose is handled in main game loop now
 	LOG("Sector::destroyTower() exit\n");
 }
@@ -1054,8 +1182,9 @@ void Sector::destroyBuilding(Type building_type,int client_player) {
 void Sector::destroyBuilding(Type building_type,bool silent,int client_player) {
 	LOG("Sector::destroyBuilding(%d) [%d: %d, %d]\n", building_type, player, xpos, ypos);
 	ASSERT( buildings[(int)building_type] != NULL );
+	this->economyChanged();
 	if( this == gamestate->getCurrentSector() && !silent ) {
-		playSample(game_g->s_buildingdestroyed, SOUND_CHANNEL_FX);
+		this->addSampleEffect(game->s_buildingdestroyed, SOUND_CHANNEL_FX);
 	}
 	if( building_type == BUILDING_TOWER ) {
 		this->destroyTower(false, client_player);
@@ -1063,9 +1192,9 @@ void Sector::destroyBuilding(Type building_type,bool silent,int client_player) {
 	}
 	else if( building_type == BUILDING_MINE ) {
 		if( this->player == client_player && !silent ) {
-			playSample(game_g->s_mine_destroyed);
+			this->addSampleEffect(game->s_mine_destroyed, SOUND_CHANNEL_SAMPLES);
 			//((PlayingGameState *)gamestate)->setFlashingSquare(this->xpos, this->ypos);
-			gamestate->setFlashingSquare(this->xpos, this->ypos);
+			this->addEffect(SectorEffect::TYPE_FLASHING_SQUARE);
 		}
 		for(int i=0;i<N_ID;i++) {
 			/*
@@ -1081,9 +1210,9 @@ void Sector::destroyBuilding(Type building_type,bool silent,int client_player) {
 	}
 	else if( building_type == BUILDING_FACTORY ) {
 		if( this->player == client_player && !silent ) {
-			playSample(game_g->s_factory_destroyed);
+			this->addSampleEffect(game->s_factory_destroyed, SOUND_CHANNEL_SAMPLES);
 			//((PlayingGameState *)gamestate)->setFlashingSquare(this->xpos, this->ypos);
-			gamestate->setFlashingSquare(this->xpos, this->ypos);
+			this->addEffect(SectorEffect::TYPE_FLASHING_SQUARE);
 		}
 		/*this->population -= this->n_workers;
 		if( this->population < 0 ) {
@@ -1095,9 +1224,9 @@ void Sector::destroyBuilding(Type building_type,bool silent,int client_player) {
 	}
 	else if( building_type == BUILDING_LAB ) {
 		if( this->player == client_player && !silent ) {
-			playSample(game_g->s_lab_destroyed);
+			this->addSampleEffect(game->s_lab_destroyed, SOUND_CHANNEL_SAMPLES);
 			//((PlayingGameState *)gamestate)->setFlashingSquare(this->xpos, this->ypos);
-			gamestate->setFlashingSquare(this->xpos, this->ypos);
+			this->addEffect(SectorEffect::TYPE_FLASHING_SQUARE);
 		}
 		if( this->current_design != NULL && this->current_design->getInvention()->getEpoch() > lab_epoch_c ) {
 			// for pre-lab epoch designs, we can imagine the designers can work without being in the lab...
@@ -1123,9 +1252,11 @@ void Sector::destroyBuilding(Type building_type,bool silent,int client_player) {
 	delete this->buildings[(int)building_type];
 	this->buildings[(int)building_type] = NULL;
 	this->built[(int)building_type] = 0;
+	this->invalidateDesignCache();
+	this->appearanceChanged();
 
 	if( this == gamestate->getCurrentSector() && this->player == client_player ) {
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 }
 
@@ -1134,13 +1265,13 @@ bool Sector::canShutdown() const {
 	if( this->is_shutdown )
 		return false;
 
-	if( this->getEpoch() == n_epochs_c-1 && game_g->getStartEpoch() != end_epoch_c ) // in 2100AD
+	if( this->getEpoch() == n_epochs_c-1 && game->getStartEpoch() != end_epoch_c ) // in 2100AD
 	{
 		for(int y=0;y<map_height_c;y++) {
 			for(int x=0;x<map_width_c;x++) {
-				//if( game_g->getMap()->sector_at[x][y] ) {
-				if( game_g->getMap()->isSectorAt(x, y) ) {
-					const Sector *sector = game_g->getMap()->getSector(x, y);
+				//if( game->getMap()->sector_at[x][y] ) {
+				if( game->getMap()->isSectorAt(x, y) ) {
+					const Sector *sector = game->getMap()->getSector(x, y);
 					if( ( sector != gamestate->getCurrentSector() && sector->getPlayer() == this->getPlayer() )
 						|| sector->getArmy(this->getPlayer())->any(true) ) {
 							return true;
@@ -1171,6 +1302,7 @@ void Sector::shutdown(int client_player) {
 	}
 
 	this->is_shutdown = true;
+	this->appearanceChanged();
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
 		gamestate->reset();
@@ -1226,7 +1358,7 @@ void Sector::killDefender(int index) {
 
 bool Sector::canBuild(Type type) const {
 	//LOG("Sector::canBuild(%d)\n",type);
-	if( game_g->getStartEpoch() == end_epoch_c )
+	if( game->getStartEpoch() == end_epoch_c )
 		return false;
 
 	if( getBuilding(type) != NULL )
@@ -1251,15 +1383,15 @@ bool Sector::canMine(Id id) const {
 	if( !this->anyElements(id) )
 		return false;
 
-	if( game_g->elements[id]->getType() == Element::GATHERABLE )
+	if( game->elements[id]->getType() == Element::GATHERABLE )
 		return true;
-	else if( game_g->elements[id]->getType() == Element::OPENPITMINE )
+	else if( game->elements[id]->getType() == Element::OPENPITMINE )
 		return ( this->epoch >= 1 );
-	else if( game_g->elements[id]->getType() == Element::DEEPMINE )
+	else if( game->elements[id]->getType() == Element::DEEPMINE )
 		return (this->buildings[BUILDING_MINE] != NULL);
 
 	// error
-	LOG("###Didn't expect element id %d of type %d\n",id,game_g->elements[id]->getType());
+	LOG("###Didn't expect element id %d of type %d\n",id,game->elements[id]->getType());
 	ASSERT(0);
 	return false;
 }
@@ -1267,26 +1399,13 @@ bool Sector::canMine(Id id) const {
 Design *Sector::canBuildDesign(Invention::Type type,int epoch) const {
 	//LOG("Sector::canBuildDesign(%d,%d)\n",type,epoch);
 	ASSERT_EPOCH(epoch);
-	if(epoch < game_g->getStartEpoch() || epoch > game_g->getStartEpoch() + 3 )
+	if(epoch < game->getStartEpoch() || epoch > game->getStartEpoch() + 3 )
 		return NULL; // can't build this
 	if( epoch >= factory_epoch_c && this->getBuilding(BUILDING_FACTORY) == NULL )
 		return NULL; // need a factory for this
 
-	Invention *invention = Invention::getInvention(type, epoch);
-	ASSERT(invention != NULL);
-	Design *best_design = NULL;
-	for(size_t i=0;i<this->designs.size() && best_design==NULL;i++) {
-		Design *design = this->designs.at(i);
-		// design should be non-NULL, but to satisfy VS Code Analysis...
-		if( design == NULL )
-			continue;
-		if( design->getInvention() != invention )
-			continue;
-		bool ok = canBuildDesign(design);
-		if( ok )
-			best_design = design;
-	}
-	return best_design;
+	this->updateDesignCache();
+	return this->buildable_designs[type][epoch];
 }
 
 bool Sector::canBuildDesign(Design *design) const {
@@ -1294,26 +1413,12 @@ bool Sector::canBuildDesign(Design *design) const {
 	if( design->getInvention()->getEpoch() >= factory_epoch_c && this->getBuilding(BUILDING_FACTORY) == NULL )
 		return false; // need a factory for this
 
-	bool ok = true;
-	for(int j=0;j<N_ID && ok;j++) {
-		if( design->getCost((Id)j) > this->elementstocks[j] ) {
-			// not enough elements
-			ok = false;
-		}
-	}
-	return ok;
+	return design->canAfford(this->elementstocks);
 }
 
 bool Sector::canEverBuildDesign(Design *design) const {
 	//LOG("Sector::canBuildDesign(%d)\n",design);
-	bool ok = true;
-	for(int j=0;j<N_ID && ok;j++) {
-		if( design->getCost((Id)j) > this->elementstocks[j] + this->elements[j] ) {
-			// not enough elements
-			ok = false;
-		}
-	}
-	return ok;
+	return design->canAfford(this->elementstocks, this->elements);
 }
 
 void Sector::autoTrashDesigns() {
@@ -1333,7 +1438,7 @@ void Sector::autoTrashDesigns() {
 bool Sector::tryMiningMore() const {
 	// todo: only check elements we can mine (we might not be able to advance to that epoch)
 	for(int i=0;i<N_ID;i++) {
-		//Element *element = game_g->elements[i];
+		//Element *element = game->elements[i];
 		if( this->elements[i] > 0 &&
 			this->elementstocks[i] < 6 * element_multiplier_c
 			//( element->type != Element::GATHERABLE || this->elementstocks[i] < max_gatherables_stored_c * element_multiplier_c )
@@ -1418,25 +1523,47 @@ void Sector::cheat(int client_player) {
 Design *Sector::knownDesign(Invention::Type type,int epoch) const {
 	//LOG("Sector::knownDesign(%d,%d)\n",type,epoch);
 	ASSERT_EPOCH(epoch);
-	Invention *invention = Invention::getInvention(type, epoch);
-	ASSERT(invention != NULL);
-	Design *best_design = NULL;
-	for(size_t i=0;i<this->designs.size() && best_design==NULL;i++) {
+	this->updateDesignCache();
+	return this->known_designs[type][epoch];
+}
+
+Design *Sector::bestDesign(Invention::Type type,int epoch) const {
+	//LOG("Sector::bestDesign(%d,%d)\n",type,epoch);
+	ASSERT_EPOCH(epoch);
+	this->updateDesignCache();
+	return this->best_designs[type][epoch];
+}
+
+/** Recomputes the results of knownDesign(), canBuildDesign() and bestDesign() for every invention, if
+ *  anything they depend on has changed since they were last computed.
+ */
+void Sector::updateDesignCache() const {
+	if( this->design_cache_valid && this->design_cache_disallow_nukes == game->isPrefDisallowNukes() )
+		return;
+	for(int i=0;i<Invention::N_TYPES;i++) {
+		for(int j=0;j<n_epochs_c;j++) {
+			this->known_designs[i][j] = NULL;
+			this->buildable_designs[i][j] = NULL;
+			this->best_designs[i][j] = this->calculateBestDesign((Invention::Type)i, j);
+		}
+	}
+	// the first of the sector's designs for each invention, and the first one that can be built
+	for(size_t i=0;i<this->designs.size();i++) {
 		Design *design = this->designs.at(i);
 		// design should be non-NULL, but to satisfy VS Code Analysis...
 		if( design == NULL )
 			continue;
-		if( design->getInvention() == invention ) {
-			//ASSERT( best_design == NULL );
-			best_design = design;
-		}
+		const Invention *invention = design->getInvention();
+		if( this->known_designs[invention->getType()][invention->getEpoch()] == NULL )
+			this->known_designs[invention->getType()][invention->getEpoch()] = design;
+		if( this->buildable_designs[invention->getType()][invention->getEpoch()] == NULL && this->canBuildDesign(design) )
+			this->buildable_designs[invention->getType()][invention->getEpoch()] = design;
 	}
-	return best_design;
+	this->design_cache_disallow_nukes = game->isPrefDisallowNukes();
+	this->design_cache_valid = true;
 }
 
-Design *Sector::bestDesign(Invention::Type type,int epoch) const {
-	//LOG("Sector::bestDesign(%d,%d)\n",type,epoch);
-	ASSERT_EPOCH(epoch);
+Design *Sector::calculateBestDesign(Invention::Type type,int epoch) const {
 	Invention *invention = Invention::getInvention(type, epoch);
 	ASSERT(invention != NULL);
 	Design *best_design = NULL;
@@ -1445,14 +1572,12 @@ Design *Sector::bestDesign(Invention::Type type,int epoch) const {
 		//Design *design = (Design *)invention->designs->elementAt(i);
 		Design *design = invention->getDesign(i);
 		bool ok = true;
-		if( game_g->isPrefDisallowNukes() && ( type == Invention::DEFENCE || type == Invention::WEAPON ) && epoch == nuclear_epoch_c ) {
+		if( game->isPrefDisallowNukes() && ( type == Invention::DEFENCE || type == Invention::WEAPON ) && epoch == nuclear_epoch_c ) {
 			ok = false;
 		}
-		for(int j=0;j<N_ID && ok;j++) {
-			if( design->getCost((Id)j) > this->elementstocks[j] ) {
-				// not enough elements
-				ok = false;
-			}
+		if( ok && !design->canAfford(this->elementstocks) ) {
+			// not enough elements
+			ok = false;
 		}
 		if( ok ) {
 			if( best_design == NULL )
@@ -1474,9 +1599,10 @@ void Sector::trashDesign(Invention *invention) {
 			break;
 		}
 	}
+	this->invalidateDesignCache();
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 }
 
@@ -1490,9 +1616,10 @@ void Sector::trashDesign(Design *design) {
 			break;
 		}
 	}
+	this->invalidateDesignCache();
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 }
 
@@ -1500,7 +1627,7 @@ bool Sector::nukeSector(Sector *source) {
 	LOG("Sector::nuke(%d) [%d: %d, %d]\n", source, player, xpos, ypos);
 	ASSERT( source->player != -1 );
 	ASSERT( this->player != source->player );
-	ASSERT( this->player == -1 || !Player::isAlliance( this->player, source->player ) );
+	ASSERT( this->player == -1 || !game->isAlliance( this->player, source->player ) );
 	if( isBeingNuked() ) {
 		ASSERT( this->nuke_time != -1 );
 		return false;
@@ -1508,7 +1635,7 @@ bool Sector::nukeSector(Sector *source) {
 
 	// we still start the timer, even if a laser will shoot it
 	this->nuke_by_player = source->player;
-	this->nuke_time = game_g->getGameTime();
+	this->nuke_time = game->getGameTime();
 
 	if( this->getActivePlayer() != -1 ) {
 		// nuke defences
@@ -1519,7 +1646,7 @@ bool Sector::nukeSector(Sector *source) {
 					if( this->buildings[i]->getTurretMan(j) == nuclear_epoch_c ) {
 						ASSERT( !this->nuke_defence_animation );
 						this->nuke_defence_animation = true;
-						this->nuke_defence_time = game_g->getGameTime();
+						this->nuke_defence_time = game->getGameTime();
 						this->nuke_defence_x = this->buildings[i]->getTurretButton(j)->getLeft();
 						this->nuke_defence_y = this->buildings[i]->getTurretButton(j)->getTop();
 						this->buildings[i]->clearTurretMan(j);
@@ -1537,7 +1664,7 @@ bool Sector::nukeSector(Sector *source) {
 Design *Sector::canResearch(Invention::Type type,int epoch) const {
 	//LOG("Sector::canResearch(%d,%d)\n",type,epoch);
 	ASSERT_EPOCH(epoch);
-	if( epoch < game_g->getStartEpoch() || epoch > game_g->getStartEpoch() + 3 )
+	if( epoch < game->getStartEpoch() || epoch > game->getStartEpoch() + 3 )
 		return NULL; // can't research this
 	if( epoch > lab_epoch_c && this->getBuilding(BUILDING_LAB) == NULL )
 		return NULL; // need a lab for this
@@ -1556,14 +1683,15 @@ int Sector::getNDesigns() const {
 void Sector::consumeStocks(Design *design) {
     // disable logging, performance issue on mobile devices (Symbian)
     //LOG("Sector::consumeStocks(%d) [%d: %d, %d]\n", design, player, xpos, ypos);
-	for(int j=0;j<N_ID;j++) {
+	for(int j=0;j<design->getNCosts();j++) {
+		Id id = design->getCostId(j);
 		// we should have enough elements here!
-		ASSERT(this->elementstocks[j] >= design->getCost((Id)j));
-		this->reduceElementStocks((Id)j, design->getCost((Id)j));
+		ASSERT(this->elementstocks[id] >= design->getCost(id));
+		this->reduceElementStocks(id, design->getCost(id));
 	}
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 }
 
@@ -1571,7 +1699,7 @@ void Sector::buildDesign() {
 	//LOG("Sector::buildDesign(%d : %s) [%d: %d, %d]\n", this->current_manufacture, this->current_manufacture->getInvention()->getName(), player, xpos, ypos);
 /*#ifdef _DEBUG
 	LOG("### Sector::buildDesign a\n");
-	game_g->getMap()->checkSectors();
+	game->getMap()->checkSectors();
 #endif*/
 	Invention *invention = this->current_manufacture->getInvention();
 	if( invention->getType() == Invention::WEAPON ) {
@@ -1581,7 +1709,7 @@ void Sector::buildDesign() {
 		this->stored_defenders[invention->getEpoch()]++;
 	}
 	else if( invention->getType() == Invention::SHIELD ) {
-		int shield = invention->getEpoch() - game_g->getStartEpoch();
+		int shield = invention->getEpoch() - game->getStartEpoch();
 		ASSERT_SHIELD(shield);
 		this->stored_shields[shield]++;
 	}
@@ -1590,7 +1718,7 @@ void Sector::buildDesign() {
 	}
 /*#ifdef _DEBUG
 	//LOG("### Sector::buildDesign b\n");
-	game_g->getMap()->checkSectors();
+	game->getMap()->checkSectors();
 #endif*/
 }
 
@@ -1599,10 +1727,10 @@ bool Sector::assembleArmy(int epoch,int n) {
 	ASSERT_EPOCH(epoch);
 	int n_population = this->getPopulation();
 	int n_spare = this->getAvailablePopulation();
-	int n_men = game_g->invention_weapons[epoch]->getNMen() * n;
+	int n_men = game->invention_weapons[epoch]->getNMen() * n;
 	if( n_spare < n_men ) {
 		n = 1;
-		n_men = game_g->invention_weapons[epoch]->getNMen() * n;
+		n_men = game->invention_weapons[epoch]->getNMen() * n;
 	}
 	if( n_spare < n_men )
 		return false;
@@ -1625,7 +1753,7 @@ bool Sector::assembleArmy(int epoch,int n) {
 	if( n_make > 0 ) {
 		this->getAssembledArmy()->add(epoch, n_make);
 		this->getStoredArmy()->remove(epoch, n_make);
-		n_men = game_g->invention_weapons[epoch]->getNMen() * n_make;
+		n_men = game->invention_weapons[epoch]->getNMen() * n_make;
 		this->setPopulation( n_population - n_men );
 	}
 	return (n_make == n);
@@ -1690,10 +1818,10 @@ int Sector::getStoredDefenders(int epoch) const {
 bool Sector::useShield(Building *building,int shield) {
 	ASSERT_SHIELD(shield);
 	if( this->stored_shields[shield] == 0 ) {
-		if( game_g->getStartEpoch() + shield >= factory_epoch_c )
+		if( game->getStartEpoch() + shield >= factory_epoch_c )
 			return false;
 		// not enough - try to make one
-		Design *design = this->canBuildDesign(Invention::SHIELD, game_g->getStartEpoch() + shield);
+		Design *design = this->canBuildDesign(Invention::SHIELD, game->getStartEpoch() + shield);
 		if( design == NULL )
 			return false; // can't make a new one
 		this->consumeStocks(design);
@@ -1715,11 +1843,11 @@ float Sector::getDefenceStrength() const {
 	//LOG("Sector::getDefenceStrength() [%d: %d, %d]\n", player, xpos, ypos);
 	ASSERT_PLAYER(player);
 	float str = 0.0f;
-	if( game_g->getStartEpoch() == end_epoch_c ) {
+	if( game->getStartEpoch() == end_epoch_c ) {
 		str = 4.0f;
 	}
 	else {
-		//str = ( this->epoch - game_g->getStartEpoch() ) + 1;
+		//str = ( this->epoch - game->getStartEpoch() ) + 1;
 		str = 1.0f;
 	}
 	if( this->player == PlayerType::PLAYER_BLUE ) {
@@ -1728,9 +1856,29 @@ float Sector::getDefenceStrength() const {
 	return str;
 }
 
-void Sector::doCombat(int client_player) {
+/** Whether doCombat() will kill anyone here - i.e., whether any player has men facing an enemy with some strength.
+ */
+bool Sector::isFighting() const {
+	for(int i=0;i<n_players_c;i++) {
+		const Army *army = this->getArmy(i);
+		int this_total = army->getTotal();
+		if( this->player == i ) {
+			this_total += this->getNDefenders();
+		}
+		if( this_total == 0 )
+			continue;
+		for(int j=0;j<n_players_c;j++) {
+			if( i != j && !game->isAlliance(i,j) ) {
+				if( this->getArmy(j)->getStrength() > 0 || ( this->player == j && this->getDefenderStrength() > 0 ) )
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+void Sector::doCombat(int client_player, int looptime) {
 	//LOG("Sector::doCombat()\n");
-	int looptime = game_g->getLoopTime();
 
 	/*int army_strengths[n_players_c];
 	int n_armies = 0;
@@ -1743,10 +1891,10 @@ void Sector::doCombat(int client_player) {
 	Army *friendly = this->getArmy(human_player);
 	Army *enemy = this->getArmy(enemy_player);
 	}*/
-	bool died[n_players_c];
+	int n_deaths[n_players_c];
 	//int random = rand () % RAND_MAX;
 	for(int i=0;i<n_players_c;i++) {
-		died[i] = false;
+		n_deaths[i] = 0;
 		Army *army = this->getArmy(i);
 		int this_strength = army->getStrength();
 		int this_total = army->getTotal();
@@ -1759,7 +1907,7 @@ void Sector::doCombat(int client_player) {
 		if( this_total > 0 ) {
 			int enemy_strength = 0;
 			for(int j=0;j<n_players_c;j++) {
-				if( i != j && !Player::isAlliance(i,j) ) {
+				if( i != j && !game->isAlliance(i,j) ) {
 					enemy_strength += this->getArmy(j)->getStrength();
 					if( this->player == j ) {
 						enemy_strength += this->getDefenderStrength();
@@ -1777,30 +1925,33 @@ void Sector::doCombat(int client_player) {
 				// see docs/combat_logic.txt for more examples
 				float death_rate = ((float)this_strength) / ((float)this_total);
 				death_rate = death_rate * ((float)(combat_rate_c * gameticks_per_hour_c)) / ((float)enemy_strength);
-				int prob = poisson((int)death_rate, looptime);
-				int random = rand() % RAND_MAX;
-				if( random <= prob ) {
-					// soldier has died
-					died[i] = true;
-				}
+				int random = this->random_simulation.rand() % RAND_MAX;
+				// the number of soldiers that died - usually at most one, except over long time steps
+				n_deaths[i] = poissonEvents(this_total, (int)death_rate, looptime, random);
 			}
 		}
 	}
 	for(int i=0;i<n_players_c;i++) {
-		if( died[i] ) {
+		if( n_deaths[i] > 0 ) {
 			Army *army = this->getArmy(i);
-			int this_total = army->getTotal();
-			if( this->player == i )
-				this_total += this->getNDefenders();
-
-			int die = rand() % this_total;
-			if( die < army->getTotal() ) {
-				army->kill(die);
-			}
-			else {
-				// kill a defender
-				this->killDefender(die - army->getTotal());
+			int n_soldiers = army->getTotal();
+			int n_defenders = this->player == i ? this->getNDefenders() : 0;
+			int n_killed[n_epochs_c+1];
+			for(int j=0;j<=n_epochs_c;j++)
+				n_killed[j] = 0;
+			for(int j=0;j<n_deaths[i];j++) {
+				int die = this->random_simulation.rand() % (n_soldiers + n_defenders);
+				if( die < n_soldiers ) {
+					n_killed[ army->findSoldier(die, n_killed) ]++;
+					n_soldiers--;
+				}
+				else {
+					// kill a defender
+					this->killDefender(die - n_soldiers);
+					n_defenders--;
+				}
 			}
+			army->kill(n_killed);
 		}
 	}
 
@@ -1808,16 +1959,22 @@ void Sector::doCombat(int client_player) {
 	if( this->player != -1 ) {
 		int bombard = 0;
 		for(int i=0;i<n_players_c;i++) {
-			if( this->player != i && !Player::isAlliance(this->player, i) ) {
+			if( this->player != i && !game->isAlliance(this->player, i) ) {
 				bombard += this->getArmy(i)->getBombardStrength();
 			}
 		}
 		if( bombard > 0 ) {
 			int bombard_rate = ( bombard_rate_c * gameticks_per_hour_c ) / bombard;
 			bombard_rate = (int)(bombard_rate * this->getDefenceStrength());
-			int prob = poisson(bombard_rate, looptime);
-			int random = rand() % RAND_MAX;
-			if( random <= prob ) {
+			// can't do more damage than the buildings have health
+			int n_health = 0;
+			for(int i=0;i<N_BUILDINGS;i++) {
+				if( this->buildings[i] != NULL )
+					n_health += this->buildings[i]->getHealth();
+			}
+			int random = this->random_simulation.rand() % RAND_MAX;
+			int n_hits = poissonEvents(n_health, bombard_rate, looptime, random);
+			for(int hit=0;hit<n_hits && this->player != -1;hit++) {
 				// caused some damage
 				int n_buildings = 0;
 				for(int i=0;i<N_BUILDINGS;i++) {
@@ -1825,7 +1982,7 @@ void Sector::doCombat(int client_player) {
 						n_buildings++;
 				}
 				ASSERT( n_buildings > 0 );
-				int b = rand() % n_buildings;
+				int b = this->random_simulation.rand() % n_buildings;
 				for(int i=0;i<N_BUILDINGS;i++) {
 					Building *building = this->buildings[i];
 					if( building != NULL ) {
@@ -1840,9 +1997,9 @@ void Sector::doCombat(int client_player) {
 								destroyBuilding((Type)i, client_player);
 							}
 							else if( this->player == client_player && building->getHealth() == 10 && building->getType() == BUILDING_TOWER ) {
-								playSample(game_g->s_tower_critical);
+								this->addSampleEffect(game->s_tower_critical, SOUND_CHANNEL_SAMPLES);
 								//((PlayingGameState *)gamestate)->setFlashingSquare(this->xpos, this->ypos);
-								gamestate->setFlashingSquare(this->xpos, this->ypos);
+								this->addEffect(SectorEffect::TYPE_FLASHING_SQUARE);
 							}
 							break;
 						}
@@ -1858,92 +2015,120 @@ void Sector::doPlayer(int client_player) {
 	//LOG("Sector::doPlayer()\n");
 	// stuff for sectors owned by a player
 
-	// n.b., only update the particle systems that are specific to sectors owned by a player
-	if( this->smokeParticleSystem != NULL ) {
-		this->smokeParticleSystem->update();
-	}
-
-	if( game_g->getGameMode() == GAMEMODE_MULTIPLAYER_CLIENT ) {
+	if( game->getGameMode() == GAMEMODE_MULTIPLAYER_CLIENT ) {
 		// rest of function is for game logic done by server
 		return;
 	}
 
-	int time = game_g->getGameTime();
-	int looptime = game_g->getLoopTime();
+	int time = game->getGameTime();
+	int looptime = game->getLoopTime();
+
+	if( this->economy_time != time - looptime || this->mined_lasttime == -1 ) {
+		// not processed on the previous frame (new owner, was shut down, or just loaded), so only mine for this frame
+		this->catchUpEconomy();
+		this->mined_lasttime = time - looptime;
+		this->economy_due = true;
+	}
+	if( !this->economy_due ) {
+		// nothing to do until the next scheduled event, or until something changes
+		this->economy_time = time;
+		return;
+	}
+	this->economy_due = false;
 
 	if( this->current_design != NULL ) {
 		if( this->researched_lasttime == -1 )
 			this->researched_lasttime = time;
+		int cost = this->getInventionCost();
 		while( time - this->researched_lasttime > gameticks_per_hour_c ) {
 			this->researched += this->getDesigners();
 			this->researched_lasttime += gameticks_per_hour_c;
+			if( this->researched > cost )
+				break;
 		}
-		int cost = this->getInventionCost();
 		if( this->researched > cost ) {
 			//LOG("Sector [%d: %d, %d] has made a %s\n", player, xpos, ypos, this->current_design->getInvention()->getName());
 			this->invent(client_player);
 		}
 	}
 
-	if( this->current_manufacture != NULL ) {
-		if( this->manufactured_lasttime == -1 )
-			this->manufactured_lasttime = time;
-		if( this->manufactured == 0 && this->getWorkers() > 0 ) {
-			if( !this->canBuildDesign( this->current_manufacture ) ) {
-				// not enough elements
-				// therefore production run completed
-				if( this->player == client_player ) {
-					playSample(game_g->s_fcompleted);
-					gamestate->setFlashingSquare(this->xpos, this->ypos);
+	// for large time steps (fast forward), more than one item may be manufactured
+	bool started_next = false;
+	for(;;) {
+		if( this->current_manufacture != NULL ) {
+			if( this->manufactured_lasttime == -1 )
+				this->manufactured_lasttime = time;
+			if( this->manufactured == 0 && this->getWorkers() > 0 ) {
+				if( !this->canBuildDesign( this->current_manufacture ) ) {
+					// not enough elements
+					// therefore production run completed
+					if( this->player == client_player ) {
+						this->addSampleEffect(game->s_fcompleted, SOUND_CHANNEL_SAMPLES);
+						this->addEffect(SectorEffect::TYPE_FLASHING_SQUARE);
+					}
+					this->setCurrentManufacture(NULL);
+					if( this == gamestate->getCurrentSector() ) {
+						//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
+						this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
+					}
+				}
+				else {
+					this->consumeStocks( this->current_manufacture );
+				}
+			}
+		}
+		// a new if statement, as production run may have ended due to lack of elements
+		if( this->current_manufacture != NULL ) {
+			int cost = this->getManufactureCost();
+			while( time - this->manufactured_lasttime > gameticks_per_hour_c ) {
+				this->manufactured += this->getWorkers();
+				this->manufactured_lasttime += gameticks_per_hour_c;
+				if( this->manufactured > cost )
+					break;
+			}
+			if( this->manufactured == 0 && this->getWorkers() > 0 ) {
+				this->manufactured++; // a bit hacky; just to avoid consuming stocks again
+			}
+			if( this->manufactured > cost ) {
+				this->buildDesign();
+				this->manufactured = 0;
+				if( this->n_famount != infinity_c )
+					this->setFAmount( this->n_famount - 1 );
+				if( this->n_famount == 0 ) {
+					// production run completed
+					//LOG("production run completed\n");
+					if( this->player == client_player ) {
+						this->addSampleEffect(game->s_fcompleted, SOUND_CHANNEL_SAMPLES);
+						this->addEffect(SectorEffect::TYPE_FLASHING_SQUARE);
+					}
+					this->setCurrentManufacture(NULL);
 				}
-				this->setCurrentManufacture(NULL);
 				if( this == gamestate->getCurrentSector() ) {
 					//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-					gamestate->getGamePanel()->refresh();
+					this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 				}
 			}
-			else {
-				this->consumeStocks( this->current_manufacture );
-			}
 		}
-	}
-	// a new if statement, as production run may have ended due to lack of elements
-	if( this->current_manufacture != NULL ) {
-		while( time - this->manufactured_lasttime > gameticks_per_hour_c ) {
-			this->manufactured += this->getWorkers();
-			this->manufactured_lasttime += gameticks_per_hour_c;
-		}
-		if( this->manufactured == 0 && this->getWorkers() > 0 ) {
-			this->manufactured++; // a bit hacky; just to avoid consuming stocks again
+		if( this->current_manufacture == NULL ) {
+			break;
 		}
-		int cost = this->getManufactureCost();
-		if( this->manufactured > cost ) {
-			this->buildDesign();
-			this->manufactured = 0;
-			if( this->n_famount != infinity_c )
-				this->setFAmount( this->n_famount - 1 );
-			if( this->n_famount == 0 ) {
-				// production run completed
-				//LOG("production run completed\n");
-				if( this->player == client_player ) {
-					playSample(game_g->s_fcompleted);
-					gamestate->setFlashingSquare(this->xpos, this->ypos);
-				}
-				this->setCurrentManufacture(NULL);
-			}
-			if( this == gamestate->getCurrentSector() ) {
-				//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-				gamestate->getGamePanel()->refresh();
+		if( time - this->manufactured_lasttime <= gameticks_per_hour_c ) {
+			// if an item has just been made, start the next one straight away, rather than on the next frame
+			if( started_next || this->manufactured != 0 || this->getWorkers() == 0 ) {
+				break;
 			}
+			started_next = true;
 		}
 	}
 
 	bool new_stocks = false;
+	int mined_time = time - this->mined_lasttime;
+	this->mined_lasttime = time;
 	for(int i=0;i<N_ID;i++) {
 		if( this->elements[i] == 0 ) {
 			continue; // no more of this element
 		}
-		Element *element = game_g->elements[i];
+		Element *element = game->elements[i];
 		if( element->getType() != Element::GATHERABLE || this->elementstocks[i] < max_gatherables_stored_c * element_multiplier_c )
 		{
 			int n_gatherers = 0;
@@ -1952,7 +2137,7 @@ void Sector::doPlayer(int client_player) {
 			}
 			else
 				n_gatherers = this->getMiners((Id)i);
-			this->partial_elementstocks[i] += element_multiplier_c * n_gatherers * looptime;
+			this->partial_elementstocks[i] += element_multiplier_c * n_gatherers * mined_time;
 			while( this->partial_elementstocks[i] > mine_rate_c * gameticks_per_hour_c ) {
 				new_stocks = true;
 				this->partial_elementstocks[i] -= mine_rate_c * gameticks_per_hour_c;
@@ -1968,9 +2153,7 @@ void Sector::doPlayer(int client_player) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refreshDeployInventions();
 		((PlayingGameState *)gamestate)->getGamePanel()->refreshManufactureInventions();*/
 
-		gamestate->getGamePanel()->refreshCanDesign();
-		gamestate->getGamePanel()->refreshDesignInventions();
-		gamestate->getGamePanel()->refreshManufactureInventions();
+		this->addEffect(SectorEffect::TYPE_REFRESH_STOCKS);
 	}
 
 	if( this->built_lasttime == -1 )
@@ -1990,28 +2173,226 @@ void Sector::doPlayer(int client_player) {
 
 	if( this->growth_lasttime == -1 )
 		this->growth_lasttime = time;
-	else if( game_g->getTutorial() != NULL && !game_g->getTutorial()->aiAllowGrowth() && !game_g->players[this->player]->isHuman() ) {
+	else if( game->getTutorial() != NULL && !game->getTutorial()->aiAllowGrowth() && !game->players[this->player]->isHuman() ) {
 		// don't allow growth
 	}
 	else if( this->getSparePopulation() > 0 ) {
-		int spare_pop = this->getSparePopulation();
-		if( spare_pop > max_grow_population_c/2 ) {
-			spare_pop = max_grow_population_c - spare_pop;
-			spare_pop = max(spare_pop, 0);
-		}
-		if( spare_pop > 0 ) {
+		int spare_pop = this->getGrowthPopulation();
+		int old_pop = this->population;
+		// for large time steps (fast forward) there may be more than one birth, each one changing the delay for the next
+		while( spare_pop > 0 ) {
 			int delay = ( growth_rate_c * gameticks_per_hour_c ) / spare_pop;
-			if( time - this->growth_lasttime > delay ) {
-				int old_pop = this->population;
-				if( this->getSparePopulation() < max_grow_population_c )
-					this->population++;
+			if( time - this->growth_lasttime <= delay ) {
+				break;
+			}
+			if( this->getSparePopulation() < max_grow_population_c )
+				this->population++;
+			// births are counted from no earlier than the start of this step (time isn't carried over from when there was no spare population)
+			int birth_time = max(this->growth_lasttime + delay, time - looptime);
+			spare_pop = this->getGrowthPopulation();
+			if( spare_pop > 0 && time - birth_time > ( growth_rate_c * gameticks_per_hour_c ) / spare_pop ) {
+				this->growth_lasttime = birth_time;
+			}
+			else {
 				this->growth_lasttime = time;
-				int births = this->population - old_pop;
-				if( births > 0 ) {
-					game_g->players[this->player]->registerBirths(births);
-				}
+				break;
 			}
 		}
+		int births = this->population - old_pop;
+		if( births > 0 ) {
+			SectorEffect effect(SectorEffect::TYPE_BIRTHS);
+			effect.player = this->player;
+			effect.value = births;
+			this->addEffect(effect);
+		}
+	}
+
+	// n.b., only update this now, so that any changes made above catch up to the previous frame
+	this->economy_time = time;
+	this->scheduleEconomy(time);
+}
+
+/** Returns the population that drives growth: this rises with the spare population, then falls off
+ *  again as the sector approaches max_grow_population_c.
+ */
+int Sector::getGrowthPopulation() const {
+	int spare_pop = this->getSparePopulation();
+	if( spare_pop > max_grow_population_c/2 ) {
+		spare_pop = max_grow_population_c - spare_pop;
+		spare_pop = max(spare_pop, 0);
+	}
+	return spare_pop;
+}
+
+/** Returns the number of whole hours that doPlayer() would have processed by the given time.
+*/
+int Sector::economyTicks(int lasttime, int time) {
+	if( lasttime == -1 || time - lasttime <= gameticks_per_hour_c )
+		return 0;
+	return ( time - lasttime - 1 ) / gameticks_per_hour_c;
+}
+
+/** Returns the game time at which an accumulator increasing by rate every hour will first exceed
+ *  cost, 0 if it already does, or -1 if it never will.
+ */
+int Sector::economyTickEventTime(int value, int lasttime, int rate, int cost) {
+	if( value > cost )
+		return 0;
+	if( rate <= 0 )
+		return -1;
+	int ticks = ( cost - value ) / rate + 1;
+	return lasttime + ticks * gameticks_per_hour_c + 1;
+}
+
+/** Returns the amount partial_elementstocks increases by per game tick, or -1 if this element
+ *  isn't being mined at all.
+ */
+int Sector::getMiningRate(Id id) const {
+	if( this->elements[(int)id] == 0 ) {
+		return -1; // no more of this element
+	}
+	Element *element = game->elements[(int)id];
+	if( element->getType() == Element::GATHERABLE ) {
+		if( this->elementstocks[(int)id] >= max_gatherables_stored_c * element_multiplier_c )
+			return -1;
+		return element_multiplier_c * n_gatherable_rate_c;
+	}
+	return element_multiplier_c * this->getMiners(id);
+}
+
+/** Brings the research, manufacturing, building and mining accumulators up to date with the last
+ *  call to doPlayer(). These are only updated lazily, so this must be called before changing
+ *  anything they depend on.
+ */
+void Sector::catchUpEconomy() {
+	int time = this->economy_time;
+	if( time == -1 ) {
+		return;
+	}
+	if( this->current_design != NULL ) {
+		int ticks = economyTicks(this->researched_lasttime, time);
+		this->researched += ticks * this->getDesigners();
+		this->researched_lasttime += ticks * gameticks_per_hour_c;
+	}
+	if( this->current_manufacture != NULL ) {
+		int ticks = economyTicks(this->manufactured_lasttime, time);
+		this->manufactured += ticks * this->getWorkers();
+		this->manufactured_lasttime += ticks * gameticks_per_hour_c;
+	}
+	int ticks = economyTicks(this->built_lasttime, time);
+	if( ticks > 0 ) {
+		for(int i=0;i<N_BUILDINGS;i++) {
+			this->built[i] += ticks * this->getBuilders((Type)i);
+		}
+		this->built_lasttime += ticks * gameticks_per_hour_c;
+	}
+	if( this->mined_lasttime != -1 && time > this->mined_lasttime ) {
+		for(int i=0;i<N_ID;i++) {
+			int rate = this->getMiningRate((Id)i);
+			if( rate > 0 ) {
+				this->partial_elementstocks[i] += rate * ( time - this->mined_lasttime );
+			}
+		}
+		this->mined_lasttime = time;
+	}
+}
+
+/** Must be called before modifying anything that doPlayer() depends on.
+*/
+void Sector::economyChanged() {
+	this->catchUpEconomy();
+	this->economy_due = true;
+}
+
+/** Returns the earliest game time at which doPlayer() will next change this sector, 0 if it
+ *  should be processed straight away, or -1 if nothing will happen until something changes.
+ */
+int Sector::nextEconomyEventTime() const {
+	int next = -1;
+	int event = -1;
+
+	if( this->current_design != NULL ) {
+		if( this->researched_lasttime == -1 )
+			return 0;
+		event = economyTickEventTime(this->researched, this->researched_lasttime, this->getDesigners(), this->getInventionCost());
+		if( event != -1 && ( next == -1 || event < next ) )
+			next = event;
+	}
+
+	if( this->current_manufacture != NULL ) {
+		if( this->manufactured_lasttime == -1 )
+			return 0;
+		// n.b., doPlayer() starts each item (or ends the run, if there aren't enough elements) as soon as the
+		// previous one is done, and anything else that leaves an item to start calls economyChanged()
+		event = economyTickEventTime(this->manufactured, this->manufactured_lasttime, this->getWorkers(), this->getManufactureCost());
+		if( event != -1 && ( next == -1 || event < next ) )
+			next = event;
+	}
+
+	if( this->mined_lasttime == -1 )
+		return 0;
+	for(int i=0;i<N_ID;i++) {
+		int rate = this->getMiningRate((Id)i);
+		if( rate == -1 )
+			continue;
+		int remaining = mine_rate_c * gameticks_per_hour_c - this->partial_elementstocks[i];
+		if( remaining < 0 )
+			return 0;
+		if( rate > 0 ) {
+			event = this->mined_lasttime + remaining / rate + 1;
+			if( next == -1 || event < next )
+				next = event;
+		}
+	}
+
+	if( this->built_lasttime == -1 )
+		return 0;
+	for(int i=0;i<N_BUILDINGS;i++) {
+		event = economyTickEventTime(this->built[i], this->built_lasttime, this->getBuilders((Type)i), getBuildingCost((Type)i, this->player));
+		if( event != -1 && ( next == -1 || event < next ) )
+			next = event;
+	}
+
+	if( this->growth_lasttime == -1 )
+		return 0;
+	int spare_pop = this->getGrowthPopulation();
+	if( game->getTutorial() != NULL && !game->getTutorial()->aiAllowGrowth() && !game->players[this->player]->isHuman() ) {
+		// no growth, as set by the tutorial when it starts
+	}
+	else if( spare_pop > 0 ) {
+		int delay = ( growth_rate_c * gameticks_per_hour_c ) / spare_pop;
+		event = this->growth_lasttime + delay + 1;
+		if( next == -1 || event < next )
+			next = event;
+	}
+
+	return next;
+}
+
+/** Works out when doPlayer() next needs to process this sector.
+*/
+void Sector::scheduleEconomy(int time) {
+	this->economy_generation++; // any previously scheduled event is now out of date
+	int next = this->nextEconomyEventTime();
+	if( next == -1 ) {
+		// idle until something changes
+	}
+	else if( next <= time ) {
+		this->economy_due = true;
+	}
+	else {
+		SectorEffect effect(SectorEffect::TYPE_ECONOMY_EVENT);
+		effect.x = next;
+		effect.value = this->economy_generation;
+		this->addEffect(effect);
+	}
+}
+
+/** Called by the Map when a scheduled event is reached.
+*/
+void Sector::economyEvent(int generation) {
+	if( generation == this->economy_generation ) {
+		this->economy_due = true;
 	}
 }
 
@@ -2021,7 +2402,7 @@ void Sector::getNukePos(int *nuke_x, int *nuke_y) const {
 	*nuke_y = -1;
 	if( this->isBeingNuked() ) {
 		ASSERT( nuke_time != -1 );
-		float alpha = ((float)( game_g->getGameTime() - nuke_time )) / (float)nuke_delay_c;
+		float alpha = ((float)( game->getGameTime() - nuke_time )) / (float)nuke_delay_c;
 		ASSERT( alpha >= 0.0 );
 		if( alpha > 1.0 )
 			alpha = 1.0;
@@ -2034,27 +2415,22 @@ void Sector::getNukePos(int *nuke_x, int *nuke_y) const {
 
 void Sector::update(int client_player) {
 	//LOG("Sector::update()\n");
-	if( game_g->getGameMode() != GAMEMODE_MULTIPLAYER_CLIENT ) {
-		this->doCombat(client_player);
-	}
-
-	// update particle systems (that aren't done in doPlayer())
-	if( this->jetParticleSystem != NULL ) {
-		this->jetParticleSystem->update();
-	}
-	if( this->nukeParticleSystem != NULL ) {
-		this->nukeParticleSystem->update();
-	}
-	if( this->nukeDefenceParticleSystem != NULL ) {
-		this->nukeDefenceParticleSystem->update();
+	if( game->getGameMode() != GAMEMODE_MULTIPLAYER_CLIENT ) {
+		// when fast forwarding, resolve combat over several steps, so that the strengths are updated as soldiers die
+		int looptime = game->getLoopTime();
+		do {
+			int step = min(looptime, max_combat_step_c);
+			this->doCombat(client_player, step);
+			looptime -= step;
+		} while( looptime > 0 );
 	}
 
 	if( this->player != -1 ) {
 		if( !this->is_shutdown )
-			this->doPlayer(client_player); // still call for clients, to update particle system
+			this->doPlayer(client_player);
 	}
-	else if( game_g->getGameMode() != GAMEMODE_MULTIPLAYER_CLIENT ) {
-		int time = game_g->getGameTime();
+	else if( game->getGameMode() != GAMEMODE_MULTIPLAYER_CLIENT ) {
+		int time = game->getGameTime();
 		int n_players_in_sector = 0;
 		int player_in_sector = -1;
 		for(int i=0;i<n_players_c;i++) {
@@ -2066,7 +2442,7 @@ void Sector::update(int client_player) {
 		}
 
 		// build new tower?
-		if( game_g->getTutorial() != NULL && game_g->getTutorial()->getCard() != NULL && !game_g->getTutorial()->getCard()->playerAllowBuildTower() ) {
+		if( game->getTutorial() != NULL && game->getTutorial()->getCard() != NULL && !game->getTutorial()->getCard()->playerAllowBuildTower() ) {
 			// don't allow building new tower
 		}
 		else if( n_players_in_sector == 1 ) {
@@ -2082,27 +2458,27 @@ void Sector::update(int client_player) {
 				/*if( ((PlayingGameState *)gamestate)->getSelectedArmy() == this->getArmy(player_in_sector) ) {
 					((PlayingGameState *)gamestate)->clearSelectedArmy();
 				}*/
-				if( gamestate->getSelectedArmy() == this->getArmy(player_in_sector) ) {
-					gamestate->clearSelectedArmy();
-				}
+				SectorEffect effect(SectorEffect::TYPE_CLEAR_SELECTED_ARMY);
+				effect.player = player_in_sector;
+				this->addEffect(effect);
 				this->createTower(player_in_sector, 0);
 				this->returnArmy();
 				if( this == gamestate->getCurrentSector() ) {
 					//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-					gamestate->getGamePanel()->refresh();
+					this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 				}
 			}
 		}
 	}
 
-	if( game_g->getGameMode() == GAMEMODE_MULTIPLAYER_CLIENT ) {
+	if( game->getGameMode() == GAMEMODE_MULTIPLAYER_CLIENT ) {
 		return;
 	}
 	// rest of function is done by server
 
 	if( this->nuke_by_player != -1 ) {
 		ASSERT( this->nuke_time != -1 );
-		if( game_g->getGameTime() >= this->nuke_time + nuke_delay_c ) {
+		if( game->getGameTime() >= this->nuke_time + nuke_delay_c ) {
 			this->nuked = true;
 
 			if( this->getActivePlayer() != -1 ) {
@@ -2115,14 +2491,19 @@ void Sector::update(int client_player) {
 								this->buildings[i]->killIthDefender(j);
 								this->nuked = false;
 								if( this == gamestate->getCurrentSector() ) {
-									if( game_g->explosions[0] != NULL ) {
-										int w = game_g->explosions[0]->getScaledWidth();
-										int h = game_g->explosions[0]->getScaledHeight();
-										gamestate->explosionEffect( buildings[i]->getTurretButton(j)->getXCentre() - w/2, buildings[i]->getTurretButton(j)->getYCentre() - h/2);
+									if( game->explosions[0] != NULL ) {
+										int w = game->explosions[0]->getScaledWidth();
+										int h = game->explosions[0]->getScaledHeight();
+										SectorEffect effect(SectorEffect::TYPE_EXPLOSION_EFFECT);
+										effect.x = buildings[i]->getTurretButton(j)->getXCentre() - w/2;
+										effect.y = buildings[i]->getTurretButton(j)->getYCentre() - h/2;
+										this->addEffect(effect);
 										int nuke_x = -1, nuke_y = -1;
 										this->getNukePos(&nuke_x, &nuke_y);
-										Image *nuke_image = game_g->nukes[this->nuke_by_player][1];
-										gamestate->explosionEffect( nuke_x + nuke_image->getScaledWidth()/2 - w/2, nuke_y + nuke_image->getScaledHeight()/2 - h/2);
+										Image *nuke_image = game->nukes[this->nuke_by_player][1];
+										effect.x = nuke_x + nuke_image->getScaledWidth()/2 - w/2;
+										effect.y = nuke_y + nuke_image->getScaledHeight()/2 - h/2;
+										this->addEffect(effect);
 									}
 								}
 							}
@@ -2132,8 +2513,7 @@ void Sector::update(int client_player) {
 			}
 
 			if( this->nuked ) {
-				playSample(game_g->s_explosion, SOUND_CHANNEL_FX);
-				game_g->s_explosion->setVolume(0.25f); // needed so we can hear speech sample over the explosion
+				this->addSampleEffect(game->s_explosion, SOUND_CHANNEL_FX, 0.25f); // reduced volume needed so we can hear speech sample over the explosion
 				if( this->getActivePlayer() != -1 ) {
 					this->destroyTower(true, client_player);
 				}
@@ -2147,12 +2527,12 @@ void Sector::update(int client_player) {
 					// bit of a hacky way of finding trees...
 					bool is_tree = false;
 					for(int i=0;i<n_trees_c && !is_tree;i++) {
-						if( image == game_g->icon_trees[i][0] ) {
+						if( image == game->icon_trees[i][0] ) {
 							is_tree = true;
 						}
 					}
 					if( is_tree ) {
-						feature->setImage(game_g->icon_trees[2], 1);
+						feature->setImage(game->icon_trees[2], 1);
 						 ++iter;
 					}
 					else {
@@ -2160,21 +2540,21 @@ void Sector::update(int client_player) {
 					}
 				}
 				// now add some new features
-				int n_clutter = game_g->icon_clutter_nuked.size() > 0 ? (1 + rand() % 4) : 0;
+				int n_clutter = game->icon_clutter_nuked.size() > 0 ? (1 + this->random_cosmetic.rand() % 4) : 0;
 				for(int i=0;i<n_clutter;i++) {
-					int land_width = game_g->land[0]->getScaledWidth() - 32;
-					int land_height = game_g->land[0]->getScaledHeight() - 32;
-					int xpos = offset_land_x_c + rand() % land_width;
-					int ypos = offset_land_y_c + rand() % land_height;
-					Image **image_ptr = &game_g->icon_clutter_nuked[rand() % game_g->icon_clutter_nuked.size()];
+					int land_width = game->land[0]->getScaledWidth() - 32;
+					int land_height = game->land[0]->getScaledHeight() - 32;
+					int xpos = offset_land_x_c + this->random_cosmetic.rand() % land_width;
+					int ypos = offset_land_y_c + this->random_cosmetic.rand() % land_height;
+					Image **image_ptr = &game->icon_clutter_nuked[this->random_cosmetic.rand() % game->icon_clutter_nuked.size()];
 					Feature *feature = new Feature(image_ptr, 1, xpos, ypos);
 					this->features.push_back(feature);
 				}
 				if( this == gamestate->getCurrentSector() ) {
 					//((PlayingGameState *)gamestate)->refreshSoldiers(true);
 					//((PlayingGameState *)gamestate)->whiteFlash();
-					gamestate->refreshSoldiers(true);
-					gamestate->whiteFlash();
+					this->addEffect(SectorEffect::TYPE_REFRESH_SOLDIERS);
+					this->addEffect(SectorEffect::TYPE_WHITE_FLASH);
 				}
 				if( this->isShutdown() ) {
 					// shutdown sectors are never marked as "nuked"
@@ -2185,23 +2565,160 @@ void Sector::update(int client_player) {
 			this->nuke_by_player = -1;
 			this->nuke_time = -1;
 			this->nuke_defence_animation = false;
+			this->mapIndexChanged(); // armies can't move out of a nuked sector
+			this->appearanceChanged(); // the tower and features may have gone
 		}
 	}
 }
 
+/** Updates the particle systems. This isn't done in update(), as they share the game's cosmetic random
+ *  stream, so must be done in order on the main thread.
+ */
+void Sector::updateParticleSystems() {
+	if( this->smokeParticleSystem != NULL && this->player != -1 && !this->is_shutdown ) {
+		// smoke is only for sectors owned by a player
+		this->smokeParticleSystem->update();
+	}
+	if( this->jetParticleSystem != NULL ) {
+		this->jetParticleSystem->update();
+	}
+	if( this->nukeParticleSystem != NULL ) {
+		this->nukeParticleSystem->update();
+	}
+	if( this->nukeDefenceParticleSystem != NULL ) {
+		this->nukeDefenceParticleSystem->update();
+	}
+}
+
+void Sector::addEffect(const SectorEffect &effect) {
+	if( this->defer_effects )
+		this->effects.push_back(effect);
+	else
+		this->applyEffect(effect);
+}
+
+void Sector::addSampleEffect(Sample *sample, int channel, float volume) {
+	SectorEffect effect(SectorEffect::TYPE_SAMPLE);
+	effect.sample = sample;
+	effect.channel = channel;
+	effect.volume = volume;
+	this->addEffect(effect);
+}
+
+/** Applies the effects queued while effects were deferred, in the order they were made.
+ */
+void Sector::applyEffects() {
+	for(size_t i=0;i<this->effects.size();i++) {
+		this->applyEffect(this->effects[i]);
+	}
+	this->effects.clear();
+}
+
+/** Called when the sector's owner, which players have an army here, or whether it's nuked, may have changed. The
+ *  map's index is updated straight away, unless effects are deferred, in which case it waits for updateMapIndex().
+ */
+void Sector::mapIndexChanged() {
+	if( this->defer_effects )
+		this->map_index_due = true;
+	else
+		game->getMap()->updateIndex(this);
+}
+
+void Sector::updateMapIndex() {
+	if( this->map_index_due ) {
+		this->map_index_due = false;
+		game->getMap()->updateIndex(this);
+	}
+}
+
+void Sector::applyEffect(const SectorEffect &effect) {
+	switch( effect.type ) {
+	case SectorEffect::TYPE_SAMPLE:
+		playSample(effect.sample, effect.channel);
+		if( effect.volume >= 0.0f ) {
+			effect.sample->setVolume(effect.volume);
+		}
+		break;
+	case SectorEffect::TYPE_FLASHING_SQUARE:
+		gamestate->setFlashingSquare(this->xpos, this->ypos);
+		break;
+	case SectorEffect::TYPE_REFRESH_PANEL:
+		gamestate->getGamePanel()->refresh();
+		break;
+	case SectorEffect::TYPE_REFRESH_STOCKS:
+		gamestate->getGamePanel()->refreshCanDesign();
+		gamestate->getGamePanel()->refreshDesignInventions();
+		gamestate->getGamePanel()->refreshManufactureInventions();
+		break;
+	case SectorEffect::TYPE_REFRESH_SHUTDOWN:
+		gamestate->getGamePanel()->refreshShutdown();
+		break;
+	case SectorEffect::TYPE_RESET_PANEL:
+		gamestate->getGamePanel()->setPage(GamePanel::STATE_SECTORCONTROL);
+		gamestate->getGamePanel()->setup();
+		break;
+	case SectorEffect::TYPE_REFRESH_SOLDIERS:
+		gamestate->refreshSoldiers(true);
+		break;
+	case SectorEffect::TYPE_BIRTHS:
+		game->players[effect.player]->registerBirths(effect.value);
+		break;
+	case SectorEffect::TYPE_DEATHS:
+		for(int i=0;i<effect.value;i++) {
+			gamestate->registerDeath(effect.player, effect.x);
+		}
+		break;
+	case SectorEffect::TYPE_DEATH_EFFECT:
+		gamestate->deathEffect(effect.x, effect.y);
+		break;
+	case SectorEffect::TYPE_EXPLOSION_EFFECT:
+		gamestate->explosionEffect(effect.x, effect.y);
+		break;
+	case SectorEffect::TYPE_WHITE_FLASH:
+		gamestate->whiteFlash();
+		break;
+	case SectorEffect::TYPE_CLEAR_SELECTED_ARMY:
+		if( gamestate->getSelectedArmy() == this->getArmy(effect.player) ) {
+			gamestate->clearSelectedArmy();
+		}
+		break;
+	case SectorEffect::TYPE_ADD_BUILDING:
+		// the building may have been destroyed again since
+		if( this == gamestate->getCurrentSector() && this->buildings[effect.value] == effect.building ) {
+			gamestate->addBuilding(effect.building);
+		}
+		break;
+	case SectorEffect::TYPE_TOWER_DESTROYED:
+		// only announced if the player has other sectors
+		if( effect.sample != NULL && ( effect.value != 0 || game->playerAlive(effect.player) ) ) {
+			playSample(effect.sample, effect.channel);
+			gamestate->setFlashingSquare(this->xpos, this->ypos);
+		}
+		break;
+	case SectorEffect::TYPE_ECONOMY_EVENT:
+		game->getMap()->scheduleEconomyEvent(effect.x, this, effect.value);
+		break;
+	default:
+		ASSERT(0);
+		break;
+	}
+}
+
 bool Sector::mineElement(int client_player, Id i) {
-	Element *element = game_g->elements[(int)i];
+	this->economyChanged();
+	Element *element = game->elements[(int)i];
 	ASSERT( this->elements[(int)i] > 0 );
 	this->elementstocks[(int)i]++;
 	this->elements[(int)i]--;
+	this->invalidateDesignCache();
 	if( this->elements[(int)i] == 0 ) {
 		if( element->getType() != Element::GATHERABLE )
 			this->setMiners(i, 0);
-		LOG("Sector [%d: %d, %d] running out of element %d : %s\n", player, xpos, ypos, (int)i, game_g->elements[(int)i]->getName());
+		LOG("Sector [%d: %d, %d] running out of element %d : %s\n", player, xpos, ypos, (int)i, game->elements[(int)i]->getName());
 		if( this->player == client_player ) {
-			playSample(game_g->s_running_out_of_elements);
+			this->addSampleEffect(game->s_running_out_of_elements, SOUND_CHANNEL_SAMPLES);
 			//((PlayingGameState *)gamestate)->setFlashingSquare(this->xpos, this->ypos);
-			gamestate->setFlashingSquare(this->xpos, this->ypos);
+			this->addEffect(SectorEffect::TYPE_FLASHING_SQUARE);
 		}
 		return true;
 	}
@@ -2209,6 +2726,7 @@ bool Sector::mineElement(int client_player, Id i) {
 }
 
 void Sector::invent(int client_player) {
+	this->economyChanged();
 	ASSERT(current_design != NULL);
 	bool done_sound = false;
 	if( this->player != client_player )
@@ -2216,15 +2734,16 @@ void Sector::invent(int client_player) {
 	ASSERT( !this->inventions_known[ current_design->getInvention()->getType() ][ current_design->getInvention()->getEpoch() ] );
 	this->inventions_known[ current_design->getInvention()->getType() ][ current_design->getInvention()->getEpoch() ] = true;
 	this->designs.push_back( current_design );
+	this->invalidateDesignCache();
 
-	if( this->epoch < game_g->getStartEpoch() + 3 && epoch < n_epochs_c-1 ) {
+	if( this->epoch < game->getStartEpoch() + 3 && epoch < n_epochs_c-1 ) {
 		//int levels[4] = {0, 0, 0, 0};
 		int score = 0;
 		for(int i=0;i<3;i++) {
 			int val = 1;
 			for(int j=0;j<4;j++) {
-				if( game_g->getStartEpoch()+j < n_epochs_c ) {
-					if( this->inventions_known[i][game_g->getStartEpoch()+j] ) {
+				if( game->getStartEpoch()+j < n_epochs_c ) {
+					if( this->inventions_known[i][game->getStartEpoch()+j] ) {
 						//levels[j]++;
 						score += val;
 					}
@@ -2233,7 +2752,7 @@ void Sector::invent(int client_player) {
 			}
 		}
 		score = ( score + 3 ) / 3;
-		int new_epoch = game_g->getStartEpoch();
+		int new_epoch = game->getStartEpoch();
 		while( score > 1 ) {
 			new_epoch++;
 			score /= 2;
@@ -2241,53 +2760,57 @@ void Sector::invent(int client_player) {
 		if( new_epoch > this->epoch ) {
 			// advance a tech level!
 			this->epoch = new_epoch;
+			this->appearanceChanged();
 			LOG("Sector [%d: %d, %d] has advanced to tech level %d\n", player, xpos, ypos, epoch);
 			if( !done_sound ) {
-				playSample(game_g->s_advanced_tech);
+				this->addSampleEffect(game->s_advanced_tech, SOUND_CHANNEL_SAMPLES);
 				done_sound = true;
 			}
 		}
 	}
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 	if( !done_sound ) {
 		if( current_design->isErgonomicallyTerrific() )
-			playSample(game_g->s_ergo);
+			this->addSampleEffect(game->s_ergo, SOUND_CHANNEL_SAMPLES);
 		else
-			playSample(game_g->s_design_is_ready);
+			this->addSampleEffect(game->s_design_is_ready, SOUND_CHANNEL_SAMPLES);
 	}
 	if( this->player == client_player ) {
 		//((PlayingGameState *)gamestate)->setFlashingSquare(this->xpos, this->ypos);
-		gamestate->setFlashingSquare(this->xpos, this->ypos);
+		this->addEffect(SectorEffect::TYPE_FLASHING_SQUARE);
 	}
 	this->setCurrentDesign(NULL);
 }
 
 void Sector::buildBuilding(Type type) {
+	this->economyChanged();
 	LOG("Sector [%d: %d, %d] has built building type %d\n", player, xpos, ypos, (int)type);
 	this->setBuilders(type, 0);
 	this->built[(int)type] = 0;
 	if( type == BUILDING_MINE ) {
-		this->buildings[BUILDING_MINE] = new Building(gamestate, this, BUILDING_MINE);
+		this->buildings[BUILDING_MINE] = new Building(game, gamestate, this, BUILDING_MINE);
 	}
 	else if( type == BUILDING_FACTORY ) {
-		this->buildings[BUILDING_FACTORY] = new Building(gamestate, this, BUILDING_FACTORY);
+		this->buildings[BUILDING_FACTORY] = new Building(game, gamestate, this, BUILDING_FACTORY);
 	}
 	else if( type == BUILDING_LAB ) {
-		this->buildings[BUILDING_LAB] = new Building(gamestate, this, BUILDING_LAB);
+		this->buildings[BUILDING_LAB] = new Building(game, gamestate, this, BUILDING_LAB);
 	}
 	else {
 		// error
 		LOG("###Didn't expect completion of building type %d\n", (int)type);
 		ASSERT(0);
 	}
+	this->appearanceChanged();
+	this->invalidateDesignCache();
 	updateForNewBuilding(type);
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
 		//((PlayingGameState *)gamestate)->addBuilding( this->buildings[(Type)i] ); // now done in Building constructor
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 }
 
@@ -2370,12 +2893,14 @@ int Sector::getBuildingCost(Type type, int building_player) {
 
 void Sector::setEpoch(int epoch) {
 	LOG("Sector::setEpoch(%d) [%d: %d,%d]\n", epoch, player, xpos, ypos);
+	this->economyChanged();
 	ASSERT_EPOCH(epoch);
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 	this->epoch = epoch;
+	this->appearanceChanged();
 }
 
 int Sector::getEpoch() const {
@@ -2391,13 +2916,13 @@ int Sector::getBuildingEpoch() const {
 	int eph = this->getEpoch();
 	/*if( this->is_shutdown )
 		eph = end_epoch_c;
-	else if( game_g->getStartEpoch() == end_epoch_c )
+	else if( game->getStartEpoch() == end_epoch_c )
 		eph = end_epoch_c;
 	else if( eph == n_epochs_c-1 )
 		eph = n_epochs_c-2;*/
 	if( this->is_shutdown )
 		eph = n_epochs_c-1;
-	else if( game_g->getStartEpoch() == end_epoch_c )
+	else if( game->getStartEpoch() == end_epoch_c )
 		eph = n_epochs_c-1;
 	else if( eph == n_epochs_c-1 )
 		eph = n_epochs_c-2;
@@ -2417,14 +2942,15 @@ int Sector::getActivePlayer() const {
 
 void Sector::setCurrentDesign(Design *current_design) {
 	//LOG("Sector::setCurrentDesign(%d : %s) [%d: %d, %d]\n", current_design, current_design==NULL?"NONE":current_design->getInvention()->getName(), player, xpos, ypos);
+	this->economyChanged();
 	ASSERT( current_design == NULL || current_design->getInvention()->getEpoch() <= lab_epoch_c || this->getBuilding(BUILDING_LAB ) != NULL );
 	this->current_design = current_design;
 	this->n_designers = 0;
 	this->researched = 0;
-	this->researched_lasttime = game_g->getGameTime();
+	this->researched_lasttime = game->getGameTime();
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 }
 
@@ -2435,9 +2961,10 @@ const Design *Sector::getCurrentDesign() const {
 
 void Sector::setCurrentManufacture(Design *current_manufacture) {
 	//LOG("Sector::setCurrentManufacture(%d : %s) [%d: %d, %d]\n", current_manufacture, current_manufacture==NULL?"NONE":current_manufacture->getInvention()->getName(), player, xpos, ypos);
+	this->economyChanged();
 /*#ifdef _DEBUG
 	LOG("### Sector::setCurrentManufacture a\n");
-	game_g->getMap()->checkSectors();
+	game->getMap()->checkSectors();
 #endif*/
 	ASSERT( current_manufacture == NULL || this->getBuilding(BUILDING_FACTORY ) != NULL );
 	ASSERT( current_manufacture == NULL || current_manufacture->getInvention()->getEpoch() >= factory_epoch_c );
@@ -2446,18 +2973,18 @@ void Sector::setCurrentManufacture(Design *current_manufacture) {
 	this->setWorkers(0); // call to also set the particle system rate
 	this->n_famount = 1;
 	this->manufactured = 0;
-	this->manufactured_lasttime = game_g->getGameTime();
+	this->manufactured_lasttime = game->getGameTime();
 /*#ifdef _DEBUG
 	LOG("### Sector::setCurrentManufacture b\n");
-	game_g->getMap()->checkSectors();
+	game->getMap()->checkSectors();
 #endif*/
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 /*#ifdef _DEBUG
 	LOG("### Sector::setCurrentManufacture c\n");
-	game_g->getMap()->checkSectors();
+	game->getMap()->checkSectors();
 #endif*/
 }
 
@@ -2468,7 +2995,8 @@ const Design *Sector::getCurrentManufacture() const {
 
 void Sector::inventionTimeLeft(int *halfdays,int *hours) const {
 	//LOG("Sector::inventionTimeLeft()\n");
-	int cost = this->getInventionCost() - this->researched;
+	int researched = this->researched + economyTicks(this->researched_lasttime, this->economy_time) * this->getDesigners();
+	int cost = this->getInventionCost() - researched;
 	int time = cost / this->getDesigners();
 	*halfdays = (int)( time / 12 );
 	*hours = time % 12;
@@ -2476,7 +3004,8 @@ void Sector::inventionTimeLeft(int *halfdays,int *hours) const {
 
 void Sector::manufactureTimeLeft(int *halfdays,int *hours) const {
 	//LOG("Sector::manufactureTimeLeft()\n");
-	int cost = this->getManufactureCost() - this->manufactured;
+	int manufactured = this->manufactured + economyTicks(this->manufactured_lasttime, this->economy_time) * this->getWorkers();
+	int cost = this->getManufactureCost() - manufactured;
 	int time = cost / this->getWorkers();
 	*halfdays = (int)( time / 12 );
 	*hours = time % 12;
@@ -2498,6 +3027,7 @@ bool Sector::inventionKnown(Invention::Type type,int epoch) const {
 
 // Set Elements Remaining
 void Sector::setElements(Id id,int n_elements) {
+	this->economyChanged();
 	ASSERT_ELEMENT_ID(id);
 	this->elements[(int)id] = n_elements * element_multiplier_c;
 }
@@ -2515,9 +3045,11 @@ bool Sector::anyElements(Id id) const {
 }
 
 void Sector::reduceElementStocks(Id id,int reduce) {
+	this->economyChanged();
 	// reduce should be already multiplied by element_multiplier_c !
 	ASSERT_ELEMENT_ID(id);
 	this->elementstocks[(int)id] -= reduce;
+	this->invalidateDesignCache();
 }
 
 void Sector::getElementStocks(int *n,int *fraction,Id id) const {
@@ -2547,8 +3079,9 @@ void Sector::buildingTowerTimeLeft(int player,int *halfdays,int *hours) const {
 void Sector::buildingTimeLeft(Type type,int *halfdays,int *hours) const {
 	//LOG("Sector::buildingTimeLeft(%d)\n",type);
 	ASSERT(type != BUILDING_TOWER);
-	int cost = getBuildingCost(type, this->player) - this->built[type];
 	int n_builders = this->getBuilders(type);
+	int built = this->built[type] + economyTicks(this->built_lasttime, this->economy_time) * n_builders;
+	int cost = getBuildingCost(type, this->player) - built;
 	ASSERT(n_builders != 0);
 	int time = cost / n_builders;
 	*halfdays = (int)( time / 12 );
@@ -2557,29 +3090,32 @@ void Sector::buildingTimeLeft(Type type,int *halfdays,int *hours) const {
 
 void Sector::setPopulation(int population) {
 	//LOG("Sector::setPopulation(%d)\n",population);
+	this->economyChanged();
 	ASSERT(population >= 0);
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 	this->population = population;
 }
 
 void Sector::setDesigners(int n_designers) {
 	//LOG("Sector::setDesigners(%d)\n",n_designers);
+	this->economyChanged();
 	ASSERT( n_designers == 0 || this->current_design != NULL );
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 	this->n_designers = n_designers;
 }
 
 void Sector::setWorkers(int n_workers) {
 	//LOG("Sector::setWorkers(%d)\n",n_workers);
+	this->economyChanged();
 	ASSERT( n_workers == 0 || this->current_manufacture != NULL );
 	if( this == gamestate->getCurrentSector() ) {
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 	this->n_workers = n_workers;
 	this->updateWorkers();
@@ -2601,33 +3137,36 @@ void Sector::updateWorkers() {
 
 void Sector::setFAmount(int n_famount) {
 	//LOG("Sector::setFAmount(%d) [%d,%d]\n", n_famount, xpos, ypos);
+	this->economyChanged();
 	ASSERT(n_famount <= infinity_c);
 	ASSERT( this->current_manufacture != NULL );
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 	this->n_famount = n_famount;
 }
 
 void Sector::setMiners(Id id,int n_miners) {
 	//LOG("Sector::setMiners(%d,%d)\n",id,n_miners);
+	this->economyChanged();
 	ASSERT_ELEMENT_ID(id);
-	ASSERT( game_g->elements[id]->getType() != Element::GATHERABLE );
+	ASSERT( game->elements[id]->getType() != Element::GATHERABLE );
 	ASSERT( n_miners == 0 || canMine(id) );
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 	this->n_miners[id] = n_miners;
 }
 
 void Sector::setBuilders(Type type,int n_builders) {
 	//LOG("Sector::setBuilders(%d,%d)\n",type,n_builders);
+	this->economyChanged();
 	ASSERT( n_builders == 0 || canBuild(type) );
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 	this->n_builders[type] = n_builders;
 }
@@ -2712,7 +3251,7 @@ bool Sector::enemiesPresent(int player,bool include_unarmed) const {
 	ASSERT( player != -1 );
 	bool rtn = false;
 	for(int i=0;i<n_players_c && !rtn;i++) {
-		if( i != player && !Player::isAlliance(i, player) ) {
+		if( i != player && !game->isAlliance(i, player) ) {
 			if( this->getArmy(i)->any(include_unarmed) ) {
 				rtn = true;
 			}
@@ -2727,7 +3266,7 @@ void Sector::returnAssembledArmy() {
 	returnArmy(assembled_army);
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
 	}
 }
 
@@ -2739,13 +3278,15 @@ bool Sector::returnArmy() {
 
 bool Sector::returnArmy(Army *army) {
 	//LOG("Sector::returnArmy(%d)\n",army);
+	this->economyChanged();
 	ASSERT( this->player != -1 );
 
 	Sector *src_sector = army->getSector();
-	bool temp[map_width_c][map_height_c];
-	game_g->getMap()->canMoveTo(temp, src_sector->xpos, src_sector->ypos, army->getPlayer());
-	//bool adj = game_g->getMap()->temp[this->xpos][this->ypos];
-	bool adj = temp[this->xpos][this->ypos];
+	bool adj = true;
+	if( src_sector != this ) {
+		// n.b., not needed for an army already in this sector, which also means we don't look at other sectors while sectors are being updated
+		adj = game->getMap()->canMoveTo(src_sector->xpos, src_sector->ypos, this->xpos, this->ypos, army->getPlayer());
+	}
 	bool moved_all = true;
 
 	if( !army->canLeaveSafely() ) {
@@ -2761,7 +3302,7 @@ bool Sector::returnArmy(Army *army) {
 				moved_all = false;
 			}
 			else {
-				int n_men = ( i==n_epochs_c ? 1 : game_g->invention_weapons[i]->getNMen() );
+				int n_men = ( i==n_epochs_c ? 1 : game->invention_weapons[i]->getNMen() );
 				this->population += army->getSoldiers(i) * n_men;
 				if( i != n_epochs_c ) {
 					// unarmed men are never stored in the stored_army (as not actually a weapon)
@@ -2774,8 +3315,8 @@ bool Sector::returnArmy(Army *army) {
 
 	if( this == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->getGamePanel()->refresh();
-		gamestate->getGamePanel()->refresh();
-		gamestate->refreshSoldiers(true);
+		this->addEffect(SectorEffect::TYPE_REFRESH_PANEL);
+		this->addEffect(SectorEffect::TYPE_REFRESH_SOLDIERS);
 	}
 	return moved_all;
 }
@@ -2788,10 +3329,7 @@ bool Sector::moveArmy(Army *army) {
 		return false;
 	}
 	Sector *src_sector = army->getSector();
-	bool temp[map_width_c][map_height_c];
-	game_g->getMap()->canMoveTo(temp, src_sector->xpos, src_sector->ypos, army->getPlayer());
-	//bool adj = game_g->getMap()->temp[this->xpos][this->ypos];
-	bool adj = temp[this->xpos][this->ypos];
+	bool adj = game->getMap()->canMoveTo(src_sector->xpos, src_sector->ypos, this->xpos, this->ypos, army->getPlayer());
 	bool moved_all = true;
 	if( !army->canLeaveSafely() ) {
 		// retreat
@@ -2815,13 +3353,14 @@ bool Sector::moveArmy(Army *army) {
 
 	if( this == gamestate->getCurrentSector() || army->getSector() == gamestate->getCurrentSector() ) {
 		//((PlayingGameState *)gamestate)->refreshSoldiers(true);
-		gamestate->refreshSoldiers(true);
+		this->addEffect(SectorEffect::TYPE_REFRESH_SOLDIERS);
 	}
 
 	return moved_all;
 }
 
 void Sector::evacuate() {
+	this->economyChanged();
 	for(int i=0;i<N_BUILDINGS;i++) {
 		Building *building = this->getBuilding((Type)i);
 		if( building != NULL ) {
@@ -2844,7 +3383,7 @@ void Sector::evacuate() {
 }
 
 void Sector::assembleAll(bool include_unarmed) {
-	for(int i=n_epochs_c-1;i>=game_g->getStartEpoch();i--) {
+	for(int i=n_epochs_c-1;i>=game->getStartEpoch();i--) {
 		if( i == nuclear_epoch_c )
 			continue;
 		while( this->assembleArmy(i, 1) ) {
@@ -3015,7 +3554,7 @@ void Sector::loadStateParseXMLNode(const TiXmlNode *parent) {
 								throw std::runtime_error("sector invalid player");
 							}
 							if( player != -1 ) {
-								this->assembled_army = new Army(gamestate, this, this->getPlayer());
+								this->assembled_army = new Army(game, gamestate, this, this->getPlayer());
 							}
 						}
 						else if( strcmp(attribute_name, "is_shutdown") == 0 ) {
@@ -3210,7 +3749,7 @@ void Sector::loadStateParseXMLNode(const TiXmlNode *parent) {
 						throw std::runtime_error("building invalid building_id");
 					}
 					if( buildings[building_id] == NULL ) {
-						this->buildings[building_id] = new Building(gamestate, this, (Type)building_id);
+						this->buildings[building_id] = new Building(game, gamestate, this, (Type)building_id);
 						updateForNewBuilding((Type)building_id);
 					}
 					this->buildings[building_id]->loadStateParseXMLNode(parent);
@@ -3218,7 +3757,7 @@ void Sector::loadStateParseXMLNode(const TiXmlNode *parent) {
 				}
 				else if( strcmp(element_name, "stored_army") == 0 ) {
 					if( stored_army == NULL ) {
-						this->stored_army = new Army(gamestate, this, this->getPlayer());
+						this->stored_army = new Army(game, gamestate, this, this->getPlayer());
 					}
 					this->stored_army->loadStateParseXMLNode(parent);
 					read_children = false;
@@ -3315,6 +3854,9 @@ void Sector::loadStateParseXMLNode(const TiXmlNode *parent) {
 	for(const TiXmlNode *child=parent->FirstChild();child!=NULL && read_children;child=child->NextSibling())  {
 		loadStateParseXMLNode(child);
 	}
+	this->invalidateDesignCache(); // stocks, designs or buildings may have been loaded
+	this->mapIndexChanged(); // as may the player and armies
+	this->appearanceChanged();
 }
 
 void Sector::printDebugInfo() const {
@@ -3334,14 +3876,14 @@ void Sector::printDebugInfo() const {
 			printf("    manufacturing %s\n", current_manufacture->getInvention()->getName());
 		for(int i=0;i<N_ID;i++) {
 			if( this->canMine((Id)i) ) {
-				Element *element = game_g->elements[i];
+				Element *element = game->elements[i];
 				if( element->getType() != Element::GATHERABLE )
 					printf("   mining %s %d\n", element->getName(), this->getMiners((Id)i));
 			}
 		}
 		for(int i=0;i<N_ID;i++) {
 			int stocks = this->elementstocks[i];
-			Element *element = game_g->elements[i];
+			Element *element = game->elements[i];
 			if( stocks > 0 )
 				printf("stocks of %s: %d\n", element->getName(), stocks);
 		}
@@ -3353,9 +3895,9 @@ void Sector::printDebugInfo() const {
 
 bool Design::setupDesigns() {
 	Design *design = NULL;
-	Weapon **invention_weapons = game_g->invention_weapons;
-	Invention **invention_defences = game_g->invention_defences;
-	Invention **invention_shields = game_g->invention_shields;
+	Weapon **invention_weapons = Game::invention_weapons;
+	Invention **invention_defences = Game::invention_defences;
+	Invention **invention_shields = Game::invention_shields;
 	// Weapons
 	// 0 - rock (1.5)
 	// rock, wood, bone, slate, herbirite, valium, bethlium, parasite, moonlite, aquarium, solarium, aruldite
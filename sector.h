@@ -7,12 +7,15 @@ namespace Gigalomania {
 	class Image;
 	class PanelPage;
 	class Button;
+	class Sample;
 }
 
 using namespace Gigalomania;
 
 class Feature;
 class Sector;
+class Building;
+class Game;
 class PlayingGameState;
 class Invention;
 
@@ -23,6 +26,7 @@ using std::stringstream;
 #include "TinyXML/tinyxml.h"
 
 #include "common.h"
+#include "utils.h"
 
 const int element_multiplier_c = 2;
 const int n_gatherable_rate_c = 500;
@@ -31,6 +35,7 @@ const int growth_rate_c = 200; // higher is slower; beware of having a growth ra
 const int mine_rate_c = 30; // higher is slower
 const int combat_rate_c = 50; // higher is slower combat
 const int bombard_rate_c = 5; // higher is slower damage
+const int max_combat_step_c = 200; // longest time step that combat is resolved over in one go, before the strengths are recalculated
 const int max_gatherables_stored_c = 22;
 
 bool isAirUnit(int epoch);
@@ -101,12 +106,22 @@ public:
 
 class Army {
 	int soldiers[n_epochs_c+1]; // unarmed men are soldiers[n_epochs_c]; // saved
+	// running totals over all the soldiers, kept up to date by changeSoldiers(); not saved
+	int total;
+	int total_men;
+	int strength;
+	int bombard_strength;
 	int player; // no need to save, saved by caller
 	Sector *sector; // no need to save
+	Game *game;
 	PlayingGameState *gamestate;
 
+	void changeSoldiers(int i,int n);
+	bool totalsValid() const;
+	void presenceChanged();
+
 public:
-	Army(PlayingGameState *gamestate, Sector *sector, int player);
+	Army(Game *game, PlayingGameState *gamestate, Sector *sector, int player);
 	~Army() {
 	}
 
@@ -128,16 +143,15 @@ public:
 	void add(Army *army);
 	void remove(int i,int n);
 	void kill(int index);
-	void empty() {
-		for(int i=0;i<n_epochs_c+1;i++)
-			soldiers[i] = 0;
-	}
+	void kill(const int n_killed[n_epochs_c+1]);
+	int findSoldier(int index, const int n_killed[n_epochs_c+1]) const;
+	void empty();
 	bool canLeaveSafely() const;
 	void retreat(bool only_air);
 
 	int getIndividualStrength(int i) const;
-	static int getIndividualStrength(int player, int i);
-	static int getIndividualBombardStrength(int i);
+	static int getIndividualStrength(const Game *game, int player, int i);
+	static int getIndividualBombardStrength(const Game *game, int i);
 
 	void saveState(stringstream &stream) const;
 	void loadStateParseXMLNode(const TiXmlNode *parent);
@@ -172,17 +186,26 @@ class Design {
 	Invention *invention;
 	bool ergonomically_terrific;
 	int cost[N_ID];
+	// most designs only need a few elements, so these are also listed in element order
+	int n_costs;
+	Id cost_ids[N_ID];
 	int save_id;
 
 public:
 	Design(Invention *invention,bool ergonomically_terrific);
 
-	void setCost(Id id, float cost) {
-		this->cost[(int)id] = (int)(cost * element_multiplier_c);
-	}
-	int getCost(Id id) {
+	void setCost(Id id, float cost);
+	int getCost(Id id) const {
 		return this->cost[(int)id];
 	}
+	int getNCosts() const {
+		return this->n_costs;
+	}
+	Id getCostId(int i) const {
+		return this->cost_ids[i];
+	}
+	bool canAfford(const int stocks[N_ID]) const;
+	bool canAfford(const int stocks[N_ID], const int extra_stocks[N_ID]) const;
 	bool isErgonomicallyTerrific() const {
 		return this->ergonomically_terrific;
 	}
@@ -270,10 +293,11 @@ private:
 	int turret_man_frame[max_building_turrets_c];
 	PanelPage *building_button;
 	PanelPage *turret_buttons[max_building_turrets_c];
+	Game *game;
 	PlayingGameState *gamestate;
 
 public:
-	Building(PlayingGameState *gamestate, Sector *sector, Type type);
+	Building(Game *game, PlayingGameState *gamestate, Sector *sector, Type type);
 	~Building();
 
 	Type getType() const {
@@ -333,6 +357,44 @@ public:
 	void loadStateParseXMLNode(const TiXmlNode *parent);
 };
 
+/** A change that updating a sector makes outside of the sector: sounds, the user interface, player
+ *  statistics and the map's event queue. While sectors are being updated in parallel, these are queued
+ *  by each sector, then applied on the main thread in sector order; otherwise they're applied at once.
+ */
+class SectorEffect {
+public:
+	enum Type {
+		TYPE_SAMPLE = 0,
+		TYPE_FLASHING_SQUARE = 1,
+		TYPE_REFRESH_PANEL = 2,
+		TYPE_REFRESH_STOCKS = 3,
+		TYPE_REFRESH_SHUTDOWN = 4,
+		TYPE_RESET_PANEL = 5,
+		TYPE_REFRESH_SOLDIERS = 6,
+		TYPE_BIRTHS = 7,
+		TYPE_DEATHS = 8,
+		TYPE_DEATH_EFFECT = 9,
+		TYPE_EXPLOSION_EFFECT = 10,
+		TYPE_WHITE_FLASH = 11,
+		TYPE_CLEAR_SELECTED_ARMY = 12,
+		TYPE_ADD_BUILDING = 13,
+		TYPE_TOWER_DESTROYED = 14,
+		TYPE_ECONOMY_EVENT = 15
+	};
+
+	Type type;
+	Sample *sample;
+	int channel;
+	float volume; // if not negative, the volume to set after playing the sample
+	Building *building;
+	int player;
+	int value;
+	int x, y;
+
+	SectorEffect(Type type) : type(type), sample(NULL), channel(0), volume(-1.0f), building(NULL), player(-1), value(0), x(0), y(0) {
+	}
+};
+
 class Sector {
 	vector<Feature *> features;
 	int xpos, ypos; // saved
@@ -362,7 +424,7 @@ class Sector {
 	int manufactured; // saved
 	int manufactured_lasttime; // saved
 	int growth_lasttime; // saved
-	int mined_lasttime; // saved
+	int mined_lasttime; // time that partial_elementstocks were last brought up to date // saved
 	int built_towers[n_players_c]; // for neutral sectors // saved
 	int built[N_BUILDINGS]; // NB: built[BUILDING_TOWER] should never be used // saved
 	int built_lasttime; // saved
@@ -371,6 +433,19 @@ class Sector {
 	int elementstocks[N_ID]; // elements mined // saved
 	int partial_elementstocks[N_ID]; // saved
 
+	// the economy (research, manufacturing, mining, building, growth) is only processed when it's due - see Map::scheduleEconomyEvent()
+	int economy_time; // game time of the most recent call to doPlayer(), or -1; not saved
+	bool economy_due; // not saved
+	int economy_generation; // used to ignore out of date scheduled events; not saved
+
+	Random random_simulation; // sector's own random streams, so results don't depend on the order sectors are updated in
+	Random random_cosmetic;
+	bool defer_effects;
+	vector<SectorEffect> effects; // effects waiting to be applied, when defer_effects is true
+	bool map_index_due; // whether the map's index needs updating for this sector, once effects are no longer deferred
+	int appearance_generation; // incremented whenever the land, features or buildings drawn for the sector change; not saved
+	void applyEffect(const SectorEffect &effect);
+
 	void initTowerStuff();
 	void consumeStocks(Design *design);
 
@@ -379,14 +454,34 @@ class Sector {
 	bool inventions_known[3][n_epochs_c]; // not saved, inferred fom designs
 	vector<Design *> designs; // saved
 
+	// results of knownDesign(), canBuildDesign() and bestDesign() for each invention, recomputed only when the
+	// stocks, designs or buildings change - see invalidateDesignCache(); not saved
+	mutable bool design_cache_valid;
+	mutable bool design_cache_disallow_nukes; // bestDesign() depends on this preference
+	mutable Design *known_designs[Invention::N_TYPES][n_epochs_c];
+	mutable Design *buildable_designs[Invention::N_TYPES][n_epochs_c];
+	mutable Design *best_designs[Invention::N_TYPES][n_epochs_c];
+	void invalidateDesignCache() {
+		this->design_cache_valid = false;
+	}
+	void updateDesignCache() const;
+	Design *calculateBestDesign(Invention::Type type,int epoch) const;
+
 	static int getBuildingCost(Type type, int building_player);
 	void destroyBuilding(Type building_type,int client_player);
 	void destroyBuilding(Type building_type,bool silent,int client_player);
 	void updateWorkers();
 
 	float getDefenceStrength() const;
-	void doCombat(int client_player);
+	void doCombat(int client_player, int looptime);
 	void doPlayer(int client_player);
+	int getGrowthPopulation() const;
+	static int economyTicks(int lasttime, int time);
+	static int economyTickEventTime(int value, int lasttime, int rate, int cost);
+	int getMiningRate(Id id) const;
+	void economyChanged();
+	int nextEconomyEventTime() const;
+	void scheduleEconomy(int time);
 
 	Design *loadStateParseXMLDesign(const TiXmlAttribute *attribute);
 
@@ -401,10 +496,11 @@ class Sector {
 	SmokeParticleSystem *nukeParticleSystem;
 	SmokeParticleSystem *nukeDefenceParticleSystem;
 
+	Game *game;
 	PlayingGameState *gamestate;
 public:
 
-	Sector(PlayingGameState *gamestate, int epoch, int xpos, int ypos, MapColour map_colour);
+	Sector(Game *game, PlayingGameState *gamestate, int epoch, int xpos, int ypos, MapColour map_colour);
 	~Sector();
 
 	void createTower(int player,int population);
@@ -440,6 +536,28 @@ public:
 	bool useShield(Building *building,int shield);
 	int getStoredShields(int shield) const;
 	void update(int client_player);
+	void updateParticleSystems();
+	void setDeferEffects(bool defer_effects) {
+		this->defer_effects = defer_effects;
+		if( !defer_effects )
+			this->updateMapIndex();
+	}
+	void addEffect(const SectorEffect &effect);
+	void addEffect(SectorEffect::Type type) {
+		this->addEffect(SectorEffect(type));
+	}
+	void addSampleEffect(Sample *sample, int channel, float volume = -1.0f);
+	void applyEffects();
+	void mapIndexChanged();
+	void updateMapIndex();
+	void appearanceChanged() {
+		this->appearance_generation++;
+	}
+	int getAppearanceGeneration() const {
+		return this->appearance_generation;
+	}
+	void catchUpEconomy();
+	void economyEvent(int generation);
 
 	int getNFeatures() const {
 		return this->features.size();
@@ -552,6 +670,7 @@ public:
 	}
 	const Army *getArmy(int player) const;
 	Army *getArmy(int player);
+	bool isFighting() const;
 	bool enemiesPresent() const;
 	bool enemiesPresentWithBombardment() const;
 	bool enemiesPresent(int player) const;
@@ -9,6 +9,7 @@
 #endif
 
 #include <vector>
+#include <queue>
 #include <string>
 #include <cassert>
 
@@ -32,6 +32,7 @@
 
 #include <cassert>
 #include <cmath> // n.b., needed on Linux at least
+#include <algorithm>
 
 #include "utils.h"
 #include "common.h"
@@ -41,10 +42,9 @@
 //const bool DEBUG = true;
 //const int DEBUGLEVEL = 4;
 
-/* Return probability (as a proportion of RAND_MAX) that at least one poisson event
-* occurred within the time_interval, given the mean number of time units per event.
+/* As poisson(), but always calculated, rather than looked up.
 */
-int poisson(int mean_ticks_per_event,int time_interval) {
+int poissonExact(int mean_ticks_per_event,int time_interval) {
 	if( mean_ticks_per_event == 0 )
 		return RAND_MAX;
 	ASSERT( mean_ticks_per_event > 0 );
@@ -52,6 +52,355 @@ int poisson(int mean_ticks_per_event,int time_interval) {
 	return prob;
 }
 
+class PoissonCacheEntry {
+public:
+	int mean_ticks_per_event; // 0 for an unused entry
+	int time_interval;
+	int prob;
+};
+
+const int poisson_cache_size_c = 256; // must be a power of 2
+static THREAD_LOCAL PoissonCacheEntry poisson_cache[poisson_cache_size_c]; // per thread, as sectors and games may be updated on several threads
+
+/* Return probability (as a proportion of RAND_MAX) that at least one poisson event
+* occurred within the time_interval, given the mean number of time units per event.
+* Only a few means are used (constants such as soldier_turn_rate_c, or rates that change only
+* when armies do), and the time interval is a frame, so results are cached by (mean, interval).
+*/
+int poisson(int mean_ticks_per_event,int time_interval) {
+	if( mean_ticks_per_event == 0 )
+		return RAND_MAX;
+	unsigned int hash = ((unsigned int)mean_ticks_per_event) * 2654435761u + ((unsigned int)time_interval) * 40503u;
+	PoissonCacheEntry *entry = &poisson_cache[ (hash >> 16) & (poisson_cache_size_c-1) ];
+	if( entry->mean_ticks_per_event != mean_ticks_per_event || entry->time_interval != time_interval ) {
+		entry->prob = poissonExact(mean_ticks_per_event, time_interval);
+		entry->mean_ticks_per_event = mean_ticks_per_event;
+		entry->time_interval = time_interval;
+	}
+	return entry->prob;
+}
+
+/* Return the number of poisson events that occurred within the time_interval, given the mean number
+* of time units per event, up to max_events (e.g., the number of soldiers that can die). random should
+* be from 0 to RAND_MAX, and is compared against poisson() as for a single test, so over short intervals
+* this is usually the same as whether poisson() gave an event.
+*/
+int poissonEvents(int max_events,int mean_ticks_per_event,int time_interval,int random) {
+	if( max_events <= 0 )
+		return 0;
+	int prob = poisson(mean_ticks_per_event, time_interval);
+	if( random > prob )
+		return 0;
+	// invert the distribution with the same random number, so that we only need the one
+	double lambda = ((double)time_interval) / ( mean_ticks_per_event > 0 ? mean_ticks_per_event : 1 );
+	double u = ((double)random) / RAND_MAX;
+	double survival = 1.0 - exp(- lambda); // probability of at least n_events
+	double log_factorial = 0.0; // log(n_events!), summed rather than using lgamma(), which isn't thread safe
+	int n_events = 1;
+	while( n_events < max_events ) {
+		// n.b., work with logs to avoid underflow for long intervals
+		log_factorial += log((double)n_events);
+		survival -= exp( n_events * log(lambda) - lambda - log_factorial );
+		if( u > survival )
+			break;
+		n_events++;
+	}
+	return n_events;
+}
+
+WorkerPool::WorkerPool(int n_threads) : mutex(NULL), work_cond(NULL), done_cond(NULL), task(NULL), data(NULL), n_indices(0), next_index(0), n_done(0), run_id(0), quit(false) {
+	LOG("WorkerPool::WorkerPool(%d)\n", n_threads);
+	mutex = SDL_CreateMutex();
+	work_cond = SDL_CreateCond();
+	done_cond = SDL_CreateCond();
+	for(int i=0;i<n_threads;i++) {
+#if SDL_MAJOR_VERSION == 1
+		SDL_Thread *thread = SDL_CreateThread(workerThread, this);
+#else
+		SDL_Thread *thread = SDL_CreateThread(workerThread, "worker", this);
+#endif
+		if( thread == NULL ) {
+			// not fatal, we'll just have fewer threads
+			LOG("failed to create worker thread: %s\n", SDL_GetError());
+			break;
+		}
+		threads.push_back(thread);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	SDL_LockMutex(mutex);
+	quit = true;
+	SDL_CondBroadcast(work_cond);
+	SDL_UnlockMutex(mutex);
+	for(size_t i=0;i<threads.size();i++) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+	SDL_DestroyCond(done_cond);
+	SDL_DestroyCond(work_cond);
+	SDL_DestroyMutex(mutex);
+}
+
+int WorkerPool::workerThread(void *pool_ptr) {
+	WorkerPool *pool = static_cast<WorkerPool *>(pool_ptr);
+	int last_run_id = 0;
+	SDL_LockMutex(pool->mutex);
+	for(;;) {
+		while( !pool->quit && pool->run_id == last_run_id ) {
+			SDL_CondWait(pool->work_cond, pool->mutex);
+		}
+		if( pool->quit )
+			break;
+		last_run_id = pool->run_id;
+		pool->work();
+	}
+	SDL_UnlockMutex(pool->mutex);
+	return 0;
+}
+
+/* Takes indices and runs the task on them until there are none left. Must be called with the mutex locked.
+ */
+void WorkerPool::work() {
+	while( next_index < n_indices ) {
+		int index = next_index++;
+		SDL_UnlockMutex(mutex);
+		task(data, index);
+		SDL_LockMutex(mutex);
+		n_done++;
+		if( n_done == n_indices ) {
+			SDL_CondSignal(done_cond);
+		}
+	}
+}
+
+void WorkerPool::run(Task task, void *data, int n_indices) {
+	if( threads.size() == 0 || n_indices <= 1 ) {
+		for(int i=0;i<n_indices;i++) {
+			task(data, i);
+		}
+		return;
+	}
+	SDL_LockMutex(mutex);
+	this->task = task;
+	this->data = data;
+	this->n_indices = n_indices;
+	this->next_index = 0;
+	this->n_done = 0;
+	this->run_id++;
+	SDL_CondBroadcast(work_cond);
+	this->work();
+	while( n_done < n_indices ) {
+		SDL_CondWait(done_cond, mutex);
+	}
+	SDL_UnlockMutex(mutex);
+}
+
+Profiler::Profiler() : samples(NULL), frame(0) {
+	LOG("Profiler::Profiler()\n");
+	samples = new Sample[n_samples_c];
+#if SDL_MAJOR_VERSION == 1
+	mutex = SDL_CreateMutex();
+	n_samples_added = 0;
+	for(int i=0;i<n_samples_c;i++) {
+		samples[i].sequence = 0;
+	}
+#else
+	SDL_AtomicSet(&n_samples_added, 0);
+	for(int i=0;i<n_samples_c;i++) {
+		SDL_AtomicSet(&samples[i].sequence, 0);
+	}
+	start_counter = SDL_GetPerformanceCounter();
+#endif
+}
+
+Profiler::~Profiler() {
+#if SDL_MAJOR_VERSION == 1
+	SDL_DestroyMutex(mutex);
+#endif
+	delete [] samples;
+}
+
+const char *Profiler::getPhaseName(ProfilePhase phase) {
+	switch( phase ) {
+	case PROFILE_INPUT:
+		return "input";
+	case PROFILE_AI:
+		return "ai";
+	case PROFILE_GAMESTATE_UPDATE:
+		return "update";
+	case PROFILE_SECTOR_UPDATE:
+		return "sectors";
+	case PROFILE_DRAW:
+		return "draw";
+	case PROFILE_PANEL_DRAW:
+		return "panel";
+	case PROFILE_PRESENT:
+		return "present";
+	default:
+		break;
+	}
+	ASSERT(false);
+	return "";
+}
+
+/* Returns the time in microseconds since the profiler was created.
+ */
+Uint64 Profiler::getTime() const {
+#if SDL_MAJOR_VERSION == 1
+	return 1000 * (Uint64)SDL_GetTicks();
+#else
+	return ( 1000000 * (SDL_GetPerformanceCounter() - start_counter) ) / SDL_GetPerformanceFrequency();
+#endif
+}
+
+void Profiler::addSample(ProfilePhase phase, Uint64 start_time, Uint64 end_time) {
+#if SDL_MAJOR_VERSION == 1
+	SDL_LockMutex(mutex);
+	int index = n_samples_added++;
+#else
+	int index = SDL_AtomicAdd(&n_samples_added, 1);
+#endif
+	Sample *sample = &samples[index & (n_samples_c-1)];
+#if SDL_MAJOR_VERSION != 1
+	// mark as being written, in case a reader gets to it before we're done
+	SDL_AtomicSet(&sample->sequence, 0);
+#endif
+	sample->phase = phase;
+	sample->frame = frame;
+	sample->thread_id = (unsigned long)SDL_ThreadID();
+	sample->start_time = start_time;
+	sample->duration = end_time - start_time;
+#if SDL_MAJOR_VERSION == 1
+	sample->sequence = index+1;
+	SDL_UnlockMutex(mutex);
+#else
+	SDL_AtomicSet(&sample->sequence, index+1);
+#endif
+}
+
+/* Copies the index-th sample added, returning false if it has since been overwritten, or is still being
+ * written.
+ */
+bool Profiler::readSample(Sample *sample, int index) const {
+	Sample *slot = &samples[index & (n_samples_c-1)];
+#if SDL_MAJOR_VERSION == 1
+	SDL_LockMutex(mutex);
+	*sample = *slot;
+	SDL_UnlockMutex(mutex);
+	return sample->sequence == index+1;
+#else
+	if( SDL_AtomicGet(&slot->sequence) != index+1 )
+		return false;
+	sample->phase = slot->phase;
+	sample->frame = slot->frame;
+	sample->thread_id = slot->thread_id;
+	sample->start_time = slot->start_time;
+	sample->duration = slot->duration;
+	// if the sequence has changed, the slot was overwritten while we were copying it
+	return SDL_AtomicGet(&slot->sequence) == index+1;
+#endif
+}
+
+/* Returns the mean and maximum time per frame in milliseconds spent in each phase, over the last n_frames
+ * completed frames. Sector updates are summed over all threads.
+ */
+void Profiler::getPhaseTimes(float mean_ms[PROFILE_N_PHASES], float max_ms[PROFILE_N_PHASES], int n_frames) const {
+	ASSERT( n_frames > 0 && n_frames <= n_overlay_frames_c );
+	Uint64 frame_times[n_overlay_frames_c][PROFILE_N_PHASES];
+	for(int i=0;i<n_frames;i++) {
+		for(int j=0;j<PROFILE_N_PHASES;j++) {
+			frame_times[i][j] = 0;
+		}
+	}
+#if SDL_MAJOR_VERSION == 1
+	SDL_LockMutex(mutex);
+	int n_added = n_samples_added;
+	SDL_UnlockMutex(mutex);
+#else
+	int n_added = SDL_AtomicGet(const_cast<SDL_atomic_t *>(&n_samples_added));
+#endif
+	int first = n_added > n_samples_c ? n_added - n_samples_c : 0;
+	for(int i=first;i<n_added;i++) {
+		Sample sample;
+		if( !readSample(&sample, i) )
+			continue;
+		int age = frame - 1 - sample.frame;
+		if( age >= 0 && age < n_frames ) {
+			frame_times[age][sample.phase] += sample.duration;
+		}
+	}
+	for(int j=0;j<PROFILE_N_PHASES;j++) {
+		Uint64 total = 0, max_time = 0;
+		for(int i=0;i<n_frames;i++) {
+			total += frame_times[i][j];
+			max_time = std::max(max_time, frame_times[i][j]);
+		}
+		mean_ms[j] = ((float)total) / (1000.0f * n_frames);
+		max_ms[j] = ((float)max_time) / 1000.0f;
+	}
+}
+
+/* Writes the samples in the buffer in Chrome's trace event format, for viewing in chrome://tracing.
+ */
+bool Profiler::writeTrace(const char *filename) const {
+	LOG("Profiler::writeTrace(%s)\n", filename);
+	FILE *file = fopen(filename, "w");
+	if( file == NULL ) {
+		LOG("failed to open trace file\n");
+		return false;
+	}
+#if SDL_MAJOR_VERSION == 1
+	SDL_LockMutex(mutex);
+	int n_added = n_samples_added;
+	SDL_UnlockMutex(mutex);
+#else
+	int n_added = SDL_AtomicGet(const_cast<SDL_atomic_t *>(&n_samples_added));
+#endif
+	int first = n_added > n_samples_c ? n_added - n_samples_c : 0;
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	bool done_first = false;
+	for(int i=first;i<n_added;i++) {
+		Sample sample;
+		if( !readSample(&sample, i) )
+			continue;
+		fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.0f,\"dur\":%.0f,\"args\":{\"frame\":%d}}", done_first ? "," : "", getPhaseName(sample.phase), sample.thread_id, (double)sample.start_time, (double)sample.duration, sample.frame);
+		done_first = true;
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
+
+static unsigned int splitmix32(unsigned int *x) {
+	unsigned int z = (*x += 0x9e3779b9);
+	z = (z ^ (z >> 16)) * 0x85ebca6b;
+	z = (z ^ (z >> 13)) * 0xc2b2ae35;
+	return z ^ (z >> 16);
+}
+
+void Random::seed(unsigned int seed) {
+	// expand the seed with splitmix, as xoshiro mustn't have an all zero state
+	for(int i=0;i<4;i++) {
+		state[i] = splitmix32(&seed);
+	}
+}
+
+static inline unsigned int rotl(unsigned int x, int k) {
+	return (x << k) | (x >> (32 - k));
+}
+
+unsigned int Random::next() {
+	unsigned int result = rotl(state[1] * 5, 7) * 9;
+	unsigned int t = state[1] << 9;
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = rotl(state[3], 11);
+	return result;
+}
+
 int n_digits(int number) {
 	int num = 0;
 	if( number < 0 ) {
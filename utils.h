@@ -9,6 +9,12 @@
 
 const bool LOGGING = true; // enable logging even for release builds, for now
 
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
 #ifndef LOG
 #define LOG if( !LOGGING ) ((void)0); else log
 #endif
@@ -101,7 +107,135 @@ public:
 	}
 };
 
+/* Seedable random number generator (xoshiro128**), so that games can be reproduced from a seed, independently of
+ * the C library's rand().
+ */
+class Random {
+	unsigned int state[4];
+public:
+	Random() {
+		seed(0);
+	}
+	void seed(unsigned int seed);
+	unsigned int next();
+	int rand() {
+		// same range as the C library's rand(), so that results can be compared with poisson()
+		return (int)(next() % ((unsigned int)RAND_MAX + 1));
+	}
+};
+
+/* Pool of worker threads, for running a task over a range of indices in parallel. The calling thread also
+ * works on the task, and run() only returns once every index is done. With no worker threads, the indices
+ * are simply run in order on the calling thread.
+ */
+class WorkerPool {
+public:
+	typedef void (*Task)(void *data, int index);
+private:
+	std::vector<SDL_Thread *> threads;
+	SDL_mutex *mutex;
+	SDL_cond *work_cond; // signalled when there's new work, or on quitting
+	SDL_cond *done_cond; // signalled when the last index is done
+	Task task;
+	void *data;
+	int n_indices;
+	int next_index;
+	int n_done;
+	int run_id; // incremented for each call to run(), so workers can tell when there's new work
+	bool quit;
+
+	static int workerThread(void *pool);
+	void work();
+public:
+	WorkerPool(int n_threads);
+	~WorkerPool();
+
+	int getNThreads() const {
+		return (int)threads.size();
+	}
+	void run(Task task, void *data, int n_indices);
+};
+
+enum ProfilePhase {
+	PROFILE_INPUT = 0,
+	PROFILE_AI,
+	PROFILE_GAMESTATE_UPDATE,
+	PROFILE_SECTOR_UPDATE,
+	PROFILE_DRAW,
+	PROFILE_PANEL_DRAW,
+	PROFILE_PRESENT,
+	PROFILE_N_PHASES
+};
+
+/* Records how long each phase of a frame takes. Samples are added to a ring buffer, which any thread may
+ * do without locking; once it's full, the oldest samples are overwritten.
+ */
+class Profiler {
+public:
+	class Sample {
+	public:
+#if SDL_MAJOR_VERSION == 1
+		int sequence;
+#else
+		SDL_atomic_t sequence; // number of the sample plus one once written, or 0 while being written
+#endif
+		ProfilePhase phase;
+		int frame;
+		unsigned long thread_id;
+		Uint64 start_time; // microseconds since the profiler was created
+		Uint64 duration;
+	};
+	static const int n_samples_c = 8192; // must be a power of 2
+	static const int n_overlay_frames_c = 60;
+private:
+	Sample *samples;
+#if SDL_MAJOR_VERSION == 1
+	SDL_mutex *mutex; // SDL 1 doesn't have atomics
+	int n_samples_added;
+#else
+	SDL_atomic_t n_samples_added;
+	Uint64 start_counter;
+#endif
+	int frame;
+
+	bool readSample(Sample *sample, int index) const;
+public:
+	Profiler();
+	~Profiler();
+
+	static const char *getPhaseName(ProfilePhase phase);
+	Uint64 getTime() const;
+	void beginFrame() {
+		this->frame++;
+	}
+	int getFrame() const {
+		return this->frame;
+	}
+	void addSample(ProfilePhase phase, Uint64 start_time, Uint64 end_time);
+	void getPhaseTimes(float mean_ms[PROFILE_N_PHASES], float max_ms[PROFILE_N_PHASES], int n_frames) const;
+	bool writeTrace(const char *filename) const;
+};
+
+/* Times the enclosing scope as a sample of the given phase. Does nothing if profiler is NULL.
+ */
+class ProfileScope {
+	Profiler *profiler;
+	ProfilePhase phase;
+	Uint64 start_time;
+public:
+	ProfileScope(Profiler *profiler, ProfilePhase phase) : profiler(profiler), phase(phase), start_time(0) {
+		if( profiler != NULL )
+			start_time = profiler->getTime();
+	}
+	~ProfileScope() {
+		if( profiler != NULL )
+			profiler->addSample(phase, start_time, profiler->getTime());
+	}
+};
+
+int poissonExact(int mean_ticks_per_event,int time_interval);
 int poisson(int mean_ticks_per_event,int time_interval);
+int poissonEvents(int max_events,int mean_ticks_per_event,int time_interval,int random);
 
 int n_digits(int number);
 
@@ -109,6 +243,7 @@ void textLines(int *n_lines,int *max_wid,const char *text, int lower_w, int uppe
 
 float perlin_noise2(float vec[2]);
 
+#include <cstddef>
 #include <vector>
 using std::vector;
 
@@ -123,6 +258,84 @@ bool remove_vec(vector<T> *vec,const T& value) {
 	return false;
 }
 
+class PoolCounters {
+public:
+	int n_allocations; // total allocations made
+	int n_heap_allocations; // allocations that didn't fit in the pool, so came from the heap
+	int n_in_use; // blocks of the pool currently in use
+	int peak_in_use;
+
+	PoolCounters() : n_allocations(0), n_heap_allocations(0), n_in_use(0), peak_in_use(0) {
+	}
+};
+
+/* Fixed-capacity pool of memory for objects of class T, for classes that are created and destroyed often - a
+ * class uses one by overriding operator new and delete. Once the pool is full, memory comes from the heap
+ * instead, which the counters record. Each block remembers which pool it came from, so objects can be freed
+ * with release() without knowing their pool; the pool must outlive them. Not thread safe, so each pool should
+ * only be used from one thread.
+ */
+template<class T, int capacity_c>
+class Pool {
+	struct Block {
+		union {
+			Block *next; // when free
+			Pool *owner; // when in use, or NULL if from the heap
+		};
+		union {
+			char data[sizeof(T)];
+			double align_double;
+			void *align_ptr;
+		} object;
+	};
+	Block blocks[capacity_c];
+	Block *free_list;
+	PoolCounters counters;
+
+	Pool(const Pool &);
+	Pool &operator=(const Pool &);
+public:
+	Pool() : free_list(NULL) {
+		for(int i=capacity_c-1;i>=0;i--) {
+			blocks[i].next = free_list;
+			free_list = &blocks[i];
+		}
+	}
+
+	void *allocate() {
+		counters.n_allocations++;
+		Block *block = free_list;
+		if( block == NULL ) {
+			counters.n_heap_allocations++;
+			block = static_cast<Block *>(::operator new(sizeof(Block)));
+			block->owner = NULL;
+			return &block->object;
+		}
+		free_list = block->next;
+		block->owner = this;
+		counters.n_in_use++;
+		if( counters.n_in_use > counters.peak_in_use )
+			counters.peak_in_use = counters.n_in_use;
+		return &block->object;
+	}
+	static void release(void *ptr) {
+		if( ptr == NULL )
+			return;
+		Block *block = reinterpret_cast<Block *>(static_cast<char *>(ptr) - offsetof(Block, object));
+		Pool *owner = block->owner;
+		if( owner == NULL ) {
+			::operator delete(block);
+			return;
+		}
+		block->next = owner->free_list;
+		owner->free_list = block;
+		owner->counters.n_in_use--;
+	}
+	const PoolCounters &getCounters() const {
+		return counters;
+	}
+};
+
 #if defined(AROS) || defined(__MORPHOS__)
 
 void getAROSScreenSize(int *user_width, int *user_height);